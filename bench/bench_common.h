@@ -0,0 +1,165 @@
+#pragma once
+
+// Inputs shared by the benchmarks: an HTML corpus and SKU documents.
+// Both are read from disk when present and generated otherwise, so every
+// benchmark runs on a bare checkout but measures real data when given it.
+//   BENCH_CORPUS_DIR  *.html pages (default bench/corpus, filled by
+//                     scripts/fetch_corpus.sh)
+//   BENCH_SKUS        skus.jsonl from scripts/gen_data.sh (default
+//                     data/generated/skus.jsonl)
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "parser/parser.h"
+
+#ifndef BENCH_SOURCE_DIR
+#define BENCH_SOURCE_DIR "."
+#endif
+
+namespace crawler::bench {
+
+struct HtmlPage {
+    std::string url;
+    std::string html;
+};
+
+struct Sku {
+    std::string url;
+    std::string title;
+    std::string description;
+    std::unordered_map<std::string, std::string> metadata; // category, brand, price
+};
+
+inline std::string env_or(const char* name, const std::string& fallback) {
+    const char* value = std::getenv(name);
+    return value && *value ? value : fallback;
+}
+
+// A product listing page of the shape the crawler sees most: navigation,
+// a grid of linked products, boilerplate scripts and a footer
+inline std::string synthetic_page(std::mt19937& rng, int products) {
+    static const char* kWords[] = {"smartphone", "laptop", "tablet", "camera", "shirt", "jacket",
+                                   "lamp", "rug", "bike", "racket", "novel", "guide",
+                                   "puzzle", "cream", "perfume", "battery", "filter", "brake"};
+    auto word = [&]() { return kWords[rng() % std::size(kWords)]; };
+    std::ostringstream html;
+    html << "<!DOCTYPE html><html lang=\"en\"><head><meta charset=\"utf-8\">"
+         << "<title>" << word() << " " << word() << " deals</title>"
+         << "<meta name=\"description\" content=\"Shop " << word() << " and more\">"
+         << "<link rel=\"canonical\" href=\"https://shop.example.com/c/" << word() << "\">"
+         << "<script>window.dataLayer=window.dataLayer||[];function gtag(){dataLayer.push(arguments)}</script>"
+         << "<style>.grid{display:grid}.card{padding:8px}</style></head><body>"
+         << "<nav><ul>";
+    for (int i = 0; i < 20; i++) {
+        html << "<li><a href=\"/c/" << word() << "?ref=nav&amp;i=" << i << "\">" << word() << "</a></li>";
+    }
+    html << "</ul></nav><main><h1>" << word() << "</h1><div class=\"grid\">";
+    for (int i = 0; i < products; i++) {
+        html << "<div class=\"card\"><a href=\"/products/" << rng() % 1000000 << "#reviews\">"
+             << "<img src=\"/img/" << i << ".jpg\" alt=\"" << word() << "\"></a>"
+             << "<h2>" << word() << " " << word() << " " << word() << "</h2>"
+             << "<p>High quality " << word() << " with " << word() << " and " << word()
+             << ". Perfect for your " << word() << " needs.</p>"
+             << "<span class=\"price\">$" << rng() % 1000 << ".99</span></div>";
+    }
+    html << "</div></main><footer><p>&copy; Example Shop</p>"
+         << "<a href=\"https://twitter.com/example\">Twitter</a>"
+         << "<a href=\"mailto:help@example.com\">Contact</a></footer></body></html>";
+    return html.str();
+}
+
+inline std::vector<HtmlPage> load_corpus() {
+    std::vector<HtmlPage> pages;
+    std::filesystem::path dir = env_or("BENCH_CORPUS_DIR", BENCH_SOURCE_DIR "/bench/corpus");
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, error)) {
+        if (entry.path().extension() != ".html") continue;
+        std::ifstream in(entry.path(), std::ios::binary);
+        std::ostringstream html;
+        html << in.rdbuf();
+        pages.push_back({"https://" + entry.path().stem().string() + "/", html.str()});
+    }
+    std::sort(pages.begin(), pages.end(), [](const auto& a, const auto& b) { return a.url < b.url; });
+
+    if (pages.empty()) {
+        std::mt19937 rng(42);
+        for (int i = 0; i < 16; i++) {
+            pages.push_back({"https://shop.example.com/c/" + std::to_string(i), synthetic_page(rng, 10 + i * 10)});
+        }
+    }
+    return pages;
+}
+
+// Hands `fn` the first `count` SKUs of the generated data set, topped up
+// with SKUs drawn the way scripts/gen_data.sh draws them if the file is
+// short or absent; one at a time, so 10^6 of them need not fit in memory
+inline void for_each_sku(size_t count, const std::function<void(const Sku&)>& fn) {
+    size_t seen = 0;
+    Sku sku;
+    std::ifstream in(env_or("BENCH_SKUS", "data/generated/skus.jsonl"));
+    std::string line;
+    while (seen < count && std::getline(in, line)) {
+        auto json = nlohmann::json::parse(line, nullptr, false);
+        if (json.is_discarded()) continue;
+        sku.url = json.value("url", "");
+        sku.title = json.value("title", "");
+        sku.description = json.value("description", "");
+        sku.metadata["category"] = json.value("category", "");
+        sku.metadata["brand"] = json.value("brand", "");
+        sku.metadata["price"] = std::to_string(json.value("price", 0.0));
+        fn(sku);
+        seen++;
+    }
+
+    static const std::vector<std::pair<std::string, std::vector<std::string>>> kCategories = {
+        {"Electronics", {"smartphone", "laptop", "tablet", "headphones", "camera", "speaker"}},
+        {"Clothing", {"shirt", "pants", "jacket", "shoes", "hat", "dress"}},
+        {"Home", {"furniture", "lamp", "cushion", "curtain", "rug", "mirror"}},
+        {"Sports", {"bike", "ball", "racket", "dumbbell", "yoga", "running"}},
+        {"Books", {"novel", "textbook", "guide", "magazine", "comic", "dictionary"}},
+        {"Toys", {"doll", "car", "puzzle", "board", "action", "building"}},
+        {"Beauty", {"cream", "lipstick", "perfume", "shampoo", "brush", "mirror"}},
+        {"Automotive", {"tire", "battery", "oil", "filter", "brake", "light"}},
+    };
+    std::mt19937 rng(static_cast<unsigned>(seen) + 7);
+    for (; seen < count; seen++) {
+        const auto& [category, words] = kCategories[rng() % kCategories.size()];
+        sku.title.clear();
+        for (int i = 0; i < 3; i++) sku.title += words[rng() % words.size()] + " ";
+        sku.title += static_cast<char>('a' + rng() % 26);
+        sku.title += ' ';
+        sku.title += static_cast<char>('a' + rng() % 26);
+        sku.url = "https://example.com/products/" + std::to_string(seen + 1);
+        sku.description = "High quality " + sku.title + " in " + category + " category. Perfect for your needs.";
+        sku.metadata["category"] = category;
+        sku.metadata["brand"] = std::string("Brand") + static_cast<char>('A' + rng() % 8);
+        sku.metadata["price"] = std::to_string(9.99 + (rng() % 99000) / 100.0);
+        fn(sku);
+    }
+}
+
+inline std::vector<Sku> load_skus(size_t count) {
+    std::vector<Sku> skus;
+    skus.reserve(count);
+    for_each_sku(count, [&skus](const Sku& sku) { skus.push_back(sku); });
+    return skus;
+}
+
+inline void make_document(const Sku& sku, ParsedDocument& doc) {
+    doc.clear();
+    doc.url = sku.url;
+    doc.title = sku.title;
+    doc.text_content = sku.title + " " + sku.description;
+    Parser::tokenize_document(doc);
+}
+
+} // namespace crawler::bench
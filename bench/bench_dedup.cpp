@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench_common.h"
+#include "dedup/dedup.h"
+
+using namespace crawler;
+
+namespace {
+
+// Arg 0 is the in-process fallback, 1 Redis at BENCH_REDIS_HOST:BENCH_REDIS_PORT
+// (localhost:6379), skipped when it cannot be reached
+std::unique_ptr<Deduplicator> make_dedup(benchmark::State& state) {
+    auto dedup = std::make_unique<Deduplicator>();
+    if (state.range(0) == 0) {
+        dedup->enable_local_fallback(true);
+        state.SetLabel("local");
+        return dedup;
+    }
+    state.SetLabel("redis");
+    std::string host = bench::env_or("BENCH_REDIS_HOST", "localhost");
+    int port = std::stoi(bench::env_or("BENCH_REDIS_PORT", "6379"));
+    if (!dedup->init_redis(host, port)) {
+        state.SkipWithError("Redis not reachable");
+        return nullptr;
+    }
+    return dedup;
+}
+
+std::vector<std::string> make_urls(size_t count, uint64_t seed) {
+    std::vector<std::string> urls;
+    urls.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        urls.push_back("https://bench" + std::to_string(seed) + ".example.com/p/" + std::to_string(i));
+    }
+    return urls;
+}
+
+// Discovery: a batch of outlinks, all unseen, checked and marked in one go
+void BM_FilterUnseenNew(benchmark::State& state) {
+    auto dedup = make_dedup(state);
+    if (!dedup) return;
+    size_t batch = static_cast<size_t>(state.range(1));
+    uint64_t round = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto urls = make_urls(batch, round++);
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(dedup->filter_unseen(urls));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch));
+}
+BENCHMARK(BM_FilterUnseenNew)->ArgsProduct({{0, 1}, {1, 64}});
+
+// Rediscovery: the same batch again, every URL already seen
+void BM_FilterUnseenSeen(benchmark::State& state) {
+    auto dedup = make_dedup(state);
+    if (!dedup) return;
+    auto urls = make_urls(static_cast<size_t>(state.range(1)), 1u << 30);
+    dedup->filter_unseen(urls);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dedup->filter_unseen(urls));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_FilterUnseenSeen)->ArgsProduct({{0, 1}, {1, 64}});
+
+// Index workers: claim a page body's hash, a new one each time
+void BM_CheckAndMarkContent(benchmark::State& state) {
+    auto dedup = make_dedup(state);
+    if (!dedup) return;
+    uint64_t next = 1;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dedup->check_and_mark_content(std::to_string(next++), "doc"));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CheckAndMarkContent)->Arg(0)->Arg(1);
+
+} // namespace
+
+BENCHMARK_MAIN();
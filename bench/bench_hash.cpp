@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "bench_common.h"
+#include "utils/hash_utils.h"
+
+using namespace crawler;
+
+namespace {
+
+std::string make_data(size_t size) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; i++) data[i] = static_cast<char>('a' + (i * 7919) % 26);
+    return data;
+}
+
+void BM_Xxhash(benchmark::State& state) {
+    std::string data = make_data(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HashUtils::xxhash(data));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Xxhash)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+void BM_Sha256(benchmark::State& state) {
+    std::string data = make_data(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HashUtils::sha256(data));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Sha256)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+// Page bodies from the corpus, as hashed for content dedup
+void BM_HashContent(benchmark::State& state) {
+    auto pages = bench::load_corpus();
+    int64_t bytes = 0;
+    for (const auto& page : pages) bytes += static_cast<int64_t>(page.html.size());
+    for (auto _ : state) {
+        for (const auto& page : pages) {
+            benchmark::DoNotOptimize(HashUtils::hash_content(page.html));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_HashContent);
+
+void BM_HashUrl(benchmark::State& state) {
+    std::vector<std::string> urls;
+    for (int i = 0; i < 1024; i++) {
+        urls.push_back("https://example.com/products/" + std::to_string(i * 7919) + "?ref=grid&page=" +
+                       std::to_string(i % 16));
+    }
+    for (auto _ : state) {
+        for (const auto& url : urls) {
+            benchmark::DoNotOptimize(HashUtils::hash_url(url));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(urls.size()));
+}
+BENCHMARK(BM_HashUrl);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "bench_common.h"
+#include "indexer/indexer.h"
+
+using namespace crawler;
+
+namespace {
+
+std::string index_dir(const std::string& name) {
+    auto dir = std::filesystem::temp_directory_path() /
+               ("bench_indexer_" + std::to_string(getpid()) + "_" + name);
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+// Prebuilt documents, so indexing is timed without tokenizing
+struct Corpus {
+    std::vector<bench::Sku> skus;
+    std::vector<ParsedDocument> docs;
+};
+
+const Corpus& corpus(size_t count) {
+    static std::map<size_t, std::unique_ptr<Corpus>> corpora;
+    auto& corpus = corpora[count];
+    if (!corpus) {
+        corpus = std::make_unique<Corpus>();
+        corpus->skus = bench::load_skus(count);
+        corpus->docs.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            bench::make_document(corpus->skus[i], corpus->docs[i]);
+        }
+    }
+    return *corpus;
+}
+
+// Index throughput, segment flushes and background merges included; the
+// documents are recycled, each indexed again under a new doc_id
+void BM_IndexDocument(benchmark::State& state) {
+    const Corpus& docs = corpus(20000);
+    std::string dir = index_dir("write");
+    auto indexer = std::make_unique<Indexer>(dir);
+    size_t next = 0;
+    for (auto _ : state) {
+        size_t i = next++ % docs.docs.size();
+        benchmark::DoNotOptimize(indexer->index_document(docs.docs[i], docs.skus[i].metadata));
+    }
+    state.SetItemsProcessed(state.iterations());
+    indexer.reset();
+    std::filesystem::remove_all(dir);
+}
+BENCHMARK(BM_IndexDocument)->UseRealTime();
+
+// One index per size, built on first use and shared by the search benchmarks
+Indexer& searchable_index(size_t count) {
+    static std::map<size_t, std::unique_ptr<Indexer>> indexes;
+    auto& indexer = indexes[count];
+    if (!indexer) {
+        indexer = std::make_unique<Indexer>(index_dir(std::to_string(count)));
+        ParsedDocument doc;
+        bench::for_each_sku(count, [&](const bench::Sku& sku) {
+            bench::make_document(sku, doc);
+            indexer->index_document(doc, sku.metadata);
+        });
+        indexer->refresh();
+    }
+    return *indexer;
+}
+
+const std::vector<std::string> kQueries = {
+    "smartphone", "laptop camera", "shirt", "furniture lamp", "bike",
+    "novel guide", "doll", "cream perfume", "tire", "\"high quality\" battery",
+};
+
+// Latency per query, cycling through terms of different selectivity
+void BM_Search(benchmark::State& state) {
+    Indexer& indexer = searchable_index(static_cast<size_t>(state.range(0)));
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(indexer.search(kQueries[next++ % kQueries.size()], 10));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Search)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+void BM_SearchFiltered(benchmark::State& state) {
+    Indexer& indexer = searchable_index(static_cast<size_t>(state.range(0)));
+    SearchFilter filter;
+    filter.category = "Electronics";
+    filter.max_price = 500;
+    Facets facets;
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(indexer.search(kQueries[next++ % kQueries.size()], 10, filter, &facets));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SearchFiltered)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+#include <string_view>
+#include <vector>
+#include "bench_common.h"
+#include "parser/parser.h"
+#include "parser/tokenizer.h"
+
+using namespace crawler;
+
+namespace {
+
+const std::vector<bench::HtmlPage>& corpus() {
+    static const auto pages = bench::load_corpus();
+    return pages;
+}
+
+int64_t corpus_bytes() {
+    int64_t bytes = 0;
+    for (const auto& page : corpus()) bytes += static_cast<int64_t>(page.html.size());
+    return bytes;
+}
+
+// Whole corpus per iteration: HTML parse, text extraction, tokenizing
+void BM_Parse(benchmark::State& state) {
+    Parser parser;
+    for (auto _ : state) {
+        for (const auto& page : corpus()) {
+            ParsedDocument doc = parser.parse(page.url, page.html);
+            benchmark::DoNotOptimize(doc.tokens.data());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * corpus_bytes());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(corpus().size()));
+}
+BENCHMARK(BM_Parse);
+
+// What parse workers do: one document reused across pages
+void BM_ParseInto(benchmark::State& state) {
+    Parser parser;
+    ParsedDocument doc;
+    for (auto _ : state) {
+        for (const auto& page : corpus()) {
+            parser.parse_into(page.url, page.html, doc);
+            benchmark::DoNotOptimize(doc.tokens.data());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * corpus_bytes());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(corpus().size()));
+}
+BENCHMARK(BM_ParseInto);
+
+// Tokenizer alone on the corpus' extracted text; arg 0 is the dispatched
+// (SIMD where available) implementation, 1 the scalar one
+void BM_Tokenize(benchmark::State& state) {
+    Parser parser;
+    std::vector<std::string> texts;
+    int64_t bytes = 0;
+    for (const auto& page : corpus()) {
+        texts.push_back(parser.parse(page.url, page.html).text_content);
+        bytes += static_cast<int64_t>(texts.back().size());
+    }
+    bool scalar = state.range(0) == 1;
+    state.SetLabel(scalar ? "scalar" : Tokenizer::implementation());
+
+    std::vector<char> buffer;
+    std::vector<std::string_view> tokens;
+    for (auto _ : state) {
+        for (const auto& text : texts) {
+            // The tokenizer lowercases in place
+            buffer.assign(text.begin(), text.end());
+            tokens.clear();
+            if (scalar) {
+                Tokenizer::tokenize_scalar(buffer.data(), buffer.size(), tokens);
+            } else {
+                Tokenizer::tokenize(buffer.data(), buffer.size(), tokens);
+            }
+            benchmark::DoNotOptimize(tokens.data());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_Tokenize)->Arg(0)->Arg(1);
+
+} // namespace
+
+BENCHMARK_MAIN();
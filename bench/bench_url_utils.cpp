@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "bench_common.h"
+#include "parser/link_extractor.h"
+#include "utils/url_utils.h"
+
+using namespace crawler;
+
+namespace {
+
+// Absolute outlinks and the raw hrefs they came from, as found in the corpus
+struct Links {
+    std::vector<std::string> bases;
+    std::vector<std::string> hrefs;
+    std::vector<std::string> absolute;
+};
+
+const Links& links() {
+    static const Links links = []() {
+        Links result;
+        for (const auto& page : bench::load_corpus()) {
+            StreamingLinkExtractor extractor(page.url);
+            std::vector<std::string> found;
+            extractor.feed(page.html, found);
+            result.absolute.insert(result.absolute.end(), found.begin(), found.end());
+            // hrefs as written, relative or not, resolved against the page
+            size_t at = 0;
+            while ((at = page.html.find("href=\"", at)) != std::string::npos) {
+                at += 6;
+                size_t end = page.html.find('"', at);
+                if (end == std::string::npos) break;
+                result.bases.push_back(page.url);
+                result.hrefs.push_back(page.html.substr(at, end - at));
+                at = end;
+            }
+        }
+        if (result.absolute.empty()) {
+            result.absolute = {"https://Example.com:443/a/b/../c?z=1&a=2#top", "http://example.org/x?utm_source=y"};
+        }
+        return result;
+    }();
+    return links;
+}
+
+void BM_Canonicalize(benchmark::State& state) {
+    const auto& urls = links().absolute;
+    for (auto _ : state) {
+        for (const auto& url : urls) {
+            benchmark::DoNotOptimize(UrlUtils::canonicalize(url));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(urls.size()));
+}
+BENCHMARK(BM_Canonicalize);
+
+// Canonical form and components into a reused buffer, as the scheduler and
+// dedup call it
+void BM_Parse(benchmark::State& state) {
+    const auto& urls = links().absolute;
+    std::string buffer;
+    ParsedUrl parsed;
+    for (auto _ : state) {
+        for (const auto& url : urls) {
+            benchmark::DoNotOptimize(UrlUtils::parse(url, buffer, parsed));
+            benchmark::DoNotOptimize(parsed.host_id);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(urls.size()));
+}
+BENCHMARK(BM_Parse);
+
+void BM_Normalize(benchmark::State& state) {
+    const auto& urls = links().absolute;
+    for (auto _ : state) {
+        for (const auto& url : urls) {
+            benchmark::DoNotOptimize(UrlUtils::normalize(url));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(urls.size()));
+}
+BENCHMARK(BM_Normalize);
+
+void BM_Resolve(benchmark::State& state) {
+    const auto& l = links();
+    for (auto _ : state) {
+        for (size_t i = 0; i < l.hrefs.size(); i++) {
+            benchmark::DoNotOptimize(UrlUtils::resolve(l.bases[i], l.hrefs[i]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(l.hrefs.size()));
+}
+BENCHMARK(BM_Resolve);
+
+void BM_ExtractDomain(benchmark::State& state) {
+    const auto& urls = links().absolute;
+    for (auto _ : state) {
+        for (const auto& url : urls) {
+            benchmark::DoNotOptimize(UrlUtils::extract_domain(url));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(urls.size()));
+}
+BENCHMARK(BM_ExtractDomain);
+
+} // namespace
+
+BENCHMARK_MAIN();
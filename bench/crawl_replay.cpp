@@ -0,0 +1,197 @@
+// End-to-end crawl throughput without the network: the full
+// scheduler -> fetch -> parse -> dedup/index -> storage pipeline runs
+// against a ReplayFetcher, then pages/s, bytes/s and how busy each stage
+// was are printed as JSON.
+//
+//   crawl_replay [--config=configs/replay.yaml] [--corpus=PATH]
+//                [--hosts=100] [--pages-per-host=1000] [--links=20]
+//                [--cross-host=0.2] [--latency-ms=50] [--latency-p99-ms=500]
+//                [--page-kb=30] [--page-p99-kb=200] [--bandwidth-mbps=100]
+//                [--error-rate=0.01] [--timeout-rate=0.001] [--seed=1]
+//                [--max-pages=20000] [--duration-s=60] [--out=FILE]
+//
+// storage.data_dir and storage.index_dir of the config must start empty,
+// so every run crawls the same pages from scratch.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "utils/config.h"
+#include "scheduler/scheduler.h"
+#include "fetcher/fetcher.h"
+#include "fetcher/replay_fetcher.h"
+#include "parser/parser.h"
+#include "dedup/dedup.h"
+#include "indexer/indexer.h"
+#include "storage/storage.h"
+#include "pipeline/pipeline.h"
+#include "api/json_writer.h"
+#include "observability/logger.h"
+#include "observability/metrics.h"
+#include "observability/trace.h"
+
+using namespace crawler;
+
+namespace {
+
+std::unordered_map<std::string, std::string> parse_args(int argc, char* argv[]) {
+    std::unordered_map<std::string, std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) continue;
+        size_t eq = arg.find('=');
+        args[arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2)] =
+            eq == std::string::npos ? "1" : arg.substr(eq + 1);
+    }
+    return args;
+}
+
+double stage_ms(TraceStage stage) {
+    return Metrics::instance().histogram(std::string("pipeline_stage_") + trace_stage_name(stage) + "_ms")
+        .snapshot().sum;
+}
+
+// Share of a pool's capacity spent working over the run
+void write_utilisation(JsonWriter& json, const char* name, double busy_ms, size_t workers, double wall_ms) {
+    json.key(name);
+    json.begin_object();
+    json.key("workers");
+    json.value(static_cast<uint64_t>(workers));
+    json.key("busy_ms");
+    json.value(busy_ms);
+    json.key("utilisation");
+    json.value(workers && wall_ms > 0 ? busy_ms / (static_cast<double>(workers) * wall_ms) : 0.0);
+    json.end_object();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto args = parse_args(argc, argv);
+    auto arg = [&args](const char* name, const std::string& fallback) {
+        auto it = args.find(name);
+        return it != args.end() ? it->second : fallback;
+    };
+    auto number = [&arg](const char* name, double fallback) {
+        return std::strtod(arg(name, std::to_string(fallback)).c_str(), nullptr);
+    };
+
+    auto& config = Config::instance();
+    std::string config_path = arg("config", "configs/replay.yaml");
+    if (!config.load(config_path)) {
+        std::cerr << "Failed to load config from " << config_path << std::endl;
+        return 1;
+    }
+    Logger::instance().init(config.logging_level(), config.logging_format(), "stdout");
+
+    ReplayOptions options;
+    options.corpus = arg("corpus", "");
+    options.hosts = static_cast<size_t>(number("hosts", static_cast<double>(options.hosts)));
+    options.pages_per_host = static_cast<size_t>(number("pages-per-host", static_cast<double>(options.pages_per_host)));
+    options.links_per_page = static_cast<int>(number("links", options.links_per_page));
+    options.cross_host_links = number("cross-host", options.cross_host_links);
+    options.latency_median_ms = number("latency-ms", options.latency_median_ms);
+    options.latency_p99_ms = number("latency-p99-ms", options.latency_p99_ms);
+    options.page_kb_median = number("page-kb", options.page_kb_median);
+    options.page_kb_p99 = number("page-p99-kb", options.page_kb_p99);
+    options.bandwidth_mbps = number("bandwidth-mbps", options.bandwidth_mbps);
+    options.error_rate = number("error-rate", options.error_rate);
+    options.timeout_rate = number("timeout-rate", options.timeout_rate);
+    options.seed = static_cast<uint64_t>(number("seed", static_cast<double>(options.seed)));
+    size_t max_pages = static_cast<size_t>(number("max-pages", 20000));
+    auto duration = std::chrono::duration<double>(number("duration-s", 60));
+
+    ReplayFetcher replay(options);
+    if (!replay.load()) {
+        return 1;
+    }
+
+    Scheduler scheduler;
+    Fetcher fetcher;
+    Parser parser;
+    Deduplicator dedup;
+    dedup.enable_local_fallback(true);
+    Storage storage(config.storage_data_dir());
+    Indexer indexer(config.storage_index_dir());
+    if (!storage.list_documents().empty() || indexer.total_documents() != 0) {
+        std::cerr << "Replay needs an empty " << config.storage_data_dir() << " and "
+                  << config.storage_index_dir() << std::endl;
+        return 1;
+    }
+
+    CrawlPipeline pipeline(scheduler, fetcher, parser, dedup, indexer, storage);
+    pipeline.set_async_fetcher(&replay);
+    scheduler.add_seed_urls(dedup.filter_unseen(replay.seed_urls()));
+
+    auto started = std::chrono::steady_clock::now();
+    pipeline.start();
+    while (!pipeline.idle() && replay.successful_fetches() < max_pages &&
+           std::chrono::steady_clock::now() - started < duration) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    pipeline.stop();
+    storage.flush();
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    double wall_s = wall_ms / 1000;
+
+    auto& metrics = Metrics::instance();
+    std::string body;
+    JsonWriter json(body);
+    json.begin_object();
+    json.key("wall_s");
+    json.value(wall_s);
+    json.key("pages");
+    json.value(static_cast<uint64_t>(replay.successful_fetches()));
+    json.key("pages_per_s");
+    json.value(static_cast<double>(replay.successful_fetches()) / wall_s);
+    json.key("bytes_per_s");
+    json.value(static_cast<double>(replay.bytes_served()) / wall_s);
+    json.key("fetches");
+    json.value(static_cast<uint64_t>(replay.total_fetches()));
+    json.key("failed_fetches");
+    json.value(static_cast<uint64_t>(replay.failed_fetches()));
+    json.key("indexed");
+    json.value(static_cast<uint64_t>(indexer.total_documents()));
+    json.key("content_duplicates");
+    json.value(metrics.get_counter("content_duplicates"));
+    json.key("near_duplicates");
+    json.value(metrics.get_counter("near_duplicates"));
+    json.key("dropped_pages");
+    json.value(static_cast<uint64_t>(pipeline.dropped_pages()));
+    json.key("hosts");
+    json.value(static_cast<uint64_t>(options.hosts));
+    json.key("corpus_pages");
+    json.value(static_cast<uint64_t>(replay.corpus_pages()));
+
+    // Busy time over capacity: fetch slots held, and each worker pool's
+    // time in its stage (queue waits excluded). A pool near 1 is the
+    // bottleneck; the queue waits in "stages" show where pages pile up.
+    json.key("utilisation");
+    json.begin_object();
+    write_utilisation(json, "fetch", replay.busy_ms(), replay.max_in_flight(), wall_ms);
+    write_utilisation(json, "parse", stage_ms(TraceStage::PARSE),
+                      static_cast<size_t>(config.pipeline_parse_workers()), wall_ms);
+    write_utilisation(json, "index", stage_ms(TraceStage::DEDUP) + stage_ms(TraceStage::INDEX),
+                      static_cast<size_t>(config.pipeline_index_workers()), wall_ms);
+    write_utilisation(json, "storage", stage_ms(TraceStage::STORAGE),
+                      static_cast<size_t>(config.pipeline_storage_workers()), wall_ms);
+    json.end_object();
+
+    Tracer::instance().write_json(json);
+    json.end_object();
+
+    std::cout << body << std::endl;
+    std::string out_path = arg("out", "");
+    if (!out_path.empty()) {
+        std::ofstream out(out_path, std::ios::trunc);
+        out << body << '\n';
+    }
+
+    Logger::instance().shutdown();
+    return 0;
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+# Download the HTML corpus used by the parser and URL benchmarks
+
+set -e
+
+CORPUS_DIR="${1:-./bench/corpus}"
+URL_LIST="${2:-$CORPUS_DIR/urls.txt}"
+
+mkdir -p "$CORPUS_DIR"
+
+n=0
+grep -v '^#' "$URL_LIST" | grep -v '^$' | while read -r url; do
+    n=$((n + 1))
+    host=$(echo "$url" | sed -E 's#^[a-z]+://([^/:]+).*#\1#')
+    out="$CORPUS_DIR/${host}_${n}.html"
+    if curl -sSL --compressed --max-time 30 -A "WebCrawler/1.0" -o "$out" "$url"; then
+        echo "Fetched $url ($(wc -c < "$out") bytes)"
+    else
+        echo "Failed to fetch $url" >&2
+        rm -f "$out"
+    fi
+done
+
+echo "Corpus in $CORPUS_DIR"
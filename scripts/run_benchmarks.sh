@@ -0,0 +1,34 @@
+#!/bin/bash
+# Run the microbenchmarks, one JSON result file per benchmark executable.
+# Compare two runs with google-benchmark's tools/compare.py.
+
+set -e
+
+BUILD_DIR="${1:-./build/release}"
+OUTPUT_DIR="${2:-./results/bench}"
+NUM_SKUS="${NUM_SKUS:-1000000}"
+
+mkdir -p "$OUTPUT_DIR"
+
+# Search benchmarks index up to 10^6 generated SKUs
+export BENCH_SKUS="${BENCH_SKUS:-./data/generated/skus.jsonl}"
+if [ ! -f "$BENCH_SKUS" ]; then
+    ./scripts/gen_data.sh "$(dirname "$BENCH_SKUS")" "$NUM_SKUS"
+fi
+
+for bench in bench_parser bench_url_utils bench_hash bench_dedup bench_indexer; do
+    echo "Running $bench..."
+    "$BUILD_DIR/bench/$bench" \
+        --benchmark_out="$OUTPUT_DIR/$bench.json" \
+        --benchmark_out_format=json \
+        --benchmark_counters_tabular=true \
+        "${@:3}"
+done
+
+# Offline end-to-end crawl; starts from an empty data directory so every
+# run fetches the same simulated pages
+echo "Running crawl_replay..."
+rm -rf ./data/replay
+"$BUILD_DIR/bench/crawl_replay" --config=configs/replay.yaml --out="$OUTPUT_DIR/crawl_replay.json" > /dev/null
+
+echo "Results in $OUTPUT_DIR"
@@ -1,136 +1,277 @@
 #include "api_server.h"
+#include "json_writer.h"
 #include "../observability/logger.h"
 #include "../observability/metrics.h"
+#include "../utils/config.h"
 #include <crow.h>
-#include <nlohmann/json.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
 
 namespace crawler {
 
+namespace {
+
+// Smaller bodies are not worth a deflate call
+constexpr size_t kGzipMinBytes = 1024;
+
+// Latency over ratio; JSON compresses well even at the fastest level
+constexpr int kGzipLevel = Z_BEST_SPEED;
+
+// Per-thread deflate state, reset rather than rebuilt for each response
+struct Deflater {
+    z_stream stream{};
+    bool ready = false;
+
+    ~Deflater() {
+        if (ready) deflateEnd(&stream);
+    }
+};
+
+// gzip `in` into `out`; false leaves the response uncompressed
+bool gzip(const std::string& in, std::string& out) {
+    thread_local Deflater deflater;
+    z_stream& stream = deflater.stream;
+    if (!deflater.ready) {
+        // 16 + window bits asks zlib for the gzip wrapper
+        if (deflateInit2(&stream, kGzipLevel, Z_DEFLATED, 16 + 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        deflater.ready = true;
+    } else if (deflateReset(&stream) != Z_OK) {
+        return false;
+    }
+
+    out.resize(deflateBound(&stream, in.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.avail_in = static_cast<uInt>(in.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) return false;
+    out.resize(stream.total_out);
+    return true;
+}
+
+bool accepts_gzip(const crow::request& req) {
+    return req.get_header_value("Accept-Encoding").find("gzip") != std::string::npos;
+}
+
+// A response from a handler's buffer, compressed if the client allows it
+crow::response make_response(const crow::request& req, const std::string& body, const char* content_type) {
+    thread_local std::string compressed;
+    crow::response res(200);
+    if (body.size() >= kGzipMinBytes && accepts_gzip(req) && gzip(body, compressed)) {
+        res.body.assign(compressed);
+        res.set_header("Content-Encoding", "gzip");
+    } else {
+        res.body.assign(body);
+    }
+    res.set_header("Content-Type", content_type);
+    res.set_header("Vary", "Accept-Encoding");
+    return res;
+}
+
+crow::response error_response(int code, const std::string& message) {
+    std::string body;
+    JsonWriter json(body);
+    json.begin_object();
+    json.key("error");
+    json.value(message);
+    json.end_object();
+    crow::response res(code, body);
+    res.set_header("Content-Type", "application/json");
+    return res;
+}
+
+// Query parameter parsers that leave `out` alone if absent or malformed
+void parse_param(const crow::request& req, const char* name, int& out) {
+    const char* text = req.url_params.get(name);
+    if (!text) return;
+    int value = 0;
+    const char* end = text + std::char_traits<char>::length(text);
+    auto result = std::from_chars(text, end, value);
+    if (result.ec == std::errc() && result.ptr == end) out = value;
+}
+
+void parse_param(const crow::request& req, const char* name, double& out) {
+    const char* text = req.url_params.get(name);
+    if (!text || !*text) return;
+    char* end = nullptr;
+    double value = std::strtod(text, &end);
+    if (*end == '\0') out = value;
+}
+
+void parse_param(const crow::request& req, const char* name, std::string& out) {
+    const char* text = req.url_params.get(name);
+    if (text) out = text;
+}
+
+} // namespace
+
 ApiServer::ApiServer() = default;
 
 ApiServer::~ApiServer() {
     stop();
+    delete static_cast<crow::SimpleApp*>(app_);
 }
 
 bool ApiServer::init(const std::string& host, int port, int threads) {
     host_ = host;
     port_ = port;
-    threads_ = threads;
+    threads_ = std::max(threads, 1);
+    max_results_ = Config::instance().api_max_results();
+    if (!app_) {
+        app_ = new crow::SimpleApp();
+    }
     return true;
 }
 
-void ApiServer::set_search_handler(std::function<std::string(const std::string&, int)> handler) {
-    search_handler_ = handler;
+void ApiServer::set_search_handler(SearchHandler handler) {
+    search_handler_ = std::move(handler);
 }
 
-void ApiServer::set_recommend_handler(std::function<std::string(const std::string&)> handler) {
-    recommend_handler_ = handler;
+void ApiServer::set_recommend_handler(RecommendHandler handler) {
+    recommend_handler_ = std::move(handler);
 }
 
 void ApiServer::set_metrics_handler(std::function<std::string()> handler) {
-    metrics_handler_ = handler;
+    metrics_handler_ = std::move(handler);
 }
 
-void ApiServer::setup_routes() {
-    // This will be called from start() to set up Crow routes
+void ApiServer::set_pipeline_debug_handler(DebugHandler handler) {
+    pipeline_debug_handler_ = std::move(handler);
 }
 
-void ApiServer::start() {
-    crow::SimpleApp app;
+void ApiServer::setup_routes() {
+    auto& app = *static_cast<crow::SimpleApp*>(app_);
     
     // Search endpoint
     CROW_ROUTE(app, "/search")
     .methods("GET"_method)
-    ([](const crow::request& req) {
-        auto& logger = Logger::instance();
-        auto& metrics = Metrics::instance();
+    ([this](const crow::request& req) {
+        static Counter& requests = Metrics::instance().counter("api_search_requests");
+        static Histogram& latency_ms = Metrics::instance().histogram("api_search_latency_ms");
         
-        std::string query = req.url_params.get("q") ? req.url_params.get("q") : "";
-        int topk = req.url_params.get("topk") ? std::stoi(req.url_params.get("topk")) : 10;
+        SearchRequest request;
+        parse_param(req, "q", request.query);
+        parse_param(req, "topk", request.topk);
+        parse_param(req, "category", request.filter.category);
+        parse_param(req, "brand", request.filter.brand);
+        parse_param(req, "min_price", request.filter.min_price);
+        parse_param(req, "max_price", request.filter.max_price);
+        const char* facets = req.url_params.get("facets");
+        request.facets = facets && std::string_view(facets) != "0" && std::string_view(facets) != "false";
         
-        if (query.empty()) {
-            crow::response res(400);
-            res.body = R"({"error": "Missing query parameter 'q'"})";
-            res.set_header("Content-Type", "application/json");
-            return res;
+        if (request.query.empty()) {
+            return error_response(400, "Missing query parameter 'q'");
         }
+        request.topk = std::clamp(request.topk, 1, max_results_);
         
-        metrics.increment_counter("api_search_requests");
+        requests.increment();
         auto start = std::chrono::steady_clock::now();
         
-        // TODO: Call actual search handler
-        nlohmann::json result;
-        result["query"] = query;
-        result["results"] = nlohmann::json::array();
-        result["total"] = 0;
+        thread_local std::string body;
+        body.clear();
+        if (search_handler_) {
+            search_handler_(request, body);
+        } else {
+            JsonWriter json(body);
+            json.begin_object();
+            json.key("query");
+            json.value(request.query);
+            json.key("results");
+            json.begin_array();
+            json.end_array();
+            json.key("total");
+            json.value(0);
+            json.end_object();
+        }
+        crow::response res = make_response(req, body, "application/json");
         
         auto end = std::chrono::steady_clock::now();
-        auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        metrics.record_histogram("api_search_latency_ms", latency);
-        
-        crow::response res(200);
-        res.body = result.dump();
-        res.set_header("Content-Type", "application/json");
+        latency_ms.record(std::chrono::duration<double, std::milli>(end - start).count());
         return res;
     });
     
     // Recommend endpoint
     CROW_ROUTE(app, "/recommend")
     .methods("GET"_method)
-    ([](const crow::request& req) {
-        auto& metrics = Metrics::instance();
-        
-        std::string sku = req.url_params.get("sku") ? req.url_params.get("sku") : "";
+    ([this](const crow::request& req) {
+        static Counter& requests = Metrics::instance().counter("api_recommend_requests");
         
+        std::string sku;
+        parse_param(req, "sku", sku);
         if (sku.empty()) {
-            crow::response res(400);
-            res.body = R"({"error": "Missing parameter 'sku'"})";
-            res.set_header("Content-Type", "application/json");
-            return res;
+            return error_response(400, "Missing parameter 'sku'");
         }
         
-        metrics.increment_counter("api_recommend_requests");
-        
-        // TODO: Call actual recommend handler
-        nlohmann::json result;
-        result["sku"] = sku;
-        result["recommendations"] = nlohmann::json::array();
+        requests.increment();
         
-        crow::response res(200);
-        res.body = result.dump();
-        res.set_header("Content-Type", "application/json");
-        return res;
+        thread_local std::string body;
+        body.clear();
+        if (recommend_handler_) {
+            recommend_handler_(sku, body);
+        } else {
+            JsonWriter json(body);
+            json.begin_object();
+            json.key("sku");
+            json.value(sku);
+            json.key("recommendations");
+            json.begin_array();
+            json.end_array();
+            json.end_object();
+        }
+        return make_response(req, body, "application/json");
     });
     
     // Metrics endpoint
     CROW_ROUTE(app, "/metrics")
     .methods("GET"_method)
-    ([]() {
-        auto& metrics = Metrics::instance();
-        crow::response res(200);
-        res.body = metrics.to_prometheus();
-        res.set_header("Content-Type", "text/plain");
-        return res;
+    ([this](const crow::request& req) {
+        std::string body = metrics_handler_ ? metrics_handler_() : Metrics::instance().to_prometheus();
+        return make_response(req, body, "text/plain");
+    });
+    
+    // Queue depths, per-stage latencies and slow crawl tasks
+    CROW_ROUTE(app, "/debug/pipeline")
+    .methods("GET"_method)
+    ([this](const crow::request& req) {
+        if (!pipeline_debug_handler_) {
+            return error_response(404, "Pipeline not running");
+        }
+        thread_local std::string body;
+        body.clear();
+        pipeline_debug_handler_(body);
+        return make_response(req, body, "application/json");
     });
     
     // Health check
     CROW_ROUTE(app, "/health")
     .methods("GET"_method)
     ([]() {
-        nlohmann::json result;
-        result["status"] = "healthy";
-        crow::response res(200);
-        res.body = result.dump();
+        crow::response res(200, R"({"status":"healthy"})");
         res.set_header("Content-Type", "application/json");
         return res;
     });
-    
-    app.port(port_).multithreaded().run();
+}
+
+void ApiServer::start() {
+    if (!app_) return;
+    auto& app = *static_cast<crow::SimpleApp*>(app_);
+    setup_routes();
     running_ = true;
+    Logger::instance().info("API server listening on " + host_ + ":" + std::to_string(port_) + " with " +
+                            std::to_string(threads_) + " threads");
+    app.bindaddr(host_).port(static_cast<uint16_t>(port_)).concurrency(static_cast<uint16_t>(threads_)).run();
+    running_ = false;
 }
 
 void ApiServer::stop() {
-    running_ = false;
+    if (app_ && running_) {
+        static_cast<crow::SimpleApp*>(app_)->stop();
+    }
 }
 
 } // namespace crawler
@@ -3,11 +3,29 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include "../indexer/indexer.h"
 
 namespace crawler {
 
+// Parameters of a /search request
+struct SearchRequest {
+    std::string query;
+    int topk = 10;
+    SearchFilter filter; // category, brand, min_price, max_price
+    bool facets = false;
+};
+
+// HTTP API over Crow, served by api.threads worker threads. Handlers
+// append their JSON response to `body`, a per-thread buffer the server
+// clears and reuses, so building a response does not allocate once the
+// buffer has grown (see JsonWriter). Responses are gzipped for clients
+// that accept it.
 class ApiServer {
 public:
+    using SearchHandler = std::function<void(const SearchRequest& request, std::string& body)>;
+    using RecommendHandler = std::function<void(const std::string& sku, std::string& body)>;
+    using DebugHandler = std::function<void(std::string& body)>;
+    
     ApiServer();
     ~ApiServer();
     
@@ -21,13 +39,16 @@ public:
     void stop();
     
     // Set search handler
-    void set_search_handler(std::function<std::string(const std::string& query, int topk)> handler);
+    void set_search_handler(SearchHandler handler);
     
     // Set recommend handler
-    void set_recommend_handler(std::function<std::string(const std::string& sku)> handler);
+    void set_recommend_handler(RecommendHandler handler);
     
     // Set metrics handler
     void set_metrics_handler(std::function<std::string()> handler);
+    
+    // Set /debug/pipeline handler
+    void set_pipeline_debug_handler(DebugHandler handler);
 
 private:
     void setup_routes();
@@ -35,13 +56,15 @@ private:
     std::string host_;
     int port_;
     int threads_;
+    int max_results_ = 1000;
     bool running_ = false;
     
-    std::function<std::string(const std::string&, int)> search_handler_;
-    std::function<std::string(const std::string&)> recommend_handler_;
+    SearchHandler search_handler_;
+    RecommendHandler recommend_handler_;
     std::function<std::string()> metrics_handler_;
+    DebugHandler pipeline_debug_handler_;
     
-    void* app_; // Crow app pointer
+    void* app_ = nullptr; // Crow app pointer, created by init()
 };
 
 } // namespace crawler
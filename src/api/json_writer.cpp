@@ -0,0 +1,145 @@
+#include "json_writer.h"
+#include <charconv>
+#include <cmath>
+
+namespace crawler {
+
+namespace {
+
+// Length of the UTF-8 sequence at p, or 0 if it is not a valid one
+size_t utf8_length(const unsigned char* p, size_t left) {
+    unsigned char lead = p[0];
+    size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+    if (length == 0 || length > left || lead > 0xF4 || lead == 0xC0 || lead == 0xC1) return 0;
+    for (size_t i = 1; i < length; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    }
+    // Overlong forms, surrogates and values past U+10FFFF
+    if ((lead == 0xE0 && p[1] < 0xA0) || (lead == 0xED && p[1] >= 0xA0) ||
+        (lead == 0xF0 && p[1] < 0x90) || (lead == 0xF4 && p[1] >= 0x90)) {
+        return 0;
+    }
+    return length;
+}
+
+} // namespace
+
+void JsonWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (!first_[depth_]) out_.push_back(',');
+    first_[depth_] = false;
+}
+
+void JsonWriter::open(char bracket) {
+    separate();
+    out_.push_back(bracket);
+    if (depth_ < kMaxDepth) depth_++;
+    first_[depth_] = true;
+}
+
+void JsonWriter::close(char bracket) {
+    out_.push_back(bracket);
+    if (depth_ > 0) depth_--;
+}
+
+void JsonWriter::begin_object() { open('{'); }
+void JsonWriter::end_object() { close('}'); }
+void JsonWriter::begin_array() { open('['); }
+void JsonWriter::end_array() { close(']'); }
+
+void JsonWriter::key(std::string_view name) {
+    separate();
+    write_string(name);
+    out_.push_back(':');
+    after_key_ = true;
+}
+
+void JsonWriter::value(std::string_view text) {
+    separate();
+    write_string(text);
+}
+
+void JsonWriter::value(double number) {
+    separate();
+    if (!std::isfinite(number)) {
+        out_.append("null");
+        return;
+    }
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    out_.append(digits, result.ptr);
+}
+
+void JsonWriter::value(int64_t number) {
+    separate();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    out_.append(digits, result.ptr);
+}
+
+void JsonWriter::value(uint64_t number) {
+    separate();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    out_.append(digits, result.ptr);
+}
+
+void JsonWriter::value(bool flag) {
+    separate();
+    out_.append(flag ? "true" : "false");
+}
+
+void JsonWriter::null() {
+    separate();
+    out_.append("null");
+}
+
+void JsonWriter::write_string(std::string_view text) {
+    static const char kHex[] = "0123456789abcdef";
+    const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+    size_t size = text.size();
+    out_.push_back('"');
+
+    // Runs of bytes that need no escaping are appended whole
+    size_t run = 0;
+    size_t i = 0;
+    while (i < size) {
+        unsigned char c = p[i];
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+            i++;
+            continue;
+        }
+        size_t length = c >= 0x80 ? utf8_length(p + i, size - i) : 0;
+        if (length > 0) {
+            i += length;
+            continue;
+        }
+
+        out_.append(text.data() + run, i - run);
+        switch (c) {
+            case '"': out_.append("\\\""); break;
+            case '\\': out_.append("\\\\"); break;
+            case '\n': out_.append("\\n"); break;
+            case '\r': out_.append("\\r"); break;
+            case '\t': out_.append("\\t"); break;
+            case '\b': out_.append("\\b"); break;
+            case '\f': out_.append("\\f"); break;
+            default:
+                if (c < 0x20) {
+                    char escape[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+                    out_.append(escape, sizeof(escape));
+                } else {
+                    out_.append("\\ufffd");
+                }
+        }
+        i++;
+        run = i;
+    }
+    out_.append(text.data() + run, size - run);
+    out_.push_back('"');
+}
+
+} // namespace crawler
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+namespace crawler {
+
+// Streams JSON text straight into a caller's buffer, without building a
+// DOM first; with a buffer reused across responses it stops allocating
+// once the buffer has grown. Commas go in by themselves: inside an object
+// alternate key() and a value or nested container. Strings are escaped as
+// JSON requires, and bytes that are not valid UTF-8 become U+FFFD, since
+// crawled text is not always clean. Non-finite numbers are written as null.
+class JsonWriter {
+public:
+    static constexpr size_t kMaxDepth = 32;
+
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+
+    void key(std::string_view name);
+
+    void value(std::string_view text);
+    void value(const char* text) { value(std::string_view(text)); }
+    void value(const std::string& text) { value(std::string_view(text)); }
+    void value(double number);
+    void value(int64_t number);
+    void value(uint64_t number);
+    void value(int number) { value(static_cast<int64_t>(number)); }
+    void value(bool flag);
+    void null();
+
+private:
+    void separate();
+    void open(char bracket);
+    void close(char bracket);
+    void write_string(std::string_view text);
+
+    std::string& out_;
+    size_t depth_ = 0;
+    bool first_[kMaxDepth + 1] = {true}; // per level: nothing written yet
+    bool after_key_ = false;
+};
+
+} // namespace crawler
@@ -0,0 +1,77 @@
+#include "search_handler.h"
+#include "json_writer.h"
+
+namespace crawler {
+
+void write_search_response(Indexer& indexer, QueryCache& cache, const SearchRequest& request,
+                           std::string& body) {
+    JsonWriter json(body);
+    json.begin_object();
+    json.key("query");
+    json.value(request.query);
+    size_t cached_from = body.size();
+
+    std::string key = QueryCache::key(request.query, request.topk, request.filter, request.facets);
+    uint64_t generation = indexer.generation();
+    thread_local std::string cached;
+    if (cache.get(key, generation, cached)) {
+        body += cached;
+        return;
+    }
+
+    Facets facets;
+    auto results = indexer.search(request.query, request.topk, request.filter, request.facets ? &facets : nullptr);
+
+    json.key("results");
+    json.begin_array();
+    for (const auto& result : results) {
+        json.begin_object();
+        json.key("doc_id");
+        json.value(result.doc_id);
+        json.key("url");
+        json.value(result.url);
+        json.key("title");
+        json.value(result.title);
+        json.key("snippet");
+        json.value(result.snippet);
+        json.key("score");
+        json.value(result.score);
+        json.key("category");
+        json.value(result.category);
+        json.key("brand");
+        json.value(result.brand);
+        json.key("price");
+        json.value(result.price);
+        json.end_object();
+    }
+    json.end_array();
+    json.key("total");
+    json.value(static_cast<uint64_t>(results.size()));
+    if (request.facets) {
+        auto write_counts = [&json](const char* name, const std::vector<FacetCount>& counts) {
+            json.key(name);
+            json.begin_array();
+            for (const auto& count : counts) {
+                json.begin_object();
+                json.key("value");
+                json.value(count.value);
+                json.key("count");
+                json.value(static_cast<uint64_t>(count.count));
+                json.end_object();
+            }
+            json.end_array();
+        };
+        json.key("facets");
+        json.begin_object();
+        json.key("matches");
+        json.value(static_cast<uint64_t>(facets.matches));
+        write_counts("categories", facets.categories);
+        write_counts("brands", facets.brands);
+        json.end_object();
+    }
+    json.end_object();
+    cached.assign(body, cached_from);
+    cache.put(key, generation, cached);
+}
+
+} // namespace crawler
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include "api_server.h"
+#include "../indexer/indexer.h"
+#include "../indexer/query_cache.h"
+
+namespace crawler {
+
+// Answer a /search request as JSON appended to `body`, from `cache` while
+// the index generation is unchanged. QueryCache::key() normalises the
+// query, so the cached bytes stop short of the echoed "query" field,
+// which is written from this request every time.
+void write_search_response(Indexer& indexer, QueryCache& cache, const SearchRequest& request,
+                           std::string& body);
+
+} // namespace crawler
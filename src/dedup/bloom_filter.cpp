@@ -0,0 +1,195 @@
+#include "bloom_filter.h"
+#include "../utils/varint.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace crawler {
+
+namespace {
+
+constexpr uint32_t kSnapshotMagic = 0x324D4C42; // "BLM2"
+constexpr size_t kSnapshotHeaderSize = 4 + 8 + 8 + 8;
+
+// Bit 0 of each block's first word serializes add()s to that block; keys
+// use the other 511 bits
+constexpr uint64_t kLockBit = 1;
+
+__extension__ typedef unsigned __int128 uint128;
+
+// splitmix64 finalizer: spreads weak input hashes (similar URLs under the
+// fallback hash differ only in their low bits) over the blocks, and
+// decorrelates in-block bits from the block choice
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
+BloomFilter::BloomFilter(size_t expected_items, double false_positive_rate) {
+    expected_items = std::max<size_t>(expected_items, 1024);
+    false_positive_rate = std::clamp(false_positive_rate, 1e-6, 0.5);
+
+    // Classic optimum is -ln(p) / ln(2)^2 bits per item. Packing each key's
+    // bits into one block skews the load, so add ~20% to hold the target rate
+    double bits_per_item = -std::log(false_positive_rate) / (std::log(2.0) * std::log(2.0));
+    double total_bits = bits_per_item * 1.2 * static_cast<double>(expected_items);
+    num_blocks_ = std::max<size_t>(1, static_cast<size_t>(std::ceil(total_bits / 512.0)));
+    hash_count_ = std::clamp<size_t>(static_cast<size_t>(std::round(bits_per_item * std::log(2.0))), 1, 16);
+
+    size_t words = num_blocks_ * kBlockWords;
+    words_ = std::make_unique<std::atomic<uint64_t>[]>(words);
+    for (size_t i = 0; i < words; i++) {
+        words_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t BloomFilter::block_index(uint64_t hash) const {
+    // Multiply-shift range reduction, no modulo
+    return static_cast<size_t>((static_cast<uint128>(mix64(hash)) * num_blocks_) >> 64);
+}
+
+void BloomFilter::block_masks(uint64_t hash, uint64_t (&masks)[kBlockWords]) const {
+    std::fill(std::begin(masks), std::end(masks), 0);
+    uint64_t mixed = mix64(hash ^ 0x9E3779B97F4A7C15ULL);
+    uint32_t a = static_cast<uint32_t>(mixed);
+    uint32_t b = static_cast<uint32_t>(mixed >> 32) | 1;
+    for (size_t i = 0; i < hash_count_; i++) {
+        uint32_t bit = 1 + (a + static_cast<uint32_t>(i) * b) % 511;
+        masks[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+bool BloomFilter::add(uint64_t hash) {
+    uint64_t masks[kBlockWords];
+    block_masks(hash, masks);
+    std::atomic<uint64_t>* block = &words_[block_index(hash) * kBlockWords];
+
+    auto present = [&]() {
+        for (size_t w = 0; w < kBlockWords; w++) {
+            if ((block[w].load(std::memory_order_relaxed) & masks[w]) != masks[w]) return false;
+        }
+        return true;
+    };
+    // Already there: the common duplicate case stays lock-free
+    if (present()) return false;
+
+    // Bits spread over several words, so setting them is not one atomic
+    // step; without the lock two adders of one key could both see new bits
+    // and both report it new
+    while (block[0].fetch_or(kLockBit, std::memory_order_acquire) & kLockBit) {
+        std::this_thread::yield();
+    }
+    bool added = !present();
+    if (added) {
+        for (size_t w = 0; w < kBlockWords; w++) {
+            if (masks[w]) block[w].fetch_or(masks[w], std::memory_order_relaxed);
+        }
+    }
+    block[0].fetch_and(~kLockBit, std::memory_order_release);
+
+    if (added) {
+        items_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return added;
+}
+
+bool BloomFilter::may_contain(uint64_t hash) const {
+    uint64_t masks[kBlockWords];
+    block_masks(hash, masks);
+    const std::atomic<uint64_t>* block = &words_[block_index(hash) * kBlockWords];
+
+    for (size_t w = 0; w < kBlockWords; w++) {
+        if ((block[w].load(std::memory_order_relaxed) & masks[w]) != masks[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BloomFilter::save(const std::string& path) const {
+    std::string header;
+    varint::put_fixed32(header, kSnapshotMagic);
+    varint::put_fixed64(header, num_blocks_);
+    varint::put_fixed64(header, hash_count_);
+    varint::put_fixed64(header, items_.load());
+
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    // Concurrent add()s may land on either side of the copy; that only
+    // loses keys added during the save, which the next snapshot picks up
+    std::vector<uint64_t> chunk;
+    const size_t chunk_words = 64 * 1024;
+    size_t total = num_blocks_ * kBlockWords;
+    for (size_t start = 0; start < total; start += chunk_words) {
+        size_t n = std::min(chunk_words, total - start);
+        chunk.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            chunk[i] = words_[start + i].load(std::memory_order_relaxed);
+            if ((start + i) % kBlockWords == 0) chunk[i] &= ~kLockBit; // an add() in progress
+        }
+        file.write(reinterpret_cast<const char*>(chunk.data()),
+                   static_cast<std::streamsize>(n * sizeof(uint64_t)));
+    }
+    file.close();
+    if (!file) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool BloomFilter::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    char header[kSnapshotHeaderSize];
+    if (!file.read(header, sizeof(header))) {
+        return false;
+    }
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(header);
+    if (varint::get_fixed32(p) != kSnapshotMagic ||
+        varint::get_fixed64(p + 4) != num_blocks_ ||
+        varint::get_fixed64(p + 12) != hash_count_) {
+        return false;
+    }
+    uint64_t items = varint::get_fixed64(p + 20);
+
+    std::vector<uint64_t> chunk;
+    const size_t chunk_words = 64 * 1024;
+    size_t total = num_blocks_ * kBlockWords;
+    for (size_t start = 0; start < total; start += chunk_words) {
+        size_t n = std::min(chunk_words, total - start);
+        chunk.resize(n);
+        if (!file.read(reinterpret_cast<char*>(chunk.data()),
+                       static_cast<std::streamsize>(n * sizeof(uint64_t)))) {
+            // Truncated snapshot: start empty rather than half-filled
+            for (size_t i = 0; i < total; i++) {
+                words_[i].store(0, std::memory_order_relaxed);
+            }
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            words_[start + i].store(chunk[i], std::memory_order_relaxed);
+        }
+    }
+    items_ = static_cast<size_t>(items);
+    return true;
+}
+
+} // namespace crawler
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace crawler {
+
+// Blocked Bloom filter over 64-bit hashes.
+// Every key maps to one 512-bit block (a cache line) and sets k bits inside
+// it, so a lookup touches one line instead of k random ones. Bits live in
+// atomic words: may_contain() is lock-free, and add() takes a spin bit in
+// the block only when the key is missing, so exactly one of several
+// concurrent add()s of a key returns true.
+class BloomFilter {
+public:
+    // Sized for expected_items at the given false-positive rate
+    BloomFilter(size_t expected_items, double false_positive_rate);
+
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+
+    // Insert; returns true if the key was definitely not present before
+    bool add(uint64_t hash);
+
+    // False means definitely never added
+    bool may_contain(uint64_t hash) const;
+
+    // Snapshot (written to a temp file, then renamed over `path`).
+    // load() fails if the file was built with different parameters.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    // Statistics
+    size_t size_bytes() const { return num_blocks_ * kBlockWords * sizeof(uint64_t); }
+    size_t hash_count() const { return hash_count_; }
+    size_t approx_items() const { return items_; }
+
+private:
+    static constexpr size_t kBlockWords = 8; // 8 x 64 = 512 bits
+
+    size_t block_index(uint64_t hash) const;
+    // One mask per word of the block
+    void block_masks(uint64_t hash, uint64_t (&masks)[kBlockWords]) const;
+
+    size_t num_blocks_;
+    size_t hash_count_;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    std::atomic<size_t> items_{0};
+};
+
+} // namespace crawler
@@ -1,197 +1,454 @@
 #include "dedup.h"
 #include "../utils/hash_utils.h"
 #include "../utils/url_utils.h"
-#include <hiredis/hiredis.h>
+#include "../utils/config.h"
+#include <filesystem>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 
 namespace crawler {
 
-Deduplicator::Deduplicator() = default;
+namespace {
 
-Deduplicator::~Deduplicator() {
-    if (redis_context_) {
-        redisFree(static_cast<redisContext*>(redis_context_));
+// Queued Redis marks are sent on their own once this many pile up
+constexpr size_t kMaxPendingMarks = 1024;
+
+// Marks handed back after a failed batch are kept up to this many; the
+// local filter still has the rest
+constexpr size_t kMaxRequeuedMarks = 16 * kMaxPendingMarks;
+
+// Hash of the canonical URL, parsed into a per-thread buffer
+uint64_t url_key(const std::string& url) {
+    thread_local std::string canonical;
+    ParsedUrl parsed;
+    if (UrlUtils::parse(url, canonical, parsed)) {
+        return HashUtils::hash_url(canonical);
     }
+    return HashUtils::hash_url(UrlUtils::canonicalize(url));
+}
+
+} // namespace
+
+Deduplicator::Deduplicator() {
+    auto& config = Config::instance();
+    ttl_seconds_ = config.dedup_redis_ttl_seconds();
+
+    if (config.dedup_url_filter_enabled()) {
+        url_filter_ = std::make_unique<BloomFilter>(config.dedup_expected_urls(),
+                                                    config.dedup_url_filter_fp_rate());
+        url_filter_path_ = config.storage_data_dir() + "/dedup/url_filter.bloom";
+        url_filter_->load(url_filter_path_);
+    }
+
+    if (config.dedup_near_dup_enabled()) {
+        near_dup_index_ = std::make_unique<NearDupIndex>(config.dedup_near_dup_max_distance());
+        near_dup_shingle_size_ = config.dedup_near_dup_shingle_size();
+        near_dup_min_tokens_ = config.dedup_near_dup_min_tokens();
+    }
+}
+
+Deduplicator::~Deduplicator() {
+    flush_pending_marks();
 }
 
 bool Deduplicator::init_redis(const std::string& host, int port) {
-    redisContext* ctx = redisConnect(host.c_str(), port);
-    if (ctx == nullptr || ctx->err) {
-        if (ctx) {
-            redisFree(ctx);
-        }
-        redis_available_ = false;
-        return false;
+    auto& config = Config::instance();
+    RedisPool::Options options;
+    options.host = host;
+    options.port = port;
+    options.size = config.redis_connection_pool_size();
+    options.timeout_ms = config.redis_timeout_ms();
+    options.password = config.redis_password();
+    options.db = config.redis_db();
+
+    redis_available_ = redis_pool_.connect(options);
+    return redis_available_;
+}
+
+uint64_t Deduplicator::content_key_hash(const std::string& content_hash) {
+    try {
+        return std::stoull(content_hash);
+    } catch (...) {
+        // If content_hash is not a number, hash it
+        return HashUtils::hash_content(content_hash);
     }
-    
-    redis_context_ = ctx;
-    redis_available_ = true;
-    return true;
 }
 
 bool Deduplicator::is_url_seen(const std::string& url) {
-    std::string canonical = UrlUtils::canonicalize(url);
-    uint64_t url_hash = HashUtils::hash_url(canonical);
-    
+    uint64_t url_hash = url_key(url);
+
+    // A filter miss is definite; no need to ask Redis
+    if (url_filter_ && !url_filter_->may_contain(url_hash)) {
+        filter_negatives_++;
+        return false;
+    }
+
     // Try Redis first
-    if (redis_available_) {
+    if (redis_up()) {
         std::string key = "dedup:url:" + std::to_string(url_hash);
-        bool seen = check_redis_url(key);
-        if (seen) {
+        bool seen = false;
+        if (redis_exists(key, seen) && seen) {
             redis_hits_++;
             url_duplicates_++;
             return true;
         }
         redis_misses_++;
     }
-    
+
     // Fallback to local
-    if (use_local_fallback_ || !redis_available_) {
+    if (url_filter_ && !redis_available_) {
+        // Filter says "maybe": without Redis, accept the false-positive rate
+        url_duplicates_++;
+        return true;
+    }
+    if (!url_filter_ && use_local()) {
         std::lock_guard<std::mutex> lock(local_mutex_);
         if (local_url_set_.find(url_hash) != local_url_set_.end()) {
             url_duplicates_++;
             return true;
         }
     }
-    
+
     return false;
 }
 
 void Deduplicator::mark_url_seen(const std::string& url) {
-    std::string canonical = UrlUtils::canonicalize(url);
-    uint64_t url_hash = HashUtils::hash_url(canonical);
-    
+    uint64_t url_hash = url_key(url);
+
+    if (url_filter_) {
+        url_filter_->add(url_hash);
+    }
+
     // Try Redis first
-    if (redis_available_) {
-        std::string key = "dedup:url:" + std::to_string(url_hash);
-        mark_redis_url(key);
+    if (redis_up()) {
+        redis_setex("dedup:url:" + std::to_string(url_hash), "1");
     }
-    
+
     // Fallback to local
-    if (use_local_fallback_ || !redis_available_) {
+    if (!url_filter_ && use_local()) {
         std::lock_guard<std::mutex> lock(local_mutex_);
         local_url_set_.insert(url_hash);
     }
 }
 
-bool Deduplicator::is_content_seen(const std::string& content_hash) {
-    uint64_t hash;
-    try {
-        hash = std::stoull(content_hash);
-    } catch (...) {
-        // If content_hash is not a number, hash it
-        hash = HashUtils::hash_content(content_hash);
+std::vector<std::string> Deduplicator::filter_unseen(std::span<const std::string> urls) {
+    std::vector<std::string> unseen;
+    if (urls.empty()) return unseen;
+
+    // Hash once, and drop repeats inside the batch before going remote
+    std::vector<uint64_t> hashes;
+    std::vector<size_t> candidates;
+    hashes.reserve(urls.size());
+    candidates.reserve(urls.size());
+    std::unordered_set<uint64_t> batch;
+    for (size_t i = 0; i < urls.size(); i++) {
+        uint64_t url_hash = url_key(urls[i]);
+        hashes.push_back(url_hash);
+        if (batch.insert(url_hash).second) {
+            candidates.push_back(i);
+        } else {
+            url_duplicates_++;
+        }
+    }
+
+    if (url_filter_) {
+        return filter_unseen_tiered(urls, hashes, candidates);
+    }
+
+    std::vector<bool> is_new(urls.size(), false);
+    bool decided = false;
+    if (redis_up()) {
+        std::vector<std::string> keys;
+        keys.reserve(candidates.size());
+        for (size_t i : candidates) {
+            keys.push_back("dedup:url:" + std::to_string(hashes[i]));
+        }
+
+        std::vector<bool> newly_set;
+        if (redis_set_nx(keys, "1", newly_set)) {
+            for (size_t k = 0; k < candidates.size(); k++) {
+                if (newly_set[k]) {
+                    is_new[candidates[k]] = true;
+                    redis_misses_++;
+                } else {
+                    redis_hits_++;
+                    url_duplicates_++;
+                }
+            }
+            decided = true;
+        }
+    }
+
+    // Local set: authoritative without Redis, a mirror with it
+    if (use_local() || !decided) {
+        std::lock_guard<std::mutex> lock(local_mutex_);
+        for (size_t i : candidates) {
+            bool inserted = local_url_set_.insert(hashes[i]).second;
+            if (!decided) {
+                is_new[i] = inserted;
+                if (!inserted) {
+                    url_duplicates_++;
+                }
+            }
+        }
+    }
+
+    for (size_t i : candidates) {
+        if (is_new[i]) {
+            unseen.push_back(urls[i]);
+        }
+    }
+    return unseen;
+}
+
+std::vector<std::string> Deduplicator::filter_unseen_tiered(std::span<const std::string> urls,
+                                                           const std::vector<uint64_t>& hashes,
+                                                           const std::vector<size_t>& candidates) {
+    std::vector<std::string> unseen;
+    std::vector<size_t> maybe_seen;
+    std::vector<std::string> new_keys;
+    for (size_t i : candidates) {
+        if (url_filter_->add(hashes[i])) {
+            filter_negatives_++;
+            unseen.push_back(urls[i]);
+            new_keys.push_back("dedup:url:" + std::to_string(hashes[i]));
+        } else {
+            maybe_seen.push_back(i);
+        }
+    }
+
+    if (!redis_up()) {
+        // Filter answers alone; "maybe" counts as seen
+        url_duplicates_ += maybe_seen.size();
+        return unseen;
+    }
+
+    std::vector<std::string> marks;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_marks_.insert(pending_marks_.end(), std::make_move_iterator(new_keys.begin()),
+                              std::make_move_iterator(new_keys.end()));
+        if (maybe_seen.empty() && pending_marks_.size() < kMaxPendingMarks) {
+            return unseen; // No round trip needed yet
+        }
+        marks.swap(pending_marks_);
+    }
+
+    // One pipeline: resolve the filter's "maybe"s with SET NX, and carry
+    // the queued marks for definitely-new URLs along
+    std::string ttl = std::to_string(ttl_seconds_);
+    std::vector<std::vector<std::string>> commands;
+    commands.reserve(maybe_seen.size() + marks.size());
+    for (size_t i : maybe_seen) {
+        commands.push_back({"SET", "dedup:url:" + std::to_string(hashes[i]), "1", "NX", "EX", ttl});
     }
-    
+    for (auto& key : marks) {
+        commands.push_back({"SET", std::move(key), "1", "EX", ttl});
+    }
+
+    std::vector<RedisReply> replies;
+    if (!redis_execute(commands, replies)) {
+        // Treat the unresolved ones as seen, like the filter alone would,
+        // and keep the marks for a later batch
+        url_duplicates_ += maybe_seen.size();
+        requeue_marks(commands, maybe_seen.size());
+        return unseen;
+    }
+
+    for (size_t k = 0; k < maybe_seen.size(); k++) {
+        if (replies[k].type == RedisReply::Type::STATUS) {
+            // Filter false positive
+            redis_misses_++;
+            unseen.push_back(urls[maybe_seen[k]]);
+        } else {
+            redis_hits_++;
+            url_duplicates_++;
+        }
+    }
+    return unseen;
+}
+
+void Deduplicator::flush_pending_marks() {
+    if (!redis_up()) return;
+    std::vector<std::string> marks;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        marks.swap(pending_marks_);
+    }
+    if (marks.empty()) return;
+
+    std::string ttl = std::to_string(ttl_seconds_);
+    std::vector<std::vector<std::string>> commands;
+    commands.reserve(marks.size());
+    for (auto& key : marks) {
+        commands.push_back({"SET", std::move(key), "1", "EX", ttl});
+    }
+    std::vector<RedisReply> replies;
+    if (!redis_execute(commands, replies)) {
+        requeue_marks(commands, 0);
+    }
+}
+
+void Deduplicator::requeue_marks(std::vector<std::vector<std::string>>& commands, size_t first) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    for (size_t i = first; i < commands.size() && pending_marks_.size() < kMaxRequeuedMarks; i++) {
+        pending_marks_.push_back(std::move(commands[i][1])); // SET <key> ...
+    }
+}
+
+bool Deduplicator::save_snapshot() {
+    flush_pending_marks();
+    if (!url_filter_) return true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(url_filter_path_).parent_path(), ec);
+    return url_filter_->save(url_filter_path_);
+}
+
+bool Deduplicator::is_content_seen(const std::string& content_hash) {
+    uint64_t hash = content_key_hash(content_hash);
+
     // Try Redis first
-    if (redis_available_) {
+    if (redis_up()) {
         std::string key = "dedup:content:" + content_hash;
-        bool seen = check_redis_content(key);
-        if (seen) {
+        bool seen = false;
+        if (redis_exists(key, seen) && seen) {
             redis_hits_++;
             content_duplicates_++;
             return true;
         }
         redis_misses_++;
     }
-    
+
     // Fallback to local
-    if (use_local_fallback_ || !redis_available_) {
+    if (use_local()) {
         std::lock_guard<std::mutex> lock(local_mutex_);
         if (local_content_set_.find(hash) != local_content_set_.end()) {
             content_duplicates_++;
             return true;
         }
     }
-    
+
     return false;
 }
 
 void Deduplicator::mark_content_seen(const std::string& content_hash, const std::string& doc_id) {
-    uint64_t hash;
-    try {
-        hash = std::stoull(content_hash);
-    } catch (...) {
-        hash = HashUtils::hash_content(content_hash);
-    }
-    
+    uint64_t hash = content_key_hash(content_hash);
+
     // Try Redis
-    if (redis_available_) {
-        std::string key = "dedup:content:" + content_hash;
-        mark_redis_content(key, doc_id);
+    if (redis_up()) {
+        redis_setex("dedup:content:" + content_hash, doc_id);
     }
-    
+
     // Fallback to local
-    if (use_local_fallback_ || !redis_available_) {
+    if (use_local()) {
         std::lock_guard<std::mutex> lock(local_mutex_);
         local_content_set_.insert(hash);
     }
 }
 
+bool Deduplicator::check_and_mark_content(const std::string& content_hash, const std::string& doc_id) {
+    uint64_t hash = content_key_hash(content_hash);
+
+    std::optional<bool> seen;
+    if (redis_up()) {
+        std::vector<bool> newly_set;
+        if (redis_set_nx({"dedup:content:" + content_hash}, doc_id, newly_set)) {
+            seen = !newly_set[0];
+            if (*seen) {
+                redis_hits_++;
+            } else {
+                redis_misses_++;
+            }
+        }
+    }
+
+    if (use_local() || !seen) {
+        std::lock_guard<std::mutex> lock(local_mutex_);
+        bool inserted = local_content_set_.insert(hash).second;
+        if (!seen) {
+            seen = !inserted;
+        }
+    }
+
+    if (seen.value_or(false)) {
+        content_duplicates_++;
+        return true;
+    }
+    return false;
+}
+
+bool Deduplicator::check_and_mark_near_duplicate(std::span<const std::string_view> tokens) {
+    if (!near_dup_index_ || tokens.size() < near_dup_min_tokens_) {
+        return false;
+    }
+
+    uint64_t fingerprint = SimHash::compute(tokens, near_dup_shingle_size_);
+    if (near_dup_index_->check_and_insert(fingerprint)) {
+        near_duplicates_++;
+        return true;
+    }
+    return false;
+}
+
 void Deduplicator::enable_local_fallback(bool enable) {
     use_local_fallback_ = enable;
 }
 
-bool Deduplicator::check_redis_url(const std::string& key) {
-    if (!redis_context_) return false;
-    
-    redisContext* ctx = static_cast<redisContext*>(redis_context_);
-    redisReply* reply = static_cast<redisReply*>(redisCommand(ctx, "EXISTS %s", key.c_str()));
-    
-    if (reply == nullptr) {
-        redis_available_ = false;
+bool Deduplicator::redis_set_nx(const std::vector<std::string>& keys, const std::string& value,
+                                std::vector<bool>& newly_set) {
+    std::vector<std::vector<std::string>> commands;
+    commands.reserve(keys.size());
+    std::string ttl = std::to_string(ttl_seconds_);
+    for (const auto& key : keys) {
+        commands.push_back({"SET", key, value, "NX", "EX", ttl});
+    }
+
+    std::vector<RedisReply> replies;
+    if (!redis_execute(commands, replies)) {
+        return false;
+    }
+
+    newly_set.assign(keys.size(), false);
+    for (size_t i = 0; i < replies.size(); i++) {
+        // "+OK" when the key was created, nil when it already existed
+        newly_set[i] = replies[i].type == RedisReply::Type::STATUS;
+    }
+    return true;
+}
+
+bool Deduplicator::redis_exists(const std::string& key, bool& exists) {
+    std::vector<RedisReply> replies;
+    if (!redis_execute({{"EXISTS", key}}, replies)) {
         return false;
     }
-    
-    bool exists = reply->integer == 1;
-    freeReplyObject(reply);
-    return exists;
+    exists = replies[0].type == RedisReply::Type::INTEGER && replies[0].integer == 1;
+    return true;
+}
+
+void Deduplicator::redis_setex(const std::string& key, const std::string& value) {
+    std::vector<RedisReply> replies;
+    redis_execute({{"SETEX", key, std::to_string(ttl_seconds_), value}}, replies);
 }
 
-bool Deduplicator::check_redis_content(const std::string& key) {
-    if (!redis_context_) return false;
-    
-    redisContext* ctx = static_cast<redisContext*>(redis_context_);
-    redisReply* reply = static_cast<redisReply*>(redisCommand(ctx, "EXISTS %s", key.c_str()));
-    
-    if (reply == nullptr) {
-        redis_available_ = false;
+bool Deduplicator::redis_up() {
+    if (redis_available_) return true;
+    // The pool reconnects at most once per interval, so this is usually
+    // a quick "no"; a PING that gets through brings Redis back
+    std::vector<RedisReply> replies;
+    return redis_execute({{"PING"}}, replies);
+}
+
+bool Deduplicator::redis_execute(const std::vector<std::vector<std::string>>& commands,
+                                 std::vector<RedisReply>& replies) {
+    if (!redis_pool_.execute(commands, replies)) {
+        // The pool replaces broken connections; only give up once none are left
+        redis_available_ = redis_pool_.available();
         return false;
     }
-    
-    bool exists = reply->integer == 1;
-    freeReplyObject(reply);
-    return exists;
-}
-
-void Deduplicator::mark_redis_url(const std::string& key) {
-    if (!redis_context_) return;
-    
-    redisContext* ctx = static_cast<redisContext*>(redis_context_);
-    redisReply* reply = static_cast<redisReply*>(redisCommand(ctx, "SETEX %s 86400 1", key.c_str()));
-    
-    if (reply == nullptr) {
-        redis_available_ = false;
-        return;
-    }
-    
-    freeReplyObject(reply);
-}
-
-void Deduplicator::mark_redis_content(const std::string& key, const std::string& doc_id) {
-    if (!redis_context_) return;
-    
-    redisContext* ctx = static_cast<redisContext*>(redis_context_);
-    redisReply* reply = static_cast<redisReply*>(redisCommand(ctx, "SETEX %s 86400 %s", 
-                                                              key.c_str(), doc_id.c_str()));
-    
-    if (reply == nullptr) {
-        redis_available_ = false;
-        return;
-    }
-    
-    freeReplyObject(reply);
+    redis_available_ = true;
+    return true;
 }
 
 } // namespace crawler
@@ -4,6 +4,13 @@
 #include <unordered_set>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "redis_pool.h"
+#include "bloom_filter.h"
+#include "simhash.h"
 
 namespace crawler {
 
@@ -18,43 +25,96 @@ public:
     // Mark URL as seen
     void mark_url_seen(const std::string& url);
     
+    // Check and mark a batch of URLs in one round trip (SET NX per URL).
+    // Returns the URLs nobody had seen before, in input order; repeats
+    // within the batch are dropped too.
+    std::vector<std::string> filter_unseen(std::span<const std::string> urls);
+    
     // Check if content is duplicate
     bool is_content_seen(const std::string& content_hash);
     
     // Mark content as seen
     void mark_content_seen(const std::string& content_hash, const std::string& doc_id);
     
-    // Initialize Redis connection
+    // Atomic is_content_seen + mark_content_seen; true if it was already seen
+    bool check_and_mark_content(const std::string& content_hash, const std::string& doc_id);
+    
+    // SimHash of the page's token shingles against every page kept so far.
+    // True if one is within dedup.near_dup_max_distance bits; otherwise the
+    // page is added. Pages shorter than near_dup_min_tokens are never dups.
+    bool check_and_mark_near_duplicate(std::span<const std::string_view> tokens);
+    
+    // Initialize the Redis connection pool (redis.* settings from Config)
     bool init_redis(const std::string& host, int port);
     
     // Fallback to local storage if Redis fails
     void enable_local_fallback(bool enable);
     
+    // Persist the local URL filter (and flush queued Redis marks) so a
+    // restart does not start with an empty filter
+    bool save_snapshot();
+    
     // Statistics
     size_t url_duplicates() const { return url_duplicates_; }
     size_t content_duplicates() const { return content_duplicates_; }
+    size_t near_duplicates() const { return near_duplicates_; }
     size_t redis_hits() const { return redis_hits_; }
     size_t redis_misses() const { return redis_misses_; }
+    size_t filter_negatives() const { return filter_negatives_; }
+    size_t url_filter_bytes() const { return url_filter_ ? url_filter_->size_bytes() : 0; }
 
 private:
-    bool check_redis_url(const std::string& url_hash);
-    bool check_redis_content(const std::string& content_hash);
-    void mark_redis_url(const std::string& url_hash);
-    void mark_redis_content(const std::string& content_hash, const std::string& doc_id);
+    static uint64_t content_key_hash(const std::string& content_hash);
+    bool use_local() const { return use_local_fallback_ || !redis_available_; }
+    // Whether to go to Redis; while it is down, lets the pool try to
+    // reconnect now and then
+    bool redis_up();
+    
+    // Pipelined SET key value NX EX ttl; newly_set[i] is true where the key
+    // did not exist. Returns false (and marks Redis down) on failure.
+    bool redis_set_nx(const std::vector<std::string>& keys, const std::string& value,
+                      std::vector<bool>& newly_set);
+    bool redis_exists(const std::string& key, bool& exists);
+    void redis_setex(const std::string& key, const std::string& value);
+    bool redis_execute(const std::vector<std::vector<std::string>>& commands,
+                       std::vector<RedisReply>& replies);
+    std::vector<std::string> filter_unseen_tiered(std::span<const std::string> urls,
+                                                  const std::vector<uint64_t>& hashes,
+                                                  const std::vector<size_t>& candidates);
+    void flush_pending_marks();
+    // Put the keys of a failed batch's marks, commands[first..], back in
+    // pending_marks_
+    void requeue_marks(std::vector<std::vector<std::string>>& commands, size_t first);
     
     // Local fallback
     std::unordered_set<uint64_t> local_url_set_;
     std::unordered_set<uint64_t> local_content_set_;
     mutable std::mutex local_mutex_;
     bool use_local_fallback_ = false;
-    bool redis_available_ = false;
+    std::atomic<bool> redis_available_{false};
+    
+    RedisPool redis_pool_;
+    int ttl_seconds_ = 86400;
+    
+    // Local first tier for URLs. A filter miss is a definite "new", so the
+    // Redis mark for it is queued and sent with the next batch that has to
+    // go out anyway. Replaces local_url_set_ when enabled.
+    std::unique_ptr<BloomFilter> url_filter_;
+    std::string url_filter_path_;
+    std::mutex pending_mutex_;
+    std::vector<std::string> pending_marks_; // Redis keys
     
-    void* redis_context_ = nullptr; // hiredis context
+    // Near-duplicate content (process-local)
+    std::unique_ptr<NearDupIndex> near_dup_index_;
+    size_t near_dup_shingle_size_ = 3;
+    size_t near_dup_min_tokens_ = 50;
     
     std::atomic<size_t> url_duplicates_{0};
     std::atomic<size_t> content_duplicates_{0};
+    std::atomic<size_t> near_duplicates_{0};
     std::atomic<size_t> redis_hits_{0};
     std::atomic<size_t> redis_misses_{0};
+    std::atomic<size_t> filter_negatives_{0};
 };
 
 } // namespace crawler
@@ -0,0 +1,212 @@
+#include "redis_pool.h"
+#include <hiredis/hiredis.h>
+#include <sys/time.h>
+
+namespace crawler {
+
+namespace {
+
+RedisReply decode_reply(const redisReply* reply) {
+    RedisReply out;
+    switch (reply->type) {
+        case REDIS_REPLY_STATUS:
+            out.type = RedisReply::Type::STATUS;
+            out.str.assign(reply->str, reply->len);
+            break;
+        case REDIS_REPLY_INTEGER:
+            out.type = RedisReply::Type::INTEGER;
+            out.integer = reply->integer;
+            break;
+        case REDIS_REPLY_STRING:
+            out.type = RedisReply::Type::STRING;
+            out.str.assign(reply->str, reply->len);
+            break;
+        case REDIS_REPLY_ERROR:
+            out.type = RedisReply::Type::ERROR;
+            out.str.assign(reply->str, reply->len);
+            break;
+        default:
+            out.type = RedisReply::Type::NIL;
+            break;
+    }
+    return out;
+}
+
+bool simple_command(redisContext* ctx, const std::vector<std::string>& args) {
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    for (const auto& arg : args) {
+        argv.push_back(arg.data());
+        argvlen.push_back(arg.size());
+    }
+    redisReply* reply = static_cast<redisReply*>(
+        redisCommandArgv(ctx, static_cast<int>(argv.size()), argv.data(), argvlen.data()));
+    if (reply == nullptr) {
+        return false;
+    }
+    bool ok = reply->type != REDIS_REPLY_ERROR;
+    freeReplyObject(reply);
+    return ok;
+}
+
+} // namespace
+
+RedisPool::~RedisPool() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (void* ctx : idle_) {
+        redisFree(static_cast<redisContext*>(ctx));
+    }
+    idle_.clear();
+}
+
+void* RedisPool::open_connection() const {
+    struct timeval tv;
+    tv.tv_sec = options_.timeout_ms / 1000;
+    tv.tv_usec = (options_.timeout_ms % 1000) * 1000;
+
+    redisContext* ctx = redisConnectWithTimeout(options_.host.c_str(), options_.port, tv);
+    if (ctx == nullptr || ctx->err) {
+        if (ctx) {
+            redisFree(ctx);
+        }
+        return nullptr;
+    }
+
+    // Same bound for replies, so a stalled server cannot hang a worker
+    redisSetTimeout(ctx, tv);
+    redisEnableKeepAlive(ctx);
+
+    if (!options_.password.empty() && !simple_command(ctx, {"AUTH", options_.password})) {
+        redisFree(ctx);
+        return nullptr;
+    }
+    if (options_.db != 0 && !simple_command(ctx, {"SELECT", std::to_string(options_.db)})) {
+        redisFree(ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+bool RedisPool::connect(const Options& options) {
+    options_ = options;
+    if (options_.size < 1) {
+        options_.size = 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    configured_ = true;
+    for (int i = 0; i < options_.size; i++) {
+        void* ctx = open_connection();
+        if (ctx == nullptr) {
+            next_reconnect_ = std::chrono::steady_clock::now() + kReconnectInterval;
+            break;
+        }
+        idle_.push_back(ctx);
+        live_++;
+    }
+    return live_ > 0;
+}
+
+void* RedisPool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (idle_.empty()) {
+        auto now = std::chrono::steady_clock::now();
+        if (configured_ && live_ < options_.size && now >= next_reconnect_) {
+            // Short of connections: open one, outside the lock since it can
+            // take up to timeout_ms
+            next_reconnect_ = now + kReconnectInterval;
+            live_++;
+            lock.unlock();
+            void* ctx = open_connection();
+            lock.lock();
+            if (ctx) {
+                reconnects_++;
+                return ctx;
+            }
+            live_--;
+            cv_.notify_all();
+            continue;
+        }
+        if (live_ == 0) {
+            return nullptr;
+        }
+        if (live_ < options_.size) {
+            cv_.wait_until(lock, next_reconnect_);
+        } else {
+            cv_.wait(lock);
+        }
+    }
+    void* ctx = idle_.back();
+    idle_.pop_back();
+    return ctx;
+}
+
+void RedisPool::release(void* ctx, bool broken) {
+    if (broken) {
+        // A context with pending replies or an error cannot be reused
+        redisFree(static_cast<redisContext*>(ctx));
+        ctx = open_connection();
+        if (ctx) {
+            reconnects_++;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ctx) {
+            idle_.push_back(ctx);
+        } else {
+            // acquire() tries again once the interval has passed
+            live_--;
+            next_reconnect_ = std::chrono::steady_clock::now() + kReconnectInterval;
+        }
+    }
+    cv_.notify_one();
+}
+
+bool RedisPool::execute(const std::vector<std::vector<std::string>>& commands,
+                        std::vector<RedisReply>& replies) {
+    replies.clear();
+    if (commands.empty()) return true;
+
+    void* handle = acquire();
+    if (handle == nullptr) {
+        return false;
+    }
+    redisContext* ctx = static_cast<redisContext*>(handle);
+
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    bool ok = true;
+    for (const auto& command : commands) {
+        argv.clear();
+        argvlen.clear();
+        for (const auto& arg : command) {
+            argv.push_back(arg.data());
+            argvlen.push_back(arg.size());
+        }
+        if (redisAppendCommandArgv(ctx, static_cast<int>(argv.size()), argv.data(),
+                                   argvlen.data()) != REDIS_OK) {
+            ok = false;
+            break;
+        }
+    }
+
+    // The first redisGetReply flushes the whole output buffer
+    replies.reserve(commands.size());
+    while (ok && replies.size() < commands.size()) {
+        void* raw = nullptr;
+        if (redisGetReply(ctx, &raw) != REDIS_OK || raw == nullptr) {
+            ok = false;
+            break;
+        }
+        replies.push_back(decode_reply(static_cast<redisReply*>(raw)));
+        freeReplyObject(raw);
+    }
+
+    round_trips_++;
+    release(handle, !ok);
+    return ok;
+}
+
+} // namespace crawler
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace crawler {
+
+// Decoded reply of one pipelined command
+struct RedisReply {
+    enum class Type { NIL, STATUS, INTEGER, STRING, ERROR };
+    Type type = Type::NIL;
+    long long integer = 0;
+    std::string str;
+};
+
+// Fixed-size pool of hiredis connections. A hiredis context is not
+// thread-safe, so each caller leases one for the duration of a batch.
+// Batches are pipelined: every command is appended to the output buffer
+// and the replies are read back afterwards, one round trip per batch.
+// Connections that could not be replaced are retried from acquire(), at
+// most once per kReconnectInterval, so the pool recovers after an outage.
+class RedisPool {
+public:
+    static constexpr std::chrono::milliseconds kReconnectInterval{1000};
+
+    struct Options {
+        std::string host = "localhost";
+        int port = 6379;
+        int size = 10;
+        int timeout_ms = 1000;
+        std::string password;
+        int db = 0;
+    };
+
+    RedisPool() = default;
+    ~RedisPool();
+
+    RedisPool(const RedisPool&) = delete;
+    RedisPool& operator=(const RedisPool&) = delete;
+
+    // Open all connections; false if none could be established. The
+    // missing ones are retried later either way.
+    bool connect(const Options& options);
+
+    // Run commands (argv form) in one pipeline. Returns false if the
+    // connection failed part way, or no connection was to be had; replies
+    // then only holds what was read.
+    bool execute(const std::vector<std::vector<std::string>>& commands,
+                 std::vector<RedisReply>& replies);
+
+    // True while at least one connection is usable
+    bool available() const { return live_ > 0; }
+
+    // Statistics
+    int size() const { return options_.size; }
+    size_t round_trips() const { return round_trips_; }
+    size_t reconnects() const { return reconnects_; }
+
+private:
+    void* open_connection() const;
+    void* acquire();
+    void release(void* ctx, bool broken);
+
+    Options options_;
+    std::vector<void*> idle_; // hiredis contexts
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<int> live_{0}; // idle, leased or being opened
+    bool configured_ = false;  // connect() was called
+    std::chrono::steady_clock::time_point next_reconnect_;
+
+    std::atomic<size_t> round_trips_{0};
+    std::atomic<size_t> reconnects_{0};
+};
+
+} // namespace crawler
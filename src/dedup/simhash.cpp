@@ -0,0 +1,105 @@
+#include "simhash.h"
+#include "../utils/hash_utils.h"
+#include <algorithm>
+
+namespace crawler {
+
+namespace {
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+} // namespace
+
+uint64_t SimHash::compute(std::span<const std::string_view> tokens, size_t shingle_size) {
+    if (tokens.empty()) return 0;
+    shingle_size = std::max<size_t>(shingle_size, 1);
+
+    // Hash each token once; shingle hashes are combinations of these
+    std::vector<uint64_t> token_hashes;
+    token_hashes.reserve(tokens.size());
+    for (auto token : tokens) {
+        token_hashes.push_back(mix64(HashUtils::xxhash(token)));
+    }
+
+    int counts[64] = {0};
+    size_t width = std::min(shingle_size, token_hashes.size());
+    for (size_t start = 0; start + width <= token_hashes.size(); start++) {
+        uint64_t shingle = 0;
+        for (size_t i = 0; i < width; i++) {
+            // Order-sensitive combine
+            shingle = mix64(shingle ^ (token_hashes[start + i] + 0x9E3779B97F4A7C15ULL * (i + 1)));
+        }
+        for (int bit = 0; bit < 64; bit++) {
+            counts[bit] += ((shingle >> bit) & 1) ? 1 : -1;
+        }
+    }
+
+    uint64_t fingerprint = 0;
+    for (int bit = 0; bit < 64; bit++) {
+        if (counts[bit] > 0) {
+            fingerprint |= 1ULL << bit;
+        }
+    }
+    return fingerprint;
+}
+
+NearDupIndex::NearDupIndex(int max_distance)
+    : max_distance_(std::clamp(max_distance, 0, 15)) {
+    bands_ = max_distance_ + 1;
+    band_bits_ = 64 / bands_;
+    tables_.resize(bands_);
+}
+
+uint64_t NearDupIndex::band_key(uint64_t fingerprint, int band) const {
+    // The last band takes the leftover bits
+    int shift = band * band_bits_;
+    int bits = band == bands_ - 1 ? 64 - shift : band_bits_;
+    uint64_t mask = bits >= 64 ? ~0ULL : ((1ULL << bits) - 1);
+    return (fingerprint >> shift) & mask;
+}
+
+bool NearDupIndex::find_locked(uint64_t fingerprint) const {
+    for (int band = 0; band < bands_; band++) {
+        auto it = tables_[band].find(band_key(fingerprint, band));
+        if (it == tables_[band].end()) continue;
+        for (uint32_t index : it->second) {
+            if (SimHash::distance(fingerprints_[index], fingerprint) <= max_distance_) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool NearDupIndex::check_and_insert(uint64_t fingerprint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (find_locked(fingerprint)) {
+        return true;
+    }
+
+    uint32_t index = static_cast<uint32_t>(fingerprints_.size());
+    fingerprints_.push_back(fingerprint);
+    for (int band = 0; band < bands_; band++) {
+        tables_[band][band_key(fingerprint, band)].push_back(index);
+    }
+    return false;
+}
+
+bool NearDupIndex::contains_near(uint64_t fingerprint) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return find_locked(fingerprint);
+}
+
+size_t NearDupIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fingerprints_.size();
+}
+
+} // namespace crawler
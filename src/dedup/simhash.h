@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace crawler {
+
+// 64-bit SimHash (Charikar) over word shingles.
+// Pages that differ only in a few shingles (timestamps, ads, session
+// tokens) get fingerprints a small Hamming distance apart.
+class SimHash {
+public:
+    // Fingerprint of the document's shingles of `shingle_size` consecutive
+    // tokens (already normalised, e.g. by Tokenizer). Fewer tokens than that
+    // hash as one shingle.
+    static uint64_t compute(std::span<const std::string_view> tokens, size_t shingle_size = 3);
+
+    static int distance(uint64_t a, uint64_t b) { return __builtin_popcountll(a ^ b); }
+};
+
+// Banded LSH index over SimHash fingerprints.
+// The 64 bits are split into max_distance + 1 bands; by pigeonhole any two
+// fingerprints within max_distance agree exactly on at least one band, so a
+// lookup only compares against the bucket of each band, not the corpus.
+// Thread-safe.
+class NearDupIndex {
+public:
+    explicit NearDupIndex(int max_distance = 3);
+
+    // Returns true if a fingerprint within max_distance is already indexed;
+    // otherwise inserts this one and returns false
+    bool check_and_insert(uint64_t fingerprint);
+
+    // Lookup only
+    bool contains_near(uint64_t fingerprint) const;
+
+    // Statistics
+    size_t size() const;
+    int max_distance() const { return max_distance_; }
+
+private:
+    uint64_t band_key(uint64_t fingerprint, int band) const;
+    bool find_locked(uint64_t fingerprint) const;
+
+    int max_distance_;
+    int bands_;
+    int band_bits_;
+
+    std::vector<uint64_t> fingerprints_;
+    // Per band: band value -> indexes into fingerprints_
+    std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> tables_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace crawler
@@ -0,0 +1,459 @@
+#include "async_fetcher.h"
+#include "body_writer.h"
+#include "../utils/config.h"
+#include "../utils/hash_utils.h"
+#include "../utils/url_utils.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace crawler {
+
+static std::once_flag curl_init_flag;
+
+struct AsyncFetcher::Request {
+    std::string url; // current hop
+    std::string host;
+    FetchCallback callback;
+    BodyChunkCallback on_chunk;
+    FetchResult result; // accumulates redirects across hops
+    BodyWriter writer;
+    int redirect_count = 0;
+    std::chrono::steady_clock::time_point start;
+    CURL* easy = nullptr;
+};
+
+AsyncFetcher::AsyncFetcher() {
+    std::call_once(curl_init_flag, []() {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+    });
+
+    auto& config = Config::instance();
+    connect_timeout_ms_ = config.fetcher_connect_timeout_ms();
+    read_timeout_ms_ = config.fetcher_read_timeout_ms();
+    max_redirects_ = config.fetcher_max_redirects();
+    user_agent_ = config.fetcher_user_agent();
+    verify_tls_ = config.fetcher_verify_tls();
+    max_body_bytes_ = config.fetcher_max_body_bytes();
+    html_only_ = config.fetcher_html_only();
+    max_in_flight_ = config.fetcher_max_in_flight();
+    max_host_connections_ = config.fetcher_max_host_connections();
+    max_total_connections_ = config.fetcher_max_total_connections();
+}
+
+AsyncFetcher::~AsyncFetcher() {
+    stop();
+}
+
+bool AsyncFetcher::start() {
+    if (running_) return true;
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    multi_ = curl_multi_init();
+    if (epoll_fd_ < 0 || wake_fd_ < 0 || !multi_) {
+        stop();
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETFUNCTION, &AsyncFetcher::socket_callback);
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERFUNCTION, &AsyncFetcher::timer_callback);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERDATA, this);
+    // Multiplex HTTP/2 streams over one connection per host when possible
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, max_host_connections_);
+    curl_multi_setopt(multi_, CURLMOPT_MAX_TOTAL_CONNECTIONS, max_total_connections_);
+    curl_multi_setopt(multi_, CURLMOPT_MAXCONNECTS, max_total_connections_);
+
+    running_ = true;
+    loop_thread_ = std::thread(&AsyncFetcher::event_loop, this);
+    return true;
+}
+
+void AsyncFetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        running_ = false;
+    }
+    capacity_cv_.notify_all();
+    if (wake_fd_ >= 0) wake();
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
+
+    // Fail whatever never reached completion
+    std::deque<std::unique_ptr<Request>> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_);
+    }
+    for (auto& req : pending) {
+        req->result.success = false;
+        req->result.error_message = "Fetcher stopped";
+        in_flight_--;
+        req->callback(std::move(req->result));
+    }
+    for (auto& [easy, req] : active_) {
+        curl_multi_remove_handle(multi_, easy);
+        curl_easy_cleanup(easy);
+        req->result.success = false;
+        req->result.error_message = "Fetcher stopped";
+        in_flight_--;
+        req->callback(std::move(req->result));
+    }
+    active_.clear();
+
+    for (auto& [host, handles] : idle_handles_) {
+        for (void* easy : handles) {
+            curl_easy_cleanup(easy);
+        }
+    }
+    idle_handles_.clear();
+    idle_handle_count_ = 0;
+
+    if (multi_) {
+        curl_multi_cleanup(multi_);
+        multi_ = nullptr;
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
+
+bool AsyncFetcher::submit(const std::string& url, FetchCallback callback, BodyChunkCallback on_chunk) {
+    auto req = std::make_unique<Request>();
+    req->url = url;
+    req->host = UrlUtils::extract_domain(url);
+    req->callback = std::move(callback);
+    req->on_chunk = std::move(on_chunk);
+    req->writer.set_max_bytes(max_body_bytes_);
+    req->writer.set_html_only(html_only_);
+    req->writer.set_sink(&req->on_chunk);
+    req->start = std::chrono::steady_clock::now();
+
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        capacity_cv_.wait(lock, [this] { return !running_ || in_flight_ < max_in_flight_; });
+        if (!running_) {
+            return false;
+        }
+        in_flight_++;
+        pending_.push_back(std::move(req));
+    }
+    total_fetches_++;
+    wake();
+    return true;
+}
+
+double AsyncFetcher::average_latency_ms() const {
+    size_t total = total_fetches_.load();
+    if (total == 0) return 0.0;
+    return static_cast<double>(total_latency_ms_.load()) / total;
+}
+
+void AsyncFetcher::wake() {
+    uint64_t one = 1;
+    ssize_t n = write(wake_fd_, &one, sizeof(one));
+    (void)n;
+}
+
+void AsyncFetcher::event_loop() {
+    constexpr int kMaxEvents = 256;
+    epoll_event events[kMaxEvents];
+    int still_running = 0;
+
+    while (running_) {
+        drain_pending();
+
+        int wait_ms = 1000;
+        if (timer_armed_) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                timer_deadline_ - std::chrono::steady_clock::now()).count();
+            wait_ms = static_cast<int>(std::clamp<long long>(remaining, 0, 1000));
+        }
+
+        int n = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t count;
+                ssize_t r = read(wake_fd_, &count, sizeof(count));
+                (void)r;
+                continue;
+            }
+
+            int flags = 0;
+            if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+            curl_multi_socket_action(multi_, fd, flags, &still_running);
+        }
+
+        if (timer_armed_ && std::chrono::steady_clock::now() >= timer_deadline_) {
+            timer_armed_ = false;
+            curl_multi_socket_action(multi_, CURL_SOCKET_TIMEOUT, 0, &still_running);
+        }
+
+        process_completions();
+    }
+}
+
+void AsyncFetcher::drain_pending() {
+    std::deque<std::unique_ptr<Request>> batch;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        batch.swap(pending_);
+    }
+
+    for (auto& req : batch) {
+        Request* raw = req.get();
+        raw->easy = static_cast<CURL*>(acquire_handle(raw->host));
+        if (!raw->easy) {
+            raw->result.success = false;
+            raw->result.error_message = "Failed to initialize CURL";
+            failed_fetches_++;
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex_);
+                in_flight_--;
+            }
+            capacity_cv_.notify_one();
+            raw->callback(std::move(raw->result));
+            continue;
+        }
+        active_[raw->easy] = std::move(req);
+        start_transfer(raw);
+    }
+}
+
+void AsyncFetcher::start_transfer(Request* req) {
+    CURL* curl = req->easy;
+    req->writer.reset(curl, &req->url);
+
+    curl_easy_setopt(curl, CURLOPT_URL, req->url.c_str());
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, req);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, BodyWriter::callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &req->writer);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L); // Manual redirect handling
+    // Only http(s), for the first hop and anything a Location header points at
+    curl_easy_setopt(curl, CURLOPT_PROTOCOLS_STR, "http,https");
+    curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS_STR, "http,https");
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent_.c_str());
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout_ms_);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, read_timeout_ms_);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, verify_tls_ ? 1L : 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, verify_tls_ ? 2L : 0L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    // Prefer waiting for a multiplexable connection over opening a new one
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+
+    curl_multi_add_handle(multi_, curl);
+}
+
+void AsyncFetcher::process_completions() {
+    CURLMsg* msg;
+    int remaining = 0;
+    while ((msg = curl_multi_info_read(multi_, &remaining)) != nullptr) {
+        if (msg->msg != CURLMSG_DONE) continue;
+
+        CURL* easy = msg->easy_handle;
+        CURLcode code = msg->data.result;
+        curl_multi_remove_handle(multi_, easy);
+
+        auto it = active_.find(easy);
+        if (it == active_.end()) {
+            curl_easy_cleanup(easy);
+            continue;
+        }
+        finish_request(it->second.get(), code);
+    }
+}
+
+void AsyncFetcher::finish_request(Request* req, int code) {
+    CURL* curl = req->easy;
+    FetchResult& result = req->result;
+    req->writer.add_timings(result.timings);
+
+    if (code != CURLE_OK) {
+        result.success = false;
+        if (req->writer.aborted() != BodyWriter::Abort::NONE) {
+            // Rejected by the body writer; retrying would get the same answer
+            result.retryable = false;
+            result.error_message = req->writer.abort_reason();
+        } else {
+            result.error_message = curl_easy_strerror(static_cast<CURLcode>(code));
+        }
+        complete(req);
+        return;
+    }
+
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    result.http_status = http_code;
+
+    char* final_url = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &final_url);
+    if (final_url) {
+        result.final_url = final_url;
+    }
+
+    char* content_type = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &content_type);
+    if (content_type) {
+        result.content_type = content_type;
+    }
+
+    if (http_code >= 200 && http_code < 300) {
+        result.success = true;
+        result.content = std::move(req->writer.body());
+    } else if (http_code >= 300 && http_code < 400) {
+        char* location = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_REDIRECT_URL, &location);
+        if (location) {
+            if (req->redirect_count >= max_redirects_) {
+                result.success = false;
+                result.error_message = "Too many redirects";
+                complete(req);
+                return;
+            }
+
+            // Follow on a handle for the new host; the connection cache in the
+            // multi handle keeps the old host's connection alive
+            std::string next_url = location;
+            result.redirects.push_back(next_url);
+            req->redirect_count++;
+
+            std::string next_host = UrlUtils::extract_domain(next_url);
+            if (next_host != req->host) {
+                CURL* next = static_cast<CURL*>(acquire_handle(next_host));
+                if (next) {
+                    auto owned = std::move(active_[curl]);
+                    active_.erase(curl);
+                    release_handle(req->host, curl);
+                    req->easy = next;
+                    req->host = next_host;
+                    active_[next] = std::move(owned);
+                }
+            }
+            req->url = next_url;
+            start_transfer(req);
+            return;
+        }
+    }
+
+    if (!result.success && result.error_message.empty()) {
+        result.error_message = "HTTP status " + std::to_string(http_code);
+    }
+    complete(req);
+}
+
+void AsyncFetcher::complete(Request* req) {
+    auto it = active_.find(req->easy);
+    std::unique_ptr<Request> owned = std::move(it->second);
+    active_.erase(it);
+    release_handle(req->host, req->easy);
+
+    FetchResult& result = req->result;
+    result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - req->start);
+    total_latency_ms_ += result.latency.count();
+
+    if (result.success) {
+        successful_fetches_++;
+        result.content_hash = std::to_string(HashUtils::hash_content(result.content));
+        result.content_size = result.content.size();
+    } else {
+        failed_fetches_++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        in_flight_--;
+    }
+    capacity_cv_.notify_one();
+
+    req->callback(std::move(result));
+}
+
+void* AsyncFetcher::acquire_handle(const std::string& host) {
+    auto it = idle_handles_.find(host);
+    if (it != idle_handles_.end() && !it->second.empty()) {
+        CURL* easy = static_cast<CURL*>(it->second.back());
+        it->second.pop_back();
+        idle_handle_count_--;
+        if (it->second.empty()) {
+            idle_handles_.erase(it);
+        }
+        // Reset options but keep the handle's DNS and TLS session caches
+        curl_easy_reset(easy);
+        reused_handles_++;
+        return easy;
+    }
+    return curl_easy_init();
+}
+
+void AsyncFetcher::release_handle(const std::string& host, void* easy) {
+    auto& handles = idle_handles_[host];
+    if (handles.size() >= max_idle_handles_per_host_ ||
+        idle_handle_count_ >= static_cast<size_t>(max_total_connections_)) {
+        curl_easy_cleanup(easy);
+        return;
+    }
+    handles.push_back(easy);
+    idle_handle_count_++;
+}
+
+int AsyncFetcher::socket_callback(void* easy, int fd, int what, void* userp, void* socketp) {
+    (void)easy;
+    AsyncFetcher* self = static_cast<AsyncFetcher*>(userp);
+
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(self->epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        curl_multi_assign(self->multi_, fd, nullptr);
+        return 0;
+    }
+
+    epoll_event ev{};
+    ev.data.fd = fd;
+    if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) ev.events |= EPOLLIN;
+    if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) ev.events |= EPOLLOUT;
+
+    if (socketp) {
+        epoll_ctl(self->epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+    } else {
+        epoll_ctl(self->epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+        // Any non-null marker: this socket is registered with epoll
+        curl_multi_assign(self->multi_, fd, self);
+    }
+    return 0;
+}
+
+int AsyncFetcher::timer_callback(void* multi, long timeout_ms, void* userp) {
+    (void)multi;
+    AsyncFetcher* self = static_cast<AsyncFetcher*>(userp);
+    if (timeout_ms < 0) {
+        self->timer_armed_ = false;
+    } else {
+        self->timer_armed_ = true;
+        self->timer_deadline_ = std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(timeout_ms);
+    }
+    return 0;
+}
+
+} // namespace crawler
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
+#include "fetcher.h"
+
+namespace crawler {
+
+// Completion callback; runs on the fetcher's event loop thread
+using FetchCallback = std::function<void(FetchResult result)>;
+
+// Non-blocking fetch backend the pipeline dispatches to: the curl_multi
+// engine below, or ReplayFetcher serving a recorded corpus offline
+class FetchEngine {
+public:
+    virtual ~FetchEngine() = default;
+
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+    virtual bool submit(const std::string& url, FetchCallback callback, BodyChunkCallback on_chunk) = 0;
+};
+
+// Event-driven fetch engine on curl_multi + epoll.
+// One loop thread drives thousands of concurrent transfers; connections are
+// kept alive in the multi handle's cache and multiplexed over HTTP/2 where
+// the server supports it. Easy handles are pooled per host and reused.
+class AsyncFetcher : public FetchEngine {
+public:
+    AsyncFetcher();
+    ~AsyncFetcher() override;
+
+    // Start / stop the event loop thread. stop() fails outstanding requests.
+    bool start() override;
+    void stop() override;
+
+    // Queue a request. Blocks while max_in_flight requests are outstanding;
+    // returns false if the fetcher is stopped. on_chunk, if set, sees the
+    // body as it arrives, on the loop thread.
+    bool submit(const std::string& url, FetchCallback callback, BodyChunkCallback on_chunk = {}) override;
+
+    // Limits (take effect for handles created after the call)
+    void set_max_in_flight(size_t max) { max_in_flight_ = max; }
+    void set_max_host_connections(long max) { max_host_connections_ = max; }
+    void set_max_total_connections(long max) { max_total_connections_ = max; }
+
+    // Statistics
+    size_t in_flight() const { return in_flight_; }
+    size_t total_fetches() const { return total_fetches_; }
+    size_t successful_fetches() const { return successful_fetches_; }
+    size_t failed_fetches() const { return failed_fetches_; }
+    size_t reused_handles() const { return reused_handles_; }
+    double average_latency_ms() const;
+
+private:
+    struct Request;
+
+    void event_loop();
+    void wake();
+    void drain_pending();
+    void process_completions();
+    void start_transfer(Request* req);
+    void finish_request(Request* req, int code);
+    void complete(Request* req);
+
+    void* acquire_handle(const std::string& host);
+    void release_handle(const std::string& host, void* easy);
+
+    static int socket_callback(void* easy, int fd, int what, void* userp, void* socketp);
+    static int timer_callback(void* multi, long timeout_ms, void* userp);
+
+    void* multi_ = nullptr; // CURLM*
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+
+    // Next libcurl timeout, owned by the loop thread
+    bool timer_armed_ = false;
+    std::chrono::steady_clock::time_point timer_deadline_;
+
+    std::deque<std::unique_ptr<Request>> pending_;
+    std::mutex pending_mutex_;
+    std::condition_variable capacity_cv_;
+
+    // Loop-thread only: transfers owned by the multi handle, idle handles per host
+    std::unordered_map<void*, std::unique_ptr<Request>> active_;
+    std::unordered_map<std::string, std::vector<void*>> idle_handles_;
+    size_t idle_handle_count_ = 0;
+
+    std::thread loop_thread_;
+    std::atomic<bool> running_{false};
+
+    int connect_timeout_ms_ = 5000;
+    int read_timeout_ms_ = 10000;
+    int max_redirects_ = 5;
+    std::string user_agent_ = "WebCrawler/1.0";
+    bool verify_tls_ = true;
+    size_t max_body_bytes_ = 0;
+    bool html_only_ = false;
+    size_t max_in_flight_ = 1000;
+    long max_host_connections_ = 6;
+    long max_total_connections_ = 512;
+    size_t max_idle_handles_per_host_ = 8;
+
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<size_t> total_fetches_{0};
+    std::atomic<size_t> successful_fetches_{0};
+    std::atomic<size_t> failed_fetches_{0};
+    std::atomic<size_t> reused_handles_{0};
+    std::atomic<uint64_t> total_latency_ms_{0};
+};
+
+} // namespace crawler
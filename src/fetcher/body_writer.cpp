@@ -0,0 +1,124 @@
+#include "body_writer.h"
+#include <curl/curl.h>
+#include <strings.h>
+#include <algorithm>
+
+namespace crawler {
+
+void BodyWriter::reset(void* curl, const std::string* url) {
+    curl_ = curl;
+    url_ = url;
+    body_.clear();
+    content_type_.clear();
+    started_ = false;
+    streaming_ = false;
+    abort_ = Abort::NONE;
+}
+
+size_t BodyWriter::callback(void* contents, size_t size, size_t nmemb, void* userp) {
+    return static_cast<BodyWriter*>(userp)->write(static_cast<const char*>(contents), size * nmemb);
+}
+
+bool BodyWriter::start() {
+    // Headers are complete by the time the first body byte arrives
+    CURL* curl = static_cast<CURL*>(curl_);
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code < 200 || http_code >= 300) {
+        // Redirect and error bodies are only size-capped
+        return true;
+    }
+
+    char* content_type = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &content_type);
+    if (content_type) {
+        content_type_ = content_type;
+    }
+    if (html_only_ && !content_type_.empty() && !is_html(content_type_)) {
+        abort_ = Abort::NOT_HTML;
+        return false;
+    }
+
+    // Compressed length is a lower bound of what we will be handed
+    curl_off_t length = -1;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    if (length > 0) {
+        if (max_bytes_ > 0 && static_cast<size_t>(length) > max_bytes_) {
+            abort_ = Abort::TOO_LARGE;
+            return false;
+        }
+        body_.reserve(static_cast<size_t>(length));
+    }
+
+    streaming_ = sink_ && *sink_;
+    return true;
+}
+
+size_t BodyWriter::write(const char* data, size_t size) {
+    if (!started_) {
+        started_ = true;
+        if (!start()) return 0;
+    }
+    if (max_bytes_ > 0 && body_.size() + size > max_bytes_) {
+        abort_ = Abort::TOO_LARGE;
+        return 0;
+    }
+
+    body_.append(data, size);
+    if (streaming_) {
+        (*sink_)(*url_, std::string_view(data, size));
+    }
+    return size;
+}
+
+std::string BodyWriter::abort_reason() const {
+    switch (abort_) {
+        case Abort::TOO_LARGE:
+            return "Body exceeds " + std::to_string(max_bytes_) + " bytes";
+        case Abort::NOT_HTML:
+            return "Not HTML: " + content_type_;
+        default:
+            return "";
+    }
+}
+
+void BodyWriter::add_timings(FetchTimings& timings) const {
+    // libcurl reports each phase's end in microseconds since the hop
+    // started; a phase that did not happen (TLS over http, or what a
+    // failed hop never reached) reads 0
+    CURL* curl = static_cast<CURL*>(curl_);
+    curl_off_t dns = 0, connect = 0, tls = 0, first_byte = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    connect = std::max(connect, dns);
+    tls = std::max(tls, connect);
+    first_byte = std::max(first_byte, tls);
+    total = std::max(total, first_byte);
+    timings.dns_ms += static_cast<double>(dns) / 1000.0;
+    timings.connect_ms += static_cast<double>(connect - dns) / 1000.0;
+    timings.tls_ms += static_cast<double>(tls - connect) / 1000.0;
+    timings.ttfb_ms += static_cast<double>(first_byte - tls) / 1000.0;
+    timings.download_ms += static_cast<double>(total - first_byte) / 1000.0;
+}
+
+bool BodyWriter::is_html(std::string_view content_type) {
+    while (!content_type.empty() && (content_type.front() == ' ' || content_type.front() == '\t')) {
+        content_type.remove_prefix(1);
+    }
+    for (std::string_view type : {std::string_view("text/html"), std::string_view("application/xhtml+xml")}) {
+        if (content_type.size() < type.size() ||
+            strncasecmp(content_type.data(), type.data(), type.size()) != 0) {
+            continue;
+        }
+        if (content_type.size() == type.size()) return true;
+        char next = content_type[type.size()];
+        if (next == ';' || next == ' ' || next == '\t') return true;
+    }
+    return false;
+}
+
+} // namespace crawler
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include "fetcher.h"
+
+namespace crawler {
+
+// Write-callback state for one transfer hop, shared by Fetcher and
+// AsyncFetcher. On the first body byte it checks the status and
+// Content-Type; afterwards it caps the body size and hands 2xx chunks to
+// the caller's sink as they arrive. write() returning short makes libcurl
+// abort the transfer with CURLE_WRITE_ERROR.
+class BodyWriter {
+public:
+    enum class Abort { NONE, TOO_LARGE, NOT_HTML };
+
+    // Rearm for a new hop; keeps the body buffer's capacity
+    void reset(void* curl, const std::string* url);
+
+    // Limits; max_bytes 0 means unlimited
+    void set_max_bytes(size_t max_bytes) { max_bytes_ = max_bytes; }
+    void set_html_only(bool html_only) { html_only_ = html_only; }
+    void set_sink(const BodyChunkCallback* sink) { sink_ = sink; }
+
+    // CURLOPT_WRITEFUNCTION with CURLOPT_WRITEDATA = this
+    static size_t callback(void* contents, size_t size, size_t nmemb, void* userp);
+
+    std::string& body() { return body_; }
+    Abort aborted() const { return abort_; }
+
+    // Error message for a transfer write() cut short, empty otherwise
+    std::string abort_reason() const;
+
+    // Adds the finished hop's phase times to `timings`
+    void add_timings(FetchTimings& timings) const;
+
+    // text/html or application/xhtml+xml, parameters and case ignored
+    static bool is_html(std::string_view content_type);
+
+private:
+    size_t write(const char* data, size_t size);
+    bool start();
+
+    void* curl_ = nullptr; // CURL*
+    const std::string* url_ = nullptr;
+    std::string body_;
+    std::string content_type_;
+    size_t max_bytes_ = 0;
+    bool html_only_ = false;
+    const BodyChunkCallback* sink_ = nullptr;
+
+    bool started_ = false;
+    bool streaming_ = false;
+    Abort abort_ = Abort::NONE;
+};
+
+} // namespace crawler
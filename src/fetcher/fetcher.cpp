@@ -1,4 +1,5 @@
 #include "fetcher.h"
+#include "body_writer.h"
 #include "../utils/config.h"
 #include "../utils/hash_utils.h"
 #include <curl/curl.h>
@@ -9,16 +10,28 @@ namespace crawler {
 
 static std::once_flag curl_init_flag;
 
-struct CurlWriteData {
-    std::string data;
+// One easy handle per thread, reused across requests and redirect hops so
+// the connection, DNS and TLS session caches survive between fetches
+struct ThreadCurlHandle {
+    CURL* handle = nullptr;
+    
+    ~ThreadCurlHandle() {
+        if (handle) {
+            curl_easy_cleanup(handle);
+        }
+    }
+    
+    CURL* acquire() {
+        if (!handle) {
+            handle = curl_easy_init();
+        } else {
+            curl_easy_reset(handle);
+        }
+        return handle;
+    }
 };
 
-static size_t curl_write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
-    size_t total_size = size * nmemb;
-    CurlWriteData* data = static_cast<CurlWriteData*>(userp);
-    data->data.append(static_cast<char*>(contents), total_size);
-    return total_size;
-}
+static thread_local ThreadCurlHandle thread_curl;
 
 Fetcher::Fetcher() {
     std::call_once(curl_init_flag, []() {
@@ -30,17 +43,20 @@ Fetcher::Fetcher() {
     read_timeout_ms_ = config.fetcher_read_timeout_ms();
     max_redirects_ = config.fetcher_max_redirects();
     user_agent_ = config.fetcher_user_agent();
+    verify_tls_ = config.fetcher_verify_tls();
+    max_body_bytes_ = config.fetcher_max_body_bytes();
+    html_only_ = config.fetcher_html_only();
 }
 
 Fetcher::~Fetcher() {
     // curl_global_cleanup(); // Don't cleanup, might be used elsewhere
 }
 
-FetchResult Fetcher::fetch(const std::string& url) {
+FetchResult Fetcher::fetch(const std::string& url, const BodyChunkCallback& on_chunk) {
     total_fetches_++;
     auto start = std::chrono::steady_clock::now();
     
-    FetchResult result = fetch_impl(url, 0);
+    FetchResult result = fetch_impl(url, 0, on_chunk);
     
     auto end = std::chrono::steady_clock::now();
     result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -48,7 +64,7 @@ FetchResult Fetcher::fetch(const std::string& url) {
     
     if (result.success) {
         successful_fetches_++;
-        result.content_hash = HashUtils::hash_content(result.content);
+        result.content_hash = std::to_string(HashUtils::hash_content(result.content));
         result.content_size = result.content.size();
     } else {
         failed_fetches_++;
@@ -57,7 +73,8 @@ FetchResult Fetcher::fetch(const std::string& url) {
     return result;
 }
 
-FetchResult Fetcher::fetch_impl(const std::string& url, int redirect_count) {
+FetchResult Fetcher::fetch_impl(const std::string& url, int redirect_count,
+                                const BodyChunkCallback& on_chunk) {
     if (redirect_count > max_redirects_) {
         FetchResult result;
         result.success = false;
@@ -65,7 +82,7 @@ FetchResult Fetcher::fetch_impl(const std::string& url, int redirect_count) {
         return result;
     }
     
-    CURL* curl = curl_easy_init();
+    CURL* curl = thread_curl.acquire();
     if (!curl) {
         FetchResult result;
         result.success = false;
@@ -73,19 +90,31 @@ FetchResult Fetcher::fetch_impl(const std::string& url, int redirect_count) {
         return result;
     }
     
-    CurlWriteData write_data;
+    BodyWriter writer;
+    writer.reset(curl, &url);
+    writer.set_max_bytes(max_body_bytes_);
+    writer.set_html_only(html_only_);
+    writer.set_sink(&on_chunk);
     FetchResult result;
     
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &write_data);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, BodyWriter::callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &writer);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L); // Manual redirect handling
+    // Only http(s), for the first hop and anything a Location header points at
+    curl_easy_setopt(curl, CURLOPT_PROTOCOLS_STR, "http,https");
+    curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS_STR, "http,https");
     curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent_.c_str());
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout_ms_);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, read_timeout_ms_);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L); // For testing
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, verify_tls_ ? 1L : 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, verify_tls_ ? 2L : 0L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
     
     CURLcode res = curl_easy_perform(curl);
+    writer.add_timings(result.timings);
     
     if (res == CURLE_OK) {
         long http_code;
@@ -106,28 +135,32 @@ FetchResult Fetcher::fetch_impl(const std::string& url, int redirect_count) {
         
         if (http_code >= 200 && http_code < 300) {
             result.success = true;
-            result.content = write_data.data;
+            result.content = std::move(writer.body());
         } else if (http_code >= 300 && http_code < 400) {
             // Handle redirect
             char* location = nullptr;
             curl_easy_getinfo(curl, CURLINFO_REDIRECT_URL, &location);
             if (location) {
                 result.redirects.push_back(location);
-                // Recursively follow redirect
-                FetchResult redirect_result = fetch_impl(location, redirect_count + 1);
+                // Recursively follow redirect (reuses this thread's handle)
+                FetchResult redirect_result = fetch_impl(result.redirects.back(), redirect_count + 1, on_chunk);
                 redirect_result.redirects.insert(redirect_result.redirects.begin(), 
                                                 result.redirects.begin(), 
                                                 result.redirects.end());
-                curl_easy_cleanup(curl);
+                redirect_result.timings.add(result.timings);
                 return redirect_result;
             }
         }
+    } else if (writer.aborted() != BodyWriter::Abort::NONE) {
+        // Rejected by the body writer; retrying would get the same answer
+        result.success = false;
+        result.retryable = false;
+        result.error_message = writer.abort_reason();
     } else {
         result.success = false;
         result.error_message = curl_easy_strerror(res);
     }
     
-    curl_easy_cleanup(curl);
     return result;
 }
 
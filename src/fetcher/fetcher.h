@@ -1,12 +1,35 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 #include <memory>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 
 namespace crawler {
 
+// libcurl's phases of a transfer, summed over redirect hops
+struct FetchTimings {
+    double dns_ms = 0;
+    double connect_ms = 0;
+    double tls_ms = 0;
+    double ttfb_ms = 0;     // connected to first response byte
+    double download_ms = 0; // first byte to last
+
+    double total_ms() const { return dns_ms + connect_ms + tls_ms + ttfb_ms + download_ms; }
+
+    void add(const FetchTimings& other) {
+        dns_ms += other.dns_ms;
+        connect_ms += other.connect_ms;
+        tls_ms += other.tls_ms;
+        ttfb_ms += other.ttfb_ms;
+        download_ms += other.download_ms;
+    }
+};
+
 struct FetchResult {
     bool success = false;
     int http_status = 0;
@@ -14,21 +37,27 @@ struct FetchResult {
     std::string final_url;
     std::string content_type;
     std::chrono::milliseconds latency{0};
+    FetchTimings timings;
     std::vector<std::string> redirects;
     std::string error_message;
+    bool retryable = true; // false when the response was rejected (size, type)
     
     // Metadata
     std::string content_hash;
     size_t content_size = 0;
 };
 
+// Receives a 2xx body while it downloads: the URL of the current hop and
+// the next chunk. Runs on the fetching thread and must not block.
+using BodyChunkCallback = std::function<void(const std::string& url, std::string_view chunk)>;
+
 class Fetcher {
 public:
     Fetcher();
     ~Fetcher();
     
-    // Fetch URL
-    FetchResult fetch(const std::string& url);
+    // Fetch URL; on_chunk, if set, sees the body as it arrives
+    FetchResult fetch(const std::string& url, const BodyChunkCallback& on_chunk = {});
     
     // Set timeout
     void set_connect_timeout(int ms);
@@ -47,13 +76,16 @@ public:
     double average_latency_ms() const;
 
 private:
-    FetchResult fetch_impl(const std::string& url, int redirect_count);
+    FetchResult fetch_impl(const std::string& url, int redirect_count, const BodyChunkCallback& on_chunk);
     std::string make_request(const std::string& url);
     
     int connect_timeout_ms_ = 5000;
     int read_timeout_ms_ = 10000;
     int max_redirects_ = 5;
     std::string user_agent_ = "WebCrawler/1.0";
+    bool verify_tls_ = true;
+    size_t max_body_bytes_ = 0;
+    bool html_only_ = false;
     
     std::atomic<size_t> total_fetches_{0};
     std::atomic<size_t> successful_fetches_{0};
@@ -0,0 +1,487 @@
+#include "replay_fetcher.h"
+#include "../utils/config.h"
+#include "../utils/hash_utils.h"
+#include "../utils/url_utils.h"
+#include "../observability/logger.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string_view>
+
+namespace crawler {
+
+namespace {
+
+constexpr std::string_view kSyntheticPrefix = "site";
+constexpr std::string_view kSyntheticSuffix = ".replay.test";
+constexpr size_t kChunkBytes = 16 * 1024; // bodies reach on_chunk in pieces this size
+constexpr double kZ99 = 2.3263;           // standard normal 99th percentile
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Log-normal draw with the given median and 99th percentile
+double draw_lognormal(std::mt19937_64& rng, double median, double p99) {
+    if (median <= 0) return 0;
+    double sigma = p99 > median ? std::log(p99 / median) / kZ99 : 0.0;
+    std::normal_distribution<double> normal(0.0, 1.0);
+    return median * std::exp(sigma * normal(rng));
+}
+
+double draw_uniform(std::mt19937_64& rng) {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+// Pronounceable filler words, so pages tokenize like text and differ
+// enough not to look like near-duplicates of one another
+const std::vector<std::string>& vocabulary() {
+    static const std::vector<std::string> words = []() {
+        static const char* kSyllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "ti", "vo",
+                                           "ber", "dan", "fel", "gor", "han", "jus", "mar", "pel"};
+        std::vector<std::string> out;
+        for (const char* a : kSyllables) {
+            for (const char* b : kSyllables) {
+                for (const char* c : kSyllables) {
+                    out.push_back(std::string(a) + b + c);
+                }
+            }
+        }
+        return out;
+    }();
+    return words;
+}
+
+bool read_file(const std::string& path, std::string& out) {
+    gzFile file = gzopen(path.c_str(), "rb"); // reads plain files too
+    if (!file) return false;
+    out.clear();
+    char buffer[64 * 1024];
+    int n;
+    while ((n = gzread(file, buffer, sizeof(buffer))) > 0) {
+        out.append(buffer, static_cast<size_t>(n));
+    }
+    bool ok = n == 0;
+    gzclose(file);
+    return ok;
+}
+
+std::string_view header_value(std::string_view headers, std::string_view name) {
+    size_t pos = 0;
+    while (pos < headers.size()) {
+        size_t end = headers.find("\r\n", pos);
+        if (end == std::string_view::npos) end = headers.size();
+        std::string_view line = headers.substr(pos, end - pos);
+        if (line.size() > name.size() && line[name.size()] == ':' &&
+            std::equal(name.begin(), name.end(), line.begin(),
+                       [](char a, char b) { return std::tolower(a) == std::tolower(b); })) {
+            std::string_view value = line.substr(name.size() + 1);
+            while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+            return value;
+        }
+        pos = end + 2;
+    }
+    return {};
+}
+
+} // namespace
+
+ReplayFetcher::ReplayFetcher(ReplayOptions options) : options_(std::move(options)) {
+    auto& config = Config::instance();
+    max_in_flight_ = config.fetcher_max_in_flight();
+    read_timeout_ms_ = config.fetcher_read_timeout_ms();
+    max_redirects_ = config.fetcher_max_redirects();
+    max_body_bytes_ = config.fetcher_max_body_bytes();
+}
+
+ReplayFetcher::~ReplayFetcher() {
+    stop();
+}
+
+bool ReplayFetcher::load() {
+    corpus_.clear();
+    corpus_urls_.clear();
+    redirects_.clear();
+    if (options_.corpus.empty()) return true;
+
+    std::error_code error;
+    bool ok = std::filesystem::is_directory(options_.corpus, error)
+        ? load_directory(options_.corpus)
+        : load_warc(options_.corpus);
+    if (ok) {
+        Logger::instance().info("Replaying " + std::to_string(corpus_.size()) + " pages from " + options_.corpus);
+    }
+    return ok;
+}
+
+bool ReplayFetcher::load_warc(const std::string& path) {
+    std::string data;
+    if (!read_file(path, data)) {
+        Logger::instance().error("Cannot read WARC file " + path);
+        return false;
+    }
+
+    std::string_view rest(data);
+    while (!rest.empty()) {
+        size_t header_end = rest.find("\r\n\r\n");
+        if (rest.rfind("WARC/", 0) != 0 || header_end == std::string_view::npos) break;
+        std::string_view headers = rest.substr(0, header_end);
+        std::string_view length_text = header_value(headers, "Content-Length");
+        size_t length = 0;
+        std::from_chars(length_text.data(), length_text.data() + length_text.size(), length);
+        size_t body_start = header_end + 4;
+        if (body_start + length > rest.size()) {
+            Logger::instance().warn("Truncated WARC record in " + path);
+            break;
+        }
+        std::string_view body = rest.substr(body_start, length);
+        rest.remove_prefix(std::min(rest.size(), body_start + length + 4));
+
+        std::string_view type = header_value(headers, "WARC-Type");
+        std::string url(header_value(headers, "WARC-Target-URI"));
+        if (url.empty()) continue;
+        if (type == "response") {
+            // Body is the HTTP response; keep what follows its headers, or
+            // where a redirect points
+            size_t http_end = body.find("\r\n\r\n");
+            if (http_end == std::string_view::npos) continue;
+            std::string_view http_headers = body.substr(0, http_end);
+            int status = 0;
+            size_t space = http_headers.find(' ');
+            if (space != std::string_view::npos) {
+                std::from_chars(http_headers.data() + space + 1, http_headers.data() + http_headers.size(), status);
+            }
+            std::string_view location = header_value(http_headers, "Location");
+            if (status >= 300 && status < 400 && !location.empty()) {
+                redirects_.emplace(url, std::make_pair(status, UrlUtils::resolve(url, std::string(location))));
+                continue;
+            }
+            body.remove_prefix(http_end + 4);
+        } else if (type != "resource") {
+            continue;
+        }
+        auto [it, inserted] = corpus_.emplace(url, std::string(body));
+        if (inserted) corpus_urls_.push_back(url);
+    }
+    return true;
+}
+
+bool ReplayFetcher::load_directory(const std::string& dir) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    std::vector<fs::path> files;
+    for (auto it = fs::recursive_directory_iterator(dir, error); !error && it != fs::recursive_directory_iterator();
+         it.increment(error)) {
+        if (it->is_regular_file(error)) files.push_back(it->path());
+    }
+    if (error) {
+        Logger::instance().error("Cannot list corpus directory " + dir + ": " + error.message());
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+
+    // <host>/<path> is served as https://<host>/<path>, with index.html as
+    // its directory; a top-level <host>.html is that host's front page
+    for (const auto& file : files) {
+        std::string relative = fs::relative(file, dir, error).generic_string();
+        if (relative.empty() || relative.front() == '.') continue;
+        std::string url;
+        size_t slash = relative.find('/');
+        if (slash == std::string::npos) {
+            if (file.extension() != ".html") continue;
+            url = "https://" + file.stem().string() + "/";
+        } else {
+            url = "https://" + relative;
+            constexpr std::string_view kIndex = "/index.html";
+            if (url.size() > kIndex.size() && url.compare(url.size() - kIndex.size(), kIndex.size(), kIndex) == 0) {
+                url.resize(url.size() - kIndex.size() + 1);
+            }
+        }
+
+        std::ifstream in(file, std::ios::binary);
+        std::ostringstream body;
+        body << in.rdbuf();
+        auto [it, inserted] = corpus_.emplace(url, body.str());
+        if (inserted) corpus_urls_.push_back(url);
+    }
+    return true;
+}
+
+std::vector<std::string> ReplayFetcher::seed_urls() const {
+    std::vector<std::string> seeds = corpus_urls_;
+    for (size_t host = 0; host < options_.hosts; host++) {
+        seeds.push_back("https://" + std::string(kSyntheticPrefix) + std::to_string(host) +
+                        std::string(kSyntheticSuffix) + "/");
+    }
+    return seeds;
+}
+
+bool ReplayFetcher::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return true;
+    running_ = true;
+    timer_thread_ = std::thread(&ReplayFetcher::timer_loop, this);
+    return true;
+}
+
+void ReplayFetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    timer_cv_.notify_all();
+    capacity_cv_.notify_all();
+    if (timer_thread_.joinable()) {
+        timer_thread_.join();
+    }
+
+    // Fail whatever had not completed yet
+    std::unordered_map<Request*, std::unique_ptr<Request>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.swap(pending_);
+        timers_ = {};
+    }
+    for (auto& [raw, request] : pending) {
+        request->result = FetchResult{};
+        request->result.error_message = "Fetcher stopped";
+        complete(std::move(request));
+    }
+}
+
+bool ReplayFetcher::submit(const std::string& url, FetchCallback callback, BodyChunkCallback on_chunk) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        capacity_cv_.wait(lock, [this] { return !running_ || in_flight_ < max_in_flight_; });
+        if (!running_) return false;
+        in_flight_++;
+    }
+
+    uint32_t attempt;
+    {
+        std::lock_guard<std::mutex> lock(attempts_mutex_);
+        attempt = attempts_[url]++;
+    }
+
+    auto request = std::make_unique<Request>();
+    request->start = std::chrono::steady_clock::now();
+    request->callback = std::move(callback);
+    request->on_chunk = std::move(on_chunk);
+    double delay_ms = respond(url, attempt, request->result);
+    request->due = request->start + std::chrono::microseconds(static_cast<int64_t>(delay_ms * 1000));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            // Stopped while the response was being built
+            in_flight_--;
+            return false;
+        }
+        Request* raw = request.get();
+        timers_.push(Due{raw->due, sequence_++, raw});
+        pending_.emplace(raw, std::move(request));
+    }
+    total_fetches_++;
+    timer_cv_.notify_one();
+    return true;
+}
+
+double ReplayFetcher::respond(const std::string& url, uint32_t attempt, FetchResult& result) {
+    uint64_t url_hash = HashUtils::xxhash(url);
+    std::mt19937_64 rng(mix(url_hash ^ mix(options_.seed + attempt)));
+    result.final_url = url;
+    result.timings.ttfb_ms = draw_lognormal(rng, options_.latency_median_ms, options_.latency_p99_ms);
+
+    if (draw_uniform(rng) < options_.timeout_rate) {
+        result.error_message = "Timeout was reached";
+        result.timings.ttfb_ms = read_timeout_ms_;
+        return read_timeout_ms_;
+    }
+    if (draw_uniform(rng) < options_.error_rate) {
+        result.http_status = 503;
+        result.error_message = "HTTP status 503";
+        return result.timings.ttfb_ms;
+    }
+
+    // Each hop costs another time to first byte
+    std::string target = url;
+    for (auto hop = redirects_.find(target); hop != redirects_.end(); hop = redirects_.find(target)) {
+        if (result.redirects.size() >= static_cast<size_t>(max_redirects_)) {
+            result.http_status = hop->second.first;
+            result.error_message = "Too many redirects";
+            return result.timings.ttfb_ms;
+        }
+        target = hop->second.second;
+        result.redirects.push_back(target);
+        result.final_url = target;
+        result.timings.ttfb_ms += draw_lognormal(rng, options_.latency_median_ms, options_.latency_p99_ms);
+    }
+
+    std::string body;
+    auto it = corpus_.find(target);
+    if (it != corpus_.end()) {
+        body = it->second;
+    } else if (!synthetic_page(target, body)) {
+        result.http_status = 404;
+        result.error_message = "HTTP status 404";
+        return result.timings.ttfb_ms;
+    }
+
+    double bytes_per_ms = options_.bandwidth_mbps * 1e6 / 8 / 1000;
+    if (bytes_per_ms > 0) {
+        result.timings.download_ms = static_cast<double>(body.size()) / bytes_per_ms;
+    }
+    result.http_status = 200;
+    result.content_type = "text/html; charset=utf-8";
+    if (max_body_bytes_ > 0 && body.size() > max_body_bytes_) {
+        result.retryable = false;
+        result.error_message = "Body exceeds " + std::to_string(max_body_bytes_) + " bytes";
+    } else {
+        result.success = true;
+        result.content = std::move(body);
+    }
+    return result.timings.total_ms();
+}
+
+bool ReplayFetcher::synthetic_page(const std::string& url, std::string& html) const {
+    std::string_view rest(url);
+    for (std::string_view scheme : {"https://", "http://"}) {
+        if (rest.rfind(scheme, 0) == 0) {
+            rest.remove_prefix(scheme.size());
+            break;
+        }
+    }
+    size_t slash = rest.find('/');
+    std::string_view host = rest.substr(0, slash);
+    std::string_view path = slash == std::string_view::npos ? std::string_view("/") : rest.substr(slash);
+    if (host.size() <= kSyntheticPrefix.size() + kSyntheticSuffix.size() ||
+        host.rfind(kSyntheticPrefix, 0) != 0 ||
+        host.compare(host.size() - kSyntheticSuffix.size(), kSyntheticSuffix.size(), kSyntheticSuffix) != 0) {
+        return false;
+    }
+    std::string_view host_digits = host.substr(kSyntheticPrefix.size(),
+                                               host.size() - kSyntheticPrefix.size() - kSyntheticSuffix.size());
+    size_t host_id = 0;
+    auto parsed = std::from_chars(host_digits.data(), host_digits.data() + host_digits.size(), host_id);
+    if (parsed.ec != std::errc() || parsed.ptr != host_digits.data() + host_digits.size() ||
+        host_id >= options_.hosts) {
+        return false;
+    }
+
+    // "/" is page 0; the rest are /p/<n>
+    size_t page = 0;
+    if (path != "/") {
+        if (path.rfind("/p/", 0) != 0) return false;
+        std::string_view digits = path.substr(3);
+        parsed = std::from_chars(digits.data(), digits.data() + digits.size(), page);
+        if (parsed.ec != std::errc() || parsed.ptr != digits.data() + digits.size() ||
+            page == 0 || page >= options_.pages_per_host) {
+            return false;
+        }
+    }
+
+    const auto& words = vocabulary();
+    std::mt19937_64 rng(mix(mix(options_.seed) ^ (host_id << 32) ^ page));
+    auto word = [&]() -> const std::string& { return words[rng() % words.size()]; };
+    size_t target = static_cast<size_t>(
+        draw_lognormal(rng, options_.page_kb_median, options_.page_kb_p99) * 1024);
+    target = std::clamp<size_t>(target, 512, static_cast<size_t>(std::max(options_.page_kb_p99, 1.0) * 8 * 1024));
+
+    html.clear();
+    html.reserve(target + 256);
+    html += "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>";
+    html += word() + " " + word() + " " + word();
+    html += "</title><meta name=\"description\" content=\"";
+    html += word() + " " + word() + " " + word() + " " + word();
+    html += "\"></head><body><nav><ul>";
+    for (int i = 0; i < options_.links_per_page && options_.pages_per_host > 1; i++) {
+        size_t target_page = 1 + rng() % (options_.pages_per_host - 1);
+        html += "<li><a href=\"";
+        if (options_.hosts > 1 && draw_uniform(rng) < options_.cross_host_links) {
+            html += "https://";
+            html += kSyntheticPrefix;
+            html += std::to_string(rng() % options_.hosts);
+            html += kSyntheticSuffix;
+        }
+        html += "/p/" + std::to_string(target_page) + "\">" + word() + "</a></li>";
+    }
+    html += "</ul></nav><main><h1>" + word() + " " + word() + "</h1>";
+    while (html.size() < target) {
+        html += "<p>";
+        for (int i = 0; i < 40; i++) {
+            html += word();
+            html += ' ';
+        }
+        html += "</p>";
+    }
+    html += "</main></body></html>";
+    return true;
+}
+
+void ReplayFetcher::timer_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (timers_.empty()) {
+            timer_cv_.wait(lock);
+            continue;
+        }
+        auto due = timers_.top().due;
+        if (std::chrono::steady_clock::now() < due) {
+            timer_cv_.wait_until(lock, due);
+            continue;
+        }
+        Request* raw = timers_.top().request;
+        timers_.pop();
+        auto it = pending_.find(raw);
+        std::unique_ptr<Request> request = std::move(it->second);
+        pending_.erase(it);
+
+        lock.unlock();
+        complete(std::move(request));
+        lock.lock();
+    }
+}
+
+void ReplayFetcher::complete(std::unique_ptr<Request> request) {
+    FetchResult& result = request->result;
+    auto now = std::chrono::steady_clock::now();
+    result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(now - request->start);
+    busy_us_ += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - request->start).count());
+
+    if (result.success) {
+        successful_fetches_++;
+        bytes_served_ += result.content.size();
+        result.content_hash = std::to_string(HashUtils::hash_content(result.content));
+        result.content_size = result.content.size();
+        if (request->on_chunk) {
+            std::string_view body(result.content);
+            for (size_t offset = 0; offset < body.size(); offset += kChunkBytes) {
+                request->on_chunk(result.final_url, body.substr(offset, kChunkBytes));
+            }
+        }
+    } else {
+        failed_fetches_++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_--;
+    }
+    capacity_cv_.notify_one();
+
+    request->callback(std::move(result));
+}
+
+} // namespace crawler
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <unordered_map>
+#include "async_fetcher.h"
+
+namespace crawler {
+
+// Shape of the simulated origin. Every draw is seeded from the URL (and the
+// attempt number for errors and latency), so a run is reproducible however
+// the pipeline's threads interleave.
+struct ReplayOptions {
+    // WARC file (.warc or .warc.gz, as written by Storage::export_warc) or a
+    // directory of pages laid out as <host>/<path>; empty serves only the
+    // synthetic hosts
+    std::string corpus;
+
+    // Synthetic web: hosts x pages_per_host pages, linked within and across
+    // hosts. URLs look like https://site<k>.replay.test/p/<n>.
+    size_t hosts = 100;
+    size_t pages_per_host = 1000;
+    int links_per_page = 20;
+    double cross_host_links = 0.2; // share of links to another host
+
+    // Log-normal distributions given by median and 99th percentile
+    double latency_median_ms = 50;   // time to first byte
+    double latency_p99_ms = 500;
+    double page_kb_median = 30;      // synthetic page size
+    double page_kb_p99 = 200;
+    double bandwidth_mbps = 100;     // per transfer; sets the download time
+
+    double error_rate = 0.01;        // 503 responses, retryable
+    double timeout_rate = 0.001;     // no answer until fetcher.read_timeout_ms
+    uint64_t seed = 1;
+};
+
+// FetchEngine that answers from a recorded corpus and a generated web graph
+// instead of the network, for end-to-end crawl benchmarks. Responses are
+// built on the submitting thread and completed on a timer thread once their
+// simulated latency and download time have passed; URLs in neither the
+// corpus nor a synthetic host get a 404. 3xx responses recorded in a WARC
+// corpus are followed like AsyncFetcher does, up to fetcher.max_redirects.
+class ReplayFetcher : public FetchEngine {
+public:
+    explicit ReplayFetcher(ReplayOptions options);
+    ~ReplayFetcher() override;
+
+    // Load the corpus; false if it names something unreadable
+    bool load();
+
+    bool start() override;
+    void stop() override;
+
+    // Blocks while fetcher.max_in_flight requests are outstanding; returns
+    // false if the fetcher is stopped
+    bool submit(const std::string& url, FetchCallback callback, BodyChunkCallback on_chunk = {}) override;
+
+    // Corpus URLs followed by each synthetic host's front page
+    std::vector<std::string> seed_urls() const;
+
+    size_t corpus_pages() const { return corpus_.size(); }
+    size_t corpus_redirects() const { return redirects_.size(); }
+    size_t max_in_flight() const { return max_in_flight_; }
+
+    // Statistics
+    size_t in_flight() const { return in_flight_; }
+    size_t total_fetches() const { return total_fetches_; }
+    size_t successful_fetches() const { return successful_fetches_; }
+    size_t failed_fetches() const { return failed_fetches_; }
+    uint64_t bytes_served() const { return bytes_served_; }
+    // Sum over requests of submit-to-completion time, for utilisation
+    double busy_ms() const { return busy_us_ / 1000.0; }
+
+private:
+    struct Request {
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point due;
+        FetchCallback callback;
+        BodyChunkCallback on_chunk;
+        FetchResult result;
+    };
+    struct Due {
+        std::chrono::steady_clock::time_point due;
+        uint64_t sequence; // ties complete in submission order
+        Request* request;
+        bool operator>(const Due& other) const {
+            return due != other.due ? due > other.due : sequence > other.sequence;
+        }
+    };
+
+    bool load_warc(const std::string& path);
+    bool load_directory(const std::string& dir);
+
+    // Fills result and returns how long the origin takes to deliver it
+    double respond(const std::string& url, uint32_t attempt, FetchResult& result);
+    bool synthetic_page(const std::string& url, std::string& html) const;
+
+    void timer_loop();
+    void complete(std::unique_ptr<Request> request);
+
+    ReplayOptions options_;
+    std::unordered_map<std::string, std::string> corpus_; // url -> body
+    std::vector<std::string> corpus_urls_;                // load order
+    std::unordered_map<std::string, std::pair<int, std::string>> redirects_; // url -> (status, location)
+
+    std::mutex attempts_mutex_;
+    std::unordered_map<std::string, uint32_t> attempts_;
+
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> timers_;
+    std::unordered_map<Request*, std::unique_ptr<Request>> pending_;
+    uint64_t sequence_ = 0;
+    std::mutex mutex_;
+    std::condition_variable timer_cv_;
+    std::condition_variable capacity_cv_;
+
+    std::thread timer_thread_;
+    std::atomic<bool> running_{false};
+
+    size_t max_in_flight_ = 1000;
+    int read_timeout_ms_ = 10000;
+    int max_redirects_ = 5;
+    size_t max_body_bytes_ = 0;
+
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<size_t> total_fetches_{0};
+    std::atomic<size_t> successful_fetches_{0};
+    std::atomic<size_t> failed_fetches_{0};
+    std::atomic<uint64_t> bytes_served_{0};
+    std::atomic<uint64_t> busy_us_{0};
+};
+
+} // namespace crawler
@@ -1,180 +1,1030 @@
 #include "indexer.h"
+#include "snippet.h"
 #include "../utils/config.h"
+#include "../observability/logger.h"
 #include <fstream>
 #include <algorithm>
 #include <cmath>
-#include <sstream>
+#include <cstdio>
+#include <filesystem>
+#include <unordered_set>
+#include <limits>
+#include <chrono>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace crawler {
 
+namespace {
+
+constexpr const char* kManifestFile = "segments";
+
+// Rough per-entry overhead of the buffer's hash maps and vectors
+constexpr size_t kEntryOverhead = 64;
+
+// Segment files up to this size share the lowest merge tier
+constexpr double kMergeFloorBytes = 1 << 20;
+
+// The same for in-memory segments, and their merge factor when
+// background merging is off
+constexpr double kMemoryMergeFloorBytes = 64 << 10;
+constexpr int kMemoryMergeFactor = 10;
+
+// Largest rate limiter grant, and so the most a merge writes unthrottled
+constexpr double kMergeBurstBytes = 1 << 20;
+
+// Candidates the BM25 pass hands to phrase and proximity reranking: this
+// many times topk, and at least kRerankCandidates
+constexpr size_t kRerankFactor = 10;
+constexpr size_t kRerankCandidates = 100;
+
+// Ordinal of a document a merge leaves out
+constexpr uint32_t kDroppedDoc = std::numeric_limits<uint32_t>::max();
+
+// Ordinals of a segment's documents that pass a non-empty filter: one of
+// the segment's own bitmaps when that is all it takes, else built into
+// `scratch`. Null if none pass.
+const RoaringBitmap* filter_docs(const SegmentReader& segment, const SearchFilter& filter,
+                                 RoaringBitmap& scratch) {
+    const RoaringBitmap* docs = nullptr;
+    const std::string* values[kFacetCount] = {&filter.category, &filter.brand};
+    for (size_t facet = 0; facet < kFacetCount; facet++) {
+        if (values[facet]->empty()) continue;
+        uint32_t index = 0;
+        if (!segment.lookup_facet(static_cast<Facet>(facet), *values[facet], index)) return nullptr;
+        const RoaringBitmap& with_value = segment.facet_docs(static_cast<Facet>(facet), index);
+        if (docs) {
+            scratch = RoaringBitmap::intersect(*docs, with_value);
+            docs = &scratch;
+        } else {
+            docs = &with_value;
+        }
+    }
+
+    if (filter.has_price_range()) {
+        // A scan of the price column, or of what the other fields left
+        RoaringBitmap priced;
+        auto in_range = [&](uint32_t ordinal) {
+            double price = segment.price(ordinal);
+            return price >= filter.min_price && price <= filter.max_price;
+        };
+        if (docs) {
+            uint32_t ordinal = 0;
+            for (uint32_t from = 0; docs->next(from, ordinal); from = ordinal + 1) {
+                if (in_range(ordinal)) priced.add(ordinal);
+            }
+        } else {
+            for (uint32_t ordinal = 0; ordinal < segment.doc_count(); ordinal++) {
+                if (in_range(ordinal)) priced.add(ordinal);
+            }
+        }
+        scratch = std::move(priced);
+        docs = &scratch;
+    }
+    return docs && !docs->empty() ? docs : nullptr;
+}
+
+} // namespace
+
 Indexer::Indexer(const std::string& index_dir) : index_dir_(index_dir) {
     auto& config = Config::instance();
-    // Load config values if available
+    max_docs_per_segment_ = config.indexer_max_docs_per_segment();
+    segment_size_mb_ = config.indexer_segment_size_mb();
+    refresh_interval_ms_ = config.indexer_refresh_interval_ms();
+    proximity_weight_ = config.indexer_proximity_weight();
+    merge_threshold_ = config.indexer_merge_threshold();
+    merge_bucket_ = TokenBucket(config.indexer_merge_mb_per_sec() * 1024.0 * 1024.0, kMergeBurstBytes);
+
+    std::error_code ec;
+    std::filesystem::create_directories(index_dir_, ec);
+    load_segments();
+    publish_locked();
+
+    if (merge_threshold_ >= 2) {
+        // A restart may bring back more segments than the policy allows
+        merge_requested_ = true;
+        merge_thread_ = std::thread(&Indexer::merge_worker, this);
+    }
+    if (refresh_interval_ms_ > 0) {
+        refresh_thread_ = std::thread(&Indexer::refresh_worker, this);
+    }
 }
 
 Indexer::~Indexer() {
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        stop_ = true;
+    }
+    merge_cv_.notify_all();
+    refresh_cv_.notify_all();
+    if (merge_thread_.joinable()) {
+        merge_thread_.join();
+    }
+    if (refresh_thread_.joinable()) {
+        refresh_thread_.join();
+    }
     flush_segment();
 }
 
-bool Indexer::index_document(const ParsedDocument& parsed_doc) {
+void Indexer::set_index_callback(IndexCallback callback) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    index_callback_ = std::move(callback);
+}
+
+uint64_t Indexer::index_document(const ParsedDocument& parsed_doc) {
     return index_document(parsed_doc, {});
 }
 
-bool Indexer::index_document(const ParsedDocument& parsed_doc,
-                            const std::unordered_map<std::string, std::string>& metadata) {
-    std::lock_guard<std::mutex> lock(index_mutex_);
-    
+uint64_t Indexer::index_document(const ParsedDocument& parsed_doc,
+                                const std::unordered_map<std::string, std::string>& metadata) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+
     Document doc;
     doc.doc_id = next_doc_id_++;
     doc.url = parsed_doc.url;
     doc.title = parsed_doc.title;
     doc.text_content = parsed_doc.text_content;
-    doc.term_positions = parsed_doc.term_positions;
-    
+
     // Extract metadata
     if (metadata.count("category")) {
         doc.category = metadata.at("category");
     }
     if (metadata.count("price")) {
-        doc.price = std::stod(metadata.at("price"));
+        // Scraped from <meta>, so not necessarily a number
+        try {
+            doc.price = std::stod(metadata.at("price"));
+        } catch (...) {
+        }
     }
     if (metadata.count("brand")) {
         doc.brand = metadata.at("brand");
     }
-    
-    // Update inverted index
+
+    // Update inverted index; postings record the length for their bounds
+    uint32_t ordinal = static_cast<uint32_t>(doc.doc_id - buffer_base_doc_id_);
     size_t doc_length = 0;
+    for (const auto& [term, positions] : parsed_doc.term_positions) {
+        if (!term.empty()) doc_length += positions.size();
+    }
+    size_t bytes = sizeof(Document) + kEntryOverhead + doc.url.size() + doc.title.size() +
+                   doc.text_content.size();
     for (const auto& [term, positions] : parsed_doc.term_positions) {
         if (term.empty()) continue;
-        
-        Posting posting;
-        posting.doc_id = doc.doc_id;
-        posting.positions = positions;
-        posting.tf = static_cast<double>(positions.size());
-        
-        inverted_index_[term].push_back(posting);
-        doc_length += positions.size();
-    }
-    
-    doc_lengths_[doc.doc_id] = doc_length;
-    forward_index_[doc.doc_id] = doc;
-    
+
+        positions_scratch_.assign(positions.begin(), positions.end());
+        auto [it, inserted] = inverted_index_.try_emplace(std::string(term));
+        size_t before = inserted ? 0 : it->second.memory_bytes();
+        it->second.add(ordinal, positions_scratch_, static_cast<uint32_t>(doc_length));
+        bytes += it->second.memory_bytes() - before + (inserted ? term.size() + kEntryOverhead : 0);
+    }
+
+    doc_lengths_.push_back(static_cast<uint32_t>(doc_length));
+    forward_index_[doc.doc_id] = std::move(doc);
+    buffer_bytes_ += bytes;
+
+    uint64_t doc_id = next_doc_id_ - 1;
     total_documents_++;
     current_segment_size_++;
-    
-    // Update average document length
-    if (total_documents_ > 0) {
-        avg_doc_length_ = (avg_doc_length_ * (total_documents_ - 1) + doc_length) / total_documents_;
+    if (index_callback_) {
+        index_callback_(doc_id, parsed_doc, metadata);
     }
-    
+
     // Flush if segment is full
-    if (current_segment_size_ >= max_docs_per_segment_) {
-        flush_segment();
+    if (current_segment_size_ >= static_cast<size_t>(max_docs_per_segment_) ||
+        buffer_bytes_ + memory_bytes_ >= static_cast<size_t>(segment_size_mb_) * 1024 * 1024) {
+        flush_locked();
+    } else if (refresh_interval_ms_ <= 0) {
+        refresh_locked();
     }
-    
-    return true;
+
+    return doc_id;
 }
 
 std::vector<SearchResult> Indexer::search(const std::string& query, int topk) {
-    std::lock_guard<std::mutex> lock(index_mutex_);
-    
-    // Tokenize query
-    std::istringstream iss(query);
-    std::vector<std::string> query_terms;
-    std::string term;
-    while (iss >> term) {
-        std::transform(term.begin(), term.end(), term.begin(), ::tolower);
-        query_terms.push_back(term);
-    }
-    
-    // Score documents
-    std::unordered_map<uint64_t, double> doc_scores;
-    
-    for (const auto& query_term : query_terms) {
-        auto it = inverted_index_.find(query_term);
-        if (it == inverted_index_.end()) continue;
-        
-        // Compute IDF
-        double idf = std::log(static_cast<double>(total_documents_) / it->second.size());
-        
-        // Score each document containing this term
-        for (const auto& posting : it->second) {
-            double bm25 = calculate_bm25(query_term, posting.doc_id, posting.positions);
-            doc_scores[posting.doc_id] += bm25 * idf;
-        }
-    }
-    
-    // Sort by score
-    std::vector<std::pair<uint64_t, double>> scored_docs;
-    for (const auto& [doc_id, score] : doc_scores) {
-        scored_docs.emplace_back(doc_id, score);
-    }
-    
-    std::sort(scored_docs.begin(), scored_docs.end(),
-              [](const auto& a, const auto& b) { return a.second > b.second; });
-    
+    return search(query, topk, SearchFilter());
+}
+
+std::vector<SearchResult> Indexer::search(const std::string& query, int topk, const SearchFilter& filter,
+                                          Facets* facets) {
+    // Never waits on writers; the snapshot stays valid for as long as it is held
+    std::shared_ptr<const Snapshot> snapshot = this->snapshot();
+    const auto& segments = snapshot->segments;
+
+    if (facets) *facets = Facets();
+    Query parsed = Query::parse(query);
+    const auto& query_terms = parsed.terms;
+    if (query_terms.empty() || (topk <= 0 && !facets)) return {};
+    topk = std::max(topk, 0);
+
+    // Document frequency over every segment
+    size_t segment_count = segments.size();
+    std::vector<SegmentReader::TermInfo> infos(query_terms.size() * segment_count);
+    std::vector<bool> found(query_terms.size() * segment_count);
+    std::vector<double> idfs(query_terms.size());
+    for (size_t t = 0; t < query_terms.size(); t++) {
+        size_t doc_freq = 0;
+        for (size_t i = 0; i < segment_count; i++) {
+            size_t slot = t * segment_count + i;
+            found[slot] = segments[i].reader->lookup(query_terms[t], infos[slot]);
+            if (found[slot]) doc_freq += infos[slot].doc_freq;
+        }
+        idfs[t] = Bm25::idf(static_cast<double>(snapshot->documents), static_cast<double>(doc_freq));
+    }
+
+    // Phrases and proximity need positions, so they only rerank the best
+    // candidates of the BM25 pass, which keeps their cost bounded
+    bool rerank = topk > 0 && (!parsed.phrases.empty() || (proximity_weight_ > 0 && query_terms.size() > 1));
+    size_t candidates = static_cast<size_t>(topk);
+    if (rerank) candidates = std::max(candidates * kRerankFactor, kRerankCandidates);
+    Bm25 bm25{k1_, b_, snapshot->avg_doc_length};
+    TopK top(candidates);
+    std::vector<TermPostings> terms;
+    std::vector<PostingCursor> cursors;
+    RoaringBitmap scratch;
+    std::unordered_map<std::string_view, size_t> facet_totals[kFacetCount];
+    std::vector<uint32_t> facet_counts[kFacetCount];
+
+    // Segments in doc_id order, sharing one heap so each starts with the
+    // threshold the earlier ones reached
+    for (size_t i = 0; i < segment_count; i++) {
+        const SegmentReader& segment = *segments[i].reader;
+        DocTable docs;
+        docs.segment = &segment;
+        docs.deleted = segments[i].deleted.get();
+        if (!filter.empty() && !(docs.filter = filter_docs(segment, filter, scratch))) continue;
+
+        terms.clear();
+        for (size_t t = 0; t < query_terms.size(); t++) {
+            size_t slot = t * segment_count + i;
+            if (!found[slot]) continue;
+            TermPostings& term = terms.emplace_back();
+            term.cursor = segment.postings(infos[slot]);
+            term.idf = idfs[t];
+            term.upper_bound = idfs[t] * bm25.score(infos[slot].max_freq, infos[slot].min_length);
+        }
+        if (terms.empty()) continue;
+        if (topk > 0) max_score_search(terms, docs, bm25, top);
+
+        if (!facets) continue;
+        cursors.clear();
+        for (size_t t = 0; t < query_terms.size(); t++) {
+            size_t slot = t * segment_count + i;
+            if (found[slot]) cursors.push_back(segment.postings(infos[slot]));
+        }
+        facets->matches += count_facets(cursors, docs, facet_counts);
+        for (size_t facet = 0; facet < kFacetCount; facet++) {
+            const auto& values = segment.facet_values(static_cast<Facet>(facet));
+            for (size_t v = 0; v < values.size(); v++) {
+                if (facet_counts[facet][v] > 0 && !values[v].empty()) {
+                    facet_totals[facet][values[v]] += facet_counts[facet][v];
+                }
+            }
+        }
+    }
+    if (facets) {
+        // Views into segments the snapshot keeps mapped
+        std::vector<FacetCount>* outputs[kFacetCount] = {&facets->categories, &facets->brands};
+        for (size_t facet = 0; facet < kFacetCount; facet++) {
+            auto& output = *outputs[facet];
+            for (const auto& [value, count] : facet_totals[facet]) {
+                output.push_back({std::string(value), count});
+            }
+            std::sort(output.begin(), output.end(), [](const FacetCount& a, const FacetCount& b) {
+                return a.count > b.count || (a.count == b.count && a.value < b.value);
+            });
+        }
+    }
+    auto scored_docs = top.take();
+    if (rerank) {
+        scored_docs = rerank_candidates(*snapshot, parsed, infos, found, idfs, bm25, std::move(scored_docs),
+                                        static_cast<size_t>(topk));
+    }
+
     // Build results
     std::vector<SearchResult> results;
-    for (size_t i = 0; i < std::min(static_cast<size_t>(topk), scored_docs.size()); i++) {
-        uint64_t doc_id = scored_docs[i].first;
-        auto doc_it = forward_index_.find(doc_id);
-        if (doc_it == forward_index_.end()) continue;
-        
+    results.reserve(scored_docs.size());
+    StoredBlockCache cache;
+    for (size_t i = 0; i < scored_docs.size(); i++) {
         SearchResult result;
-        result.doc_id = doc_id;
-        result.url = doc_it->second.url;
-        result.title = doc_it->second.title;
+        result.doc_id = scored_docs[i].first;
         result.score = scored_docs[i].second;
-        
-        // Generate snippet (first 200 chars)
-        result.snippet = doc_it->second.text_content.substr(0, 200);
-        if (doc_it->second.text_content.length() > 200) {
-            result.snippet += "...";
-        }
-        
+        fill_result(*snapshot, result.doc_id, query_terms, cache, result);
         results.push_back(result);
     }
-    
+
     return results;
 }
 
-double Indexer::calculate_bm25(const std::string& term, uint64_t doc_id,
-                               const std::vector<size_t>& positions) {
-    double tf = static_cast<double>(positions.size());
-    auto doc_len_it = doc_lengths_.find(doc_id);
-    if (doc_len_it == doc_lengths_.end()) return 0.0;
-    
-    double doc_length = static_cast<double>(doc_len_it->second);
-    double normalized_length = doc_length / avg_doc_length_;
-    
-    double numerator = tf * (k1_ + 1);
-    double denominator = tf + k1_ * (1 - b_ + b_ * normalized_length);
-    
-    return numerator / denominator;
+std::vector<std::pair<uint64_t, double>> Indexer::rerank_candidates(
+    const Snapshot& snapshot, const Query& query, const std::vector<SegmentReader::TermInfo>& infos,
+    const std::vector<bool>& found, const std::vector<double>& idfs, const Bm25& bm25,
+    std::vector<std::pair<uint64_t, double>> candidates, size_t topk) const {
+    // In doc_id order, so each segment's cursors only move forward
+    std::sort(candidates.begin(), candidates.end());
+    const auto& segments = snapshot.segments;
+    size_t segment_count = segments.size();
+    size_t n = query.terms.size();
+    std::vector<PostingCursor> cursors(n);
+    std::vector<char> live(n);
+    std::vector<std::span<const uint32_t>> positions(n);
+    std::vector<std::span<const uint32_t>> words;
+    size_t current = segment_count;
+
+    TopK top(topk);
+    for (auto [doc_id, score] : candidates) {
+        auto it = std::partition_point(segments.begin(), segments.end(), [doc_id](const LiveSegment& segment) {
+            return segment.reader->max_doc_id() < doc_id;
+        });
+        uint32_t ordinal = 0;
+        if (it == segments.end() || !it->reader->find_doc(doc_id, ordinal)) continue;
+        size_t segment = static_cast<size_t>(it - segments.begin());
+        if (segment != current) {
+            current = segment;
+            for (size_t t = 0; t < n; t++) {
+                size_t slot = t * segment_count + segment;
+                live[t] = found[slot];
+                if (live[t]) cursors[t] = it->reader->postings(infos[slot]);
+            }
+        }
+
+        for (size_t t = 0; t < n; t++) {
+            positions[t] = {};
+            if (live[t] && !(live[t] = cursors[t].advance(ordinal))) continue;
+            if (live[t] && cursors[t].doc() == ordinal) positions[t] = cursors[t].positions();
+        }
+
+        bool matches = true;
+        for (const auto& phrase : query.phrases) {
+            words.clear();
+            for (size_t t : phrase) words.push_back(positions[t]);
+            if (!phrase_match(words)) {
+                matches = false;
+                break;
+            }
+        }
+        if (!matches) continue;
+
+        if (proximity_weight_ > 0) {
+            score += proximity_weight_ * proximity_score(positions, idfs, bm25, it->reader->doc_length(ordinal));
+        }
+        top.push(doc_id, score);
+    }
+    return top.take();
+}
+
+void Indexer::fill_result(const Snapshot& snapshot, uint64_t doc_id, const std::vector<std::string>& terms,
+                          StoredBlockCache& cache, SearchResult& result) const {
+    // Segments hold ascending doc_id ranges
+    const auto& segments = snapshot.segments;
+    auto it = std::partition_point(segments.begin(), segments.end(), [doc_id](const LiveSegment& segment) {
+        return segment.reader->max_doc_id() < doc_id;
+    });
+    StoredFields stored;
+    uint32_t ordinal = 0;
+    if (it == segments.end() || !it->reader->find_doc(doc_id, ordinal) ||
+        !it->reader->stored_fields(ordinal, stored, &cache)) {
+        return;
+    }
+    result.url = std::move(stored.url);
+    result.title = std::move(stored.title);
+    result.category = std::move(stored.category);
+    result.brand = std::move(stored.brand);
+    result.price = stored.price;
+    result.snippet = make_snippet(stored.text, terms);
+}
+
+void Indexer::refresh() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    refresh_locked();
 }
 
 void Indexer::flush_segment() {
-    if (current_segment_size_ == 0) return;
-    
-    // Write segment to disk (simplified)
-    std::string segment_file = index_dir_ + "/segment_" + std::to_string(segment_count_++) + ".idx";
-    std::ofstream out(segment_file, std::ios::binary);
-    
-    // TODO: Serialize index structures
-    // For now, just mark as flushed
-    
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    flush_locked();
+}
+
+std::string Indexer::segment_file(uint64_t segment_id) const {
+    return "segment_" + std::to_string(segment_id) + ".idx";
+}
+
+std::string Indexer::deletions_file(uint64_t segment_id) const {
+    return "segment_" + std::to_string(segment_id) + ".del";
+}
+
+std::shared_ptr<SegmentReader> Indexer::open_segment(uint64_t segment_id) {
+    auto segment = std::make_shared<SegmentReader>();
+    if (!segment->open(index_dir_ + "/" + segment_file(segment_id))) {
+        return nullptr;
+    }
+    return segment;
+}
+
+bool Indexer::write_segment(SegmentWriter& writer) {
+    // Buffered doc ids are contiguous, so ordinal order is doc_id order
+    for (uint32_t ordinal = 0; ordinal < doc_lengths_.size(); ordinal++) {
+        const Document& doc = forward_index_[buffer_base_doc_id_ + ordinal];
+        StoredFields fields;
+        fields.url = doc.url;
+        fields.title = doc.title;
+        fields.text = doc.text_content;
+        fields.category = doc.category;
+        fields.brand = doc.brand;
+        fields.price = doc.price;
+        writer.add_document(doc.doc_id, doc_lengths_[ordinal], fields);
+    }
+
+    std::vector<std::string> terms;
+    terms.reserve(inverted_index_.size());
+    for (const auto& [term, postings] : inverted_index_) {
+        terms.push_back(term);
+    }
+    std::sort(terms.begin(), terms.end());
+
+    // Compressed blocks go in as they are
+    for (const auto& term : terms) {
+        writer.add_term(term, std::move(inverted_index_[term]));
+    }
+    return writer.finish();
+}
+
+void Indexer::publish_locked() {
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->segments = segments_;
+    uint64_t length = 0;
+    for (const auto& segment : segments_) {
+        snapshot->documents += segment.reader->doc_count() - segment.deleted_count;
+        length += segment.reader->total_length() - segment.deleted_length;
+    }
+    if (snapshot->documents > 0) {
+        snapshot->avg_doc_length = static_cast<double>(length) / snapshot->documents;
+    }
+    std::shared_ptr<const Snapshot> old;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        old = std::exchange(snapshot_, std::move(snapshot));
+    }
+    generation_++;
+    // The last reference to old segments may go here, outside the lock
+}
+
+std::shared_ptr<const Indexer::Snapshot> Indexer::snapshot() const {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    return snapshot_;
+}
+
+bool Indexer::refresh_locked() {
+    if (forward_index_.empty()) return true;
+
+    SegmentWriter writer;
+    std::shared_ptr<const std::string> bytes;
+    auto segment = std::make_shared<SegmentReader>();
+    if (!writer.open_memory() || !write_segment(writer) || !(bytes = writer.take_memory()) ||
+        !segment->open_memory(std::move(bytes))) {
+        Logger::instance().warn("Failed to freeze the index buffer");
+        return false;
+    }
+
+    LiveSegment live;
+    live.in_memory = true;
+    live.reader = segment;
+    for (size_t ordinal = 0; ordinal < buffer_deleted_.size(); ordinal++) {
+        if (!buffer_deleted_[ordinal]) continue;
+        live.deleted_count++;
+        live.deleted_length += doc_lengths_[ordinal];
+    }
+    if (live.deleted_count > 0) {
+        buffer_deleted_.resize(segment->doc_count());
+        live.deleted = std::make_shared<const std::vector<bool>>(std::move(buffer_deleted_));
+    }
+    memory_bytes_ += segment->size_bytes();
+    segments_.push_back(std::move(live));
+
+    // Postings were moved out above; drop the rest of the buffer
+    std::unordered_map<std::string, PostingListBuilder>().swap(inverted_index_);
+    std::unordered_map<uint64_t, Document>().swap(forward_index_);
+    std::vector<uint32_t>().swap(doc_lengths_);
+    std::vector<bool>().swap(buffer_deleted_);
+    buffer_base_doc_id_ = next_doc_id_;
+    buffer_bytes_ = 0;
+
+    while (merge_memory_locked()) {
+    }
+    publish_locked();
+    return true;
+}
+
+bool Indexer::merge_memory_locked() {
+    size_t begin = file_segment_count_locked();
+    int factor = merge_threshold_ >= 2 ? merge_threshold_ : kMemoryMergeFactor;
+    size_t first = 0;
+    size_t count = 0;
+    if (!pick_merge(begin, segments_.size(), kMemoryMergeFloorBytes, factor, first, count)) return false;
+
+    std::vector<LiveSegment> run(segments_.begin() + first, segments_.begin() + first + count);
+    SegmentWriter writer;
+    MergeMap map;
+    std::shared_ptr<const std::string> bytes;
+    auto merged = std::make_shared<SegmentReader>();
+    if (!writer.open_memory() || !write_merged(run, writer, map, false) ||
+        !(bytes = writer.take_memory()) || !merged->open_memory(std::move(bytes))) {
+        return false;
+    }
+
+    for (const auto& segment : run) {
+        memory_bytes_ -= segment.reader->size_bytes();
+    }
+    auto begin_it = segments_.begin() + first;
+    if (merged->doc_count() > 0) {
+        LiveSegment live;
+        live.in_memory = true;
+        live.reader = merged;
+        memory_bytes_ += merged->size_bytes();
+        *begin_it = std::move(live);
+        segments_.erase(begin_it + 1, begin_it + count);
+    } else {
+        segments_.erase(begin_it, begin_it + count);
+    }
+    return true;
+}
+
+bool Indexer::flush_locked() {
+    if (!refresh_locked()) return false;
+    size_t first = file_segment_count_locked();
+    if (first == segments_.size()) return write_deletions_locked();
+
+    // Every in-memory segment goes into one file
+    std::vector<LiveSegment> run(segments_.begin() + first, segments_.end());
+    uint64_t segment_id = next_segment_id_++;
+    SegmentWriter writer;
+    MergeMap map;
+    std::shared_ptr<SegmentReader> segment;
+    if (!writer.open(index_dir_ + "/" + segment_file(segment_id)) ||
+        !write_merged(run, writer, map, false) || !(segment = open_segment(segment_id))) {
+        // Keep them in memory; the next flush tries again
+        Logger::instance().warn("Failed to write index segment " + segment_file(segment_id));
+        return false;
+    }
+
+    segments_.erase(segments_.begin() + first, segments_.end());
+    if (segment->doc_count() > 0) {
+        LiveSegment live;
+        live.id = segment_id;
+        live.reader = segment;
+        segments_.push_back(std::move(live));
+    } else {
+        // Everything was deleted
+        std::remove(segment->path().c_str());
+    }
+    if (!write_deletions_locked() || !write_manifest()) {
+        Logger::instance().warn("Failed to write index manifest in " + index_dir_);
+    } else {
+        // An earlier merge could not drop these from the manifest
+        for (const auto& file : obsolete_files_) {
+            std::remove(file.c_str());
+        }
+        obsolete_files_.clear();
+    }
+    memory_bytes_ = 0;
     current_segment_size_ = 0;
+    publish_locked();
+
+    merge_requested_ = true;
+    merge_cv_.notify_one();
+    return true;
+}
+
+size_t Indexer::file_segment_count_locked() const {
+    size_t count = 0;
+    while (count < segments_.size() && !segments_[count].in_memory) count++;
+    return count;
+}
+
+bool Indexer::delete_document(uint64_t doc_id) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+
+    if (doc_id >= buffer_base_doc_id_ && doc_id < next_doc_id_) {
+        // Not searchable yet, so nothing to publish
+        uint32_t ordinal = static_cast<uint32_t>(doc_id - buffer_base_doc_id_);
+        if (ordinal >= buffer_deleted_.size()) {
+            buffer_deleted_.resize(ordinal + 1);
+        } else if (buffer_deleted_[ordinal]) {
+            return false;
+        }
+        buffer_deleted_[ordinal] = true;
+        total_documents_--;
+        return true;
+    }
+
+    auto it = std::partition_point(segments_.begin(), segments_.end(), [doc_id](const LiveSegment& segment) {
+        return segment.reader->max_doc_id() < doc_id;
+    });
+    uint32_t ordinal = 0;
+    if (it == segments_.end() || !it->reader->find_doc(doc_id, ordinal) || it->is_deleted(ordinal)) {
+        return false;
+    }
+
+    // Published snapshots keep the bitmap they were given
+    auto deleted = it->deleted ? std::make_shared<std::vector<bool>>(*it->deleted)
+                               : std::make_shared<std::vector<bool>>(it->reader->doc_count());
+    (*deleted)[ordinal] = true;
+    it->deleted = std::move(deleted);
+    it->deleted_count++;
+    it->deleted_length += it->reader->doc_length(ordinal);
+    it->deletions_dirty = !it->in_memory;
+    total_documents_--;
+    publish_locked();
+    return true;
 }
 
 void Indexer::merge_segments() {
-    // TODO: Implement segment merging
-    // For now, just flush current segment
-    flush_segment();
+    std::lock_guard<std::mutex> merge_lock(merge_mutex_);
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        flush_locked();
+        count = file_segment_count_locked();
+        // A lone segment is only rewritten to purge deletions
+        if (count == 0 || (count == 1 && segments_[0].deleted_count == 0)) return;
+    }
+    merge_run(0, count);
+}
+
+void Indexer::refresh_worker() {
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    while (!stop_) {
+        refresh_cv_.wait_for(lock, std::chrono::milliseconds(refresh_interval_ms_));
+        if (!stop_) {
+            refresh_locked();
+        }
+    }
+}
+
+void Indexer::merge_worker() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex_);
+            merge_cv_.wait(lock, [this] { return stop_ || merge_requested_; });
+            if (stop_) return;
+            merge_requested_ = false;
+        }
+
+        std::lock_guard<std::mutex> merge_lock(merge_mutex_);
+        size_t first = 0;
+        size_t count = 0;
+        while (!stop_) {
+            {
+                std::lock_guard<std::mutex> lock(writer_mutex_);
+                if (!pick_merge(0, file_segment_count_locked(), kMergeFloorBytes, merge_threshold_,
+                                first, count)) {
+                    break;
+                }
+            }
+            if (!merge_run(first, count)) break;
+        }
+    }
+}
+
+bool Indexer::pick_merge(size_t begin, size_t end, double floor_bytes, int factor,
+                         size_t& first, size_t& count) const {
+    // Tier t holds segments of floor * factor^t bytes and up, counting live
+    // documents only; merging factor of them yields the next tier
+    std::vector<int> tiers;
+    tiers.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+        const LiveSegment& segment = segments_[i];
+        uint32_t docs = segment.reader->doc_count();
+        double live = docs > 0 ? 1.0 - static_cast<double>(segment.deleted_count) / docs : 0.0;
+        double bytes = std::max(static_cast<double>(segment.reader->size_bytes()) * live, floor_bytes);
+        tiers.push_back(static_cast<int>(std::log(bytes / floor_bytes) / std::log(factor)));
+    }
+
+    // Only adjacent segments merge, so doc ids stay in segment order
+    size_t run = 0;
+    for (size_t i = 0; i < tiers.size(); i++) {
+        run = i > 0 && tiers[i] == tiers[i - 1] ? run + 1 : 1;
+        if (run == static_cast<size_t>(factor)) {
+            first = begin + i + 1 - run;
+            count = run;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Indexer::throttle_merge(uint64_t bytes) {
+    // In grants of at most the bucket's capacity, which try_acquire needs
+    while (bytes > 0 && !stop_) {
+        uint64_t chunk = std::min<uint64_t>(bytes, static_cast<uint64_t>(merge_bucket_.capacity()));
+        if (merge_bucket_.try_acquire(static_cast<double>(chunk))) {
+            bytes -= chunk;
+            continue;
+        }
+        // Short naps so shutdown is not held up
+        auto now = TokenBucket::Clock::now();
+        std::this_thread::sleep_until(std::min(merge_bucket_.next_available(static_cast<double>(chunk), now),
+                                               now + std::chrono::milliseconds(100)));
+    }
+}
+
+uint32_t Indexer::MergeMap::target(size_t source, uint32_t ordinal) const {
+    return remaps[source].empty() ? static_cast<uint32_t>(ordinal + shifts[source]) : remaps[source][ordinal];
+}
+
+bool Indexer::write_merged(const std::vector<LiveSegment>& run, SegmentWriter& writer, MergeMap& map,
+                           bool background) {
+    // Background merges are rate limited and give up on shutdown
+    uint64_t throttled = 0;
+    auto throttle = [&] {
+        if (!background) return;
+        throttle_merge(writer.bytes_written() - throttled);
+        throttled = writer.bytes_written();
+    };
+
+    // Live documents keep their order. A segment without deletions moves
+    // by a constant shift; the others get an ordinal map.
+    map.shifts.assign(run.size(), 0);
+    map.remaps.assign(run.size(), {});
+    uint32_t next_ordinal = 0;
+    StoredFields fields;
+    StoredBlockCache cache;
+    for (size_t i = 0; i < run.size(); i++) {
+        const SegmentReader& segment = *run[i].reader;
+        map.shifts[i] = next_ordinal;
+        if (run[i].deleted_count > 0) {
+            map.remaps[i].assign(segment.doc_count(), kDroppedDoc);
+        }
+        for (uint32_t ordinal = 0; ordinal < segment.doc_count(); ordinal++) {
+            if (run[i].is_deleted(ordinal)) continue;
+            if (!segment.stored_fields(ordinal, fields, &cache)) {
+                writer.abort();
+                return false;
+            }
+            writer.add_document(segment.doc_id(ordinal), segment.doc_length(ordinal), fields);
+            if (!map.remaps[i].empty()) map.remaps[i][ordinal] = next_ordinal;
+            next_ordinal++;
+            throttle();
+        }
+    }
+
+    // k-way merge of the sorted dictionaries. Blocks with no deleted docs
+    // are copied still encoded; only the others are decoded and re-added.
+    std::vector<size_t> next(run.size(), 0);
+    while (!(background && stop_)) {
+        std::string_view smallest;
+        bool any = false;
+        for (size_t i = 0; i < run.size(); i++) {
+            if (next[i] >= run[i].reader->term_count()) continue;
+            std::string_view term = run[i].reader->term_at(next[i]);
+            if (!any || term < smallest) {
+                smallest = term;
+                any = true;
+            }
+        }
+        if (!any) break;
+
+        std::string current(smallest);
+        writer.start_term(current);
+        for (size_t i = 0; i < run.size(); i++) {
+            if (next[i] >= run[i].reader->term_count()) continue;
+            SegmentReader::TermInfo info;
+            if (run[i].reader->term_at(next[i], &info) != current) continue;
+            const auto& remap = map.remaps[i];
+            auto cursor = run[i].reader->postings(info);
+            while (cursor.next_block()) {
+                uint32_t first_doc = cursor.doc();
+                uint32_t last_doc = cursor.block_last();
+                if (remap.empty()) {
+                    writer.add_block(cursor.block_bytes(), map.shifts[i]);
+                    continue;
+                }
+                if (remap[first_doc] != kDroppedDoc && remap[last_doc] != kDroppedDoc &&
+                    remap[last_doc] - remap[first_doc] == last_doc - first_doc) {
+                    // Nothing deleted inside the block, so still a plain shift
+                    writer.add_block(cursor.block_bytes(), static_cast<int64_t>(remap[first_doc]) - first_doc);
+                    continue;
+                }
+                for (size_t k = 0; k < cursor.block_size(); k++) {
+                    if (k > 0) cursor.next();
+                    if (remap[cursor.doc()] != kDroppedDoc) {
+                        writer.add_posting(remap[cursor.doc()], cursor.positions());
+                    }
+                }
+            }
+            next[i]++;
+        }
+        throttle();
+    }
+
+    if (background && stop_) {
+        writer.abort();
+        return false;
+    }
+    return writer.finish();
+}
+
+bool Indexer::merge_run(size_t first, size_t count) {
+    std::vector<LiveSegment> run;
+    uint64_t segment_id = 0;
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        run.assign(segments_.begin() + first, segments_.begin() + first + count);
+        segment_id = next_segment_id_++;
+    }
+
+    // From here on the run is read through its own references to the
+    // readers, so indexing and searches carry on meanwhile
+    SegmentWriter writer;
+    MergeMap map;
+    std::shared_ptr<SegmentReader> merged;
+    if (!writer.open(index_dir_ + "/" + segment_file(segment_id))) return false;
+    if (!write_merged(run, writer, map, true) || !(merged = open_segment(segment_id))) {
+        if (!stop_) {
+            Logger::instance().warn("Failed to merge index segments");
+        }
+        return false;
+    }
+
+    std::vector<std::string> old_files;
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        LiveSegment live;
+        live.id = segment_id;
+        live.reader = merged;
+
+        // Deletions that came in during the merge move to the new ordinals
+        std::shared_ptr<std::vector<bool>> deleted;
+        for (size_t i = 0; i < run.size(); i++) {
+            const LiveSegment& current = segments_[first + i];
+            if (current.deleted == run[i].deleted) continue;
+            for (uint32_t ordinal = 0; ordinal < current.reader->doc_count(); ordinal++) {
+                if (!current.is_deleted(ordinal) || run[i].is_deleted(ordinal)) continue;
+                if (!deleted) {
+                    deleted = std::make_shared<std::vector<bool>>(merged->doc_count());
+                }
+                (*deleted)[map.target(i, ordinal)] = true;
+                live.deleted_count++;
+                live.deleted_length += current.reader->doc_length(ordinal);
+            }
+        }
+        live.deleted = std::move(deleted);
+        live.deletions_dirty = live.deleted_count > 0;
+
+        for (const auto& segment : run) {
+            obsolete_files_.push_back(index_dir_ + "/" + segment_file(segment.id));
+            if (segment.deleted_count > 0) {
+                obsolete_files_.push_back(index_dir_ + "/" + deletions_file(segment.id));
+            }
+        }
+        auto begin = segments_.begin() + first;
+        if (merged->doc_count() > 0) {
+            *begin = std::move(live);
+            segments_.erase(begin + 1, begin + count);
+        } else {
+            // Everything was deleted
+            obsolete_files_.push_back(merged->path());
+            segments_.erase(begin, begin + count);
+        }
+        // Published either way, like a flush. Until a manifest naming the
+        // merged segment is on disk the old one still names the inputs, so
+        // their files stay until a later flush or merge writes one.
+        if (!write_deletions_locked() || !write_manifest()) {
+            Logger::instance().warn("Failed to write index manifest in " + index_dir_ +
+                                    "; keeping the merged-away segment files");
+        } else {
+            old_files.swap(obsolete_files_);
+        }
+        publish_locked();
+    }
+
+    // Searches holding the old readers keep their mappings after unlink
+    for (const auto& file : old_files) {
+        std::remove(file.c_str());
+    }
+    merges_completed_++;
+    Logger::instance().info("Merged " + std::to_string(count) + " index segments into " +
+                            segment_file(segment_id));
+    return true;
+}
+
+bool Indexer::write_deletions_locked() {
+    bool ok = true;
+    for (auto& segment : segments_) {
+        if (!segment.deletions_dirty) continue;
+        if (write_deletions(index_dir_ + "/" + deletions_file(segment.id), *segment.deleted)) {
+            segment.deletions_dirty = false;
+        } else {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool Indexer::write_manifest() {
+    // The next doc id, then one segment file name per line; fsynced and
+    // replaced atomically, since checkpoints rely on it
+    std::string bytes;
+    // Merges can drop the highest doc ids, which must never be reused
+    bytes += "next_doc_id " + std::to_string(next_doc_id_) + "\n";
+    for (const auto& segment : segments_) {
+        if (segment.in_memory) continue;
+        bytes += segment_file(segment.id) + "\n";
+    }
+
+    std::string path = index_dir_ + "/" + kManifestFile;
+    std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()) &&
+              fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void Indexer::load_segments() {
+    std::ifstream in(index_dir_ + "/" + kManifestFile);
+    std::string name;
+    std::unordered_set<std::string> live;
+    while (std::getline(in, name)) {
+        unsigned long long id = 0;
+        if (std::sscanf(name.c_str(), "next_doc_id %llu", &id) == 1) {
+            next_doc_id_ = std::max<uint64_t>(next_doc_id_, id);
+            continue;
+        }
+        if (std::sscanf(name.c_str(), "segment_%llu.idx", &id) != 1) continue;
+        next_segment_id_ = std::max<uint64_t>(next_segment_id_, id + 1);
+
+        auto segment = open_segment(id);
+        if (!segment) {
+            Logger::instance().warn("Skipping unreadable index segment " + name);
+            continue;
+        }
+        live.insert(name);
+        next_doc_id_ = std::max(next_doc_id_, segment->max_doc_id() + 1);
+
+        LiveSegment entry;
+        entry.id = id;
+        entry.reader = segment;
+        std::vector<bool> deleted;
+        if (read_deletions(index_dir_ + "/" + deletions_file(id), segment->doc_count(), deleted)) {
+            live.insert(deletions_file(id));
+            for (uint32_t ordinal = 0; ordinal < segment->doc_count(); ordinal++) {
+                if (!deleted[ordinal]) continue;
+                entry.deleted_count++;
+                entry.deleted_length += segment->doc_length(ordinal);
+            }
+            if (entry.deleted_count > 0) {
+                entry.deleted = std::make_shared<const std::vector<bool>>(std::move(deleted));
+            }
+        }
+        total_documents_ += segment->doc_count() - entry.deleted_count;
+        segments_.push_back(std::move(entry));
+    }
+    buffer_base_doc_id_ = next_doc_id_;
+
+    // Leftovers of an interrupted flush or merge; the pattern also catches
+    // .del and .tmp files
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(index_dir_, ec)) {
+        std::string file = entry.path().filename().string();
+        unsigned long long id = 0;
+        if (std::sscanf(file.c_str(), "segment_%llu.idx", &id) == 1 && !live.count(file)) {
+            next_segment_id_ = std::max<uint64_t>(next_segment_id_, id + 1);
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
 }
 
 size_t Indexer::total_terms() const {
-    std::lock_guard<std::mutex> lock(index_mutex_);
-    return inverted_index_.size();
+    auto snapshot = this->snapshot();
+    size_t terms = 0;
+    for (const auto& segment : snapshot->segments) {
+        terms += segment.reader->term_count();
+    }
+    return terms;
+}
+
+size_t Indexer::segment_count() const {
+    auto snapshot = this->snapshot();
+    size_t count = 0;
+    for (const auto& segment : snapshot->segments) {
+        if (!segment.in_memory) count++;
+    }
+    return count;
+}
+
+uint64_t Indexer::next_doc_id() const {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    return next_doc_id_;
+}
+
+size_t Indexer::buffered_documents() const {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    return current_segment_size_;
 }
 
 } // namespace crawler
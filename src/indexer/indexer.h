@@ -5,7 +5,17 @@
 #include <unordered_map>
 #include <memory>
 #include <mutex>
-#include "parser.h"
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <limits>
+#include "../parser/parser.h"
+#include "../utils/token_bucket.h"
+#include "segment.h"
+#include "scoring.h"
+#include "query.h"
 
 namespace crawler {
 
@@ -14,7 +24,6 @@ struct Document {
     std::string url;
     std::string title;
     std::string text_content;
-    std::unordered_map<std::string, std::vector<size_t>> term_positions;
     
     // Metadata for recommendation
     std::string category;
@@ -22,76 +31,244 @@ struct Document {
     std::string brand;
 };
 
-struct Posting {
-    uint64_t doc_id;
-    std::vector<size_t> positions;
-    double tf = 0.0;
-    double idf = 0.0;
-    double bm25_score = 0.0;
-};
-
 struct SearchResult {
     uint64_t doc_id;
     std::string url;
     std::string title;
     std::string snippet;
     double score;
+    
+    std::string category;
+    std::string brand;
+    double price = 0.0;
+};
+
+// Restricts a search to documents with these doc values
+struct SearchFilter {
+    std::string category; // exact; empty for any
+    std::string brand;
+    double min_price = -std::numeric_limits<double>::infinity();
+    double max_price = std::numeric_limits<double>::infinity();
+    
+    bool has_price_range() const {
+        return min_price > -std::numeric_limits<double>::infinity() ||
+               max_price < std::numeric_limits<double>::infinity();
+    }
+    bool empty() const { return category.empty() && brand.empty() && !has_price_range(); }
+};
+
+struct FacetCount {
+    std::string value;
+    size_t count;
+};
+
+// Counts over every document matching a search's terms and filter, not
+// just the top k; most frequent first, documents without a value left out
+struct Facets {
+    size_t matches = 0;
+    std::vector<FacetCount> categories;
+    std::vector<FacetCount> brands;
 };
 
+// Inverted index with BM25 ranking. Queries are evaluated top-k with
+// block-max MaxScore (see max_score_search) rather than scoring every
+// posting. Quoted phrases, and with proximity_weight a BM25TP proximity
+// boost, are applied to the best candidates of that pass only, so a
+// phrase that only occurs in poorly ranked documents may go unfound.
+//
+// Writers (indexing, deletes, flushes, merge swaps) serialise on
+// writer_mutex_; searches never take it. They run on an immutable,
+// refcounted Snapshot of the segment list that the writer swaps in after
+// every change, so a search keeps whatever segments it started with mapped
+// until it finishes.
+//
+// New documents go into a mutable buffer that searches cannot see. Every
+// refresh_interval_ms it is frozen into an in-memory segment and published
+// (near-real-time search); small in-memory segments are merged as they pile
+// up. Once they reach max_docs_per_segment or segment_size_mb they are
+// merged into an immutable segment file (see SegmentWriter), searched
+// through mmap. The list of segment files is kept in index_dir/segments, so
+// a restart reopens the index instead of needing a re-crawl.
+//
+// A background thread keeps the file count logarithmic: whenever
+// merge_threshold adjacent files fall in the same size tier they are
+// merged into one, dropping deleted documents. Merges run outside the
+// writer lock and swap in with the manifest.
 class Indexer {
 public:
+    using IndexCallback = std::function<void(uint64_t doc_id, const ParsedDocument& doc,
+                                             const std::unordered_map<std::string, std::string>& metadata)>;
+    
     Indexer(const std::string& index_dir);
     ~Indexer();
     
-    // Index a document
-    bool index_document(const ParsedDocument& parsed_doc);
+    // Index a document; returns the assigned doc_id (0 if not indexed).
+    // It becomes searchable with the next refresh.
+    uint64_t index_document(const ParsedDocument& parsed_doc);
     
     // Index a document with metadata
-    bool index_document(const ParsedDocument& parsed_doc, 
-                       const std::unordered_map<std::string, std::string>& metadata);
+    uint64_t index_document(const ParsedDocument& parsed_doc, 
+                           const std::unordered_map<std::string, std::string>& metadata);
+    
+    // Called for every indexed document under the writer lock, so in doc_id
+    // order; used to log documents ahead of the segment files (CrawlJournal)
+    void set_index_callback(IndexCallback callback);
     
-    // Search
+    // Search; "quoted words" have to occur as a phrase (see Query)
     std::vector<SearchResult> search(const std::string& query, int topk = 10);
     
-    // Flush current segment to disk
+    // Search within a filter, optionally counting facets of all matches
+    std::vector<SearchResult> search(const std::string& query, int topk, const SearchFilter& filter,
+                                     Facets* facets = nullptr);
+    
+    // Make everything indexed so far searchable now
+    void refresh();
+    
+    // Write everything indexed so far to a new segment file
     void flush_segment();
     
-    // Merge segments
+    // Flush, then merge all segments into one
     void merge_segments();
     
-    // Statistics
+    // Hide a document from search; it is dropped for good by the next merge
+    // covering it. Deletions reach disk with the next flush.
+    bool delete_document(uint64_t doc_id);
+    
+    // Statistics; all but buffered_documents() as of the last refresh
     size_t total_documents() const { return total_documents_; }
+    // Summed per segment: a term in several segments counts once in each
     size_t total_terms() const;
-    size_t segment_count() const { return segment_count_; }
+    // Segment files
+    size_t segment_count() const;
+    // Indexed but not yet in a segment file
+    size_t buffered_documents() const;
+    size_t merges_completed() const { return merges_completed_; }
+    // The doc_id the next document gets; those below it and not buffered
+    // are in segment files
+    uint64_t next_doc_id() const;
+    
+    // Bumped whenever searches start seeing a different index, so cached
+    // results can tell they are stale
+    uint64_t generation() const { return generation_; }
 
 private:
     void compute_tf_idf();
     void compute_bm25();
-    double calculate_bm25(const std::string& term, uint64_t doc_id, 
-                         const std::vector<size_t>& positions);
+    
+    // A searchable segment and the documents deleted from it since
+    struct LiveSegment {
+        uint64_t id = 0; // file id; unused in memory
+        bool in_memory = false;
+        std::shared_ptr<SegmentReader> reader;
+        std::shared_ptr<const std::vector<bool>> deleted; // by ordinal, null if none; copied on write
+        uint32_t deleted_count = 0;
+        uint64_t deleted_length = 0;
+        bool deletions_dirty = false;
+        
+        bool is_deleted(uint32_t ordinal) const { return deleted && (*deleted)[ordinal]; }
+    };
+    
+    // What searches see; never modified once published
+    struct Snapshot {
+        std::vector<LiveSegment> segments; // doc_id order: files, then in memory
+        size_t documents = 0;
+        double avg_doc_length = 0.0;
+    };
+    
+    // Where a merge put each source document
+    struct MergeMap {
+        std::vector<int64_t> shifts; // per source, if it had no deletions
+        std::vector<std::vector<uint32_t>> remaps; // per source ordinal otherwise
+        
+        uint32_t target(size_t source, uint32_t ordinal) const;
+    };
+    
+    bool refresh_locked();
+    bool flush_locked();
+    void publish_locked();
+    bool write_segment(SegmentWriter& writer);
+    bool write_merged(const std::vector<LiveSegment>& run, SegmentWriter& writer, MergeMap& map,
+                      bool background);
+    std::shared_ptr<SegmentReader> open_segment(uint64_t segment_id);
+    std::string segment_file(uint64_t segment_id) const;
+    std::string deletions_file(uint64_t segment_id) const;
+    void load_segments();
+    bool write_manifest();
+    bool write_deletions_locked();
+    size_t file_segment_count_locked() const;
+    std::shared_ptr<const Snapshot> snapshot() const;
+    void fill_result(const Snapshot& snapshot, uint64_t doc_id, const std::vector<std::string>& terms,
+                     StoredBlockCache& cache, SearchResult& result) const;
+    std::vector<std::pair<uint64_t, double>> rerank_candidates(
+        const Snapshot& snapshot, const Query& query, const std::vector<SegmentReader::TermInfo>& infos,
+        const std::vector<bool>& found, const std::vector<double>& idfs, const Bm25& bm25,
+        std::vector<std::pair<uint64_t, double>> candidates, size_t topk) const;
+    
+    // Leftmost run of `factor` adjacent segments in one size tier within
+    // segments [begin, end)
+    bool pick_merge(size_t begin, size_t end, double floor_bytes, int factor,
+                    size_t& first, size_t& count) const;
+    bool merge_memory_locked();
+    
+    // Background merging; callers hold merge_mutex_
+    void merge_worker();
+    bool merge_run(size_t first, size_t count);
+    void throttle_merge(uint64_t bytes);
+    
+    void refresh_worker();
     
     std::string index_dir_;
     
-    // In-memory index structures
-    std::unordered_map<std::string, std::vector<Posting>> inverted_index_; // term -> postings
+    // Mutable buffer of documents not yet refreshed. Its doc ids are
+    // contiguous from buffer_base_doc_id_; postings are keyed by the offset
+    // from it, which is also the document's ordinal once frozen.
+    std::unordered_map<std::string, PostingListBuilder> inverted_index_; // term -> postings
     std::unordered_map<uint64_t, Document> forward_index_; // doc_id -> document
-    std::unordered_map<uint64_t, size_t> doc_lengths_; // doc_id -> length
+    std::vector<uint32_t> doc_lengths_; // ordinal -> length
+    uint64_t buffer_base_doc_id_ = 1;
+    std::vector<uint32_t> positions_scratch_;
+    size_t buffer_bytes_ = 0; // rough heap footprint of the above
+    std::vector<bool> buffer_deleted_; // by ordinal, may be short
+    
+    // The writer's segment list, published as snapshot_
+    std::vector<LiveSegment> segments_;
+    std::shared_ptr<const Snapshot> snapshot_;
+    mutable std::mutex snapshot_mutex_; // only held to copy or swap snapshot_
+    std::atomic<uint64_t> generation_{0};
+    size_t memory_bytes_ = 0; // of the in-memory segments
+    // Files of merged-away segments, removed once a manifest without them
+    // is on disk
+    std::vector<std::string> obsolete_files_;
+    uint64_t next_segment_id_ = 0;
     
     uint64_t next_doc_id_ = 1;
-    size_t current_segment_size_ = 0;
-    size_t segment_count_ = 0;
+    size_t current_segment_size_ = 0; // documents not yet in a file
     
-    mutable std::mutex index_mutex_;
+    mutable std::mutex writer_mutex_;
+    IndexCallback index_callback_;
     
     std::atomic<size_t> total_documents_{0};
     
     // BM25 parameters
     double k1_ = 1.5;
     double b_ = 0.75;
-    double avg_doc_length_ = 0.0;
+    double proximity_weight_ = 0.0;
     
     int max_docs_per_segment_ = 100000;
     int segment_size_mb_ = 100;
+    int refresh_interval_ms_ = 1000;
+    
+    // Background work
+    int merge_threshold_ = 10;
+    std::mutex merge_mutex_; // one file merge at a time; taken before writer_mutex_
+    std::condition_variable merge_cv_;
+    std::condition_variable refresh_cv_;
+    bool merge_requested_ = false;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> merges_completed_{0};
+    TokenBucket merge_bucket_; // merge bytes written per second
+    std::thread merge_thread_;
+    std::thread refresh_thread_;
 };
 
 } // namespace crawler
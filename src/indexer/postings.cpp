@@ -0,0 +1,361 @@
+#include "postings.h"
+#include "../utils/varint.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define CRAWLER_STREAMVBYTE_SSSE3 1
+#endif
+
+namespace crawler {
+
+namespace {
+
+constexpr size_t kBlockHeaderSize = 4 + 4 + 1 + 4 + 4 + 2 + 2 + 4;
+
+// Total data bytes of the four values described by a control byte
+constexpr std::array<uint8_t, 256> make_lengths() {
+    std::array<uint8_t, 256> lengths{};
+    for (int c = 0; c < 256; c++) {
+        lengths[c] = static_cast<uint8_t>(((c & 3) + 1) + ((c >> 2 & 3) + 1) +
+                                          ((c >> 4 & 3) + 1) + ((c >> 6 & 3) + 1));
+    }
+    return lengths;
+}
+
+constexpr std::array<uint8_t, 256> kLengths = make_lengths();
+
+#if defined(CRAWLER_STREAMVBYTE_SSSE3)
+// pshufb masks moving each value's bytes into its 32-bit lane; 0x80 zeroes
+constexpr std::array<std::array<uint8_t, 16>, 256> make_shuffles() {
+    std::array<std::array<uint8_t, 16>, 256> shuffles{};
+    for (int c = 0; c < 256; c++) {
+        int offset = 0;
+        for (int k = 0; k < 4; k++) {
+            int length = ((c >> (2 * k)) & 3) + 1;
+            for (int b = 0; b < 4; b++) {
+                shuffles[c][4 * k + b] = b < length ? static_cast<uint8_t>(offset + b) : 0x80;
+            }
+            offset += length;
+        }
+    }
+    return shuffles;
+}
+
+alignas(16) constexpr std::array<std::array<uint8_t, 16>, 256> kShuffles = make_shuffles();
+#endif
+
+inline void put_fixed16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+inline uint16_t get_fixed16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+// In-place prefix sum turning gaps back into values
+inline void prefix_sum(uint32_t* values, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        values[i] += values[i - 1];
+    }
+}
+
+} // namespace
+
+void StreamVByte::encode(const uint32_t* in, size_t n, std::string& out) {
+    size_t control = out.size();
+    out.resize(control + (n + 3) / 4, '\0');
+    for (size_t i = 0; i < n; i++) {
+        uint32_t value = in[i];
+        int key = value < (1u << 8) ? 0 : value < (1u << 16) ? 1 : value < (1u << 24) ? 2 : 3;
+        out[control + i / 4] = static_cast<char>(static_cast<uint8_t>(out[control + i / 4]) |
+                                                 (key << ((i % 4) * 2)));
+        for (int b = 0; b <= key; b++) {
+            out.push_back(static_cast<char>((value >> (8 * b)) & 0xFF));
+        }
+    }
+}
+
+size_t StreamVByte::encoded_size(const uint8_t* in, size_t n) {
+    size_t control = (n + 3) / 4;
+    size_t size = control;
+    for (size_t g = 0; g < n / 4; g++) {
+        size += kLengths[in[g]];
+    }
+    for (size_t i = n / 4 * 4; i < n; i++) {
+        size += ((in[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+    }
+    return size;
+}
+
+const uint8_t* StreamVByte::decode(const uint8_t* in, const uint8_t* end, size_t n, uint32_t* out) {
+    size_t control = (n + 3) / 4;
+    if (static_cast<size_t>(end - in) < control) return nullptr;
+    const uint8_t* data = in + control;
+    size_t i = 0;
+
+#if defined(CRAWLER_STREAMVBYTE_SSSE3)
+    // Four values per step while a full 16-byte load stays in bounds
+    for (; i + 4 <= n && end - data >= 16; i += 4) {
+        uint8_t c = in[i / 4];
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(kShuffles[c].data()));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_shuffle_epi8(bytes, mask));
+        data += kLengths[c];
+    }
+#endif
+
+    for (; i < n; i++) {
+        int length = ((in[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+        if (end - data < length) return nullptr;
+        uint32_t value = 0;
+        for (int b = 0; b < length; b++) {
+            value |= static_cast<uint32_t>(data[b]) << (8 * b);
+        }
+        out[i] = value;
+        data += length;
+    }
+    return data;
+}
+
+const char* StreamVByte::implementation() {
+#if defined(CRAWLER_STREAMVBYTE_SSSE3)
+    return "ssse3";
+#else
+    return "scalar";
+#endif
+}
+
+PostingCursor::PostingCursor(const uint8_t* data, size_t size)
+    : data_(data), end_(data + size), next_block_(data) {}
+
+bool PostingCursor::read_header(const uint8_t* header) {
+    if (static_cast<size_t>(end_ - header) < kBlockHeaderSize) return false;
+    size_t count = header[8];
+    size_t doc_bytes = get_fixed16(header + 17);
+    size_t freq_bytes = get_fixed16(header + 19);
+    size_t position_bytes = varint::get_fixed32(header + 21);
+    const uint8_t* docs = header + kBlockHeaderSize;
+    if (count == 0 || count > kBlockSize ||
+        static_cast<size_t>(end_ - docs) < doc_bytes + freq_bytes + position_bytes) {
+        return false;
+    }
+
+    block_ = header;
+    next_block_ = docs + doc_bytes + freq_bytes + position_bytes;
+    block_last_ = varint::get_fixed32(header + 4);
+    block_max_freq_ = varint::get_fixed32(header + 9);
+    block_min_length_ = varint::get_fixed32(header + 13);
+    count_ = count;
+    positions_data_ = docs + doc_bytes + freq_bytes;
+    positions_bytes_ = position_bytes;
+    return true;
+}
+
+bool PostingCursor::step_block() {
+    decoded_ = false;
+    positions_ready_ = false;
+    index_ = 0;
+    if (state_ == State::BEFORE || state_ == State::BLOCK) {
+        if (next_block_ < end_) {
+            state_ = read_header(next_block_) ? State::BLOCK : State::END;
+            return state_ == State::BLOCK;
+        }
+        if (tail_ && !tail_->docs_.empty()) {
+            // Unsealed postings of an in-memory list
+            state_ = State::TAIL;
+            block_ = nullptr;
+            block_last_ = tail_->docs_.back();
+            block_max_freq_ = tail_->tail_max_freq_;
+            block_min_length_ = tail_->tail_min_length_;
+            count_ = tail_->docs_.size();
+            return true;
+        }
+    }
+    state_ = State::END;
+    count_ = 0;
+    return false;
+}
+
+bool PostingCursor::decode_block() {
+    if (state_ == State::TAIL) {
+        std::memcpy(docs_, tail_->docs_.data(), count_ * sizeof(uint32_t));
+        std::memcpy(freqs_, tail_->freqs_.data(), count_ * sizeof(uint32_t));
+        positions_.assign(tail_->positions_.begin(), tail_->positions_.end());
+        positions_ready_ = true;
+    } else {
+        const uint8_t* docs = block_ + kBlockHeaderSize;
+        const uint8_t* freqs = docs + get_fixed16(block_ + 17);
+        docs_[0] = varint::get_fixed32(block_);
+        if (!StreamVByte::decode(docs, freqs, count_ - 1, docs_ + 1) ||
+            !StreamVByte::decode(freqs, positions_data_, count_, freqs_)) {
+            state_ = State::END;
+            return false;
+        }
+        prefix_sum(docs_, count_);
+    }
+
+    offsets_[0] = 0;
+    for (size_t i = 0; i < count_; i++) {
+        offsets_[i + 1] = offsets_[i] + freqs_[i];
+    }
+    if (docs_[count_ - 1] != block_last_ ||
+        (positions_ready_ && positions_.size() != offsets_[count_])) {
+        state_ = State::END;
+        return false;
+    }
+    decoded_ = true;
+    return true;
+}
+
+bool PostingCursor::next() {
+    if (decoded_ && index_ + 1 < count_) {
+        index_++;
+        return true;
+    }
+    // A block found by seek_block is entered at its first posting
+    if (!decoded_ && (state_ == State::BLOCK || state_ == State::TAIL)) {
+        return decode_block();
+    }
+    return step_block() && decode_block();
+}
+
+bool PostingCursor::seek_block(uint32_t target) {
+    if (state_ == State::BEFORE && !step_block()) return false;
+    while (state_ != State::END && block_last_ < target) {
+        step_block();
+    }
+    return state_ != State::END;
+}
+
+bool PostingCursor::advance(uint32_t target) {
+    if (!seek_block(target)) return false;
+    if (!decoded_ && !decode_block()) return false;
+    if (docs_[index_] < target) {
+        index_ = std::lower_bound(docs_ + index_, docs_ + count_, target) - docs_;
+    }
+    return true;
+}
+
+bool PostingCursor::next_block() {
+    return step_block() && decode_block();
+}
+
+std::span<const uint8_t> PostingCursor::block_bytes() const {
+    if (state_ != State::BLOCK) return {};
+    return std::span<const uint8_t>(block_, next_block_);
+}
+
+std::span<const uint32_t> PostingCursor::positions() {
+    if (!positions_ready_) {
+        positions_.resize(offsets_[count_]);
+        const uint8_t* end = positions_data_ + positions_bytes_;
+        if (!StreamVByte::decode(positions_data_, end, positions_.size(), positions_.data())) {
+            positions_.assign(positions_.size(), 0);
+        }
+        for (size_t i = 0; i < count_; i++) {
+            prefix_sum(positions_.data() + offsets_[i], freqs_[i]);
+        }
+        positions_ready_ = true;
+    }
+    return std::span<const uint32_t>(positions_.data() + offsets_[index_], freqs_[index_]);
+}
+
+void PostingListBuilder::add(uint32_t doc, std::span<const uint32_t> positions, uint32_t doc_length) {
+    uint32_t freq = static_cast<uint32_t>(positions.size());
+    docs_.push_back(doc);
+    freqs_.push_back(freq);
+    positions_.insert(positions_.end(), positions.begin(), positions.end());
+    tail_max_freq_ = std::max(tail_max_freq_, freq);
+    tail_min_length_ = std::min(tail_min_length_, doc_length);
+    max_freq_ = std::max(max_freq_, freq);
+    min_length_ = std::min(min_length_, doc_length);
+    doc_freq_++;
+    if (docs_.size() == PostingCursor::kBlockSize) {
+        seal();
+    }
+}
+
+void PostingListBuilder::append_block(std::span<const uint8_t> block, int64_t shift) {
+    // Blocks are self-contained, so the tail can be sealed early
+    if (!docs_.empty()) {
+        seal();
+    }
+    size_t header = bytes_.size();
+    bytes_.append(reinterpret_cast<const char*>(block.data()), block.size());
+
+    // Only the first and last doc are absolute; the rest are gaps
+    std::string fields;
+    varint::put_fixed32(fields, static_cast<uint32_t>(varint::get_fixed32(block.data()) + shift));
+    varint::put_fixed32(fields, static_cast<uint32_t>(varint::get_fixed32(block.data() + 4) + shift));
+    std::memcpy(&bytes_[header], fields.data(), fields.size());
+    doc_freq_ += block[8];
+    max_freq_ = std::max(max_freq_, varint::get_fixed32(block.data() + 9));
+    min_length_ = std::min(min_length_, varint::get_fixed32(block.data() + 13));
+}
+
+void PostingListBuilder::finish() {
+    if (!docs_.empty()) {
+        seal();
+    }
+}
+
+void PostingListBuilder::seal() {
+    size_t count = docs_.size();
+
+    // Gaps in place: docs within the block, positions within each doc
+    uint32_t first = docs_.front();
+    uint32_t last = docs_.back();
+    for (size_t i = count - 1; i > 0; i--) {
+        docs_[i] -= docs_[i - 1];
+    }
+    size_t start = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = start + freqs_[i] - 1; freqs_[i] > 0 && j > start; j--) {
+            positions_[j] -= positions_[j - 1];
+        }
+        start += freqs_[i];
+    }
+
+    size_t header = bytes_.size();
+    bytes_.resize(header + kBlockHeaderSize);
+    size_t docs_start = bytes_.size();
+    StreamVByte::encode(docs_.data() + 1, count - 1, bytes_);
+    size_t freqs_start = bytes_.size();
+    StreamVByte::encode(freqs_.data(), count, bytes_);
+    size_t positions_start = bytes_.size();
+    StreamVByte::encode(positions_.data(), positions_.size(), bytes_);
+
+    std::string fields;
+    varint::put_fixed32(fields, first);
+    varint::put_fixed32(fields, last);
+    fields.push_back(static_cast<char>(count));
+    varint::put_fixed32(fields, tail_max_freq_);
+    varint::put_fixed32(fields, tail_min_length_);
+    put_fixed16(fields, static_cast<uint16_t>(freqs_start - docs_start));
+    put_fixed16(fields, static_cast<uint16_t>(positions_start - freqs_start));
+    varint::put_fixed32(fields, static_cast<uint32_t>(bytes_.size() - positions_start));
+    std::memcpy(&bytes_[header], fields.data(), kBlockHeaderSize);
+
+    docs_.clear();
+    freqs_.clear();
+    positions_.clear();
+    tail_max_freq_ = 0;
+    tail_min_length_ = UINT32_MAX;
+}
+
+PostingCursor PostingListBuilder::cursor() const {
+    PostingCursor cursor(reinterpret_cast<const uint8_t*>(bytes_.data()), bytes_.size());
+    cursor.tail_ = this;
+    return cursor;
+}
+
+size_t PostingListBuilder::memory_bytes() const {
+    return sizeof(*this) + bytes_.capacity() +
+           (docs_.capacity() + freqs_.capacity() + positions_.capacity()) * sizeof(uint32_t);
+}
+
+} // namespace crawler
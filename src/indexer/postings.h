@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace crawler {
+
+// StreamVByte (Lemire et al.): 2-bit length codes for four values per
+// control byte, followed by the values' 1-4 significant bytes. Decoding
+// expands four values per pshufb with SSSE3; other targets go byte-wise.
+class StreamVByte {
+public:
+    // Append the encoding of in[0..n) to out
+    static void encode(const uint32_t* in, size_t n, std::string& out);
+
+    // Decode n values from [in, end) into out; returns the end of the
+    // encoding or nullptr if it does not fit
+    static const uint8_t* decode(const uint8_t* in, const uint8_t* end, size_t n, uint32_t* out);
+
+    // Encoded size of n values whose control bytes start at `in`
+    static size_t encoded_size(const uint8_t* in, size_t n);
+
+    // "ssse3" or "scalar"
+    static const char* implementation();
+};
+
+class PostingListBuilder;
+
+// Forward iterator over a compressed posting list.
+//
+// A list is a run of self-contained blocks of up to kBlockSize postings:
+//   header     first and last doc (fixed32), count (1 byte), highest term
+//              frequency and shortest doc length (fixed32), doc / freq /
+//              position stream sizes (fixed16, fixed16, fixed32)
+//   docs       gaps after the first doc (StreamVByte)
+//   freqs      positions per doc, which is the term frequency (StreamVByte)
+//   positions  per doc the first position, then gaps (StreamVByte)
+// The frequency and length bounds give each block a BM25 upper bound
+// whatever the collection statistics, so queries can skip blocks by their
+// header alone. Docs are decoded per block, positions only where asked for.
+// Docs are absolute only in the header, so a block moves to other doc
+// numbers by rewriting its first eight bytes (see append_block).
+class PostingCursor {
+public:
+    static constexpr size_t kBlockSize = 128;
+
+    PostingCursor() = default;
+    PostingCursor(const uint8_t* data, size_t size);
+
+    // Advance to the first / next posting; false when exhausted or corrupt
+    bool next();
+
+    // Move to the first posting with doc >= target, never backwards;
+    // blocks ending before target are skipped undecoded
+    bool advance(uint32_t target);
+
+    uint32_t doc() const { return docs_[index_]; }
+    uint32_t freq() const { return freqs_[index_]; }
+
+    // Positions of the current posting, valid until the cursor moves
+    std::span<const uint32_t> positions();
+
+    // Move to the block that would hold target, reading headers only.
+    // The block_* accessors then describe it; next() or advance() decode it.
+    bool seek_block(uint32_t target);
+    uint32_t block_last() const { return block_last_; }
+    uint32_t block_max_freq() const { return block_max_freq_; }
+    uint32_t block_min_length() const { return block_min_length_; }
+
+    // Skip the rest of the current block and stop at the first posting of
+    // the next one; next() then walks on through it
+    bool next_block();
+    size_t block_size() const { return count_; }
+
+    // Encoded bytes of the current block; empty for an unsealed tail
+    std::span<const uint8_t> block_bytes() const;
+
+private:
+    friend class PostingListBuilder;
+
+    enum class State { BEFORE, BLOCK, TAIL, END };
+
+    bool step_block();
+    bool read_header(const uint8_t* header);
+    bool decode_block();
+
+    const uint8_t* data_ = nullptr;
+    const uint8_t* end_ = nullptr;
+    const PostingListBuilder* tail_ = nullptr; // unsealed postings after the bytes
+
+    State state_ = State::BEFORE;
+    const uint8_t* block_ = nullptr; // header of the current block
+    const uint8_t* next_block_ = nullptr;
+    uint32_t block_last_ = 0;
+    uint32_t block_max_freq_ = 0;
+    uint32_t block_min_length_ = 0;
+    bool decoded_ = false;
+
+    uint32_t docs_[kBlockSize];
+    uint32_t freqs_[kBlockSize];
+    uint32_t offsets_[kBlockSize + 1]; // start of each doc's positions
+    std::vector<uint32_t> positions_;
+    const uint8_t* positions_data_ = nullptr;
+    size_t positions_bytes_ = 0;
+    bool positions_ready_ = false;
+
+    size_t count_ = 0;
+    size_t index_ = 0;
+};
+
+// Append-only compressed posting list, used for the in-memory buffer and
+// for writing segments. Postings go into an uncompressed tail that is
+// sealed into a block every kBlockSize postings.
+class PostingListBuilder {
+public:
+    // Docs must be added in ascending order, positions ascending.
+    // `doc_length` feeds the block's length bound.
+    void add(uint32_t doc, std::span<const uint32_t> positions, uint32_t doc_length);
+
+    // Copy an encoded block (PostingCursor::block_bytes) with every doc
+    // moved by `shift`; none of it is decoded
+    void append_block(std::span<const uint8_t> block, int64_t shift);
+
+    // Seal the tail; bytes() then holds the whole list
+    void finish();
+
+    const std::string& bytes() const { return bytes_; }
+    uint32_t doc_freq() const { return doc_freq_; }
+
+    // Bounds over the whole list, as in the block headers
+    uint32_t max_freq() const { return max_freq_; }
+    uint32_t min_length() const { return min_length_; }
+
+    // Iterates sealed blocks and the tail
+    PostingCursor cursor() const;
+
+    size_t memory_bytes() const;
+
+private:
+    friend class PostingCursor;
+
+    void seal();
+
+    std::string bytes_;
+    std::vector<uint32_t> docs_;
+    std::vector<uint32_t> freqs_;
+    std::vector<uint32_t> positions_; // absolute
+    uint32_t tail_max_freq_ = 0;
+    uint32_t tail_min_length_ = UINT32_MAX;
+    uint32_t doc_freq_ = 0;
+    uint32_t max_freq_ = 0;
+    uint32_t min_length_ = UINT32_MAX;
+};
+
+} // namespace crawler
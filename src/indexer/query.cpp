@@ -0,0 +1,40 @@
+#include "query.h"
+#include "../parser/tokenizer.h"
+#include <unordered_map>
+
+namespace crawler {
+
+Query Query::parse(std::string_view text) {
+    Query query;
+    std::unordered_map<std::string, size_t> index;
+    std::vector<char> buffer;
+    std::vector<std::string_view> words;
+    std::vector<size_t> phrase;
+
+    // Quotes alternate between loose words and phrases
+    bool quoted = false;
+    while (true) {
+        size_t quote = text.find('"');
+        std::string_view part = text.substr(0, quote);
+
+        buffer.assign(part.begin(), part.end());
+        words.clear();
+        Tokenizer::tokenize(buffer.data(), buffer.size(), words);
+        phrase.clear();
+        for (auto word : words) {
+            auto [it, inserted] = index.try_emplace(std::string(word), query.terms.size());
+            if (inserted) query.terms.emplace_back(word);
+            phrase.push_back(it->second);
+        }
+        if (quoted && phrase.size() >= 2) {
+            query.phrases.push_back(phrase);
+        }
+
+        if (quote == std::string_view::npos) break;
+        text.remove_prefix(quote + 1);
+        quoted = !quoted;
+    }
+    return query;
+}
+
+} // namespace crawler
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace crawler {
+
+// A parsed search query. Words are split and lowercased by Tokenizer, the
+// same way document text is, so "Apple" finds "apple,". Double-quoted words
+// form a phrase that has to occur at consecutive positions; an unmatched
+// quote runs to the end of the query.
+struct Query {
+    std::vector<std::string> terms; // distinct, in query order; all scored
+    std::vector<std::vector<size_t>> phrases; // indices into terms, two or more each
+
+    static Query parse(std::string_view text);
+};
+
+} // namespace crawler
@@ -0,0 +1,162 @@
+#include "query_cache.h"
+#include "query.h"
+#include "../observability/metrics.h"
+#include <algorithm>
+#include <functional>
+
+namespace crawler {
+
+namespace {
+
+// Rough per-entry cost of the list node, index slot and strings
+constexpr size_t kEntryOverhead = 128;
+
+// Expected entry size, for sizing the sketches
+constexpr size_t kTypicalEntryBytes = 4096;
+
+uint64_t mix(uint64_t value) {
+    // splitmix64 finaliser
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+} // namespace
+
+QueryCache::FrequencySketch::FrequencySketch(size_t width) {
+    size_t size = 64;
+    while (size < width) size *= 2;
+    counters_.assign(size * 4 / 2, 0);
+    mask_ = size - 1;
+    sample_size_ = size * 10;
+}
+
+size_t QueryCache::FrequencySketch::index(uint64_t hash, size_t row) const {
+    return row * (mask_ + 1) + (mix(hash + row * 0x9e3779b97f4a7c15ULL) & mask_);
+}
+
+void QueryCache::FrequencySketch::increment(uint64_t hash) {
+    for (size_t row = 0; row < 4; row++) {
+        size_t i = index(hash, row);
+        uint8_t& byte = counters_[i / 2];
+        int shift = (i % 2) * 4;
+        if (((byte >> shift) & 0xF) < 0xF) byte = static_cast<uint8_t>(byte + (1 << shift));
+    }
+    if (++additions_ == sample_size_) {
+        // Halve every counter, both nibbles at once
+        for (auto& byte : counters_) byte = static_cast<uint8_t>((byte >> 1) & 0x77);
+        additions_ /= 2;
+    }
+}
+
+uint32_t QueryCache::FrequencySketch::estimate(uint64_t hash) const {
+    uint32_t count = 0xF;
+    for (size_t row = 0; row < 4; row++) {
+        size_t i = index(hash, row);
+        count = std::min<uint32_t>(count, (counters_[i / 2] >> ((i % 2) * 4)) & 0xF);
+    }
+    return count;
+}
+
+QueryCache::QueryCache(size_t capacity_bytes, size_t shard_count) {
+    shard_count = std::max<size_t>(shard_count, 1);
+    shard_capacity_ = capacity_bytes / shard_count;
+    size_t sketch_width = std::max<size_t>(shard_capacity_ / kTypicalEntryBytes, 64);
+    for (size_t i = 0; i < shard_count; i++) {
+        shards_.push_back(std::make_unique<Shard>(sketch_width));
+    }
+}
+
+size_t QueryCache::entry_bytes(const std::string& key, const std::string& value) {
+    return key.size() + value.size() + kEntryOverhead;
+}
+
+void QueryCache::erase(Shard& shard, std::list<Entry>::iterator it) {
+    size_t bytes = entry_bytes(it->key, it->value);
+    shard.bytes -= bytes;
+    bytes_ -= bytes;
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+bool QueryCache::get(const std::string& key, uint64_t generation, std::string& value) {
+    uint64_t hash = std::hash<std::string>()(key);
+    Shard& shard = *shards_[mix(hash) % shards_.size()];
+    bool hit = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.sketch.increment(hash);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            if (it->second->generation == generation) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                value = it->second->value;
+                hit = true;
+            } else {
+                erase(shard, it->second);
+            }
+        }
+    }
+
+    (hit ? hits_ : misses_)++;
+    static Counter& hit_counter = Metrics::instance().counter("search_cache_hits");
+    static Counter& miss_counter = Metrics::instance().counter("search_cache_misses");
+    (hit ? hit_counter : miss_counter).increment();
+    return hit;
+}
+
+void QueryCache::put(const std::string& key, uint64_t generation, const std::string& value) {
+    size_t bytes = entry_bytes(key, value);
+    if (bytes > shard_capacity_) return;
+    uint64_t hash = std::hash<std::string>()(key);
+    Shard& shard = *shards_[mix(hash) % shards_.size()];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end()) {
+            erase(shard, found->second);
+        }
+
+        // Make room, unless the candidate is rarer than what it would evict;
+        // entries of older generations go regardless
+        uint32_t frequency = shard.sketch.estimate(hash);
+        while (shard.bytes + bytes > shard_capacity_) {
+            auto victim = std::prev(shard.lru.end());
+            if (victim->generation == generation && shard.sketch.estimate(victim->hash) >= frequency) return;
+            erase(shard, victim);
+        }
+
+        shard.lru.push_front({key, value, generation, hash});
+        shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+        shard.bytes += bytes;
+        bytes_ += bytes;
+    }
+    static Gauge& bytes_gauge = Metrics::instance().gauge("search_cache_bytes");
+    bytes_gauge.set(static_cast<double>(bytes_));
+}
+
+std::string QueryCache::key(const std::string& query, int topk, const SearchFilter& filter, bool facets) {
+    Query parsed = Query::parse(query);
+    std::vector<std::string> terms = parsed.terms;
+    std::sort(terms.begin(), terms.end());
+    std::vector<std::string> phrases;
+    for (const auto& phrase : parsed.phrases) {
+        std::string words;
+        for (size_t term : phrase) words += parsed.terms[term] + ' ';
+        phrases.push_back(std::move(words));
+    }
+    std::sort(phrases.begin(), phrases.end());
+
+    // Fields separated by a byte Tokenizer never puts in a word
+    std::string key = std::to_string(topk);
+    for (const auto& term : terms) key += '\x1f' + term;
+    key += '\x1e';
+    for (const auto& phrase : phrases) key += '\x1f' + phrase;
+    key += '\x1e' + filter.category + '\x1f' + filter.brand + '\x1f' + std::to_string(filter.min_price) +
+           '\x1f' + std::to_string(filter.max_price) + (facets ? "\x1e" "facets" : "");
+    return key;
+}
+
+} // namespace crawler
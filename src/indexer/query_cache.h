@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "indexer.h"
+
+namespace crawler {
+
+// Cache of serialized search responses, keyed by key() and tagged with the
+// Indexer::generation() they were computed at; an entry from another
+// generation is a miss and is dropped. Sharded by key hash, each shard an
+// LRU list under its own mutex within an equal share of the memory budget.
+// Admission is TinyLFU (Einziger et al.): a key only displaces the LRU
+// victim if a small count-min sketch of recent lookups has seen it more
+// often, so one-off queries cannot flush the popular ones.
+// Hits and misses go to Metrics as search_cache_hits / search_cache_misses.
+class QueryCache {
+public:
+    static constexpr size_t kDefaultShards = 16;
+
+    explicit QueryCache(size_t capacity_bytes, size_t shard_count = kDefaultShards);
+
+    bool get(const std::string& key, uint64_t generation, std::string& value);
+    void put(const std::string& key, uint64_t generation, const std::string& value);
+
+    // Normalised as Query::parse does, so "Laptop" and "laptop," share an
+    // entry; term order does not matter either
+    static std::string key(const std::string& query, int topk, const SearchFilter& filter = SearchFilter(),
+                           bool facets = false);
+
+    size_t memory_bytes() const { return bytes_; }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    // Four rows of 4-bit counters, halved every sample_size increments so
+    // old popularity fades
+    class FrequencySketch {
+    public:
+        explicit FrequencySketch(size_t width);
+        void increment(uint64_t hash);
+        uint32_t estimate(uint64_t hash) const;
+
+    private:
+        size_t index(uint64_t hash, size_t row) const;
+
+        std::vector<uint8_t> counters_; // two per byte
+        size_t mask_;
+        size_t sample_size_;
+        size_t additions_ = 0;
+    };
+
+    struct Entry {
+        std::string key;
+        std::string value;
+        uint64_t generation;
+        uint64_t hash;
+    };
+
+    struct Shard {
+        explicit Shard(size_t sketch_width) : sketch(sketch_width) {}
+
+        std::mutex mutex;
+        std::list<Entry> lru; // most recent first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // keys in lru
+        size_t bytes = 0;
+        FrequencySketch sketch;
+    };
+
+    static size_t entry_bytes(const std::string& key, const std::string& value);
+    void erase(Shard& shard, std::list<Entry>::iterator it);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t shard_capacity_;
+    std::atomic<size_t> bytes_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+} // namespace crawler
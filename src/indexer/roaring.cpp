@@ -0,0 +1,171 @@
+#include "roaring.h"
+#include <algorithm>
+#include <iterator>
+
+namespace crawler {
+
+namespace {
+
+constexpr size_t kBitsetWords = 65536 / 64;
+
+} // namespace
+
+bool RoaringBitmap::Container::contains(uint16_t low) const {
+    if (is_bitset()) return bits[low / 64] >> (low % 64) & 1;
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool RoaringBitmap::Container::next(uint32_t from, uint16_t& low) const {
+    if (from > 0xFFFF) return false;
+    if (!is_bitset()) {
+        auto it = std::lower_bound(array.begin(), array.end(), from);
+        if (it == array.end()) return false;
+        low = *it;
+        return true;
+    }
+    size_t word = from / 64;
+    uint64_t bits_left = bits[word] & (~0ULL << (from % 64));
+    while (bits_left == 0) {
+        if (++word == kBitsetWords) return false;
+        bits_left = bits[word];
+    }
+    low = static_cast<uint16_t>(word * 64 + __builtin_ctzll(bits_left));
+    return true;
+}
+
+void RoaringBitmap::Container::to_bitset() {
+    bits.assign(kBitsetWords, 0);
+    for (uint16_t low : array) {
+        bits[low / 64] |= 1ULL << (low % 64);
+    }
+    std::vector<uint16_t>().swap(array);
+}
+
+void RoaringBitmap::add(uint32_t value) {
+    uint16_t key = static_cast<uint16_t>(value >> 16);
+    uint16_t low = static_cast<uint16_t>(value);
+
+    // Ordinals usually arrive ascending, so check the last container first
+    auto it = !containers_.empty() && containers_.back().key == key
+                  ? containers_.end() - 1
+                  : std::lower_bound(containers_.begin(), containers_.end(), key,
+                                     [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers_.end() || it->key != key) {
+        it = containers_.insert(it, Container());
+        it->key = key;
+    }
+
+    Container& container = *it;
+    if (container.is_bitset()) {
+        uint64_t& word = container.bits[low / 64];
+        if (!(word >> (low % 64) & 1)) {
+            word |= 1ULL << (low % 64);
+            container.cardinality++;
+        }
+        return;
+    }
+    auto& array = container.array;
+    auto pos = !array.empty() && array.back() < low ? array.end()
+                                                    : std::lower_bound(array.begin(), array.end(), low);
+    if (pos != array.end() && *pos == low) return;
+    array.insert(pos, low);
+    container.cardinality++;
+    if (container.cardinality > kArrayMax) {
+        container.to_bitset();
+    }
+}
+
+const RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) const {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != containers_.end() && it->key == key ? &*it : nullptr;
+}
+
+bool RoaringBitmap::contains(uint32_t value) const {
+    const Container* container = find(static_cast<uint16_t>(value >> 16));
+    return container && container->contains(static_cast<uint16_t>(value));
+}
+
+bool RoaringBitmap::next(uint32_t from, uint32_t& value) const {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), static_cast<uint16_t>(from >> 16),
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    for (; it != containers_.end(); ++it) {
+        // Only the container holding `from` starts part way
+        uint32_t start = it->key == (from >> 16) ? (from & 0xFFFF) : 0;
+        uint16_t low = 0;
+        if (it->next(start, low)) {
+            value = static_cast<uint32_t>(it->key) << 16 | low;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t RoaringBitmap::cardinality() const {
+    size_t count = 0;
+    for (const auto& container : containers_) count += container.cardinality;
+    return count;
+}
+
+size_t RoaringBitmap::memory_bytes() const {
+    size_t bytes = containers_.capacity() * sizeof(Container);
+    for (const auto& container : containers_) {
+        bytes += container.array.capacity() * sizeof(uint16_t) + container.bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+    if (a.is_bitset() && b.is_bitset()) {
+        out.bits.resize(kBitsetWords);
+        for (size_t i = 0; i < kBitsetWords; i++) {
+            out.bits[i] = a.bits[i] & b.bits[i];
+            out.cardinality += static_cast<uint32_t>(__builtin_popcountll(out.bits[i]));
+        }
+        if (out.cardinality <= kArrayMax) {
+            // Back to an array
+            for (size_t i = 0; i < kBitsetWords; i++) {
+                for (uint64_t word = out.bits[i]; word; word &= word - 1) {
+                    out.array.push_back(static_cast<uint16_t>(i * 64 + __builtin_ctzll(word)));
+                }
+            }
+            std::vector<uint64_t>().swap(out.bits);
+        }
+        return out;
+    }
+    if (a.is_bitset() || b.is_bitset()) {
+        const Container& array = a.is_bitset() ? b : a;
+        const Container& bitset = a.is_bitset() ? a : b;
+        for (uint16_t low : array.array) {
+            if (bitset.contains(low)) out.array.push_back(low);
+        }
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(out.array));
+    }
+    out.cardinality = static_cast<uint32_t>(out.array.size());
+    return out;
+}
+
+RoaringBitmap RoaringBitmap::intersect(const RoaringBitmap& a, const RoaringBitmap& b) {
+    RoaringBitmap out;
+    auto ia = a.containers_.begin();
+    auto ib = b.containers_.begin();
+    while (ia != a.containers_.end() && ib != b.containers_.end()) {
+        if (ia->key < ib->key) {
+            ++ia;
+        } else if (ib->key < ia->key) {
+            ++ib;
+        } else {
+            Container container = intersect(*ia, *ib);
+            if (container.cardinality > 0) out.containers_.push_back(std::move(container));
+            ++ia;
+            ++ib;
+        }
+    }
+    return out;
+}
+
+} // namespace crawler
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace crawler {
+
+// Roaring bitmap (Chambi, Lemire et al.) of uint32 values. Values are
+// bucketed by their high 16 bits; a bucket holding up to kArrayMax values
+// is a sorted array of the low halves, a fuller one a 65536-bit bitset.
+// Used for doc-value filters over segment ordinals.
+class RoaringBitmap {
+public:
+    static constexpr size_t kArrayMax = 4096;
+
+    void add(uint32_t value);
+    bool contains(uint32_t value) const;
+
+    // First value >= from
+    bool next(uint32_t from, uint32_t& value) const;
+
+    size_t cardinality() const;
+    bool empty() const { return containers_.empty(); }
+
+    // Values in both
+    static RoaringBitmap intersect(const RoaringBitmap& a, const RoaringBitmap& b);
+
+    size_t memory_bytes() const;
+
+private:
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array; // while cardinality <= kArrayMax
+        std::vector<uint64_t> bits;  // 1024 words otherwise
+
+        bool is_bitset() const { return !bits.empty(); }
+        bool contains(uint16_t low) const;
+        bool next(uint32_t from, uint16_t& low) const;
+        void to_bitset();
+    };
+
+    static Container intersect(const Container& a, const Container& b);
+
+    // Containers ascending by key
+    const Container* find(uint16_t key) const;
+
+    std::vector<Container> containers_;
+};
+
+} // namespace crawler
@@ -0,0 +1,267 @@
+#include "scoring.h"
+#include <algorithm>
+#include <cmath>
+
+namespace crawler {
+
+namespace {
+
+// Heap order: a before b if a is the better result
+bool better(const std::pair<uint64_t, double>& a, const std::pair<uint64_t, double>& b) {
+    return a.second > b.second || (a.second == b.second && a.first < b.first);
+}
+
+// First index at or after `from` whose value is >= target: doubling steps,
+// then a binary search within the last one
+size_t gallop(std::span<const uint32_t> list, size_t from, uint64_t target) {
+    size_t step = 1;
+    size_t low = from;
+    size_t high = from;
+    while (high < list.size() && list[high] < target) {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    high = std::min(high, list.size());
+    return std::lower_bound(list.begin() + low, list.begin() + high, target) - list.begin();
+}
+
+} // namespace
+
+double Bm25::score(double tf, double doc_length) const {
+    double normalized_length = avg_doc_length > 0 ? doc_length / avg_doc_length : 1.0;
+
+    double numerator = tf * (k1 + 1);
+    double denominator = tf + k1 * (1 - b + b * normalized_length);
+
+    return numerator / denominator;
+}
+
+double Bm25::idf(double doc_count, double doc_freq) {
+    // Deleted documents still count in doc_freq until merged away
+    doc_count = std::max(doc_count, doc_freq);
+    return std::log(1.0 + (doc_count - doc_freq + 0.5) / (doc_freq + 0.5));
+}
+
+void TopK::push(uint64_t doc_id, double score) {
+    if (k_ == 0) return;
+    std::pair<uint64_t, double> entry(doc_id, score);
+    if (heap_.size() < k_) {
+        heap_.push_back(entry);
+        std::push_heap(heap_.begin(), heap_.end(), better);
+    } else if (better(entry, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), better);
+        heap_.back() = entry;
+        std::push_heap(heap_.begin(), heap_.end(), better);
+    }
+}
+
+std::vector<std::pair<uint64_t, double>> TopK::take() {
+    std::sort_heap(heap_.begin(), heap_.end(), better);
+    return std::move(heap_);
+}
+
+void max_score_search(std::vector<TermPostings>& terms, const DocTable& docs, const Bm25& bm25,
+                      TopK& top) {
+    size_t n = terms.size();
+    if (n == 0) return;
+
+    // Weakest first; bounds[i] is what terms 0..i can add at most
+    std::sort(terms.begin(), terms.end(),
+              [](const TermPostings& a, const TermPostings& b) { return a.upper_bound < b.upper_bound; });
+    std::vector<double> bounds(n);
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum += terms[i].upper_bound;
+        bounds[i] = sum;
+    }
+
+    std::vector<char> live(n);
+    for (size_t i = 0; i < n; i++) {
+        live[i] = terms[i].cursor.next();
+    }
+    auto block_bound = [&](TermPostings& term) {
+        double bound = term.idf * bm25.score(term.cursor.block_max_freq(), term.cursor.block_min_length());
+        return std::min(bound, term.upper_bound);
+    };
+
+    // Terms before `essential` only get probed
+    size_t essential = 0;
+    double threshold = top.threshold();
+    while (essential < n && bounds[essential] <= threshold) essential++;
+
+    while (essential < n) {
+        uint32_t doc = 0;
+        bool any = false;
+        for (size_t i = essential; i < n; i++) {
+            if (live[i] && (!any || terms[i].cursor.doc() < doc)) {
+                doc = terms[i].cursor.doc();
+                any = true;
+            }
+        }
+        if (!any) break;
+
+        if (docs.filter && !docs.filter->contains(doc)) {
+            uint32_t allowed = 0;
+            if (!docs.filter->next(doc, allowed)) break;
+            for (size_t i = essential; i < n; i++) {
+                if (live[i] && terms[i].cursor.doc() < allowed) live[i] = terms[i].cursor.advance(allowed);
+            }
+            continue;
+        }
+
+        // Up to the nearest block end every essential term stays within its
+        // current block's bound; if even their sum loses, skip the range
+        double rest = essential > 0 ? bounds[essential - 1] : 0.0;
+        double range_bound = rest;
+        uint32_t range_end = UINT32_MAX;
+        for (size_t i = essential; i < n; i++) {
+            if (!live[i]) continue;
+            range_bound += block_bound(terms[i]);
+            range_end = std::min(range_end, terms[i].cursor.block_last());
+        }
+        if (range_bound <= threshold) {
+            if (range_end == UINT32_MAX) break;
+            for (size_t i = essential; i < n; i++) {
+                if (live[i]) live[i] = terms[i].cursor.advance(range_end + 1);
+            }
+            continue;
+        }
+
+        // Then the same for this doc alone, before touching the doc table
+        double bound = rest;
+        for (size_t i = essential; i < n; i++) {
+            if (live[i] && terms[i].cursor.doc() == doc) bound += block_bound(terms[i]);
+        }
+        bool candidate = bound > threshold && !docs.is_deleted(doc);
+        double length = candidate ? docs.length(doc) : 0.0;
+        double score = 0.0;
+        for (size_t i = essential; i < n; i++) {
+            if (!live[i] || terms[i].cursor.doc() != doc) continue;
+            if (candidate) {
+                score += terms[i].idf * bm25.score(terms[i].cursor.freq(), length);
+            }
+            live[i] = terms[i].cursor.next();
+        }
+        if (!candidate) continue;
+
+        // Probe the rest, strongest first, while they could still matter
+        for (size_t i = essential; i-- > 0;) {
+            if (score + bounds[i] <= threshold) break;
+            if (!live[i]) continue;
+            TermPostings& term = terms[i];
+            if (!term.cursor.seek_block(doc)) {
+                live[i] = false;
+                continue;
+            }
+            if (score + block_bound(term) + (i > 0 ? bounds[i - 1] : 0.0) <= threshold) break;
+            if (!term.cursor.advance(doc)) {
+                live[i] = false;
+                continue;
+            }
+            if (term.cursor.doc() == doc) {
+                score += term.idf * bm25.score(term.cursor.freq(), length);
+            }
+        }
+
+        if (score > threshold) {
+            top.push(docs.doc_id(doc), score);
+            threshold = top.threshold();
+            while (essential < n && bounds[essential] <= threshold) essential++;
+        }
+    }
+}
+
+size_t count_facets(std::vector<PostingCursor>& cursors, const DocTable& docs,
+                    std::vector<uint32_t> (&counts)[kFacetCount]) {
+    for (size_t facet = 0; facet < kFacetCount; facet++) {
+        counts[facet].assign(docs.segment->facet_values(static_cast<Facet>(facet)).size(), 0);
+    }
+    size_t n = cursors.size();
+    std::vector<char> live(n);
+    for (size_t i = 0; i < n; i++) {
+        live[i] = cursors[i].next();
+    }
+
+    size_t matches = 0;
+    while (true) {
+        uint32_t doc = 0;
+        bool any = false;
+        for (size_t i = 0; i < n; i++) {
+            if (live[i] && (!any || cursors[i].doc() < doc)) {
+                doc = cursors[i].doc();
+                any = true;
+            }
+        }
+        if (!any) break;
+
+        // Leapfrog through the filter as max_score_search does
+        uint32_t target = doc + 1;
+        if (docs.filter && !docs.filter->contains(doc)) {
+            if (!docs.filter->next(doc, target)) break;
+        } else if (!docs.is_deleted(doc)) {
+            for (size_t facet = 0; facet < kFacetCount; facet++) {
+                counts[facet][docs.segment->facet_value(static_cast<Facet>(facet), doc)]++;
+            }
+            matches++;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (live[i] && cursors[i].doc() < target) live[i] = cursors[i].advance(target);
+        }
+    }
+    return matches;
+}
+
+bool phrase_match(std::span<const std::span<const uint32_t>> words) {
+    size_t n = words.size();
+    if (n == 0) return false;
+
+    // Leapfrog: word i either sits at start + i or names a later start
+    std::vector<size_t> at(n, 0);
+    uint64_t start = 0;
+    size_t i = 0;
+    while (i < n) {
+        uint64_t target = start + i;
+        at[i] = gallop(words[i], at[i], target);
+        if (at[i] == words[i].size()) return false;
+        uint32_t found = words[i][at[i]];
+        if (found == target) {
+            i++;
+        } else {
+            start = found - i;
+            i = 0;
+        }
+    }
+    return true;
+}
+
+double proximity_score(std::span<const std::span<const uint32_t>> terms, std::span<const double> idfs,
+                       const Bm25& bm25, double doc_length) {
+    double score = 0.0;
+    for (size_t i = 0; i < terms.size(); i++) {
+        for (size_t j = i + 1; j < terms.size(); j++) {
+            const auto& a = terms[i].size() <= terms[j].size() ? terms[i] : terms[j];
+            const auto& b = terms[i].size() <= terms[j].size() ? terms[j] : terms[i];
+            if (a.empty()) continue;
+
+            // For each occurrence of the rarer term, the other's within the window
+            double weight = 0.0;
+            size_t at = 0;
+            for (uint32_t position : a) {
+                uint64_t low = position > kProximityWindow ? position - kProximityWindow : 0;
+                at = gallop(b, at, low);
+                for (size_t k = at; k < b.size() && b[k] <= static_cast<uint64_t>(position) + kProximityWindow; k++) {
+                    if (b[k] == position) continue;
+                    double distance = b[k] > position ? b[k] - position : position - b[k];
+                    weight += 1.0 / (distance * distance);
+                }
+            }
+            if (weight > 0) {
+                score += std::min(idfs[i], idfs[j]) * bm25.score(weight, doc_length);
+            }
+        }
+    }
+    return score;
+}
+
+} // namespace crawler
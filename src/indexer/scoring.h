@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "postings.h"
+#include "segment.h"
+#include "roaring.h"
+
+namespace crawler {
+
+// BM25 term weighting. The idf is the smoothed log(1 + (N - df + 0.5) /
+// (df + 0.5)), which stays positive even for terms in nearly every document;
+// score bounds below rely on that.
+struct Bm25 {
+    double k1 = 1.5;
+    double b = 0.75;
+    double avg_doc_length = 0.0;
+
+    // Term frequency part; grows with tf and shrinks with doc length
+    double score(double tf, double doc_length) const;
+
+    static double idf(double doc_count, double doc_freq);
+};
+
+// The k best (doc id, score) pairs offered so far, in a bounded min-heap.
+// On equal scores the lower doc id wins.
+class TopK {
+public:
+    explicit TopK(size_t k) : k_(k) {}
+
+    // Score a document has to beat to get in; 0 until k are held
+    double threshold() const { return heap_.size() < k_ ? 0.0 : heap_.front().second; }
+
+    void push(uint64_t doc_id, double score);
+
+    // Best first; empties the heap
+    std::vector<std::pair<uint64_t, double>> take();
+
+private:
+    size_t k_;
+    std::vector<std::pair<uint64_t, double>> heap_; // worst on top
+};
+
+// One segment's documents (or, with `segment` null, the in-memory buffer's)
+// as scoring needs them; postings refer to them by ordinal
+struct DocTable {
+    const SegmentReader* segment = nullptr;
+    const uint32_t* lengths = nullptr;
+    uint64_t base_doc_id = 0;
+    const std::vector<bool>* deleted = nullptr; // by ordinal, may be shorter
+    const RoaringBitmap* filter = nullptr; // ordinals a query may return; null for all
+
+    uint32_t length(uint32_t ordinal) const {
+        return segment ? segment->doc_length(ordinal) : lengths[ordinal];
+    }
+    uint64_t doc_id(uint32_t ordinal) const {
+        return segment ? segment->doc_id(ordinal) : base_doc_id + ordinal;
+    }
+    bool is_deleted(uint32_t ordinal) const {
+        return deleted && ordinal < deleted->size() && (*deleted)[ordinal];
+    }
+    bool accepts(uint32_t ordinal) const {
+        return !is_deleted(ordinal) && (!filter || filter->contains(ordinal));
+    }
+};
+
+// A query term's postings within one DocTable
+struct TermPostings {
+    PostingCursor cursor;
+    double idf = 0.0;
+    double upper_bound = 0.0; // idf * score(max freq, min length) of the list
+};
+
+// Exact top-k over one DocTable with MaxScore and block-max bounds. Terms
+// whose summed upper bounds cannot beat the threshold stop driving the
+// iteration and are only probed for candidates the others produce; a
+// candidate is dropped as soon as the block bounds of the terms still to
+// be probed cannot lift it over the threshold, before any of those
+// blocks is decoded. With a filter the essential cursors leapfrog through
+// it, so filtered-out runs are skipped rather than scored. `terms` is
+// reordered.
+void max_score_search(std::vector<TermPostings>& terms, const DocTable& docs, const Bm25& bm25,
+                      TopK& top);
+
+// Per facet, how many accepted documents of a segment table hold each
+// value (indexed as in SegmentReader::facet_values) among those containing
+// any of the terms: one pass over the union of the cursors, which are used
+// up. Returns the number of those documents.
+size_t count_facets(std::vector<PostingCursor>& cursors, const DocTable& docs,
+                    std::vector<uint32_t> (&counts)[kFacetCount]);
+
+// Positions of one document's query terms run through the checks below,
+// one ascending list per term or phrase word. Lists are searched by
+// galloping, so a rare word costs little against a frequent one.
+
+// Whether word i occurs at p + i for some p
+bool phrase_match(std::span<const std::span<const uint32_t>> words);
+
+// BM25TP term proximity (Rasolofo & Savoy): each pair of occurrences of two
+// query terms at most kProximityWindow apart adds 1 / distance^2 to the
+// pair's weight, which is then saturated like a term frequency and weighed
+// by the rarer term's idf
+constexpr uint32_t kProximityWindow = 5;
+double proximity_score(std::span<const std::span<const uint32_t>> terms, std::span<const double> idfs,
+                       const Bm25& bm25, double doc_length);
+
+} // namespace crawler
@@ -0,0 +1,602 @@
+#include "segment.h"
+#include "../utils/varint.h"
+#include "../storage/async_io.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+namespace crawler {
+
+namespace {
+
+constexpr uint32_t kSegmentMagic = 0x31474553; // "SEG1"
+constexpr uint32_t kSegmentVersion = 6;
+constexpr uint32_t kDeletionsMagic = 0x314c4544; // "DEL1"
+constexpr size_t kHeaderSize = 4 + 4 + 4 + 4 + 8;
+constexpr size_t kFooterSize = 8 * 8 + 4;
+constexpr size_t kDocEntrySize = 8 + 4 + 4 + 4;
+constexpr size_t kDictEntrySize = 4 + 4 + 4 + 8 + 8 + 4 + 4;
+constexpr size_t kColumnEntrySize = kFacetCount * 4 + 8;
+constexpr size_t kStoredBlockEntrySize = 8 + 4 + 4;
+constexpr int kStoredCompressionLevel = 3;
+constexpr size_t kWriteBufferSize = 1 << 20;
+
+bool read_string(const uint8_t*& p, const uint8_t* end, std::string& out) {
+    uint64_t length = 0;
+    p = varint::get(p, end, length);
+    if (!p || length > static_cast<uint64_t>(end - p)) return false;
+    out.assign(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return true;
+}
+
+void put_string(std::string& out, const std::string& value) {
+    varint::put(out, value.size());
+    out.append(value);
+}
+
+} // namespace
+
+SegmentWriter::~SegmentWriter() {
+    if (fd_ >= 0) {
+        abort();
+    }
+    ZSTD_freeCCtx(zstd_);
+}
+
+bool SegmentWriter::open(const std::string& path) {
+    path_ = path;
+    tmp_path_ = path + ".tmp";
+    fd_ = ::open(tmp_path_.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    ok_ = fd_ >= 0;
+    if (!ok_) return false;
+
+    // Header is filled in by finish() once the counts are known
+    write(std::string(kHeaderSize, '\0'));
+    return ok_;
+}
+
+bool SegmentWriter::open_memory() {
+    memory_ = true;
+    ok_ = true;
+    write(std::string(kHeaderSize, '\0'));
+    return ok_;
+}
+
+std::shared_ptr<const std::string> SegmentWriter::take_memory() {
+    if (!memory_ || !ok_) return nullptr;
+    return std::make_shared<const std::string>(std::move(buffer_));
+}
+
+uint32_t SegmentWriter::add_document(uint64_t doc_id, uint32_t length, const StoredFields& fields) {
+    docs_.push_back({doc_id, length, static_cast<uint32_t>(stored_blocks_.size()),
+                     static_cast<uint32_t>(stored_block_.size())});
+    total_length_ += length;
+
+    put_string(stored_block_, fields.url);
+    put_string(stored_block_, fields.title);
+    put_string(stored_block_, fields.text);
+    put_string(stored_block_, fields.category);
+    put_string(stored_block_, fields.brand);
+    uint64_t price_bits;
+    std::memcpy(&price_bits, &fields.price, sizeof(price_bits));
+    varint::put_fixed64(stored_block_, price_bits);
+    if (stored_block_.size() >= kStoredBlockBytes) {
+        seal_stored_block();
+    }
+
+    const std::string* values[kFacetCount] = {&fields.category, &fields.brand};
+    for (size_t facet = 0; facet < kFacetCount; facet++) {
+        auto [it, inserted] = value_ids_[facet].try_emplace(*values[facet], values_[facet].size());
+        if (inserted) values_[facet].push_back(*values[facet]);
+        doc_values_[facet].push_back(it->second);
+    }
+    prices_.push_back(fields.price);
+
+    return static_cast<uint32_t>(docs_.size() - 1);
+}
+
+void SegmentWriter::seal_stored_block() {
+    if (stored_block_.empty()) return;
+    if (!zstd_) {
+        zstd_ = ZSTD_createCCtx();
+    }
+    compressed_.resize(ZSTD_compressBound(stored_block_.size()));
+    size_t size = zstd_ ? ZSTD_compressCCtx(zstd_, compressed_.data(), compressed_.size(), stored_block_.data(),
+                                            stored_block_.size(), kStoredCompressionLevel)
+                        : 0;
+    if (!zstd_ || ZSTD_isError(size)) {
+        ok_ = false;
+        size = 0;
+    }
+    compressed_.resize(size);
+    stored_blocks_.push_back({offset_, static_cast<uint32_t>(size), static_cast<uint32_t>(stored_block_.size())});
+    write(compressed_);
+    stored_block_.clear();
+}
+
+void SegmentWriter::start_term(std::string_view term) {
+    if (section_ == Section::DOCS) {
+        seal_stored_block();
+        section_ = Section::TERMS;
+        postings_offset_ = offset_;
+    }
+    if (in_term_) {
+        end_term();
+    }
+
+    terms_.push_back({static_cast<uint32_t>(term_bytes_.size()), static_cast<uint32_t>(term.size()),
+                      0, offset_, 0, 0, 0});
+    term_bytes_.append(term);
+    in_term_ = true;
+}
+
+void SegmentWriter::add_posting(uint32_t ordinal, std::span<const uint32_t> positions) {
+    term_postings_.add(ordinal, positions, docs_[ordinal].length);
+}
+
+void SegmentWriter::add_block(std::span<const uint8_t> block, int64_t shift) {
+    term_postings_.append_block(block, shift);
+}
+
+void SegmentWriter::add_term(std::string_view term, PostingListBuilder&& postings) {
+    start_term(term);
+    term_postings_ = std::move(postings);
+    end_term();
+}
+
+void SegmentWriter::end_term() {
+    in_term_ = false;
+    if (term_postings_.doc_freq() == 0) {
+        // Every posting was dropped; leave the term out
+        term_bytes_.resize(terms_.back().term_offset);
+        terms_.pop_back();
+        return;
+    }
+    term_postings_.finish();
+    terms_.back().doc_freq = term_postings_.doc_freq();
+    terms_.back().postings_size = term_postings_.bytes().size();
+    terms_.back().max_freq = term_postings_.max_freq();
+    terms_.back().min_length = term_postings_.min_length();
+    write(term_postings_.bytes());
+
+    term_postings_ = PostingListBuilder();
+}
+
+void SegmentWriter::write(const std::string& bytes) {
+    buffer_.append(bytes);
+    offset_ += bytes.size();
+    if (!memory_ && buffer_.size() >= kWriteBufferSize) {
+        flush_buffer();
+    }
+}
+
+void SegmentWriter::flush_buffer() {
+    // Written in the background while the next buffer fills
+    if (ok_ && !buffer_.empty()) {
+        uint64_t file_offset = offset_ - buffer_.size();
+        AsyncIo::instance().write(fd_, file_offset, std::move(buffer_), io_.track());
+    }
+    buffer_ = std::string();
+    buffer_.reserve(kWriteBufferSize);
+}
+
+bool SegmentWriter::finish() {
+    if (fd_ < 0 && !memory_) return false;
+    if (in_term_) {
+        end_term();
+    }
+    if (section_ == Section::DOCS) {
+        seal_stored_block();
+        postings_offset_ = offset_;
+    }
+
+    uint64_t docs_offset = offset_;
+    scratch_.clear();
+    for (const auto& doc : docs_) {
+        varint::put_fixed64(scratch_, doc.doc_id);
+        varint::put_fixed32(scratch_, doc.length);
+        varint::put_fixed32(scratch_, doc.stored_block);
+        varint::put_fixed32(scratch_, doc.stored_offset);
+    }
+    write(scratch_);
+
+    uint64_t terms_offset = offset_;
+    write(term_bytes_);
+
+    uint64_t dict_offset = offset_;
+    scratch_.clear();
+    for (const auto& term : terms_) {
+        varint::put_fixed32(scratch_, term.term_offset);
+        varint::put_fixed32(scratch_, term.term_length);
+        varint::put_fixed32(scratch_, term.doc_freq);
+        varint::put_fixed64(scratch_, term.postings_offset);
+        varint::put_fixed64(scratch_, term.postings_size);
+        varint::put_fixed32(scratch_, term.max_freq);
+        varint::put_fixed32(scratch_, term.min_length);
+    }
+    write(scratch_);
+
+    uint64_t values_offset = offset_;
+    scratch_.clear();
+    std::vector<uint32_t> renumber[kFacetCount];
+    for (size_t facet = 0; facet < kFacetCount; facet++) {
+        auto& values = values_[facet];
+        std::vector<uint32_t> order(values.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return values[a] < values[b]; });
+        renumber[facet].resize(values.size());
+        varint::put_fixed32(scratch_, static_cast<uint32_t>(values.size()));
+        for (uint32_t i = 0; i < order.size(); i++) {
+            renumber[facet][order[i]] = i;
+            put_string(scratch_, values[order[i]]);
+        }
+    }
+    write(scratch_);
+
+    uint64_t columns_offset = offset_;
+    scratch_.clear();
+    for (size_t facet = 0; facet < kFacetCount; facet++) {
+        for (uint32_t value : doc_values_[facet]) {
+            varint::put_fixed32(scratch_, renumber[facet][value]);
+        }
+    }
+    for (double price : prices_) {
+        uint64_t price_bits;
+        std::memcpy(&price_bits, &price, sizeof(price_bits));
+        varint::put_fixed64(scratch_, price_bits);
+    }
+    write(scratch_);
+
+    uint64_t blocks_offset = offset_;
+    scratch_.clear();
+    for (const auto& block : stored_blocks_) {
+        varint::put_fixed64(scratch_, block.offset);
+        varint::put_fixed32(scratch_, block.compressed_size);
+        varint::put_fixed32(scratch_, block.raw_size);
+    }
+    write(scratch_);
+
+    scratch_.clear();
+    varint::put_fixed64(scratch_, kHeaderSize);
+    varint::put_fixed64(scratch_, postings_offset_);
+    varint::put_fixed64(scratch_, docs_offset);
+    varint::put_fixed64(scratch_, terms_offset);
+    varint::put_fixed64(scratch_, dict_offset);
+    varint::put_fixed64(scratch_, values_offset);
+    varint::put_fixed64(scratch_, columns_offset);
+    varint::put_fixed64(scratch_, blocks_offset);
+    varint::put_fixed32(scratch_, kSegmentMagic);
+    write(scratch_);
+
+    std::string header;
+    varint::put_fixed32(header, kSegmentMagic);
+    varint::put_fixed32(header, kSegmentVersion);
+    varint::put_fixed32(header, static_cast<uint32_t>(docs_.size()));
+    varint::put_fixed32(header, static_cast<uint32_t>(terms_.size()));
+    varint::put_fixed64(header, total_length_);
+    if (memory_) {
+        std::memcpy(buffer_.data(), header.data(), header.size());
+        return ok_;
+    }
+    flush_buffer();
+    if (!io_.wait()) {
+        ok_ = false;
+    }
+    if (ok_ && pwrite(fd_, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size())) {
+        ok_ = false;
+    }
+    if (ok_ && fsync(fd_) != 0) {
+        ok_ = false;
+    }
+
+    ::close(fd_);
+    fd_ = -1;
+    if (!ok_ || std::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+        ::unlink(tmp_path_.c_str());
+        return false;
+    }
+    return true;
+}
+
+void SegmentWriter::abort() {
+    if (memory_) {
+        buffer_.clear();
+        ok_ = false;
+        return;
+    }
+    // Writes still in flight hold the descriptor
+    io_.wait();
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    ::unlink(tmp_path_.c_str());
+    ok_ = false;
+}
+
+SegmentReader::~SegmentReader() {
+    close_map();
+}
+
+void SegmentReader::close_map() {
+    if (memory_) {
+        memory_.reset();
+    } else if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool SegmentReader::open(const std::string& path) {
+    close_map();
+    path_ = path;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize + kFooterSize) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    data_ = static_cast<const uint8_t*>(map);
+    size_ = size;
+    if (!validate()) {
+        close_map();
+        return false;
+    }
+    return true;
+}
+
+bool SegmentReader::open_memory(std::shared_ptr<const std::string> bytes) {
+    close_map();
+    path_.clear();
+    if (!bytes || bytes->size() < kHeaderSize + kFooterSize) return false;
+    memory_ = std::move(bytes);
+    data_ = reinterpret_cast<const uint8_t*>(memory_->data());
+    size_ = memory_->size();
+    if (!validate()) {
+        close_map();
+        return false;
+    }
+    return true;
+}
+
+bool SegmentReader::validate() {
+    const uint8_t* footer = data_ + size_ - kFooterSize;
+    if (varint::get_fixed32(data_) != kSegmentMagic ||
+        varint::get_fixed32(data_ + 4) != kSegmentVersion ||
+        varint::get_fixed32(footer + 64) != kSegmentMagic) {
+        return false;
+    }
+    doc_count_ = varint::get_fixed32(data_ + 8);
+    term_count_ = varint::get_fixed32(data_ + 12);
+    total_length_ = varint::get_fixed64(data_ + 16);
+    stored_offset_ = varint::get_fixed64(footer);
+    postings_offset_ = varint::get_fixed64(footer + 8);
+    docs_offset_ = varint::get_fixed64(footer + 16);
+    terms_offset_ = varint::get_fixed64(footer + 24);
+    dict_offset_ = varint::get_fixed64(footer + 32);
+    values_offset_ = varint::get_fixed64(footer + 40);
+    columns_offset_ = varint::get_fixed64(footer + 48);
+    blocks_offset_ = varint::get_fixed64(footer + 56);
+
+    uint64_t footer_offset = size_ - kFooterSize;
+    bool valid = stored_offset_ == kHeaderSize && stored_offset_ <= postings_offset_ &&
+                 postings_offset_ <= docs_offset_ &&
+                 docs_offset_ + static_cast<uint64_t>(doc_count_) * kDocEntrySize == terms_offset_ &&
+                 terms_offset_ <= dict_offset_ &&
+                 dict_offset_ + static_cast<uint64_t>(term_count_) * kDictEntrySize == values_offset_ &&
+                 values_offset_ <= columns_offset_ &&
+                 columns_offset_ + static_cast<uint64_t>(doc_count_) * kColumnEntrySize == blocks_offset_ &&
+                 blocks_offset_ <= footer_offset && (footer_offset - blocks_offset_) % kStoredBlockEntrySize == 0;
+    stored_block_count_ = static_cast<uint32_t>((footer_offset - blocks_offset_) / kStoredBlockEntrySize);
+    return valid && load_facets();
+}
+
+bool SegmentReader::load_facets() {
+    const uint8_t* p = data_ + values_offset_;
+    const uint8_t* end = data_ + columns_offset_;
+    for (size_t facet = 0; facet < kFacetCount; facet++) {
+        auto& values = facet_values_[facet];
+        values.clear();
+        if (end - p < 4) return false;
+        uint32_t count = varint::get_fixed32(p);
+        p += 4;
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t length = 0;
+            p = varint::get(p, end, length);
+            if (!p || length > static_cast<uint64_t>(end - p)) return false;
+            values.emplace_back(reinterpret_cast<const char*>(p), length);
+            p += length;
+        }
+
+        // Documents by value, so filters start from a ready bitmap
+        auto& docs = facet_docs_[facet];
+        docs.assign(count, RoaringBitmap());
+        for (uint32_t ordinal = 0; ordinal < doc_count_; ordinal++) {
+            uint32_t value = facet_value(static_cast<Facet>(facet), ordinal);
+            if (value >= count) return false;
+            docs[value].add(ordinal);
+        }
+    }
+    return true;
+}
+
+const std::vector<std::string_view>& SegmentReader::facet_values(Facet facet) const {
+    return facet_values_[static_cast<size_t>(facet)];
+}
+
+uint32_t SegmentReader::facet_value(Facet facet, uint32_t ordinal) const {
+    size_t column = columns_offset_ + static_cast<size_t>(facet) * doc_count_ * 4;
+    return varint::get_fixed32(data_ + column + static_cast<size_t>(ordinal) * 4);
+}
+
+bool SegmentReader::lookup_facet(Facet facet, std::string_view value, uint32_t& index) const {
+    const auto& values = facet_values(facet);
+    auto it = std::lower_bound(values.begin(), values.end(), value);
+    if (it == values.end() || *it != value) return false;
+    index = static_cast<uint32_t>(it - values.begin());
+    return true;
+}
+
+const RoaringBitmap& SegmentReader::facet_docs(Facet facet, uint32_t index) const {
+    return facet_docs_[static_cast<size_t>(facet)][index];
+}
+
+double SegmentReader::price(uint32_t ordinal) const {
+    size_t column = columns_offset_ + kFacetCount * doc_count_ * 4;
+    uint64_t price_bits = varint::get_fixed64(data_ + column + static_cast<size_t>(ordinal) * 8);
+    double price;
+    std::memcpy(&price, &price_bits, sizeof(price));
+    return price;
+}
+
+std::string_view SegmentReader::term_at(size_t index, TermInfo* info) const {
+    const uint8_t* entry = data_ + dict_offset_ + index * kDictEntrySize;
+    uint32_t offset = varint::get_fixed32(entry);
+    uint32_t length = varint::get_fixed32(entry + 4);
+    if (info) {
+        info->doc_freq = varint::get_fixed32(entry + 8);
+        info->postings_offset = varint::get_fixed64(entry + 12);
+        info->postings_size = varint::get_fixed64(entry + 20);
+        info->max_freq = varint::get_fixed32(entry + 28);
+        info->min_length = varint::get_fixed32(entry + 32);
+    }
+    if (terms_offset_ + offset + length > dict_offset_) return {};
+    return std::string_view(reinterpret_cast<const char*>(data_ + terms_offset_ + offset), length);
+}
+
+bool SegmentReader::lookup(std::string_view term, TermInfo& info) const {
+    size_t lo = 0;
+    size_t hi = term_count_;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (term_at(mid) < term) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == term_count_ || term_at(lo, &info) != term) return false;
+    // Postings must lie inside their section
+    return info.postings_offset >= postings_offset_ &&
+           info.postings_offset + info.postings_size <= docs_offset_;
+}
+
+PostingCursor SegmentReader::postings(const TermInfo& info) const {
+    return PostingCursor(data_ + info.postings_offset, info.postings_size);
+}
+
+uint64_t SegmentReader::doc_id(uint32_t ordinal) const {
+    return varint::get_fixed64(data_ + docs_offset_ + static_cast<size_t>(ordinal) * kDocEntrySize);
+}
+
+uint32_t SegmentReader::doc_length(uint32_t ordinal) const {
+    return varint::get_fixed32(data_ + docs_offset_ + static_cast<size_t>(ordinal) * kDocEntrySize + 8);
+}
+
+bool SegmentReader::find_doc(uint64_t doc_id, uint32_t& ordinal) const {
+    uint32_t lo = 0;
+    uint32_t hi = doc_count_;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (this->doc_id(mid) < doc_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == doc_count_ || this->doc_id(lo) != doc_id) return false;
+    ordinal = lo;
+    return true;
+}
+
+bool SegmentReader::stored_fields(uint32_t ordinal, StoredFields& out, StoredBlockCache* cache) const {
+    if (ordinal >= doc_count_) return false;
+    const uint8_t* entry = data_ + docs_offset_ + static_cast<size_t>(ordinal) * kDocEntrySize;
+    uint32_t block = varint::get_fixed32(entry + 12);
+    uint32_t offset = varint::get_fixed32(entry + 16);
+    if (block >= stored_block_count_) return false;
+
+    StoredBlockCache local;
+    if (!cache) cache = &local;
+    if (cache->segment != this || cache->block != block) {
+        const uint8_t* info = data_ + blocks_offset_ + static_cast<size_t>(block) * kStoredBlockEntrySize;
+        uint64_t block_offset = varint::get_fixed64(info);
+        uint32_t compressed_size = varint::get_fixed32(info + 8);
+        uint32_t raw_size = varint::get_fixed32(info + 12);
+        if (block_offset < stored_offset_ || block_offset + compressed_size > postings_offset_) return false;
+
+        cache->segment = nullptr;
+        cache->bytes.resize(raw_size);
+        size_t size = ZSTD_decompress(cache->bytes.data(), raw_size, data_ + block_offset, compressed_size);
+        if (ZSTD_isError(size) || size != raw_size) return false;
+        cache->segment = this;
+        cache->block = block;
+    }
+    if (offset >= cache->bytes.size()) return false;
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(cache->bytes.data()) + offset;
+    const uint8_t* end = reinterpret_cast<const uint8_t*>(cache->bytes.data()) + cache->bytes.size();
+    if (!read_string(p, end, out.url) || !read_string(p, end, out.title) ||
+        !read_string(p, end, out.text) || !read_string(p, end, out.category) ||
+        !read_string(p, end, out.brand) || end - p < 8) {
+        return false;
+    }
+    uint64_t price_bits = varint::get_fixed64(p);
+    std::memcpy(&out.price, &price_bits, sizeof(out.price));
+    return true;
+}
+
+bool write_deletions(const std::string& path, const std::vector<bool>& deleted) {
+    std::string bytes;
+    varint::put_fixed32(bytes, kDeletionsMagic);
+    varint::put_fixed32(bytes, static_cast<uint32_t>(deleted.size()));
+    bytes.resize(bytes.size() + (deleted.size() + 7) / 8, '\0');
+    for (size_t i = 0; i < deleted.size(); i++) {
+        if (deleted[i]) bytes[8 + i / 8] = static_cast<char>(bytes[8 + i / 8] | (1 << (i % 8)));
+    }
+
+    std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()) &&
+              fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool read_deletions(const std::string& path, uint32_t doc_count, std::vector<bool>& deleted) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    std::string bytes(8 + (static_cast<size_t>(doc_count) + 7) / 8, '\0');
+    ssize_t n = ::read(fd, bytes.data(), bytes.size());
+    ::close(fd);
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(bytes.data());
+    if (n != static_cast<ssize_t>(bytes.size()) || varint::get_fixed32(p) != kDeletionsMagic ||
+        varint::get_fixed32(p + 4) != doc_count) {
+        return false;
+    }
+    deleted.assign(doc_count, false);
+    for (size_t i = 0; i < doc_count; i++) {
+        deleted[i] = p[8 + i / 8] & (1 << (i % 8));
+    }
+    return true;
+}
+
+} // namespace crawler
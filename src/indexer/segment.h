@@ -0,0 +1,254 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "postings.h"
+#include "roaring.h"
+#include "../storage/async_io.h"
+
+struct ZSTD_CCtx_s;
+
+namespace crawler {
+
+// Per-document fields kept in a segment for result display and filtering
+struct StoredFields {
+    std::string url;
+    std::string title;
+    std::string text;
+    std::string category;
+    std::string brand;
+    double price = 0.0;
+};
+
+// Dictionary-encoded doc-value fields, for filters and facet counts
+enum class Facet { CATEGORY, BRAND };
+constexpr size_t kFacetCount = 2;
+
+// Immutable on-disk index segment, written once by SegmentWriter and
+// searched through SegmentReader over an mmap of the file.
+//
+// Layout (little-endian):
+//   header    magic "SEG1", version, doc_count, term_count, total_length
+//   stored    zstd blocks of about kStoredBlockBytes, each holding per doc
+//             varint-length url, title, text, category, brand; price as
+//             fixed64 bits
+//   postings  per term: a compressed posting list (see PostingCursor)
+//   docs      per doc, in doc_id order: doc_id fixed64, length fixed32,
+//             stored block and offset within it once decompressed (fixed32)
+//   terms     term bytes, ascending
+//   dict      per term: term offset, term length, doc_freq (fixed32),
+//             postings offset and size (fixed64), highest term frequency
+//             and shortest doc length (fixed32) for its BM25 upper bound
+//   values    per Facet: value count (fixed32), then the distinct values
+//             ascending, varint-length
+//   columns   doc values, one column each in doc order: per Facet the
+//             index of the doc's value (fixed32), then price as fixed64 bits
+//   blocks    per stored block: offset (fixed64), compressed and raw size
+//             (fixed32)
+//   footer    section offsets and the magic again
+// Postings refer to documents by ordinal, their index in the doc table.
+class SegmentWriter {
+public:
+    static constexpr size_t kStoredBlockBytes = 16 << 10;
+
+    SegmentWriter() = default;
+    ~SegmentWriter();
+
+    SegmentWriter(const SegmentWriter&) = delete;
+    SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+    // Start writing; the file only appears at `path` once finish() succeeds
+    bool open(const std::string& path);
+
+    // Or build the segment in memory, for SegmentReader::open_memory
+    bool open_memory();
+    std::shared_ptr<const std::string> take_memory();
+
+    // Documents first, in doc_id order; returns the document's ordinal.
+    // `length` is the token count used for BM25 length normalisation.
+    uint32_t add_document(uint64_t doc_id, uint32_t length, const StoredFields& fields);
+
+    // Then terms in ascending byte order, each with postings in ordinal order
+    void start_term(std::string_view term);
+    void add_posting(uint32_t ordinal, std::span<const uint32_t> positions);
+
+    // Or an encoded block of another list, its docs moved by `shift`
+    void add_block(std::span<const uint8_t> block, int64_t shift);
+
+    // Or a whole term at once from a list already keyed by ordinal;
+    // its encoded blocks are written as they are
+    void add_term(std::string_view term, PostingListBuilder&& postings);
+
+    // Write the tables, fsync and rename into place. Terms left without
+    // postings are dropped.
+    bool finish();
+
+    // Drop the partial file
+    void abort();
+
+    uint64_t bytes_written() const { return offset_; }
+
+private:
+    void end_term();
+    void seal_stored_block();
+    void write(const std::string& bytes);
+    void flush_buffer();
+
+    std::string path_;
+    std::string tmp_path_;
+    int fd_ = -1;
+    bool memory_ = false;
+    bool ok_ = false;
+    uint64_t offset_ = 0; // bytes handed to write() so far
+    std::string buffer_;
+    IoGroup io_;          // full buffers being written through AsyncIo
+
+    enum class Section { DOCS, TERMS } section_ = Section::DOCS;
+    uint64_t postings_offset_ = 0;
+
+    struct DocEntry {
+        uint64_t doc_id;
+        uint32_t length;
+        uint32_t stored_block;
+        uint32_t stored_offset;
+    };
+    std::vector<DocEntry> docs_;
+    uint64_t total_length_ = 0;
+
+    // Stored fields of the documents since the last sealed block
+    struct StoredBlock {
+        uint64_t offset;
+        uint32_t compressed_size;
+        uint32_t raw_size;
+    };
+    std::vector<StoredBlock> stored_blocks_;
+    std::string stored_block_;
+    std::string compressed_;
+    ZSTD_CCtx_s* zstd_ = nullptr;
+
+    // Doc values; indices are renumbered in value order by finish()
+    std::unordered_map<std::string, uint32_t> value_ids_[kFacetCount];
+    std::vector<std::string> values_[kFacetCount];
+    std::vector<uint32_t> doc_values_[kFacetCount];
+    std::vector<double> prices_;
+
+    struct TermEntry {
+        uint32_t term_offset;
+        uint32_t term_length;
+        uint32_t doc_freq;
+        uint64_t postings_offset;
+        uint64_t postings_size;
+        uint32_t max_freq;
+        uint32_t min_length;
+    };
+    std::vector<TermEntry> terms_;
+    std::string term_bytes_;
+    bool in_term_ = false;
+
+    // Postings of the current term, written out at end_term()
+    PostingListBuilder term_postings_;
+    std::string scratch_;
+};
+
+// The last stored block a SegmentReader decompressed, so documents read
+// in order cost one decompression per block. One per thread.
+struct StoredBlockCache {
+    const void* segment = nullptr;
+    uint32_t block = UINT32_MAX;
+    std::string bytes;
+};
+
+class SegmentReader {
+public:
+    SegmentReader() = default;
+    ~SegmentReader();
+
+    SegmentReader(const SegmentReader&) = delete;
+    SegmentReader& operator=(const SegmentReader&) = delete;
+
+    // Map and validate a finished segment file
+    bool open(const std::string& path);
+
+    // Same over a segment built in memory, which the reader keeps alive
+    bool open_memory(std::shared_ptr<const std::string> bytes);
+
+    struct TermInfo {
+        uint32_t doc_freq = 0;
+        uint64_t postings_offset = 0;
+        uint64_t postings_size = 0;
+        uint32_t max_freq = 0;
+        uint32_t min_length = 0;
+    };
+
+    bool lookup(std::string_view term, TermInfo& info) const;
+
+    // Postings of a looked-up term; docs are ordinals
+    PostingCursor postings(const TermInfo& info) const;
+
+    // Dictionary in ascending order, for merging
+    size_t term_count() const { return term_count_; }
+    std::string_view term_at(size_t index, TermInfo* info = nullptr) const;
+
+    // Doc table
+    uint32_t doc_count() const { return doc_count_; }
+    uint64_t doc_id(uint32_t ordinal) const;
+    uint32_t doc_length(uint32_t ordinal) const;
+    bool find_doc(uint64_t doc_id, uint32_t& ordinal) const;
+    bool stored_fields(uint32_t ordinal, StoredFields& out, StoredBlockCache* cache = nullptr) const;
+
+    // Doc values, read from the columns without touching stored fields.
+    // A facet's values are ascending; a document's is an index into them.
+    const std::vector<std::string_view>& facet_values(Facet facet) const;
+    uint32_t facet_value(Facet facet, uint32_t ordinal) const;
+    bool lookup_facet(Facet facet, std::string_view value, uint32_t& index) const;
+    double price(uint32_t ordinal) const;
+
+    // Ordinals of the documents with a facet value
+    const RoaringBitmap& facet_docs(Facet facet, uint32_t index) const;
+
+    uint64_t total_length() const { return total_length_; }
+    uint64_t max_doc_id() const { return doc_count_ ? doc_id(doc_count_ - 1) : 0; }
+    size_t size_bytes() const { return size_; }
+    const std::string& path() const { return path_; }
+
+private:
+    bool validate();
+    bool load_facets();
+    void close_map();
+
+    std::string path_; // empty for an in-memory segment
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::shared_ptr<const std::string> memory_;
+
+    uint32_t doc_count_ = 0;
+    uint32_t term_count_ = 0;
+    uint64_t total_length_ = 0;
+
+    uint64_t stored_offset_ = 0;
+    uint64_t postings_offset_ = 0;
+    uint64_t docs_offset_ = 0;
+    uint64_t terms_offset_ = 0;
+    uint64_t dict_offset_ = 0;
+    uint64_t values_offset_ = 0;
+    uint64_t columns_offset_ = 0;
+    uint64_t blocks_offset_ = 0;
+    uint32_t stored_block_count_ = 0;
+
+    // Views into the values section, and the documents having each
+    std::vector<std::string_view> facet_values_[kFacetCount];
+    std::vector<RoaringBitmap> facet_docs_[kFacetCount];
+};
+
+// Deleted ordinals of a segment, kept in a small bitmap file beside it
+// since the segment itself is immutable. Written atomically.
+bool write_deletions(const std::string& path, const std::vector<bool>& deleted);
+bool read_deletions(const std::string& path, uint32_t doc_count, std::vector<bool>& deleted);
+
+} // namespace crawler
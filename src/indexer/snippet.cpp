@@ -0,0 +1,65 @@
+#include "snippet.h"
+#include "../parser/tokenizer.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace crawler {
+
+std::string make_snippet(std::string_view text, const std::vector<std::string>& terms, size_t max_bytes) {
+    if (text.size() <= max_bytes) return std::string(text);
+
+    // Tokenize a copy; views give each word's byte range in `text` too
+    std::vector<char> buffer(text.begin(), text.end());
+    std::vector<std::string_view> words;
+    Tokenizer::tokenize(buffer.data(), buffer.size(), words);
+    auto begin_of = [&](const std::string_view& word) { return static_cast<size_t>(word.data() - buffer.data()); };
+    auto end_of = [&](const std::string_view& word) { return begin_of(word) + word.size(); };
+
+    std::unordered_set<std::string_view> wanted(terms.begin(), terms.end());
+    std::vector<size_t> hits;
+    for (size_t i = 0; i < words.size(); i++) {
+        if (wanted.count(words[i])) hits.push_back(i);
+    }
+
+    // Densest window: for each hit as the first, the most further hits
+    // that still fit in max_bytes along with it
+    size_t hit_begin = 0;
+    size_t hit_end = 0;
+    size_t best = 0;
+    for (size_t first = 0, last = 0; first < hits.size(); first++) {
+        last = std::max(last, first);
+        while (last + 1 < hits.size() && end_of(words[hits[last + 1]]) - begin_of(words[hits[first]]) <= max_bytes) {
+            last++;
+        }
+        if (last - first + 1 > best && end_of(words[hits[last]]) - begin_of(words[hits[first]]) <= max_bytes) {
+            best = last - first + 1;
+            hit_begin = begin_of(words[hits[first]]);
+            hit_end = end_of(words[hits[last]]);
+        }
+    }
+
+    // Centre the hits, then shrink both ends to word boundaries
+    size_t slack = max_bytes - (hit_end - hit_begin);
+    size_t start = hit_begin > slack / 2 ? hit_begin - slack / 2 : 0;
+    start = std::min(start, text.size() - max_bytes);
+    size_t stop = start + max_bytes;
+    if (start > 0) {
+        auto word = std::lower_bound(words.begin(), words.end(), start,
+                                     [&](const std::string_view& w, size_t offset) { return begin_of(w) < offset; });
+        start = word != words.end() ? std::min(begin_of(*word), hit_begin) : hit_begin;
+    }
+    if (stop < text.size()) {
+        auto word = std::upper_bound(words.begin(), words.end(), stop,
+                                     [&](size_t offset, const std::string_view& w) { return offset < end_of(w); });
+        stop = word != words.begin() ? std::max(end_of(*(word - 1)), hit_end) : hit_end;
+        if (stop <= start) stop = start + max_bytes; // a single word longer than the window
+    }
+
+    std::string snippet;
+    if (start > 0) snippet += "...";
+    snippet.append(text.substr(start, stop - start));
+    if (stop < text.size()) snippet += "...";
+    return snippet;
+}
+
+} // namespace crawler
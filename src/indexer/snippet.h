@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace crawler {
+
+// Query-biased snippet: the stretch of at most max_bytes of `text` holding
+// the most query-term hits, cut at word boundaries, with "..." where text
+// was left out. Terms are matched as Tokenizer splits the text, the way it
+// was indexed; without hits the snippet is the start of the text.
+std::string make_snippet(std::string_view text, const std::vector<std::string>& terms,
+                         size_t max_bytes = 200);
+
+} // namespace crawler
@@ -2,17 +2,20 @@
 #include <string>
 #include <thread>
 #include <chrono>
+#include <algorithm>
 #include "utils/config.h"
 #include "scheduler/scheduler.h"
 #include "fetcher/fetcher.h"
 #include "parser/parser.h"
 #include "dedup/dedup.h"
 #include "indexer/indexer.h"
+#include "indexer/query_cache.h"
 #include "storage/storage.h"
 #include "api/api_server.h"
+#include "api/search_handler.h"
+#include "pipeline/pipeline.h"
 #include "observability/logger.h"
 #include "observability/metrics.h"
-#include <nlohmann/json.hpp>
 
 using namespace crawler;
 
@@ -30,7 +33,10 @@ int main(int argc, char* argv[]) {
     }
     
     // Initialize logger
-    Logger::instance().init("info", "json", "stdout");
+    Logger::instance().init(config.logging_level(), config.logging_format(),
+                            config.logging_output() == "file" ? config.logging_file_path() : "stdout",
+                            static_cast<size_t>(config.logging_buffer_kb()) * 1024,
+                            config.logging_overflow() == "block");
     Logger::instance().info("Starting web crawler service");
     
     // Initialize components
@@ -38,8 +44,8 @@ int main(int argc, char* argv[]) {
     Fetcher fetcher;
     Parser parser;
     Deduplicator dedup;
-    Storage storage("./data");
-    Indexer indexer("./data/index");
+    Storage storage(config.storage_data_dir());
+    Indexer indexer(config.storage_index_dir());
     
     // Initialize Redis
     if (!dedup.init_redis(config.redis_host(), config.redis_port())) {
@@ -51,109 +57,73 @@ int main(int argc, char* argv[]) {
     ApiServer api_server;
     api_server.init(config.api_host(), config.api_port(), config.api_threads());
     
-    // Set up search handler
-    api_server.set_search_handler([&indexer](const std::string& query, int topk) {
-        auto results = indexer.search(query, topk);
-        nlohmann::json json_results = nlohmann::json::array();
-        for (const auto& result : results) {
-            nlohmann::json item;
-            item["doc_id"] = result.doc_id;
-            item["url"] = result.url;
-            item["title"] = result.title;
-            item["snippet"] = result.snippet;
-            item["score"] = result.score;
-            json_results.push_back(item);
-        }
-        nlohmann::json response;
-        response["results"] = json_results;
-        response["total"] = results.size();
-        return response.dump();
+    // Set up search handler; responses are cached until the index changes
+    QueryCache search_cache(static_cast<size_t>(std::max(config.api_search_cache_mb(), 0)) * 1024 * 1024);
+    api_server.set_search_handler([&indexer, &search_cache](const SearchRequest& request, std::string& body) {
+        write_search_response(indexer, search_cache, request, body);
     });
     
-    // Start scheduler
-    scheduler.start();
+    // Crawl pipeline: fetch -> parse -> dedup/index -> storage; created
+    // before the API server starts so /debug/pipeline can report on it
+    CrawlPipeline pipeline(scheduler, fetcher, parser, dedup, indexer, storage);
+    api_server.set_pipeline_debug_handler([&pipeline](std::string& body) {
+        pipeline.write_debug(body);
+    });
     
     // Start API server in separate thread
     std::thread api_thread([&api_server]() {
         api_server.start();
     });
     
-    // Main crawl loop
-    Logger::instance().info("Starting crawl loop");
+    // Restore the frontier, dedup state and index from the last checkpoint
+    // and the write-ahead log after it
+    CrawlJournal journal(scheduler, dedup, indexer, storage, config.storage_data_dir() + "/wal");
+    bool recovered = journal.recover();
+    
+    pipeline.set_journal(&journal);
+    AsyncFetcher async_fetcher;
+    if (config.fetcher_async()) {
+        pipeline.set_async_fetcher(&async_fetcher);
+    }
     
     // Add seed URLs (example)
     std::vector<std::string> seed_urls = {
         "https://example.com",
         "https://github.com"
     };
-    scheduler.add_seed_urls(seed_urls);
-    
-    CrawlTask task;
-    while (scheduler.get_next_task(task)) {
-        Metrics::instance().increment_counter("crawl_attempts");
-        
-        // Check deduplication
-        if (dedup.is_url_seen(task.url)) {
-            Metrics::instance().increment_counter("crawl_duplicates");
-            scheduler.mark_completed(task.url);
-            continue;
+    // Seeds are crawled on a fresh start, and marked so rediscovering them
+    // is a no-op; a recovered crawl carries on with its own frontier
+    if (!recovered) {
+        dedup.filter_unseen(seed_urls);
+        for (const auto& url : seed_urls) {
+            journal.url_scheduled(url, 0);
         }
-        
-        // Fetch
-        FetchResult fetch_result = fetcher.fetch(task.url);
-        
-        if (!fetch_result.success) {
-            Logger::instance().warn("Failed to fetch: " + task.url);
-            scheduler.mark_failed(task.url, task.retry_count < config.scheduler_max_retries());
-            continue;
-        }
-        
-        // Check content deduplication
-        if (dedup.is_content_seen(fetch_result.content_hash)) {
-            Metrics::instance().increment_counter("content_duplicates");
-            scheduler.mark_completed(task.url);
-            continue;
-        }
-        
-        // Parse
-        ParsedDocument doc = parser.parse(task.url, fetch_result.content);
-        
-        // Index
-        std::unordered_map<std::string, std::string> metadata;
-        indexer.index_document(doc, metadata);
-        
-        // Save to storage
-        storage.save_document(indexer.total_documents(), task.url, 
-                             fetch_result.content, metadata);
-        
-        // Mark as seen
-        dedup.mark_url_seen(task.url);
-        dedup.mark_content_seen(fetch_result.content_hash, 
-                                std::to_string(indexer.total_documents()));
-        
-        // Extract and add new links
-        for (const auto& link : doc.links) {
-            scheduler.add_url(link, 0);
+        scheduler.add_seed_urls(seed_urls);
+    }
+    
+    Logger::instance().info("Starting crawl pipeline");
+    pipeline.start();
+    
+    // Run until the frontier is exhausted and every stage has drained
+    auto checkpoint_interval = std::chrono::seconds(config.storage_checkpoint_interval_seconds());
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    while (!pipeline.idle()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        if (std::chrono::steady_clock::now() - last_checkpoint >= checkpoint_interval) {
+            journal.checkpoint();
+            last_checkpoint = std::chrono::steady_clock::now();
         }
-        
-        scheduler.mark_completed(task.url);
-        Metrics::instance().increment_counter("crawl_success");
-        
-        // Update metrics
-        Metrics::instance().set_gauge("scheduler_queue_size", scheduler.queue_size());
-        Metrics::instance().set_gauge("indexer_total_docs", indexer.total_documents());
-        
-        // Small delay to avoid overwhelming
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     
     // Cleanup
-    scheduler.stop();
+    pipeline.stop();
+    journal.checkpoint();
     api_server.stop();
     if (api_thread.joinable()) {
         api_thread.join();
     }
     
     Logger::instance().info("Web crawler service stopped");
+    Logger::instance().shutdown();
     return 0;
 }
@@ -1,92 +1,362 @@
 #include "logger.h"
+#include "../api/json_writer.h"
 #include <iostream>
-#include <sstream>
 #include <chrono>
-#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <ctime>
 
 namespace crawler {
 
+namespace {
+
+// How long a message may sit in a ring before the writer picks it up
+constexpr auto kFlushInterval = std::chrono::milliseconds(20);
+
+struct RecordHeader {
+    int64_t time_ns;
+    uint32_t message_size;
+    uint16_t request_id_size;
+    uint8_t level;
+};
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// Single-producer single-consumer byte ring of records: a RecordHeader,
+// the request id, then the message, wrapping at the end
+struct Logger::ThreadBuffer {
+    explicit ThreadBuffer(size_t capacity) : data(capacity), mask(capacity - 1) {}
+
+    void copy_in(uint64_t position, const void* source, size_t size) {
+        size_t offset = position & mask;
+        size_t first = std::min(size, data.size() - offset);
+        std::memcpy(data.data() + offset, source, first);
+        std::memcpy(data.data(), static_cast<const char*>(source) + first, size - first);
+    }
+
+    void copy_out(uint64_t position, void* target, size_t size) const {
+        size_t offset = position & mask;
+        size_t first = std::min(size, data.size() - offset);
+        std::memcpy(target, data.data() + offset, first);
+        std::memcpy(static_cast<char*>(target) + first, data.data(), size - first);
+    }
+
+    std::vector<char> data;
+    size_t mask;
+    alignas(64) std::atomic<uint64_t> head{0}; // advanced by the owning thread
+    alignas(64) std::atomic<uint64_t> tail{0}; // advanced by the writer
+    std::atomic<bool> abandoned{false};        // owning thread has exited
+};
+
 Logger& Logger::instance() {
     static Logger instance;
     return instance;
 }
 
-void Logger::init(const std::string& level, const std::string& format, const std::string& output) {
+Logger::~Logger() {
+    shutdown();
+}
+
+void Logger::init(const std::string& level, const std::string& format, const std::string& output,
+                  size_t buffer_bytes, bool block_when_full) {
+    shutdown();
+
     if (level == "debug") min_level_ = LogLevel::DEBUG;
     else if (level == "info") min_level_ = LogLevel::INFO;
     else if (level == "warn") min_level_ = LogLevel::WARN;
     else if (level == "error") min_level_ = LogLevel::ERROR;
-    
+
     json_format_ = (format == "json");
-    
+    cached_second_ = cached_ms_ = -1;
+    block_when_full_ = block_when_full;
+
+    // Rings are a power of two so positions wrap with a mask
+    size_t capacity = 4096;
+    while (capacity < buffer_bytes) capacity <<= 1;
+    buffer_bytes_ = capacity;
+
+    file_output_.reset();
     if (output != "stdout" && !output.empty()) {
+        std::error_code error;
+        std::filesystem::path parent = std::filesystem::path(output).parent_path();
+        if (!parent.empty()) std::filesystem::create_directories(parent, error);
         file_output_ = std::make_unique<std::ofstream>(output, std::ios::app);
     }
+
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = false;
+    }
+    running_.store(true, std::memory_order_release);
+    writer_ = std::thread(&Logger::writer_loop, this);
+}
+
+void Logger::shutdown() {
+    if (!writer_.joinable()) return;
+    // New messages go the synchronous way from here on; wait out callers
+    // already pushing while the writer can still make room for them
+    running_.store(false);
+    while (pushing_.load() > 0) {
+        wake_cv_.notify_one();
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_one();
+    writer_.join();
+    drain(); // anything pushed after the writer's last pass
+}
+
+void Logger::flush() {
+    if (!running_.load(std::memory_order_acquire)) return;
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    uint64_t ticket = ++flush_requested_;
+    wake_cv_.notify_one();
+    flushed_cv_.wait(lock, [&]() { return flushed_ >= ticket || stopping_; });
 }
 
 void Logger::log(LogLevel level, const std::string& message, const std::string& request_id) {
-    if (level < min_level_) return;
-    
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    std::string formatted = format_message(level, message, request_id);
-    
-    if (file_output_ && file_output_->is_open()) {
-        *file_output_ << formatted << std::endl;
-    } else {
-        std::cout << formatted << std::endl;
+    if (!enabled(level)) return;
+    int64_t time_ns = now_ns();
+
+    // Counted before running_ is checked, so shutdown() sees every caller
+    // that may still push into a ring
+    pushing_.fetch_add(1);
+    bool buffered = running_.load() &&
+        push(thread_buffer(), level, time_ns, message, request_id);
+    pushing_.fetch_sub(1);
+
+    if (!buffered) {
+        std::lock_guard<std::mutex> lock(sync_mutex_);
+        Entry entry{time_ns, level, request_id, message};
+        out_.clear();
+        format_entry(entry, out_);
+        write_out(out_);
     }
 }
 
-void Logger::debug(const std::string& message, const std::string& request_id) {
-    log(LogLevel::DEBUG, message, request_id);
+Logger::ThreadBuffer& Logger::thread_buffer() {
+    // Marks the ring abandoned when the thread exits; the writer still
+    // holds it and drops it once it is empty
+    struct Holder {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~Holder() {
+            if (buffer) buffer->abandoned.store(true, std::memory_order_release);
+        }
+    };
+    thread_local Holder holder;
+    if (!holder.buffer) {
+        holder.buffer = std::make_shared<ThreadBuffer>(buffer_bytes_);
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(holder.buffer);
+    }
+    return *holder.buffer;
 }
 
-void Logger::info(const std::string& message, const std::string& request_id) {
-    log(LogLevel::INFO, message, request_id);
+bool Logger::push(ThreadBuffer& buffer, LogLevel level, int64_t time_ns,
+                  std::string_view message, std::string_view request_id) {
+    // Any one record fits in half the ring, so a blocked caller always gets
+    // room eventually
+    size_t capacity = buffer.data.size();
+    request_id = request_id.substr(0, std::min<size_t>(request_id.size(), 256));
+    size_t limit = capacity / 2 - sizeof(RecordHeader) - request_id.size();
+    if (message.size() > limit) message = message.substr(0, limit);
+    size_t size = sizeof(RecordHeader) + request_id.size() + message.size();
+
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    while (capacity - (head - buffer.tail.load(std::memory_order_acquire)) < size) {
+        if (!block_when_full_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            dropped_total_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        // Shutting down: the writer may be gone, so write it out directly
+        if (!running_.load(std::memory_order_acquire)) return false;
+        wake_cv_.notify_one();
+        std::this_thread::yield();
+    }
+
+    RecordHeader header{time_ns, static_cast<uint32_t>(message.size()),
+                        static_cast<uint16_t>(request_id.size()), static_cast<uint8_t>(level)};
+    buffer.copy_in(head, &header, sizeof(header));
+    buffer.copy_in(head + sizeof(header), request_id.data(), request_id.size());
+    buffer.copy_in(head + sizeof(header) + request_id.size(), message.data(), message.size());
+    buffer.head.store(head + size, std::memory_order_release);
+
+    // Errors and rings filling up do not wait for the next interval; the
+    // notify is unlocked, so at worst it is missed and the interval applies
+    uint64_t used = head + size - buffer.tail.load(std::memory_order_relaxed);
+    if (level >= LogLevel::ERROR || used > capacity / 2) {
+        wake_cv_.notify_one();
+    }
+    return true;
 }
 
-void Logger::warn(const std::string& message, const std::string& request_id) {
-    log(LogLevel::WARN, message, request_id);
+void Logger::writer_loop() {
+    while (true) {
+        uint64_t requested;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait_for(lock, kFlushInterval, [&]() {
+                return stopping_ || flush_requested_ > flushed_;
+            });
+            requested = flush_requested_;
+            stopping = stopping_;
+        }
+
+        drain();
+
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            flushed_ = requested;
+        }
+        flushed_cv_.notify_all();
+        if (stopping) break;
+    }
 }
 
-void Logger::error(const std::string& message, const std::string& request_id) {
-    log(LogLevel::ERROR, message, request_id);
+void Logger::drain() {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers = buffers_;
+    }
+
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    size_t count = 0;
+    bool abandoned_any = false;
+    for (auto& buffer : buffers) {
+        // Read before head: once abandoned, nothing more is pushed
+        bool abandoned = buffer->abandoned.load(std::memory_order_acquire);
+        abandoned_any = abandoned_any || abandoned;
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        while (tail < head) {
+            if (count == entries_.size()) entries_.emplace_back();
+            Entry& entry = entries_[count++];
+            RecordHeader header;
+            buffer->copy_out(tail, &header, sizeof(header));
+            tail += sizeof(header);
+            entry.time_ns = header.time_ns;
+            entry.level = static_cast<LogLevel>(header.level);
+            entry.request_id.resize(header.request_id_size);
+            buffer->copy_out(tail, entry.request_id.data(), header.request_id_size);
+            tail += header.request_id_size;
+            entry.message.resize(header.message_size);
+            buffer->copy_out(tail, entry.message.data(), header.message_size);
+            tail += header.message_size;
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+
+    if (abandoned_any) {
+        std::lock_guard<std::mutex> registry(buffers_mutex_);
+        buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(), [](const auto& buffer) {
+            return buffer->abandoned.load(std::memory_order_acquire) &&
+                   buffer->tail.load(std::memory_order_relaxed) ==
+                       buffer->head.load(std::memory_order_acquire);
+        }), buffers_.end());
+    }
+
+    uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        if (count == entries_.size()) entries_.emplace_back();
+        Entry& entry = entries_[count++];
+        entry.time_ns = now_ns();
+        entry.level = LogLevel::WARN;
+        entry.request_id.clear();
+        entry.message = "Dropped " + std::to_string(dropped) + " log messages: buffer full";
+    }
+    if (count == 0) return;
+
+    // Each ring is in order; merge the threads' messages by time
+    order_.resize(count);
+    for (size_t i = 0; i < count; i++) order_[i] = i;
+    std::stable_sort(order_.begin(), order_.end(), [this](size_t a, size_t b) {
+        return entries_[a].time_ns < entries_[b].time_ns;
+    });
+
+    out_.clear();
+    for (size_t i : order_) {
+        format_entry(entries_[i], out_);
+    }
+    write_out(out_);
 }
 
-std::string Logger::format_message(LogLevel level, const std::string& message, const std::string& request_id) {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::ostringstream oss;
-    std::tm tm_buf;
-    localtime_r(&time_t, &tm_buf);
-    
+void Logger::format_entry(const Entry& entry, std::string& out) {
+    std::string_view time = format_time(entry.time_ns);
     if (json_format_) {
-        oss << "{"
-            << "\"timestamp\":\"" << std::put_time(&tm_buf, "%Y-%m-%dT%H:%M:%S")
-            << "." << std::setfill('0') << std::setw(3) << ms.count() << "Z\","
-            << "\"level\":\"" << level_to_string(level) << "\",";
-        if (!request_id.empty()) {
-            oss << "\"request_id\":\"" << request_id << "\",";
+        JsonWriter json(out);
+        json.begin_object();
+        json.key("timestamp");
+        json.value(time);
+        json.key("level");
+        json.value(level_to_string(entry.level));
+        if (!entry.request_id.empty()) {
+            json.key("request_id");
+            json.value(entry.request_id);
         }
-        oss << "\"message\":\"" << message << "\""
-            << "}";
+        json.key("message");
+        json.value(entry.message);
+        json.end_object();
     } else {
-        oss << std::put_time(&tm_buf, "%Y-%m-%d %H:%M:%S")
-            << "." << std::setfill('0') << std::setw(3) << ms.count()
-            << " [" << level_to_string(level) << "]";
-        if (!request_id.empty()) {
-            oss << " [req:" << request_id << "]";
+        out.append(time);
+        out.append(" [").append(level_to_string(entry.level)).append("]");
+        if (!entry.request_id.empty()) {
+            out.append(" [req:").append(entry.request_id).append("]");
         }
-        oss << " " << message;
+        out.append(" ").append(entry.message);
+    }
+    out.push_back('\n');
+}
+
+std::string_view Logger::format_time(int64_t time_ns) {
+    // Calendar fields change once a second and the text once a millisecond;
+    // messages in between reuse it. JSON is in UTC, text in local time.
+    int64_t ms = time_ns / 1000000;
+    if (ms == cached_ms_) return time_text_;
+    int64_t second = ms / 1000;
+    if (second != cached_second_) {
+        std::time_t seconds = static_cast<std::time_t>(second);
+        std::tm tm_buf;
+        if (json_format_) gmtime_r(&seconds, &tm_buf);
+        else localtime_r(&seconds, &tm_buf);
+        char text[32];
+        size_t size = std::strftime(text, sizeof(text),
+                                    json_format_ ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M:%S", &tm_buf);
+        time_text_.assign(text, size);
+        time_text_.append(json_format_ ? ".000Z" : ".000");
+        cached_second_ = second;
+    }
+    size_t digits = time_text_.size() - (json_format_ ? 4 : 3);
+    int millis = static_cast<int>(ms % 1000);
+    time_text_[digits] = static_cast<char>('0' + millis / 100);
+    time_text_[digits + 1] = static_cast<char>('0' + millis / 10 % 10);
+    time_text_[digits + 2] = static_cast<char>('0' + millis % 10);
+    cached_ms_ = ms;
+    return time_text_;
+}
+
+void Logger::write_out(const std::string& text) {
+    if (file_output_ && file_output_->is_open()) {
+        file_output_->write(text.data(), static_cast<std::streamsize>(text.size()));
+        file_output_->flush();
+    } else {
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+        std::cout.flush();
     }
-    
-    return oss.str();
 }
 
-std::string Logger::level_to_string(LogLevel level) {
+const char* Logger::level_to_string(LogLevel level) {
     switch (level) {
         case LogLevel::DEBUG: return "DEBUG";
         case LogLevel::INFO: return "INFO";
@@ -1,9 +1,37 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <mutex>
 #include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Levels below this are compiled out: by default debug() vanishes from
+// release builds. 0 debug, 1 info, 2 warn, 3 error.
+#ifndef CRAWLER_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define CRAWLER_MIN_LOG_LEVEL 1
+#else
+#define CRAWLER_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+// For debug messages costly to build: the argument is not evaluated unless
+// the message would be logged
+#define CRAWLER_LOG_DEBUG(message)                                             \
+    do {                                                                       \
+        if constexpr (crawler::kMinCompiledLogLevel <= crawler::LogLevel::DEBUG) { \
+            if (crawler::Logger::instance().enabled(crawler::LogLevel::DEBUG)) {   \
+                crawler::Logger::instance().debug(message);                    \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
 
 namespace crawler {
 
@@ -14,28 +42,104 @@ enum class LogLevel {
     ERROR
 };
 
+constexpr LogLevel kMinCompiledLogLevel = static_cast<LogLevel>(CRAWLER_MIN_LOG_LEVEL);
+
+// Callers copy each message into a lock-free ring of their own thread's;
+// after init() a background thread drains the rings, formats the messages
+// in time order and writes them out in batches. When a ring is full the
+// message is dropped (and the drops counted in the log) or, with
+// block_when_full, the caller waits for room. Before init() and after
+// shutdown() messages are written synchronously.
 class Logger {
 public:
     static Logger& instance();
-    
-    void init(const std::string& level, const std::string& format, const std::string& output);
-    
+    ~Logger();
+
+    void init(const std::string& level, const std::string& format, const std::string& output,
+              size_t buffer_bytes = 64 * 1024, bool block_when_full = false);
+
+    // Writes out everything logged so far, then stops the writer thread
+    void shutdown();
+
+    // Returns once every message logged before the call has been written
+    void flush();
+
+    bool enabled(LogLevel level) const {
+        return level >= kMinCompiledLogLevel && level >= min_level_.load(std::memory_order_relaxed);
+    }
+
     void log(LogLevel level, const std::string& message, const std::string& request_id = "");
-    void debug(const std::string& message, const std::string& request_id = "");
-    void info(const std::string& message, const std::string& request_id = "");
-    void warn(const std::string& message, const std::string& request_id = "");
-    void error(const std::string& message, const std::string& request_id = "");
+    void debug(const std::string& message, const std::string& request_id = "") {
+        if constexpr (kMinCompiledLogLevel <= LogLevel::DEBUG) log(LogLevel::DEBUG, message, request_id);
+    }
+    void info(const std::string& message, const std::string& request_id = "") {
+        if constexpr (kMinCompiledLogLevel <= LogLevel::INFO) log(LogLevel::INFO, message, request_id);
+    }
+    void warn(const std::string& message, const std::string& request_id = "") {
+        if constexpr (kMinCompiledLogLevel <= LogLevel::WARN) log(LogLevel::WARN, message, request_id);
+    }
+    void error(const std::string& message, const std::string& request_id = "") {
+        log(LogLevel::ERROR, message, request_id);
+    }
+
+    // Messages dropped because a ring was full
+    uint64_t dropped() const { return dropped_total_.load(std::memory_order_relaxed); }
 
 private:
     Logger() = default;
-    
-    std::string format_message(LogLevel level, const std::string& message, const std::string& request_id);
-    std::string level_to_string(LogLevel level);
-    
-    LogLevel min_level_ = LogLevel::INFO;
+
+    struct ThreadBuffer;
+    struct Entry {
+        int64_t time_ns = 0;
+        LogLevel level = LogLevel::INFO;
+        std::string request_id;
+        std::string message;
+    };
+
+    ThreadBuffer& thread_buffer();
+    // False when the message was not buffered and must be written directly
+    bool push(ThreadBuffer& buffer, LogLevel level, int64_t time_ns,
+              std::string_view message, std::string_view request_id);
+    void writer_loop();
+    void drain();
+    void format_entry(const Entry& entry, std::string& out);
+    std::string_view format_time(int64_t time_ns);
+    void write_out(const std::string& text);
+    static const char* level_to_string(LogLevel level);
+
+    std::atomic<LogLevel> min_level_{LogLevel::INFO};
     bool json_format_ = false;
+    bool block_when_full_ = false;
+    size_t buffer_bytes_ = 64 * 1024;
     std::unique_ptr<std::ofstream> file_output_;
-    std::mutex log_mutex_;
+
+    // One ring per thread that has logged; a ring whose thread has exited
+    // is dropped once drained
+    std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<int> pushing_{0}; // callers in log() that may push to a ring
+    std::thread writer_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable flushed_cv_;
+    bool stopping_ = false;
+    uint64_t flush_requested_ = 0;
+    uint64_t flushed_ = 0;
+
+    std::atomic<uint64_t> dropped_{0};       // since the last batch
+    std::atomic<uint64_t> dropped_total_{0};
+
+    // Guarded by sync_mutex_: the writer's batch, or a message written
+    // synchronously
+    std::mutex sync_mutex_;
+    std::vector<Entry> entries_;
+    std::vector<size_t> order_;
+    std::string out_;
+    int64_t cached_second_ = -1;
+    int64_t cached_ms_ = -1;
+    std::string time_text_;
 };
 
 } // namespace crawler
@@ -1,110 +1,235 @@
 #include "metrics.h"
 #include <sstream>
 #include <algorithm>
-#include <numeric>
+#include <cmath>
+#include <limits>
 
 namespace crawler {
 
+namespace {
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99};
+constexpr const char* kQuantileSuffixes[] = {"_p50", "_p90", "_p99"};
+
+template <typename T>
+T& find_or_add(std::map<std::string, std::unique_ptr<T>>& metrics, const std::string& name) {
+    auto it = metrics.find(name);
+    if (it == metrics.end()) {
+        it = metrics.emplace(name, std::make_unique<T>()).first;
+    }
+    return *it->second;
+}
+
+} // namespace
+
+int64_t Counter::value() const {
+    int64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t Histogram::bucket_index(double value) {
+    // Buckets hold (lower, upper], like Prometheus' le
+    if (!(value > std::ldexp(1.0, kMinExponent))) return 0; // NaN too
+    int exponent;
+    double mantissa = std::frexp(value, &exponent); // value = mantissa * 2^exponent, mantissa in [0.5, 1)
+    exponent -= 1;
+    double scaled = (mantissa * 2 - 1) * kSubBuckets; // exact
+    int sub = static_cast<int>(scaled);
+    if (sub == scaled && --sub < 0) {
+        exponent--;
+        sub = kSubBuckets - 1;
+    }
+    if (exponent >= kMaxExponent) return kBuckets - 1;
+    return 1 + static_cast<size_t>((exponent - kMinExponent) * kSubBuckets + sub);
+}
+
+double Histogram::bucket_upper_bound(size_t index) {
+    if (index == 0) return std::ldexp(1.0, kMinExponent);
+    if (index >= kBuckets - 1) return std::numeric_limits<double>::infinity();
+    int exponent = kMinExponent + static_cast<int>((index - 1) / kSubBuckets);
+    int sub = static_cast<int>((index - 1) % kSubBuckets);
+    return std::ldexp(1.0 + static_cast<double>(sub + 1) / kSubBuckets, exponent);
+}
+
+void Histogram::record(double value) {
+    Shard& shard = shards_[metric_shard()];
+    shard.counts[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.counts.assign(kBuckets, 0);
+    for (size_t s = 0; s < kMetricShards; s++) {
+        const Shard& shard = shards_[s];
+        for (size_t i = 0; i < kBuckets; i++) {
+            snapshot.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    // Counted from the buckets, so a record() racing this one cannot make
+    // the total disagree with them
+    for (uint64_t count : snapshot.counts) {
+        snapshot.count += count;
+    }
+    return snapshot;
+}
+
+double Histogram::Snapshot::quantile(double q) const {
+    if (count == 0) return 0.0;
+    double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (counts[i] == 0 || static_cast<double>(seen + counts[i]) < rank) {
+            seen += counts[i];
+            continue;
+        }
+        double lower = i == 0 ? 0.0 : bucket_upper_bound(i - 1);
+        if (i == counts.size() - 1) return lower;
+        double upper = bucket_upper_bound(i);
+        double fraction = (rank - static_cast<double>(seen)) / static_cast<double>(counts[i]);
+        return lower + (upper - lower) * std::clamp(fraction, 0.0, 1.0);
+    }
+    return bucket_upper_bound(counts.size() - 2);
+}
+
 Metrics& Metrics::instance() {
     static Metrics instance;
     return instance;
 }
 
+Counter& Metrics::counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    return find_or_add(counters_, name);
+}
+
+Gauge& Metrics::gauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    return find_or_add(gauges_, name);
+}
+
+Histogram& Metrics::histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    return find_or_add(histograms_, name);
+}
+
 void Metrics::increment_counter(const std::string& name, int value) {
-    counters_[name] += value;
+    counter(name).increment(value);
 }
 
 int64_t Metrics::get_counter(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
     auto it = counters_.find(name);
     if (it != counters_.end()) {
-        return it->second.load();
+        return it->second->value();
     }
     return 0;
 }
 
 void Metrics::set_gauge(const std::string& name, double value) {
-    gauges_[name] = value;
+    gauge(name).set(value);
 }
 
 double Metrics::get_gauge(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
     auto it = gauges_.find(name);
     if (it != gauges_.end()) {
-        return it->second.load();
+        return it->second->value();
     }
     return 0.0;
 }
 
 void Metrics::record_histogram(const std::string& name, double value) {
-    std::lock_guard<std::mutex> lock(histograms_mutex_);
-    histograms_[name].push_back(value);
-    
-    // Keep only last 1000 values
-    if (histograms_[name].size() > 1000) {
-        histograms_[name].erase(histograms_[name].begin());
-    }
+    histogram(name).record(value);
 }
 
 std::string Metrics::to_prometheus() const {
     std::ostringstream oss;
-    
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+
     // Counters
-    for (const auto& [name, value] : counters_) {
+    for (const auto& [name, counter] : counters_) {
         oss << "# TYPE " << name << " counter\n";
-        oss << name << " " << value.load() << "\n";
+        oss << name << " " << counter->value() << "\n";
     }
-    
+
     // Gauges
-    for (const auto& [name, value] : gauges_) {
+    for (const auto& [name, gauge] : gauges_) {
         oss << "# TYPE " << name << " gauge\n";
-        oss << name << " " << value.load() << "\n";
+        oss << name << " " << gauge->value() << "\n";
     }
-    
-    // Histograms (simplified)
-    std::lock_guard<std::mutex> lock(histograms_mutex_);
-    for (const auto& [name, values] : histograms_) {
-        if (values.empty()) continue;
-        
-        double sum = std::accumulate(values.begin(), values.end(), 0.0);
-        double avg = sum / values.size();
-        double min = *std::min_element(values.begin(), values.end());
-        double max = *std::max_element(values.begin(), values.end());
-        
-        oss << "# TYPE " << name << "_avg gauge\n";
-        oss << name << "_avg " << avg << "\n";
-        oss << "# TYPE " << name << "_min gauge\n";
-        oss << name << "_min " << min << "\n";
-        oss << "# TYPE " << name << "_max gauge\n";
-        oss << name << "_max " << max << "\n";
+
+    // Histograms: the fine buckets end on every power of two, so these
+    // cumulative counts are exact
+    for (const auto& [name, histogram] : histograms_) {
+        Histogram::Snapshot snapshot = histogram->snapshot();
+        oss << "# TYPE " << name << " histogram\n";
+        uint64_t cumulative = snapshot.counts[0];
+        size_t bucket = 1;
+        for (int exponent = Histogram::kMinExponent; exponent <= Histogram::kMaxExponent; exponent++) {
+            double bound = std::ldexp(1.0, exponent);
+            for (; bucket < Histogram::kBuckets - 1 && Histogram::bucket_upper_bound(bucket) <= bound; bucket++) {
+                cumulative += snapshot.counts[bucket];
+            }
+            oss << name << "_bucket{le=\"" << bound << "\"} " << cumulative << "\n";
+        }
+        oss << name << "_bucket{le=\"+Inf\"} " << snapshot.count << "\n";
+        oss << name << "_sum " << snapshot.sum << "\n";
+        oss << name << "_count " << snapshot.count << "\n";
+
+        for (size_t i = 0; i < std::size(kQuantiles); i++) {
+            oss << "# TYPE " << name << kQuantileSuffixes[i] << " gauge\n";
+            oss << name << kQuantileSuffixes[i] << " " << snapshot.quantile(kQuantiles[i]) << "\n";
+        }
     }
-    
+
     return oss.str();
 }
 
 std::string Metrics::to_json() const {
     std::ostringstream oss;
+    std::lock_guard<std::mutex> lock(registry_mutex_);
     oss << "{\n";
     oss << "  \"counters\": {\n";
-    
+
     bool first = true;
-    for (const auto& [name, value] : counters_) {
+    for (const auto& [name, counter] : counters_) {
         if (!first) oss << ",\n";
-        oss << "    \"" << name << "\": " << value.load();
+        oss << "    \"" << name << "\": " << counter->value();
         first = false;
     }
-    
+
     oss << "\n  },\n";
     oss << "  \"gauges\": {\n";
-    
+
     first = true;
-    for (const auto& [name, value] : gauges_) {
+    for (const auto& [name, gauge] : gauges_) {
         if (!first) oss << ",\n";
-        oss << "    \"" << name << "\": " << value.load();
+        oss << "    \"" << name << "\": " << gauge->value();
         first = false;
     }
-    
+
+    oss << "\n  },\n";
+    oss << "  \"histograms\": {\n";
+
+    first = true;
+    for (const auto& [name, histogram] : histograms_) {
+        Histogram::Snapshot snapshot = histogram->snapshot();
+        if (!first) oss << ",\n";
+        oss << "    \"" << name << "\": {\"count\": " << snapshot.count << ", \"sum\": " << snapshot.sum;
+        for (size_t i = 0; i < std::size(kQuantiles); i++) {
+            oss << ", \"" << (kQuantileSuffixes[i] + 1) << "\": " << snapshot.quantile(kQuantiles[i]);
+        }
+        oss << "}";
+        first = false;
+    }
+
     oss << "\n  }\n";
     oss << "}\n";
-    
+
     return oss.str();
 }
 
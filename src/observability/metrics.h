@@ -1,41 +1,120 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
+#include <map>
+#include <memory>
+#include <array>
 #include <atomic>
 #include <mutex>
-#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
 
 namespace crawler {
 
+// Counters and histograms are split over this many shards, each thread
+// writing to its own (round-robin), and summed when read
+constexpr size_t kMetricShards = 16;
+
+inline size_t metric_shard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+class Counter {
+public:
+    void increment(int64_t value = 1) {
+        shards_[metric_shard()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+    int64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<int64_t> value{0};
+    };
+    std::array<Shard, kMetricShards> shards_;
+};
+
+class Gauge {
+public:
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// Log-linear histogram: kSubBuckets buckets per power of two from
+// 2^kMinExponent to 2^kMaxExponent, so quantiles are within 1/kSubBuckets
+// of the true value; smaller values share the first bucket, larger ones the
+// last. Lock-free, sharded like Counter.
+class Histogram {
+public:
+    static constexpr int kMinExponent = -4;
+    static constexpr int kMaxExponent = 32;
+    static constexpr int kSubBuckets = 8;
+    static constexpr size_t kBuckets = (kMaxExponent - kMinExponent) * kSubBuckets + 2;
+
+    Histogram() : shards_(new Shard[kMetricShards]) {}
+
+    void record(double value);
+
+    // Merged over the shards
+    struct Snapshot {
+        std::vector<uint64_t> counts; // per bucket
+        uint64_t count = 0;
+        double sum = 0;
+
+        // Interpolated within the bucket holding the q-th value
+        double quantile(double q) const;
+    };
+    Snapshot snapshot() const;
+
+    static size_t bucket_index(double value);
+    static double bucket_upper_bound(size_t index);
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kBuckets> counts{};
+        std::atomic<double> sum{0.0};
+    };
+    std::unique_ptr<Shard[]> shards_;
+};
+
 class Metrics {
 public:
     static Metrics& instance();
-    
-    // Counter metrics
+
+    // Handles, created on first use and valid for the life of the process;
+    // hot paths keep one instead of going by name every time
+    Counter& counter(const std::string& name);
+    Gauge& gauge(const std::string& name);
+    Histogram& histogram(const std::string& name);
+
+    // By name, at the cost of a lookup
     void increment_counter(const std::string& name, int value = 1);
     int64_t get_counter(const std::string& name) const;
-    
-    // Gauge metrics
     void set_gauge(const std::string& name, double value);
     double get_gauge(const std::string& name) const;
-    
-    // Histogram metrics (simplified: just track min/max/avg)
     void record_histogram(const std::string& name, double value);
-    
-    // Get all metrics as Prometheus format
+
+    // Get all metrics as Prometheus format; histograms as cumulative
+    // _bucket series at powers of two with _sum and _count, plus _p50,
+    // _p90 and _p99 gauges
     std::string to_prometheus() const;
-    
+
     // Get metrics as JSON
     std::string to_json() const;
 
 private:
     Metrics() = default;
-    
-    std::unordered_map<std::string, std::atomic<int64_t>> counters_;
-    std::unordered_map<std::string, std::atomic<double>> gauges_;
-    std::unordered_map<std::string, std::vector<double>> histograms_;
-    mutable std::mutex histograms_mutex_;
+
+    // Guards the registries; the metrics themselves are lock-free
+    mutable std::mutex registry_mutex_;
+    std::map<std::string, std::unique_ptr<Counter>> counters_;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms_;
 };
 
 } // namespace crawler
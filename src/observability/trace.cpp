@@ -0,0 +1,119 @@
+#include "trace.h"
+#include "../api/json_writer.h"
+
+namespace crawler {
+
+namespace {
+
+constexpr const char* kStageNames[kTraceStages] = {
+    "fetch_wait", "dns", "connect", "tls", "ttfb", "download",
+    "parse_queue", "parse", "index_queue", "dedup", "index",
+    "storage_queue", "storage",
+};
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99};
+constexpr const char* kQuantileKeys[] = {"p50_ms", "p90_ms", "p99_ms"};
+
+void write_summary(JsonWriter& json, const Histogram& histogram) {
+    Histogram::Snapshot snapshot = histogram.snapshot();
+    json.begin_object();
+    json.key("count");
+    json.value(snapshot.count);
+    json.key("mean_ms");
+    json.value(snapshot.count ? snapshot.sum / static_cast<double>(snapshot.count) : 0.0);
+    json.key("total_ms");
+    json.value(snapshot.sum);
+    for (size_t i = 0; i < std::size(kQuantiles); i++) {
+        json.key(kQuantileKeys[i]);
+        json.value(snapshot.quantile(kQuantiles[i]));
+    }
+    json.end_object();
+}
+
+} // namespace
+
+const char* trace_stage_name(TraceStage stage) {
+    size_t index = static_cast<size_t>(stage);
+    return index < kTraceStages ? kStageNames[index] : "unknown";
+}
+
+Tracer& Tracer::instance() {
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer() {
+    auto& metrics = Metrics::instance();
+    for (size_t i = 0; i < kTraceStages; i++) {
+        stages_[i] = &metrics.histogram(std::string("pipeline_stage_") + kStageNames[i] + "_ms");
+    }
+    total_ = &metrics.histogram("pipeline_task_ms");
+}
+
+void Tracer::configure(double slow_task_ms, size_t slow_task_samples) {
+    slow_task_ms_.store(slow_task_ms, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(slow_mutex_);
+    slow_task_samples_ = slow_task_samples;
+    while (slow_tasks_.size() > slow_task_samples_) slow_tasks_.pop_front();
+}
+
+void Tracer::record(const std::string& url, const TaskTrace& trace) {
+    for (size_t i = 0; i < kTraceStages; i++) {
+        if (trace.has(static_cast<TraceStage>(i))) {
+            stages_[i]->record(trace.stage_ms[i]);
+        }
+    }
+    double total_ms = trace.total_ms();
+    total_->record(total_ms);
+
+    if (total_ms < slow_task_ms_.load(std::memory_order_relaxed)) return;
+    SlowTask slow;
+    slow.url = url;
+    slow.finished_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    slow.total_ms = total_ms;
+    slow.trace = trace;
+
+    std::lock_guard<std::mutex> lock(slow_mutex_);
+    if (slow_task_samples_ == 0) return;
+    if (slow_tasks_.size() == slow_task_samples_) slow_tasks_.pop_front();
+    slow_tasks_.push_back(std::move(slow));
+}
+
+void Tracer::write_json(JsonWriter& json) const {
+    json.key("stages");
+    json.begin_object();
+    for (size_t i = 0; i < kTraceStages; i++) {
+        json.key(kStageNames[i]);
+        write_summary(json, *stages_[i]);
+    }
+    json.end_object();
+
+    json.key("task");
+    write_summary(json, *total_);
+
+    std::lock_guard<std::mutex> lock(slow_mutex_);
+    json.key("slow_tasks");
+    json.begin_array();
+    for (auto it = slow_tasks_.rbegin(); it != slow_tasks_.rend(); ++it) {
+        json.begin_object();
+        json.key("url");
+        json.value(it->url);
+        json.key("finished_ms");
+        json.value(it->finished_ms);
+        json.key("total_ms");
+        json.value(it->total_ms);
+        json.key("stages_ms");
+        json.begin_object();
+        for (size_t i = 0; i < kTraceStages; i++) {
+            if (!it->trace.has(static_cast<TraceStage>(i))) continue;
+            json.key(kStageNames[i]);
+            json.value(static_cast<double>(it->trace.stage_ms[i]));
+        }
+        json.end_object();
+        json.end_object();
+    }
+    json.end_array();
+}
+
+} // namespace crawler
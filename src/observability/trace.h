@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <deque>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "metrics.h"
+
+namespace crawler {
+
+class JsonWriter;
+
+// Where a crawled URL's time goes, in pipeline order. The fetch is split
+// into libcurl's phases plus fetch_wait, the time the request spent queued
+// before (or between) its transfers.
+enum class TraceStage : uint8_t {
+    FETCH_WAIT,
+    DNS,
+    CONNECT,
+    TLS,
+    TTFB,
+    DOWNLOAD,
+    PARSE_QUEUE,
+    PARSE,
+    INDEX_QUEUE,
+    DEDUP,
+    INDEX,
+    STORAGE_QUEUE,
+    STORAGE,
+    COUNT
+};
+
+constexpr size_t kTraceStages = static_cast<size_t>(TraceStage::COUNT);
+
+const char* trace_stage_name(TraceStage stage);
+
+// Carried by a task through the pipeline: time per stage, taken as the
+// steady clock between marks. Only stages the task reached are recorded.
+struct TaskTrace {
+    using Clock = std::chrono::steady_clock;
+
+    void begin() { start = last = Clock::now(); }
+
+    // Milliseconds since the last mark, moving the mark to now
+    double lap() {
+        auto now = Clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - last).count();
+        last = now;
+        return ms;
+    }
+    void lap(TraceStage stage) { add(stage, lap()); }
+
+    void add(TraceStage stage, double ms) {
+        stage_ms[static_cast<size_t>(stage)] += static_cast<float>(ms);
+        reached |= static_cast<uint16_t>(1u << static_cast<unsigned>(stage));
+    }
+    bool has(TraceStage stage) const { return reached & (1u << static_cast<unsigned>(stage)); }
+
+    double total_ms() const { return std::chrono::duration<double, std::milli>(last - start).count(); }
+
+    Clock::time_point start;
+    Clock::time_point last;
+    std::array<float, kTraceStages> stage_ms{};
+    uint16_t reached = 0;
+};
+
+// Aggregates finished traces into per-stage histograms
+// (pipeline_stage_<stage>_ms, pipeline_task_ms) and keeps the most recent
+// tasks slower than slow_task_ms for /debug/pipeline
+class Tracer {
+public:
+    static Tracer& instance();
+
+    void configure(double slow_task_ms, size_t slow_task_samples);
+
+    void record(const std::string& url, const TaskTrace& trace);
+
+    struct SlowTask {
+        std::string url;
+        int64_t finished_ms = 0; // Unix time
+        double total_ms = 0;
+        TaskTrace trace;
+    };
+
+    // Writes "stages", "task" and "slow_tasks" members into an open object
+    void write_json(JsonWriter& json) const;
+
+private:
+    Tracer();
+
+    std::array<Histogram*, kTraceStages> stages_{};
+    Histogram* total_ = nullptr;
+
+    std::atomic<double> slow_task_ms_{10000};
+    mutable std::mutex slow_mutex_;
+    size_t slow_task_samples_ = 32;
+    std::deque<SlowTask> slow_tasks_; // oldest first
+};
+
+} // namespace crawler
@@ -0,0 +1,248 @@
+#include "link_extractor.h"
+#include "../utils/url_utils.h"
+#include <cctype>
+#include <cstring>
+
+namespace crawler {
+
+namespace {
+
+// Tags longer than this (inline data: URIs, huge srcsets) are skipped
+constexpr size_t kMaxTagBytes = 8192;
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+inline char lower(char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+std::string lowercase(std::string_view value) {
+    std::string out(value);
+    for (char& c : out) c = lower(c);
+    return out;
+}
+
+// Space/comma separated token list, already lowercased
+bool has_token(const std::string& list, std::string_view token) {
+    size_t pos = 0;
+    while ((pos = list.find(token, pos)) != std::string::npos) {
+        bool start_ok = pos == 0 || is_space(list[pos - 1]) || list[pos - 1] == ',';
+        size_t end = pos + token.size();
+        bool end_ok = end == list.size() || is_space(list[end]) || list[end] == ',';
+        if (start_ok && end_ok) return true;
+        pos = end;
+    }
+    return false;
+}
+
+std::string decode_href(std::string_view value) {
+    while (!value.empty() && is_space(value.front())) value.remove_prefix(1);
+    while (!value.empty() && is_space(value.back())) value.remove_suffix(1);
+
+    std::string out;
+    out.reserve(value.size());
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '&' && value.compare(i, 5, "&amp;") == 0) {
+            out.push_back('&');
+            i += 4;
+        } else {
+            out.push_back(value[i]);
+        }
+    }
+    return out;
+}
+
+struct TagAttributes {
+    std::string_view href;
+    std::string_view rel;
+    std::string_view name;
+    std::string_view content;
+    bool has_href = false;
+};
+
+// Attributes of interest from the bytes after the tag name
+void parse_attributes(std::string_view tag, size_t pos, TagAttributes& attrs) {
+    while (pos < tag.size()) {
+        while (pos < tag.size() && (is_space(tag[pos]) || tag[pos] == '/')) pos++;
+        size_t key_start = pos;
+        while (pos < tag.size() && !is_space(tag[pos]) && tag[pos] != '=' && tag[pos] != '/') pos++;
+        std::string key = lowercase(tag.substr(key_start, pos - key_start));
+        if (key.empty()) break;
+
+        while (pos < tag.size() && is_space(tag[pos])) pos++;
+        std::string_view value;
+        if (pos < tag.size() && tag[pos] == '=') {
+            pos++;
+            while (pos < tag.size() && is_space(tag[pos])) pos++;
+            if (pos < tag.size() && (tag[pos] == '"' || tag[pos] == '\'')) {
+                char quote = tag[pos++];
+                size_t end = tag.find(quote, pos);
+                if (end == std::string_view::npos) end = tag.size();
+                value = tag.substr(pos, end - pos);
+                pos = end + 1;
+            } else {
+                size_t start = pos;
+                while (pos < tag.size() && !is_space(tag[pos])) pos++;
+                value = tag.substr(start, pos - start);
+            }
+        }
+
+        if (key == "href") {
+            if (!attrs.has_href) attrs.href = value;
+            attrs.has_href = true;
+        } else if (key == "rel") {
+            attrs.rel = value;
+        } else if (key == "name") {
+            attrs.name = value;
+        } else if (key == "content") {
+            attrs.content = value;
+        }
+    }
+}
+
+} // namespace
+
+StreamingLinkExtractor::StreamingLinkExtractor(std::string base_url)
+    : base_url_(std::move(base_url)) {}
+
+void StreamingLinkExtractor::feed(std::string_view chunk, std::vector<std::string>& links) {
+    const char* data = chunk.data();
+    size_t size = chunk.size();
+    size_t i = 0;
+
+    while (i < size) {
+        switch (state_) {
+            case State::TEXT: {
+                const void* lt = std::memchr(data + i, '<', size - i);
+                if (!lt) return;
+                i = static_cast<size_t>(static_cast<const char*>(lt) - data) + 1;
+                state_ = State::TAG;
+                tag_.clear();
+                tag_overflow_ = false;
+                quote_ = 0;
+                after_equals_ = false;
+                break;
+            }
+
+            case State::TAG: {
+                char c = data[i];
+                if (tag_.empty() && !tag_overflow_ &&
+                    !std::isalpha(static_cast<unsigned char>(c)) && c != '/' && c != '!') {
+                    // "a < b" in text, not a tag
+                    state_ = State::TEXT;
+                    break;
+                }
+                i++;
+
+                if (quote_) {
+                    if (c == quote_) quote_ = 0;
+                } else if (c == '>') {
+                    end_tag(links);
+                    break;
+                } else if ((c == '"' || c == '\'') && after_equals_) {
+                    quote_ = c;
+                }
+                if (!quote_ && !is_space(c)) {
+                    after_equals_ = c == '=';
+                }
+
+                if (tag_.size() < kMaxTagBytes) {
+                    tag_.push_back(c);
+                } else {
+                    tag_overflow_ = true;
+                }
+                if (tag_.size() == 3 && tag_ == "!--") {
+                    state_ = State::COMMENT;
+                    matched_ = 0;
+                }
+                break;
+            }
+
+            case State::COMMENT: {
+                char c = data[i++];
+                if (c == '-') {
+                    matched_ = matched_ < 2 ? matched_ + 1 : 2;
+                } else if (c == '>' && matched_ == 2) {
+                    state_ = State::TEXT;
+                } else {
+                    matched_ = 0;
+                }
+                break;
+            }
+
+            case State::RAW_TEXT: {
+                if (matched_ == 0) {
+                    const void* lt = std::memchr(data + i, '<', size - i);
+                    if (!lt) return;
+                    i = static_cast<size_t>(static_cast<const char*>(lt) - data) + 1;
+                    matched_ = 1;
+                    break;
+                }
+                char c = lower(data[i++]);
+                if (c == raw_end_[matched_]) {
+                    if (raw_end_[++matched_] == '\0') {
+                        // Let TAG consume the rest of the closing tag
+                        state_ = State::TAG;
+                        tag_.assign(raw_end_ + 1);
+                        tag_overflow_ = false;
+                        quote_ = 0;
+                        after_equals_ = false;
+                    }
+                } else {
+                    matched_ = c == '<' ? 1 : 0;
+                }
+                break;
+            }
+        }
+    }
+}
+
+void StreamingLinkExtractor::end_tag(std::vector<std::string>& links) {
+    state_ = State::TEXT;
+    if (tag_overflow_ || tag_.empty() || tag_[0] == '/' || tag_[0] == '!') return;
+
+    size_t pos = 0;
+    while (pos < tag_.size() && !is_space(tag_[pos]) && tag_[pos] != '/') pos++;
+    std::string name = lowercase(std::string_view(tag_).substr(0, pos));
+
+    if (name == "script" || name == "style") {
+        bool self_closing = tag_.back() == '/';
+        if (!self_closing) {
+            state_ = State::RAW_TEXT;
+            raw_end_ = name == "script" ? "</script" : "</style";
+            matched_ = 0;
+        }
+        return;
+    }
+    if (name != "a" && name != "base" && name != "meta") return;
+
+    TagAttributes attrs;
+    parse_attributes(tag_, pos, attrs);
+
+    if (name == "meta") {
+        if (lowercase(attrs.name) == "robots") {
+            std::string directives = lowercase(attrs.content);
+            nofollow_ = nofollow_ || has_token(directives, "nofollow") || has_token(directives, "none");
+        }
+        return;
+    }
+
+    if (!attrs.has_href) return;
+    std::string href = decode_href(attrs.href);
+
+    if (name == "base") {
+        if (!seen_base_ && !href.empty()) {
+            base_url_ = UrlUtils::resolve(base_url_, href);
+            seen_base_ = true;
+        }
+        return;
+    }
+
+    if (nofollow_ || !UrlUtils::is_followable_href(href)) return;
+    if (!attrs.rel.empty() && has_token(lowercase(attrs.rel), "nofollow")) return;
+    links.push_back(UrlUtils::resolve(base_url_, href));
+}
+
+} // namespace crawler
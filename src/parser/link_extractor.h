@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace crawler {
+
+// Incremental outlink scanner for HTML that arrives in chunks.
+// Picks <a href> (except rel=nofollow), <base href> and
+// <meta name=robots content=nofollow> out of the byte stream without
+// building a tree, so links can be queued while the body is still
+// downloading. Tags split across chunks are carried over; comments and
+// <script>/<style> bodies are skipped. Cruder than Parser: only &amp; is
+// decoded in hrefs, and links seen before a late robots meta are kept.
+class StreamingLinkExtractor {
+public:
+    explicit StreamingLinkExtractor(std::string base_url);
+
+    // Scan the next chunk; resolved links completed in it are appended
+    void feed(std::string_view chunk, std::vector<std::string>& links);
+
+    // <meta name=robots> asked for no link following
+    bool nofollow() const { return nofollow_; }
+
+    const std::string& base_url() const { return base_url_; }
+
+private:
+    enum class State { TEXT, TAG, COMMENT, RAW_TEXT };
+
+    void end_tag(std::vector<std::string>& links);
+
+    State state_ = State::TEXT;
+    std::string tag_;       // bytes between '<' and '>' of the current tag
+    bool tag_overflow_ = false;
+    char quote_ = 0;        // open quote inside the current tag
+    bool after_equals_ = false;
+    const char* raw_end_ = nullptr; // "</script" or "</style" in RAW_TEXT
+    size_t matched_ = 0;    // prefix of the terminator seen so far
+
+    std::string base_url_;
+    bool seen_base_ = false;
+    bool nofollow_ = false;
+};
+
+} // namespace crawler
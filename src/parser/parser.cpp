@@ -1,142 +1,266 @@
 #include "parser.h"
+#include "tokenizer.h"
 #include "../utils/url_utils.h"
 #include <gumbo.h>
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
+#include <cstring>
 #include <sstream>
-#include <regex>
+#include <string_view>
 
 namespace crawler {
 
 Parser::Parser() = default;
 Parser::~Parser() = default;
 
+namespace {
+
+std::string lowercase(const char* value) {
+    std::string out = value ? value : "";
+    std::transform(out.begin(), out.end(), out.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+const char* attribute(GumboNode* node, const char* name) {
+    GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, name);
+    return attr ? attr->value : nullptr;
+}
+
+bool has_token(const std::string& list, const char* token) {
+    // Space/comma separated, already lowercased
+    size_t len = std::strlen(token);
+    size_t pos = 0;
+    while ((pos = list.find(token, pos)) != std::string::npos) {
+        bool start_ok = pos == 0 || list[pos - 1] == ' ' || list[pos - 1] == ',';
+        bool end_ok = pos + len == list.size() || list[pos + len] == ' ' || list[pos + len] == ',';
+        if (start_ok && end_ok) return true;
+        pos += len;
+    }
+    return false;
+}
+
+// Common shop markup under the keys the indexer reads
+const char* metadata_alias(const std::string& key) {
+    if (key == "product:price:amount" || key == "og:price:amount") return "price";
+    if (key == "product:brand" || key == "og:brand") return "brand";
+    if (key == "product:category" || key == "article:section") return "category";
+    return nullptr;
+}
+
+} // namespace
+
+void ParsedDocument::clear() {
+    url.clear();
+    title.clear();
+    text_content.clear();
+    links.clear();
+    links_with_anchor.clear();
+    metadata.clear();
+    canonical_url.clear();
+    noindex = false;
+    nofollow = false;
+    token_buffer.clear();
+    tokens.clear();
+    term_positions.clear();
+}
+
 ParsedDocument Parser::parse(const std::string& url, const std::string& html_content) {
     ParsedDocument doc;
+    parse_into(url, html_content, doc);
+    return doc;
+}
+
+void Parser::parse_into(const std::string& url, const std::string& html_content, ParsedDocument& doc) {
+    doc.clear();
     doc.url = url;
     
-    GumboOutput* output = gumbo_parse(html_content.c_str());
-    
-    // Extract title
-    GumboNode* root = output->root;
-    if (root->type == GUMBO_NODE_ELEMENT) {
-        GumboVector* children = &root->v.element.children;
-        for (unsigned int i = 0; i < children->length; ++i) {
-            GumboNode* child = static_cast<GumboNode*>(children->data[i]);
-            if (child->type == GUMBO_NODE_ELEMENT && child->v.element.tag == GUMBO_TAG_TITLE) {
-                if (child->v.element.children.length > 0) {
-                    GumboNode* title_text = static_cast<GumboNode*>(child->v.element.children.data[0]);
-                    if (title_text->type == GUMBO_NODE_TEXT) {
-                        doc.title = title_text->v.text.text;
-                    }
-                }
-                break;
-            }
-        }
-    }
-    
-    // Extract text content
-    doc.text_content = extract_text(html_content);
-    
-    // Extract links
-    doc.links_with_anchor = extract_links(html_content, url);
-    for (const auto& link : doc.links_with_anchor) {
-        doc.links.push_back(link.first);
-    }
+    GumboOutput* output = gumbo_parse_with_options(&kGumboDefaultOptions, html_content.data(),
+                                                   html_content.size());
+    visit(output->root, doc);
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
     
-    // Tokenize
-    doc.tokens = tokenize(doc.text_content);
+    tokenize_document(doc);
+}
+
+void Parser::tokenize_document(ParsedDocument& doc) {
+    // Tokenize a lowercased copy; tokens and term keys are views into it
+    doc.token_buffer.assign(doc.text_content.begin(), doc.text_content.end());
+    Tokenizer::tokenize(doc.token_buffer.data(), doc.token_buffer.size(), doc.tokens);
     
     // Build term positions
     for (size_t i = 0; i < doc.tokens.size(); i++) {
-        std::string normalized = normalize_token(doc.tokens[i]);
-        if (!normalized.empty()) {
-            doc.term_positions[normalized].push_back(i);
-        }
+        doc.term_positions[doc.tokens[i]].push_back(i);
     }
-    
-    gumbo_destroy_output(&kGumboDefaultOptions, output);
-    return doc;
-}
-
-std::string Parser::extract_text(const std::string& html) {
-    GumboOutput* output = gumbo_parse(html.c_str());
-    std::string text;
-    extract_text_recursive(output->root, text);
-    gumbo_destroy_output(&kGumboDefaultOptions, output);
-    return text;
 }
 
-void Parser::extract_text_recursive(void* node_ptr, std::string& text) {
-    GumboNode* node = static_cast<GumboNode*>(node_ptr);
+void Parser::visit(void* root, ParsedDocument& doc) {
+    // Explicit stack instead of recursion: deeply nested pages exist
+    struct Frame {
+        GumboNode* node;
+        unsigned int next_child;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({static_cast<GumboNode*>(root), 0});
     
-    if (node->type == GUMBO_NODE_TEXT) {
-        text += node->v.text.text;
-        text += " ";
-    } else if (node->type == GUMBO_NODE_ELEMENT) {
-        // Skip script and style tags
-        if (node->v.element.tag != GUMBO_TAG_SCRIPT &&
-            node->v.element.tag != GUMBO_TAG_STYLE) {
-            GumboVector* children = &node->v.element.children;
-            for (unsigned int i = 0; i < children->length; ++i) {
-                extract_text_recursive(children->data[i], text);
+    std::string base_url = doc.url;
+    bool seen_base = false;
+    bool in_title = false;
+    bool have_title = false;
+    size_t anchor = SIZE_MAX;      // index into links_with_anchor while inside <a>
+    size_t anchor_depth = 0;
+    
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        GumboNode* node = frame.node;
+        
+        if (node->type == GUMBO_NODE_TEXT || node->type == GUMBO_NODE_CDATA) {
+            const char* text = node->v.text.text;
+            doc.text_content += text;
+            doc.text_content += ' ';
+            if (in_title) {
+                doc.title += text;
+            }
+            if (anchor != SIZE_MAX) {
+                doc.links_with_anchor[anchor].second += text;
+            }
+            stack.pop_back();
+            continue;
+        }
+        
+        if (node->type != GUMBO_NODE_ELEMENT && node->type != GUMBO_NODE_TEMPLATE) {
+            stack.pop_back();
+            continue;
+        }
+        
+        GumboElement& element = node->v.element;
+        if (frame.next_child == 0) {
+            // Entering the element
+            switch (element.tag) {
+                case GUMBO_TAG_SCRIPT:
+                case GUMBO_TAG_STYLE:
+                case GUMBO_TAG_TEMPLATE:
+                    stack.pop_back();
+                    continue;
+                    
+                case GUMBO_TAG_HTML:
+                    if (const char* lang = attribute(node, "lang")) {
+                        doc.metadata["lang"] = lowercase(lang);
+                    }
+                    break;
+                    
+                case GUMBO_TAG_TITLE:
+                    // First <title> wins (an SVG <title> later in the body does not)
+                    in_title = !have_title;
+                    break;
+                    
+                case GUMBO_TAG_BASE:
+                    if (const char* href = attribute(node, "href"); href && !seen_base) {
+                        base_url = UrlUtils::resolve(doc.url, href);
+                        seen_base = true;
+                    }
+                    break;
+                    
+                case GUMBO_TAG_META: {
+                    const char* key = attribute(node, "name");
+                    if (!key) key = attribute(node, "property");
+                    if (!key) key = attribute(node, "itemprop");
+                    const char* content = attribute(node, "content");
+                    if (key && content) {
+                        std::string name = lowercase(key);
+                        if (name == "robots") {
+                            std::string directives = lowercase(content);
+                            doc.noindex = doc.noindex || has_token(directives, "noindex") ||
+                                          has_token(directives, "none");
+                            doc.nofollow = doc.nofollow || has_token(directives, "nofollow") ||
+                                           has_token(directives, "none");
+                        }
+                        if (const char* alias = metadata_alias(name)) {
+                            doc.metadata.emplace(alias, content);
+                        }
+                        doc.metadata[name] = content;
+                    }
+                    break;
+                }
+                
+                case GUMBO_TAG_LINK: {
+                    const char* rel = attribute(node, "rel");
+                    const char* href = attribute(node, "href");
+                    if (rel && href && doc.canonical_url.empty() &&
+                        has_token(lowercase(rel), "canonical")) {
+                        doc.canonical_url = UrlUtils::resolve(base_url, href);
+                    }
+                    break;
+                }
+                
+                case GUMBO_TAG_A: {
+                    const char* href = attribute(node, "href");
+                    if (href && anchor == SIZE_MAX && UrlUtils::is_followable_href(href)) {
+                        std::string resolved = UrlUtils::resolve(base_url, href);
+                        const char* rel = attribute(node, "rel");
+                        if (!rel || !has_token(lowercase(rel), "nofollow")) {
+                            doc.links.push_back(resolved);
+                        }
+                        doc.links_with_anchor.emplace_back(std::move(resolved), std::string());
+                        anchor = doc.links_with_anchor.size() - 1;
+                        anchor_depth = stack.size();
+                    }
+                    break;
+                }
+                
+                default:
+                    break;
             }
         }
+        
+        if (frame.next_child < element.children.length) {
+            GumboNode* child = static_cast<GumboNode*>(element.children.data[frame.next_child++]);
+            stack.push_back({child, 0});
+            continue;
+        }
+        
+        // Leaving the element
+        if (element.tag == GUMBO_TAG_TITLE && in_title) {
+            in_title = false;
+            have_title = true;
+        }
+        if (anchor != SIZE_MAX && stack.size() == anchor_depth) {
+            anchor = SIZE_MAX;
+        }
+        stack.pop_back();
     }
 }
 
-std::vector<std::pair<std::string, std::string>> Parser::extract_links(
-    const std::string& html, const std::string& base_url) {
-    
-    GumboOutput* output = gumbo_parse(html.c_str());
-    std::vector<std::pair<std::string, std::string>> links;
-    extract_links_recursive(output->root, base_url, links);
+std::string Parser::extract_text(const std::string& html) {
+    ParsedDocument doc;
+    GumboOutput* output = gumbo_parse_with_options(&kGumboDefaultOptions, html.data(), html.size());
+    visit(output->root, doc);
     gumbo_destroy_output(&kGumboDefaultOptions, output);
-    return links;
+    return std::move(doc.text_content);
 }
 
-void Parser::extract_links_recursive(void* node_ptr, const std::string& base_url,
-                                    std::vector<std::pair<std::string, std::string>>& links) {
-    GumboNode* node = static_cast<GumboNode*>(node_ptr);
-    
-    if (node->type == GUMBO_NODE_ELEMENT && node->v.element.tag == GUMBO_TAG_A) {
-        GumboAttribute* href = gumbo_get_attribute(&node->v.element.attributes, "href");
-        if (href) {
-            std::string url = href->value;
-            std::string resolved_url = UrlUtils::resolve(base_url, url);
-            
-            // Extract anchor text
-            std::string anchor_text;
-            GumboVector* children = &node->v.element.children;
-            for (unsigned int i = 0; i < children->length; ++i) {
-                GumboNode* child = static_cast<GumboNode*>(children->data[i]);
-                if (child->type == GUMBO_NODE_TEXT) {
-                    anchor_text += child->v.text.text;
-                }
-            }
-            
-            links.emplace_back(resolved_url, anchor_text);
-        }
-    }
+std::vector<std::pair<std::string, std::string>> Parser::extract_links(
+    const std::string& html, const std::string& base_url) {
     
-    if (node->type == GUMBO_NODE_ELEMENT) {
-        GumboVector* children = &node->v.element.children;
-        for (unsigned int i = 0; i < children->length; ++i) {
-            extract_links_recursive(children->data[i], base_url, links);
-        }
-    }
+    ParsedDocument doc;
+    doc.url = base_url;
+    GumboOutput* output = gumbo_parse_with_options(&kGumboDefaultOptions, html.data(), html.size());
+    visit(output->root, doc);
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
+    return std::move(doc.links_with_anchor);
 }
 
 std::vector<std::string> Parser::tokenize(const std::string& text) {
-    std::vector<std::string> tokens;
-    std::regex word_regex(R"(\b\w+\b)");
-    std::sregex_iterator iter(text.begin(), text.end(), word_regex);
-    std::sregex_iterator end;
+    std::vector<char> buffer(text.begin(), text.end());
+    std::vector<std::string_view> views;
+    Tokenizer::tokenize(buffer.data(), buffer.size(), views);
     
-    for (; iter != end; ++iter) {
-        tokens.push_back(iter->str());
+    std::vector<std::string> tokens;
+    tokens.reserve(views.size());
+    for (auto view : views) {
+        tokens.emplace_back(view);
     }
-    
     return tokens;
 }
 
@@ -1,22 +1,39 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
 namespace crawler {
 
+// Move-only: tokens and term_positions keys are views into token_buffer
 struct ParsedDocument {
+    ParsedDocument() = default;
+    ParsedDocument(ParsedDocument&&) = default;
+    ParsedDocument& operator=(ParsedDocument&&) = default;
+    ParsedDocument(const ParsedDocument&) = delete;
+    ParsedDocument& operator=(const ParsedDocument&) = delete;
+    
     std::string url;
     std::string title;
     std::string text_content;
     std::vector<std::string> links;
     std::vector<std::pair<std::string, std::string>> links_with_anchor; // (url, anchor_text)
-    std::unordered_map<std::string, std::string> metadata; // key-value pairs
+    std::unordered_map<std::string, std::string> metadata; // key-value pairs (<meta>, lang)
+    
+    // Hints from <link rel=canonical> and <meta name=robots>
+    std::string canonical_url;
+    bool noindex = false;
+    bool nofollow = false;
     
     // For indexing
-    std::vector<std::string> tokens;
-    std::unordered_map<std::string, std::vector<size_t>> term_positions; // term -> positions
+    std::vector<char> token_buffer; // lowercased copy of text_content
+    std::vector<std::string_view> tokens;
+    std::unordered_map<std::string_view, std::vector<size_t>> term_positions; // term -> positions
+    
+    // Empty every field but keep allocated capacity for the next page
+    void clear();
 };
 
 class Parser {
@@ -27,6 +44,13 @@ public:
     // Parse HTML content
     ParsedDocument parse(const std::string& url, const std::string& html_content);
     
+    // Parse into an existing document, reusing its buffers. One gumbo parse
+    // and one tree walk fill title, text, links, metadata and robots hints.
+    void parse_into(const std::string& url, const std::string& html_content, ParsedDocument& doc);
+    
+    // Fill tokens and term_positions from text_content, as parse_into does
+    static void tokenize_document(ParsedDocument& doc);
+    
     // Extract text from HTML
     std::string extract_text(const std::string& html);
     
@@ -34,16 +58,15 @@ public:
     std::vector<std::pair<std::string, std::string>> extract_links(
         const std::string& html, const std::string& base_url);
     
-    // Tokenize text
+    // Tokenize text (lowercased words; see Tokenizer)
     std::vector<std::string> tokenize(const std::string& text);
     
     // Normalize token (lowercase, remove punctuation)
     std::string normalize_token(const std::string& token);
 
 private:
-    void extract_text_recursive(void* node, std::string& text);
-    void extract_links_recursive(void* node, const std::string& base_url, 
-                                 std::vector<std::pair<std::string, std::string>>& links);
+    // Single pass over the gumbo tree
+    void visit(void* root, ParsedDocument& doc);
 };
 
 } // namespace crawler
@@ -0,0 +1,238 @@
+#include "tokenizer.h"
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CRAWLER_TOKENIZER_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CRAWLER_TOKENIZER_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CRAWLER_TOKENIZER_NEON 1
+#endif
+
+namespace crawler {
+
+namespace {
+
+// Tokens are emitted from per-block bitmasks of word bytes
+struct TokenState {
+    bool in_word = false;
+    size_t start = 0;
+    int skip = 0; // continuation bytes left of a multibyte separator
+};
+
+inline bool is_ascii_word(uint8_t c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+}
+
+// Length of the UTF-8 separator starting at p (0 if p starts a word char).
+// Lowercases Latin-1 capitals (U+00C0-U+00DE) in place.
+int utf8_separator(uint8_t* p, const uint8_t* end) {
+    uint8_t lead = p[0];
+    uint8_t next = p + 1 < end ? p[1] : 0;
+    switch (lead) {
+        case 0xC2:
+            // NBSP ¡ § « ¶ · » ¿
+            if (next == 0xA0 || next == 0xA1 || next == 0xA7 || next == 0xAB ||
+                next == 0xB6 || next == 0xB7 || next == 0xBB || next == 0xBF) {
+                return 2;
+            }
+            return 0;
+        case 0xC3:
+            if (next == 0x97 || next == 0xB7) return 2; // × ÷
+            if (next >= 0x80 && next <= 0x9E) {
+                p[1] = static_cast<uint8_t>(next + 0x20);
+            }
+            return 0;
+        case 0xE2:
+            // U+2000-U+207F: spaces, dashes, quotes, bullets, ellipsis
+            return next == 0x80 || next == 0x81 ? 3 : 0;
+        case 0xE3:
+            // U+3000-U+303F: ideographic space and CJK punctuation
+            return next == 0x80 ? 3 : 0;
+        case 0xEF:
+            // U+FEFF byte order mark
+            return next == 0xBB && p + 2 < end && p[2] == 0xBF ? 3 : 0;
+        default:
+            return 0;
+    }
+}
+
+// Classify and lowercase n (<= 64) bytes starting at p; bit i set = word byte
+uint64_t scalar_mask(uint8_t* p, size_t n, const uint8_t* end, TokenState& state) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t c = p[i];
+        if (c < 0x80) {
+            state.skip = 0;
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<uint8_t>(c | 0x20);
+                p[i] = c;
+            }
+            if (is_ascii_word(c)) {
+                mask |= 1ULL << i;
+            }
+            continue;
+        }
+
+        if (state.skip > 0) {
+            state.skip--;
+            continue;
+        }
+        if (c >= 0xC0) {
+            int length = utf8_separator(p + i, end);
+            if (length > 0) {
+                state.skip = length - 1;
+                continue;
+            }
+        }
+        mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+// Turn one block's word mask into tokens
+inline void emit(uint64_t mask, size_t width, size_t base, const char* data,
+                 TokenState& state, std::vector<std::string_view>& tokens) {
+    uint64_t valid = width >= 64 ? ~0ULL : ((1ULL << width) - 1);
+    uint64_t shifted = (mask << 1) | (state.in_word ? 1 : 0);
+    uint64_t starts = mask & ~shifted & valid;
+    uint64_t ends = ~mask & shifted & valid;
+
+    while (true) {
+        if (state.in_word) {
+            if (ends == 0) break;
+            size_t i = static_cast<size_t>(__builtin_ctzll(ends));
+            ends &= ends - 1;
+            tokens.emplace_back(data + state.start, base + i - state.start);
+            state.in_word = false;
+        } else {
+            if (starts == 0) break;
+            size_t i = static_cast<size_t>(__builtin_ctzll(starts));
+            starts &= starts - 1;
+            state.start = base + i;
+            state.in_word = true;
+        }
+    }
+}
+
+#if defined(CRAWLER_TOKENIZER_AVX2)
+constexpr size_t kBlock = 32;
+
+// Lowercase ASCII in place; returns the word mask and sets high to the
+// mask of non-ASCII bytes
+inline uint64_t simd_mask(uint8_t* p, uint32_t& high) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+    v = _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+
+    __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), v));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    high = static_cast<uint32_t>(_mm256_movemask_epi8(v));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(lower, digit)));
+}
+#elif defined(CRAWLER_TOKENIZER_SSE2)
+constexpr size_t kBlock = 16;
+
+inline uint64_t simd_mask(uint8_t* p, uint32_t& high) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    v = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    high = static_cast<uint32_t>(_mm_movemask_epi8(v));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(lower, digit)));
+}
+#elif defined(CRAWLER_TOKENIZER_NEON)
+constexpr size_t kBlock = 16;
+
+inline uint32_t neon_movemask(uint8x16_t bytes) {
+    static const uint8_t kBits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t masked = vandq_u8(bytes, vld1q_u8(kBits));
+    return static_cast<uint32_t>(vaddv_u8(vget_low_u8(masked))) |
+           (static_cast<uint32_t>(vaddv_u8(vget_high_u8(masked))) << 8);
+}
+
+inline uint64_t simd_mask(uint8_t* p, uint32_t& high) {
+    uint8x16_t v = vld1q_u8(p);
+    uint8x16_t upper = vandq_u8(vcgeq_u8(v, vdupq_n_u8('A')), vcleq_u8(v, vdupq_n_u8('Z')));
+    v = vorrq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+    vst1q_u8(p, v);
+
+    uint8x16_t lower = vandq_u8(vcgeq_u8(v, vdupq_n_u8('a')), vcleq_u8(v, vdupq_n_u8('z')));
+    uint8x16_t digit = vandq_u8(vcgeq_u8(v, vdupq_n_u8('0')), vcleq_u8(v, vdupq_n_u8('9')));
+    high = neon_movemask(vcgeq_u8(v, vdupq_n_u8(0x80)));
+    return neon_movemask(vorrq_u8(lower, digit));
+}
+#endif
+
+} // namespace
+
+void Tokenizer::tokenize_scalar(char* data, size_t size, std::vector<std::string_view>& tokens) {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(data);
+    const uint8_t* end = bytes + size;
+    TokenState state;
+    for (size_t pos = 0; pos < size; pos += 64) {
+        size_t n = size - pos < 64 ? size - pos : 64;
+        uint64_t mask = scalar_mask(bytes + pos, n, end, state);
+        emit(mask, n, pos, data, state, tokens);
+    }
+    if (state.in_word) {
+        tokens.emplace_back(data + state.start, size - state.start);
+    }
+}
+
+void Tokenizer::tokenize(char* data, size_t size, std::vector<std::string_view>& tokens) {
+#if defined(CRAWLER_TOKENIZER_AVX2) || defined(CRAWLER_TOKENIZER_SSE2) || defined(CRAWLER_TOKENIZER_NEON)
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(data);
+    const uint8_t* end = bytes + size;
+    TokenState state;
+    size_t pos = 0;
+    for (; pos + kBlock <= size; pos += kBlock) {
+        uint32_t high = 0;
+        uint64_t mask = simd_mask(bytes + pos, high);
+        if (high != 0) {
+            // UTF-8 in this block; separators span blocks, so the scalar
+            // classifier carries its state across
+            mask = scalar_mask(bytes + pos, kBlock, end, state);
+        } else {
+            state.skip = 0;
+        }
+        emit(mask, kBlock, pos, data, state, tokens);
+    }
+    if (pos < size) {
+        uint64_t mask = scalar_mask(bytes + pos, size - pos, end, state);
+        emit(mask, size - pos, pos, data, state, tokens);
+    }
+    if (state.in_word) {
+        tokens.emplace_back(data + state.start, size - state.start);
+    }
+#else
+    tokenize_scalar(data, size, tokens);
+#endif
+}
+
+const char* Tokenizer::implementation() {
+#if defined(CRAWLER_TOKENIZER_AVX2)
+    return "avx2";
+#elif defined(CRAWLER_TOKENIZER_SSE2)
+    return "sse2";
+#elif defined(CRAWLER_TOKENIZER_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace crawler
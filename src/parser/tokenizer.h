@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace crawler {
+
+// Word tokenizer over a mutable text buffer.
+// Lowercases the buffer in place (ASCII and Latin-1 letters) and appends a
+// string_view per word, so tokens cost no allocation of their own. Word
+// characters are ASCII letters and digits plus any UTF-8 multibyte
+// character except common Unicode spaces and punctuation (NBSP, U+2000-206F,
+// CJK punctuation, guillemets, ...). ASCII runs are classified 16 or 32
+// bytes at a time with SSE2/AVX2/NEON; blocks with non-ASCII bytes take the
+// scalar path.
+class Tokenizer {
+public:
+    // Views point into `data` and stay valid while the buffer does
+    static void tokenize(char* data, size_t size, std::vector<std::string_view>& tokens);
+
+    // Reference implementation, byte at a time
+    static void tokenize_scalar(char* data, size_t size, std::vector<std::string_view>& tokens);
+
+    // "avx2", "sse2", "neon" or "scalar"
+    static const char* implementation();
+};
+
+} // namespace crawler
@@ -0,0 +1,275 @@
+#include "crawl_journal.h"
+#include "../parser/parser.h"
+#include "../utils/config.h"
+#include "../utils/url_utils.h"
+#include "../utils/varint.h"
+#include "../observability/logger.h"
+#include "../observability/metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+#include <unordered_set>
+
+namespace crawler {
+
+namespace {
+
+// Scheduled URLs are marked seen again in batches of this many
+constexpr size_t kDedupBatch = 1024;
+
+void put_string(std::string& out, std::string_view text) {
+    varint::put(out, text.size());
+    out.append(text);
+}
+
+// Payload reader; every get fails once one has
+struct PayloadReader {
+    const uint8_t* p;
+    const uint8_t* end;
+
+    explicit PayloadReader(std::string_view payload)
+        : p(reinterpret_cast<const uint8_t*>(payload.data())), end(p + payload.size()) {}
+
+    bool get(uint64_t& value) {
+        if (p) p = varint::get(p, end, value);
+        return p != nullptr;
+    }
+
+    bool get(std::string_view& text) {
+        uint64_t length = 0;
+        if (!get(length) || length > static_cast<uint64_t>(end - p)) {
+            p = nullptr;
+            return false;
+        }
+        text = std::string_view(reinterpret_cast<const char*>(p), length);
+        p += length;
+        return true;
+    }
+};
+
+} // namespace
+
+CrawlJournal::CrawlJournal(Scheduler& scheduler, Deduplicator& dedup, Indexer& indexer, Storage& storage,
+                           const std::string& wal_dir)
+    : scheduler_(scheduler), dedup_(dedup), indexer_(indexer), storage_(storage),
+      wal_(wal_dir, static_cast<size_t>(Config::instance().storage_wal_segment_size_mb()) * 1024 * 1024,
+           Config::instance().storage_wal_group_commit_ms()) {}
+
+CrawlJournal::~CrawlJournal() {
+    // The indexer may outlive us
+    if (open_) {
+        indexer_.set_index_callback(nullptr);
+    }
+}
+
+bool CrawlJournal::recover() {
+    auto& logger = Logger::instance();
+    auto start = std::chrono::steady_clock::now();
+    if (!wal_.open()) {
+        logger.error("Write-ahead log unavailable; crawl state will not survive a crash");
+        return false;
+    }
+    open_ = true;
+
+    CrawlCheckpoint saved;
+    bool restored = storage_.load_checkpoint(saved);
+    if (restored && indexer_.next_doc_id() < saved.index_next_doc_id) {
+        logger.warn("Index segments are older than the last checkpoint; documents up to doc_id " +
+                    std::to_string(saved.index_next_doc_id) + " may be missing");
+    }
+
+    // Replay: documents are indexed again as they come, in doc_id order;
+    // the frontier is settled once every event is in
+    std::vector<CrawlTask> scheduled;
+    std::unordered_set<std::string> scheduled_urls;
+    std::unordered_set<std::string> finished;
+    size_t events = 0;
+    size_t reindexed = 0;
+    size_t mismatched = 0;
+    ParsedDocument doc;
+    bool replayed = wal_.replay(restored ? saved.wal_lsn : 0,
+                                [&](uint8_t type, uint64_t, std::string_view payload) {
+        PayloadReader reader(payload);
+        uint64_t number = 0;
+        uint64_t doc_id = 0;
+        std::string_view url;
+        events++;
+        switch (static_cast<CrawlEvent>(type)) {
+        case CrawlEvent::URL_SCHEDULED: {
+            if (!reader.get(number) || !reader.get(url)) break;
+            CrawlTask task;
+            task.url = UrlUtils::canonicalize(std::string(url));
+            task.priority = static_cast<int>(varint::zigzag_decode(number));
+            if (scheduled_urls.insert(task.url).second) {
+                scheduled.push_back(std::move(task));
+            }
+            break;
+        }
+        case CrawlEvent::URL_FETCHED: {
+            uint64_t done = 0;
+            if (reader.get(url) && reader.get(number) && reader.get(done) && done) {
+                finished.emplace(url);
+            }
+            break;
+        }
+        case CrawlEvent::DOC_INDEXED: {
+            std::string_view title, text, key, value;
+            uint64_t fields = 0;
+            if (!reader.get(doc_id) || !reader.get(url) || !reader.get(title) || !reader.get(text) ||
+                !reader.get(fields)) {
+                break;
+            }
+            doc.clear();
+            for (uint64_t i = 0; i < fields && reader.get(key) && reader.get(value); i++) {
+                doc.metadata.emplace(key, value);
+            }
+            if (!reader.p) break;
+            finished.emplace(url);
+
+            // Documents below the index's next doc_id reached a segment file
+            if (doc_id < indexer_.next_doc_id()) break;
+            doc.url = url;
+            doc.title = title;
+            doc.text_content = text;
+            Parser::tokenize_document(doc);
+            if (indexer_.index_document(doc, doc.metadata) != doc_id) {
+                mismatched++;
+            }
+            reindexed++;
+            break;
+        }
+        case CrawlEvent::DOC_STORED:
+            if (reader.get(doc_id) && reader.get(url)) {
+                finished.emplace(url);
+            }
+            break;
+        }
+    });
+    if (!replayed) {
+        logger.error("Write-ahead log replay stopped early; later crawl events are lost");
+    }
+    if (mismatched > 0) {
+        logger.warn(std::to_string(mismatched) + " replayed documents got different doc ids");
+    }
+
+    // The dedup snapshot may predate URLs discovered since, so mark them
+    // again (newly or not, they are queued below)
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < scheduled.size(); i += kDedupBatch) {
+        urls.clear();
+        for (size_t j = i; j < std::min(scheduled.size(), i + kDedupBatch); j++) {
+            urls.push_back(scheduled[j].url);
+        }
+        dedup_.filter_unseen(urls);
+    }
+
+    size_t queued = 0;
+    for (const auto& task : saved.frontier) {
+        if (finished.count(task.url) || scheduled_urls.count(task.url)) continue;
+        queued += scheduler_.add_url(task.url, task.priority);
+    }
+    for (const auto& task : scheduled) {
+        if (finished.count(task.url)) continue;
+        queued += scheduler_.add_url(task.url, task.priority);
+    }
+
+    indexer_.set_index_callback([this](uint64_t doc_id, const ParsedDocument& indexed,
+                                       const std::unordered_map<std::string, std::string>& metadata) {
+        doc_indexed(doc_id, indexed, metadata);
+    });
+
+    if (!restored && events == 0) {
+        return false;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    logger.info("Recovered crawl state: " + std::to_string(events) + " logged events, " +
+                std::to_string(reindexed) + " documents re-indexed, " + std::to_string(queued) +
+                " URLs queued in " + std::to_string(elapsed) + " ms");
+
+    // Start the next run from here rather than replaying the same log again
+    if (events > 0) {
+        checkpoint();
+    }
+    return true;
+}
+
+bool CrawlJournal::checkpoint() {
+    if (!open_) return false;
+    auto start = std::chrono::steady_clock::now();
+
+    // Everything the state below reflects happened before this position.
+    // Documents indexed before it are flushed with everything else, so
+    // taking the doc id first gives a bound the flush is sure to cover.
+    CrawlCheckpoint checkpoint;
+    checkpoint.wal_lsn = wal_.next_lsn();
+    checkpoint.index_next_doc_id = indexer_.next_doc_id();
+    indexer_.flush_segment();
+    if (!storage_.flush()) {
+        Logger::instance().warn("Failed to flush the document store");
+    }
+    if (!dedup_.save_snapshot()) {
+        Logger::instance().warn("Failed to save dedup filter snapshot");
+        return false;
+    }
+    scheduler_.export_tasks(checkpoint.frontier);
+    if (!storage_.save_checkpoint(checkpoint)) {
+        Logger::instance().warn("Failed to write crawl checkpoint");
+        return false;
+    }
+    wal_.truncate(checkpoint.wal_lsn);
+
+    auto& metrics = Metrics::instance();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    metrics.record_histogram("checkpoint_latency_ms", elapsed);
+    metrics.set_gauge("checkpoint_frontier_tasks", checkpoint.frontier.size());
+    metrics.set_gauge("wal_bytes_written", wal_.bytes_written());
+    return true;
+}
+
+void CrawlJournal::append(CrawlEvent event, const std::string& payload) {
+    if (open_) {
+        wal_.append(static_cast<uint8_t>(event), payload);
+    }
+}
+
+void CrawlJournal::url_scheduled(const std::string& url, int priority) {
+    std::string payload;
+    varint::put(payload, varint::zigzag_encode(priority));
+    put_string(payload, url);
+    append(CrawlEvent::URL_SCHEDULED, payload);
+}
+
+void CrawlJournal::url_fetched(const std::string& url, int http_status, bool finished) {
+    std::string payload;
+    put_string(payload, url);
+    varint::put(payload, static_cast<uint64_t>(std::max(http_status, 0)));
+    varint::put(payload, finished ? 1 : 0);
+    append(CrawlEvent::URL_FETCHED, payload);
+}
+
+void CrawlJournal::doc_indexed(uint64_t doc_id, const ParsedDocument& doc,
+                               const std::unordered_map<std::string, std::string>& metadata) {
+    std::string payload;
+    payload.reserve(doc.url.size() + doc.title.size() + doc.text_content.size() + 32);
+    varint::put(payload, doc_id);
+    put_string(payload, doc.url);
+    put_string(payload, doc.title);
+    put_string(payload, doc.text_content);
+    varint::put(payload, metadata.size());
+    for (const auto& [key, value] : metadata) {
+        put_string(payload, key);
+        put_string(payload, value);
+    }
+    append(CrawlEvent::DOC_INDEXED, payload);
+}
+
+void CrawlJournal::doc_stored(const std::string& url, uint64_t doc_id) {
+    std::string payload;
+    varint::put(payload, doc_id);
+    put_string(payload, url);
+    append(CrawlEvent::DOC_STORED, payload);
+}
+
+} // namespace crawler
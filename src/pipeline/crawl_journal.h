@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include "../scheduler/scheduler.h"
+#include "../dedup/dedup.h"
+#include "../indexer/indexer.h"
+#include "../storage/storage.h"
+#include "../storage/wal.h"
+
+namespace crawler {
+
+// Crawl events in the write-ahead log
+enum class CrawlEvent : uint8_t {
+    URL_SCHEDULED = 1, // priority, url
+    URL_FETCHED = 2,   // url, HTTP status, whether the URL is finished with
+    DOC_INDEXED = 3,   // doc_id, url, title, text, metadata
+    DOC_STORED = 4,    // doc_id (0 for pages finished without a document), url
+};
+
+// Crash recovery for the crawl state.
+//
+// Pipeline stages log their events to a group-committed WriteAheadLog
+// under storage.data_dir/wal; indexed documents are logged whole by the
+// Indexer's callback, in doc_id order. Every checkpoint_interval_seconds
+// checkpoint() flushes the index to segment files, saves the dedup filter,
+// then writes the frontier (queued and in-flight tasks) with the log
+// position it covers, and drops the log segments before it.
+//
+// recover() loads the last checkpoint and replays the log after it:
+// documents past the index's segment files are indexed again from their
+// log records, URLs scheduled since are marked seen and queued, and URLs
+// finished since are left out. Nothing is refetched, so this takes as long
+// as re-indexing one checkpoint interval's worth of pages.
+class CrawlJournal {
+public:
+    CrawlJournal(Scheduler& scheduler, Deduplicator& dedup, Indexer& indexer, Storage& storage,
+                 const std::string& wal_dir);
+    ~CrawlJournal();
+
+    // Open the log, restore state and start logging. Returns false when
+    // there was nothing to restore, i.e. this is a fresh crawl.
+    bool recover();
+
+    // Write a checkpoint; false (with the previous one kept) on failure
+    bool checkpoint();
+
+    // Events, durable within storage.wal_group_commit_ms
+    void url_scheduled(const std::string& url, int priority);
+    void url_fetched(const std::string& url, int http_status, bool finished);
+    void doc_stored(const std::string& url, uint64_t doc_id);
+
+    // Statistics
+    uint64_t wal_bytes() const { return wal_.bytes_written(); }
+    uint64_t wal_commits() const { return wal_.commits(); }
+
+private:
+    void doc_indexed(uint64_t doc_id, const ParsedDocument& doc,
+                     const std::unordered_map<std::string, std::string>& metadata);
+    void append(CrawlEvent event, const std::string& payload);
+
+    Scheduler& scheduler_;
+    Deduplicator& dedup_;
+    Indexer& indexer_;
+    Storage& storage_;
+    WriteAheadLog wal_;
+    bool open_ = false;
+};
+
+} // namespace crawler
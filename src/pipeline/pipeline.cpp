@@ -0,0 +1,459 @@
+#include "pipeline.h"
+#include "../parser/link_extractor.h"
+#include "../api/json_writer.h"
+#include "../utils/config.h"
+#include "../observability/logger.h"
+#include "../observability/metrics.h"
+#include <memory>
+#include <algorithm>
+
+namespace crawler {
+
+namespace {
+
+// Streamed outlinks are deduped and queued in batches of this many
+constexpr size_t kDiscoveryBatch = 64;
+
+// Per-fetch state for fetcher.streaming; chunks and completion arrive on
+// the same thread, one after the other
+struct LinkStream {
+    std::unique_ptr<StreamingLinkExtractor> extractor;
+    std::vector<std::string> batch;
+    bool complete = true; // false once a batch was dropped
+};
+
+// Per-page metrics, looked up once rather than by name for every page
+struct PipelineMetrics {
+    Counter& crawl_attempts;
+    Counter& crawl_success;
+    Counter& fetch_rejected;
+    Counter& content_duplicates;
+    Counter& near_duplicates;
+    Counter& robots_noindex;
+    Counter& crawl_duplicates;
+    Counter& streamed_links;
+    Counter& parse_requeued;
+    Counter& store_failures;
+    Gauge& scheduler_queue_size;
+    Gauge& indexer_total_docs;
+    Gauge& parse_queue;
+    Gauge& index_queue;
+    Gauge& storage_queue;
+    Gauge& discovery_queue;
+};
+
+PipelineMetrics& pipeline_metrics() {
+    auto& m = Metrics::instance();
+    static PipelineMetrics metrics{
+        m.counter("crawl_attempts"),         m.counter("crawl_success"),
+        m.counter("fetch_rejected"),         m.counter("content_duplicates"),
+        m.counter("near_duplicates"),        m.counter("robots_noindex"),
+        m.counter("crawl_duplicates"),       m.counter("streamed_links"),
+        m.counter("pipeline_requeued_parse"), m.counter("crawl_store_failures"),
+        m.gauge("scheduler_queue_size"),     m.gauge("indexer_total_docs"),
+        m.gauge("pipeline_parse_queue"),     m.gauge("pipeline_index_queue"),
+        m.gauge("pipeline_storage_queue"),   m.gauge("pipeline_discovery_queue"),
+    };
+    return metrics;
+}
+
+// The fetch's wall time is libcurl's phases plus whatever it spent waiting
+// for a transfer slot or between redirect hops
+void trace_fetch(TaskTrace& trace, const FetchTimings& timings) {
+    double fetch_ms = trace.lap();
+    trace.add(TraceStage::FETCH_WAIT, std::max(0.0, fetch_ms - timings.total_ms()));
+    trace.add(TraceStage::DNS, timings.dns_ms);
+    trace.add(TraceStage::CONNECT, timings.connect_ms);
+    trace.add(TraceStage::TLS, timings.tls_ms);
+    trace.add(TraceStage::TTFB, timings.ttfb_ms);
+    trace.add(TraceStage::DOWNLOAD, timings.download_ms);
+}
+
+} // namespace
+
+CrawlPipeline::CrawlPipeline(Scheduler& scheduler, Fetcher& fetcher, Parser& parser,
+                             Deduplicator& dedup, Indexer& indexer, Storage& storage)
+    : scheduler_(scheduler), fetcher_(fetcher), parser_(parser),
+      dedup_(dedup), indexer_(indexer), storage_(storage),
+      parse_queue_(Config::instance().scheduler_queue_size(),
+                   parse_backpressure_strategy(Config::instance().scheduler_backpressure_strategy())),
+      index_queue_(Config::instance().scheduler_queue_size(),
+                   parse_backpressure_strategy(Config::instance().scheduler_backpressure_strategy())),
+      storage_queue_(Config::instance().scheduler_queue_size(),
+                     parse_backpressure_strategy(Config::instance().scheduler_backpressure_strategy())),
+      // Fed from fetcher threads, including the async loop: never blocks
+      discovery_queue_(Config::instance().scheduler_queue_size(), BackpressureStrategy::DROP) {
+    auto& config = Config::instance();
+    streaming_ = config.fetcher_streaming();
+    parse_worker_count_ = config.pipeline_parse_workers();
+    index_worker_count_ = config.pipeline_index_workers();
+    storage_worker_count_ = config.pipeline_storage_workers();
+    Tracer::instance().configure(config.tracing_slow_task_ms(),
+                                 static_cast<size_t>(std::max(config.tracing_slow_task_samples(), 0)));
+}
+
+CrawlPipeline::~CrawlPipeline() {
+    stop();
+}
+
+void CrawlPipeline::start() {
+    if (running_.exchange(true)) return;
+
+    for (int i = 0; i < parse_worker_count_; i++) {
+        parse_workers_.emplace_back(&CrawlPipeline::parse_worker, this);
+    }
+    for (int i = 0; i < index_worker_count_; i++) {
+        index_workers_.emplace_back(&CrawlPipeline::index_worker, this);
+    }
+    for (int i = 0; i < storage_worker_count_; i++) {
+        storage_workers_.emplace_back(&CrawlPipeline::storage_worker, this);
+    }
+    if (streaming_) {
+        discovery_thread_ = std::thread(&CrawlPipeline::discovery_worker, this);
+    }
+
+    if (async_fetcher_ && !async_fetcher_->start()) {
+        Logger::instance().warn("Async fetcher failed to start, using blocking fetches");
+        async_fetcher_ = nullptr;
+    }
+
+    // Fetch stage runs on the scheduler's own worker threads
+    scheduler_.set_task_handler([this](const CrawlTask& task) { fetch_stage(task); });
+    scheduler_.start();
+}
+
+void CrawlPipeline::stop() {
+    if (!running_.exchange(false)) return;
+
+    // Stop upstream first so each stage drains what is already queued
+    scheduler_.stop();
+    if (async_fetcher_) {
+        async_fetcher_->stop();
+    }
+
+    discovery_queue_.close();
+    if (discovery_thread_.joinable()) {
+        discovery_thread_.join();
+    }
+
+    parse_queue_.close();
+    for (auto& worker : parse_workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    parse_workers_.clear();
+
+    index_queue_.close();
+    for (auto& worker : index_workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    index_workers_.clear();
+
+    storage_queue_.close();
+    for (auto& worker : storage_workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    storage_workers_.clear();
+}
+
+bool CrawlPipeline::idle() const {
+    // Pages stay "active" in the scheduler until the last stage finishes them;
+    // streamed outlinks may still be on their way to the frontier
+    return scheduler_.idle() && discovery_pending_ == 0;
+}
+
+void CrawlPipeline::fetch_stage(const CrawlTask& task) {
+    pipeline_metrics().crawl_attempts.increment();
+    TaskTrace trace;
+    trace.begin();
+
+    // Scan outlinks out of the body as it arrives
+    std::shared_ptr<LinkStream> stream;
+    BodyChunkCallback on_chunk;
+    if (streaming_) {
+        stream = std::make_shared<LinkStream>();
+        on_chunk = [this, stream](const std::string& url, std::string_view chunk) {
+            if (!stream->extractor) {
+                // Only the final 2xx hop streams, so its URL is the base
+                stream->extractor = std::make_unique<StreamingLinkExtractor>(url);
+            }
+            stream->extractor->feed(chunk, stream->batch);
+            if (stream->batch.size() >= kDiscoveryBatch && !queue_discovered(stream->batch)) {
+                stream->complete = false;
+            }
+        };
+    }
+    auto finish_stream = [this, stream]() {
+        if (!stream || !stream->extractor) return false;
+        if (!queue_discovered(stream->batch)) {
+            stream->complete = false;
+        }
+        return stream->complete;
+    };
+
+    // URLs are deduplicated when discovered (see discover_links), so every
+    // task reaching here is new or a retry
+    if (async_fetcher_) {
+        // Worker only dispatches; completion arrives on the fetcher's loop thread.
+        // submit() blocks while max_in_flight requests are outstanding.
+        bool queued = async_fetcher_->submit(task.url, [this, task, finish_stream, trace](FetchResult result) {
+            bool streamed = finish_stream();
+            on_fetched(task, std::move(result), streamed, trace);
+        }, std::move(on_chunk));
+        if (!queued) {
+            scheduler_.mark_failed(task);
+        }
+        return;
+    }
+
+    FetchResult result = fetcher_.fetch(task.url, on_chunk);
+    bool streamed = finish_stream();
+    on_fetched(task, std::move(result), streamed, trace);
+}
+
+void CrawlPipeline::on_fetched(const CrawlTask& task, FetchResult result, bool links_streamed, TaskTrace trace) {
+    trace_fetch(trace, result.timings);
+    if (journal_) {
+        // A rejected response finishes the URL; anything else is retried or
+        // carries on down the pipeline
+        journal_->url_fetched(task.url, result.http_status, !result.success && !result.retryable);
+    }
+    if (!result.success) {
+        Logger::instance().warn("Failed to fetch: " + task.url + " (" + result.error_message + ")");
+        Tracer::instance().record(task.url, trace);
+        if (result.retryable) {
+            scheduler_.mark_failed(task);
+        } else {
+            pipeline_metrics().fetch_rejected.increment();
+            scheduler_.mark_failed(task.url, false);
+        }
+        return;
+    }
+
+    FetchedPage page;
+    page.task = task;
+    page.result = std::move(result);
+    page.links_streamed = links_streamed;
+    page.trace = trace;
+    if (async_fetcher_) {
+        // Runs on the fetch engine's loop thread, which must never wait on a
+        // stage: every transfer in flight would stall behind it. With "block"
+        // a full parse queue sends the task back to the frontier instead.
+        if (parse_queue_.try_push(page)) return;
+        if (parse_queue_.strategy() == BackpressureStrategy::BLOCK) {
+            pipeline_metrics().parse_requeued.increment();
+            scheduler_.requeue(task);
+        } else {
+            on_dropped(task, "parse");
+        }
+        return;
+    }
+    if (!parse_queue_.push(std::move(page))) {
+        on_dropped(task, "parse");
+    }
+}
+
+void CrawlPipeline::parse_worker() {
+    FetchedPage page;
+    while (parse_queue_.pop(page)) {
+        page.trace.lap(TraceStage::PARSE_QUEUE);
+        ParsedPage parsed;
+        parser_.parse_into(page.task.url, page.result.content, parsed.doc);
+        page.trace.lap(TraceStage::PARSE);
+        parsed.task = std::move(page.task);
+        parsed.result = std::move(page.result);
+        parsed.links_streamed = page.links_streamed;
+        parsed.trace = page.trace;
+
+        CrawlTask task = parsed.task;
+        if (!index_queue_.push(std::move(parsed))) {
+            on_dropped(task, "index");
+        }
+    }
+}
+
+void CrawlPipeline::index_worker() {
+    auto& metrics = pipeline_metrics();
+    auto& tracer = Tracer::instance();
+    ParsedPage page;
+    while (index_queue_.pop(page)) {
+        page.trace.lap(TraceStage::INDEX_QUEUE);
+
+        // Check and claim the content in one step, so two index workers
+        // never both index the same body
+        if (dedup_.check_and_mark_content(page.result.content_hash, page.task.url)) {
+            metrics.content_duplicates.increment();
+            if (journal_) journal_->doc_stored(page.task.url, 0);
+            scheduler_.mark_completed(page.task.url);
+            page.trace.lap(TraceStage::DEDUP);
+            tracer.record(page.task.url, page.trace);
+            continue;
+        }
+
+        // Same page modulo timestamps, ads, session ids...
+        if (dedup_.check_and_mark_near_duplicate(page.doc.tokens)) {
+            metrics.near_duplicates.increment();
+            if (journal_) journal_->doc_stored(page.task.url, 0);
+            scheduler_.mark_completed(page.task.url);
+            page.trace.lap(TraceStage::DEDUP);
+            tracer.record(page.task.url, page.trace);
+            continue;
+        }
+        page.trace.lap(TraceStage::DEDUP);
+
+        // <meta name=robots> is honoured: noindex pages are neither indexed
+        // nor stored, nofollow pages contribute no outlinks
+        uint64_t doc_id = 0;
+        if (page.doc.noindex) {
+            metrics.robots_noindex.increment();
+        } else {
+            doc_id = indexer_.index_document(page.doc, page.doc.metadata);
+        }
+        page.trace.lap(TraceStage::INDEX);
+
+        if (!page.doc.nofollow) {
+            if (page.links_streamed) {
+                // Already queued while the body downloaded
+                page.doc.links.clear();
+            }
+            if (!page.doc.canonical_url.empty() && page.doc.canonical_url != page.task.url) {
+                page.doc.links.push_back(page.doc.canonical_url);
+            }
+            discover_links(page.doc.links);
+            page.trace.lap(TraceStage::DEDUP);
+        }
+
+        StorePage store;
+        store.task = std::move(page.task);
+        store.doc_id = doc_id;
+        store.content = std::move(page.result.content);
+        store.metadata = std::move(page.doc.metadata);
+        store.trace = page.trace;
+
+        CrawlTask task = store.task;
+        if (!storage_queue_.push(std::move(store))) {
+            on_dropped(task, "storage");
+        }
+    }
+}
+
+void CrawlPipeline::storage_worker() {
+    auto& metrics = pipeline_metrics();
+    StorePage page;
+    while (storage_queue_.pop(page)) {
+        page.trace.lap(TraceStage::STORAGE_QUEUE);
+
+        if (page.doc_id == 0) {
+            // Not indexed (noindex), so nothing to store
+            if (journal_) journal_->doc_stored(page.task.url, 0);
+            metrics.crawl_success.increment();
+        } else {
+            // Logged once the page is on disk rather than when it is queued,
+            // and only if it got there: recovery takes DOC_STORED at its word.
+            // Likewise the page only counts as a success once it is written.
+            auto stored = [journal = journal_, url = page.task.url, doc_id = page.doc_id](bool ok) {
+                if (!ok) {
+                    pipeline_metrics().store_failures.increment();
+                    Logger::instance().warn("Failed to store: " + url);
+                    return;
+                }
+                if (journal) journal->doc_stored(url, doc_id);
+                pipeline_metrics().crawl_success.increment();
+            };
+            if (!storage_.save_document(page.doc_id, page.task.url, page.content, page.metadata, stored)) {
+                stored(false);
+            }
+        }
+
+        scheduler_.mark_completed(page.task.url);
+        page.trace.lap(TraceStage::STORAGE);
+        Tracer::instance().record(page.task.url, page.trace);
+
+        // Update metrics
+        metrics.scheduler_queue_size.set(scheduler_.queue_size());
+        metrics.indexer_total_docs.set(indexer_.total_documents());
+        metrics.parse_queue.set(parse_queue_.size());
+        metrics.index_queue.set(index_queue_.size());
+        metrics.storage_queue.set(storage_queue_.size());
+        metrics.discovery_queue.set(discovery_queue_.size());
+    }
+}
+
+void CrawlPipeline::discovery_worker() {
+    auto& metrics = pipeline_metrics();
+    std::vector<std::string> links;
+    while (discovery_queue_.pop(links)) {
+        metrics.streamed_links.increment(static_cast<int64_t>(links.size()));
+        discover_links(links);
+        discovery_pending_--;
+    }
+}
+
+void CrawlPipeline::discover_links(const std::vector<std::string>& links) {
+    if (links.empty()) return;
+
+    // One round trip checks and marks them all
+    auto unseen = dedup_.filter_unseen(links);
+    pipeline_metrics().crawl_duplicates.increment(static_cast<int64_t>(links.size() - unseen.size()));
+    for (const auto& link : unseen) {
+        // Logged first: a URL marked seen but neither logged nor queued
+        // would never be crawled after a crash
+        if (journal_) journal_->url_scheduled(link, 0);
+        scheduler_.add_url(link, 0);
+    }
+}
+
+bool CrawlPipeline::queue_discovered(std::vector<std::string>& batch) {
+    if (batch.empty()) return true;
+
+    discovery_pending_++;
+    bool queued = discovery_queue_.push(std::move(batch));
+    if (!queued) {
+        discovery_pending_--;
+        Metrics::instance().increment_counter("pipeline_dropped_discovery");
+    }
+    batch.clear();
+    return queued;
+}
+
+void CrawlPipeline::write_debug(std::string& body) const {
+    JsonWriter json(body);
+    json.begin_object();
+    json.key("queues");
+    json.begin_object();
+    json.key("frontier");
+    json.value(static_cast<uint64_t>(scheduler_.queue_size()));
+    json.key("parse");
+    json.value(static_cast<uint64_t>(parse_queue_.size()));
+    json.key("index");
+    json.value(static_cast<uint64_t>(index_queue_.size()));
+    json.key("storage");
+    json.value(static_cast<uint64_t>(storage_queue_.size()));
+    json.key("discovery");
+    json.value(static_cast<uint64_t>(discovery_queue_.size()));
+    json.end_object();
+
+    json.key("workers");
+    json.begin_object();
+    json.key("fetch");
+    json.value(Config::instance().scheduler_worker_threads());
+    json.key("parse");
+    json.value(parse_worker_count_);
+    json.key("index");
+    json.value(index_worker_count_);
+    json.key("storage");
+    json.value(storage_worker_count_);
+    json.end_object();
+
+    json.key("dropped_pages");
+    json.value(static_cast<uint64_t>(dropped_pages_.load()));
+    Tracer::instance().write_json(json);
+    json.end_object();
+}
+
+void CrawlPipeline::on_dropped(const CrawlTask& task, const std::string& stage) {
+    dropped_pages_++;
+    Metrics::instance().increment_counter("pipeline_dropped_" + stage);
+    scheduler_.mark_failed(task.url, false);
+}
+
+} // namespace crawler
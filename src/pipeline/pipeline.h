@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include "../scheduler/scheduler.h"
+#include "../fetcher/fetcher.h"
+#include "../fetcher/async_fetcher.h"
+#include "../parser/parser.h"
+#include "../dedup/dedup.h"
+#include "../indexer/indexer.h"
+#include "../storage/storage.h"
+#include "../utils/bounded_queue.h"
+#include "../observability/trace.h"
+#include "crawl_journal.h"
+
+namespace crawler {
+
+// Work items handed between stages
+struct FetchedPage {
+    CrawlTask task;
+    FetchResult result;
+    bool links_streamed = false; // outlinks already queued during download
+    TaskTrace trace;
+};
+
+struct ParsedPage {
+    CrawlTask task;
+    FetchResult result;
+    ParsedDocument doc;
+    bool links_streamed = false;
+    TaskTrace trace;
+};
+
+struct StorePage {
+    CrawlTask task;
+    uint64_t doc_id = 0;
+    std::string content;
+    std::unordered_map<std::string, std::string> metadata;
+    TaskTrace trace;
+};
+
+// Multi-stage crawl pipeline:
+//   fetch (scheduler workers) -> parse -> dedup/index -> storage
+// Each stage has its own worker pool and a bounded queue in front of it.
+// When a queue is full the producing stage blocks or drops the page,
+// depending on scheduler.backpressure_strategy. Completions from an async
+// fetch engine never block its loop thread: under "block" a page that finds
+// the parse queue full goes back to the frontier to be fetched again.
+// With fetcher.streaming, outlinks are scanned out of the body while it
+// downloads and handed to a discovery worker, ahead of the full parse.
+// Every page carries a TaskTrace of its time per stage, handed to the
+// Tracer when the page leaves the pipeline.
+class CrawlPipeline {
+public:
+    CrawlPipeline(Scheduler& scheduler, Fetcher& fetcher, Parser& parser,
+                  Deduplicator& dedup, Indexer& indexer, Storage& storage);
+    ~CrawlPipeline();
+
+    // Fetch through the curl_multi engine (or a replay corpus) instead of
+    // blocking Fetcher calls. Must be called before start(); the pipeline
+    // starts and stops it.
+    void set_async_fetcher(FetchEngine* fetcher) { async_fetcher_ = fetcher; }
+
+    // Log crawl events for crash recovery; set before start()
+    void set_journal(CrawlJournal* journal) { journal_ = journal; }
+
+    // Start stage workers and the scheduler's fetch workers
+    void start();
+
+    // Stop fetching, drain the queues and join all workers
+    void stop();
+
+    // True when the frontier is empty and no page is in any stage
+    bool idle() const;
+
+    // Statistics
+    size_t parse_queue_size() const { return parse_queue_.size(); }
+    size_t index_queue_size() const { return index_queue_.size(); }
+    size_t storage_queue_size() const { return storage_queue_.size(); }
+    size_t dropped_pages() const { return dropped_pages_; }
+    size_t discovery_queue_size() const { return discovery_queue_.size(); }
+
+    // Queue depths, worker counts and the Tracer's stage latencies and
+    // slow tasks, as JSON for /debug/pipeline
+    void write_debug(std::string& body) const;
+
+private:
+    void fetch_stage(const CrawlTask& task);
+    void on_fetched(const CrawlTask& task, FetchResult result, bool links_streamed, TaskTrace trace);
+    void parse_worker();
+    void index_worker();
+    void storage_worker();
+    void discovery_worker();
+
+    // Dedup a batch of outlinks and add the new ones to the frontier
+    void discover_links(const std::vector<std::string>& links);
+    // Hand a streamed batch to the discovery worker without blocking;
+    // false if it had to be dropped
+    bool queue_discovered(std::vector<std::string>& batch);
+
+    void on_dropped(const CrawlTask& task, const std::string& stage);
+
+    Scheduler& scheduler_;
+    Fetcher& fetcher_;
+    FetchEngine* async_fetcher_ = nullptr;
+    CrawlJournal* journal_ = nullptr;
+    Parser& parser_;
+    Deduplicator& dedup_;
+    Indexer& indexer_;
+    Storage& storage_;
+
+    BoundedQueue<FetchedPage> parse_queue_;
+    BoundedQueue<ParsedPage> index_queue_;
+    BoundedQueue<StorePage> storage_queue_;
+    BoundedQueue<std::vector<std::string>> discovery_queue_;
+
+    std::vector<std::thread> parse_workers_;
+    std::vector<std::thread> index_workers_;
+    std::vector<std::thread> storage_workers_;
+    std::thread discovery_thread_;
+
+    int parse_worker_count_ = 4;
+    int index_worker_count_ = 2;
+    int storage_worker_count_ = 2;
+    bool streaming_ = false;
+
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> dropped_pages_{0};
+    std::atomic<size_t> discovery_pending_{0}; // batches queued or in progress
+};
+
+} // namespace crawler
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+namespace crawler {
+
+struct CrawlTask {
+    std::string url;
+    int priority = 0;
+    int retry_count = 0;
+    std::chrono::steady_clock::time_point next_retry_time;
+    
+    bool operator<(const CrawlTask& other) const {
+        return priority < other.priority;
+    }
+};
+
+// How HostFrontier keeps a queued CrawlTask: the URL lives in the
+// frontier's StringArena and the host is an index into its host table, so
+// an entry is 32 trivially copyable bytes
+struct CompactTask {
+    std::chrono::steady_clock::time_point due; // next_retry_time
+    uint64_t url_ref = 0;                      // StringArena::Ref
+    uint32_t host = 0;                         // HostFrontier host index
+    int16_t priority = 0;
+    uint16_t retry_count = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<CompactTask> && sizeof(CompactTask) <= 32);
+
+} // namespace crawler
@@ -0,0 +1,374 @@
+#include "frontier.h"
+#include "../utils/url_utils.h"
+#include <algorithm>
+#include <limits>
+
+namespace crawler {
+
+HostFrontier::HostFrontier(std::function<double(const std::string&)> rate_for_host)
+    : rate_for_host_(std::move(rate_for_host)) {}
+
+namespace {
+
+// Hosts examined per push when reclaiming memory, so one push never walks
+// the whole frontier
+constexpr size_t kSweepHostsPerPush = 64;
+
+// A live host's memory beyond sizeof(HostQueue) and its name: libstdc++
+// gives each empty deque a 512-byte block plus its map, and host_index_
+// holds a node for it
+constexpr size_t kHostExtraBytes = 2 * (512 + 64) + 48;
+
+} // namespace
+
+void HostFrontier::enable_spill(FrontierSpillStore* store, size_t memory_budget_bytes,
+                                size_t head_per_host) {
+    spill_store_ = store;
+    memory_budget_bytes_ = memory_budget_bytes;
+    head_per_host_ = std::max<size_t>(head_per_host, 1);
+}
+
+size_t HostFrontier::task_bytes(const CompactTask& task) const {
+    return sizeof(CompactTask) + sizeof(uint32_t) + urls_.get(task.url_ref).size();
+}
+
+size_t HostFrontier::host_bytes(const HostQueue& queue) const {
+    return sizeof(HostQueue) + kHostExtraBytes + queue.host.size();
+}
+
+CompactTask HostFrontier::compact(const CrawlTask& task, uint32_t host) {
+    CompactTask entry;
+    entry.due = task.next_retry_time;
+    entry.url_ref = urls_.add(task.url);
+    entry.host = host;
+    entry.priority = static_cast<int16_t>(std::clamp<int>(task.priority, std::numeric_limits<int16_t>::min(),
+                                                          std::numeric_limits<int16_t>::max()));
+    entry.retry_count = static_cast<uint16_t>(std::clamp<int>(task.retry_count, 0,
+                                                              std::numeric_limits<uint16_t>::max()));
+    return entry;
+}
+
+void HostFrontier::expand(const CompactTask& entry, CrawlTask& task) const {
+    task.url.assign(urls_.get(entry.url_ref));
+    task.priority = entry.priority;
+    task.retry_count = entry.retry_count;
+    task.next_retry_time = entry.due;
+}
+
+HostFrontier::HostQueue& HostFrontier::host_queue(uint64_t host_id, std::string_view host) {
+    auto it = host_index_.find(host_id);
+    if (it != host_index_.end()) {
+        return hosts_[it->second];
+    }
+
+    uint32_t index;
+    if (!free_hosts_.empty()) {
+        index = free_hosts_.back();
+        free_hosts_.pop_back();
+    } else {
+        index = static_cast<uint32_t>(hosts_.size());
+        hosts_.emplace_back();
+    }
+
+    HostQueue& queue = hosts_[index];
+    queue.host = host;
+    queue.host_id = host_id;
+    double rate = rate_for_host_ ? rate_for_host_(queue.host) : 0.0;
+    // Burst of one second's worth of requests, then steady refill
+    queue.bucket = TokenBucket(rate, rate);
+    host_index_.emplace(host_id, index);
+    resident_bytes_ += host_bytes(queue);
+    note_idle(index); // Empty until its first task arrives
+    return queue;
+}
+
+void HostFrontier::note_idle(uint32_t index) {
+    HostQueue& queue = hosts_[index];
+    if (!queue.idle_listed) {
+        queue.idle_listed = true;
+        idle_hosts_.push_back(index);
+    }
+}
+
+void HostFrontier::recycle_idle(Clock::time_point now) {
+    for (size_t checked = 0; checked < kSweepHostsPerPush && !idle_hosts_.empty(); checked++) {
+        uint32_t index = idle_hosts_.front();
+        idle_hosts_.pop_front();
+        HostQueue& queue = hosts_[index];
+
+        if (!queue.tasks.empty() || !queue.spilled.empty() || !queue.tail.empty()) {
+            // In use again; listed anew when it next drains
+            queue.idle_listed = false;
+            continue;
+        }
+        if (queue.backoff_until > now || !queue.bucket.full(now)) {
+            // Forgetting it now would let it fetch early
+            idle_hosts_.push_back(index);
+            continue;
+        }
+
+        // The failure count goes with it: nothing of this host is queued,
+        // and its backoff has run out
+        resident_bytes_ -= host_bytes(queue);
+        host_index_.erase(queue.host_id);
+        uint64_t version = queue.version + 1; // Any heap entry left is stale
+        queue = HostQueue{};
+        queue.version = version;
+        free_hosts_.push_back(index);
+    }
+}
+
+HostFrontier::Clock::time_point HostFrontier::ready_time(const HostQueue& queue,
+                                                         Clock::time_point now) const {
+    Clock::time_point ready = queue.bucket.next_available(1.0, now);
+    ready = std::max(ready, queue.backoff_until);
+    if (!queue.tasks.empty()) {
+        ready = std::max(ready, queue.tasks.front().due);
+    }
+    return ready;
+}
+
+void HostFrontier::schedule(uint32_t index, Clock::time_point now) {
+    HostQueue& queue = hosts_[index];
+    queue.version++;
+    queue.scheduled = true;
+    ready_heap_.push({ready_time(queue, now), index, queue.version});
+}
+
+void HostFrontier::push(const CrawlTask& task) {
+    thread_local std::string buffer;
+    ParsedUrl url;
+    if (!UrlUtils::parse(task.url, buffer, url)) {
+        url.host_id = UrlUtils::hash_host({});
+    }
+    if (!idle_hosts_.empty()) {
+        recycle_idle(Clock::now());
+    }
+    // Queued per host:port, but rate_limit.per_domain names hosts
+    HostQueue& queue = host_queue(url.host_id, url.host);
+    uint32_t index = host_index_[url.host_id];
+    CompactTask entry = compact(task, index);
+    total_tasks_++;
+    resident_bytes_ += task_bytes(entry);
+
+    bool to_tail = !queue.spilled.empty() || !queue.tail.empty() ||
+                   (over_budget() && queue.tasks.size() >= head_per_host_);
+    if (spill_store_ && to_tail) {
+        queue.tail.push_back(entry);
+        if (queue.tail.size() >= head_per_host_) {
+            spill_tail(queue);
+        }
+    } else {
+        queue.tasks.push_back(entry);
+    }
+
+    if (!queue.scheduled) {
+        schedule(index, Clock::now());
+    }
+    if (over_budget()) {
+        enforce_budget();
+    }
+}
+
+bool HostFrontier::write_spill_block(const CompactTask* begin, const CompactTask* end, SpillRef& ref) {
+    block_.clear();
+    block_.resize(static_cast<size_t>(end - begin));
+    for (size_t i = 0; i < block_.size(); i++) {
+        expand(begin[i], block_[i]);
+    }
+    if (!spill_store_->write_block(block_, ref)) {
+        return false;
+    }
+    for (const CompactTask* task = begin; task != end; task++) {
+        resident_bytes_ -= task_bytes(*task);
+        release(*task);
+    }
+    spilled_tasks_ += static_cast<size_t>(end - begin);
+    return true;
+}
+
+void HostFrontier::spill_tail(HostQueue& queue) {
+    if (queue.spilled.empty() && !over_budget()) {
+        // Memory is available again; nothing on disk to keep order behind
+        queue.tasks.insert(queue.tasks.end(), queue.tail.begin(), queue.tail.end());
+        queue.tail.clear();
+        return;
+    }
+
+    SpillRef ref;
+    if (!write_spill_block(queue.tail.data(), queue.tail.data() + queue.tail.size(), ref)) {
+        return; // Disk trouble: keep the tail in memory
+    }
+    queue.spilled.push_back(ref);
+    queue.tail.clear();
+}
+
+void HostFrontier::spill_excess(HostQueue& queue) {
+    // Everything past the head goes to disk in head-sized blocks. They sit in
+    // front of the blocks already spilled, so write from the back
+    std::vector<CompactTask> block;
+    while (queue.tasks.size() > head_per_host_) {
+        size_t count = std::min(head_per_host_, queue.tasks.size() - head_per_host_);
+        block.assign(queue.tasks.end() - count, queue.tasks.end());
+
+        SpillRef ref;
+        if (!write_spill_block(block.data(), block.data() + block.size(), ref)) {
+            break;
+        }
+        queue.tasks.erase(queue.tasks.end() - count, queue.tasks.end());
+        queue.spilled.push_front(ref);
+    }
+}
+
+void HostFrontier::enforce_budget() {
+    if (hosts_.empty()) return;
+
+    for (size_t visited = 0; visited < kSweepHostsPerPush && visited < hosts_.size() &&
+                             over_budget(); visited++) {
+        sweep_cursor_ = (sweep_cursor_ + 1) % hosts_.size();
+        HostQueue& queue = hosts_[sweep_cursor_];
+        if (queue.tasks.size() > head_per_host_) {
+            spill_excess(queue);
+        }
+    }
+}
+
+void HostFrontier::refill(HostQueue& queue) {
+    uint32_t index = static_cast<uint32_t>(&queue - hosts_.data());
+    while (queue.tasks.size() < head_per_host_ && !queue.spilled.empty()) {
+        SpillRef ref = queue.spilled.front();
+        queue.spilled.pop_front();
+
+        block_.clear();
+        bool ok = spill_store_->read_block(ref, block_);
+        spilled_tasks_ -= ref.count;
+        if (!ok) {
+            // Whatever could not be decoded is lost
+            total_tasks_ -= ref.count - std::min<size_t>(ref.count, block_.size());
+        }
+        for (const auto& task : block_) {
+            CompactTask entry = compact(task, index);
+            resident_bytes_ += task_bytes(entry);
+            queue.tasks.push_back(entry);
+        }
+    }
+
+    if (queue.tasks.size() < head_per_host_ && queue.spilled.empty()) {
+        queue.tasks.insert(queue.tasks.end(), queue.tail.begin(), queue.tail.end());
+        queue.tail.clear();
+    }
+}
+
+void HostFrontier::export_tasks(std::vector<CrawlTask>& out) {
+    auto append = [this, &out](const auto& entries) {
+        for (const auto& entry : entries) {
+            expand(entry, out.emplace_back());
+        }
+    };
+    for (const auto& queue : hosts_) {
+        append(queue.tasks);
+        for (const auto& ref : queue.spilled) {
+            spill_store_->read_block(ref, out, false);
+        }
+        append(queue.tail);
+    }
+}
+
+bool HostFrontier::pop_ready(CrawlTask& task, Clock::time_point now,
+                             Clock::time_point& next_ready) {
+    while (!ready_heap_.empty()) {
+        HeapEntry top = ready_heap_.top();
+        HostQueue& queue = hosts_[top.host_index];
+
+        // Superseded by a later schedule() or drained meanwhile
+        if (top.version != queue.version || queue.tasks.empty()) {
+            ready_heap_.pop();
+            if (top.version == queue.version) {
+                queue.scheduled = false;
+            }
+            continue;
+        }
+
+        if (top.ready_at > now) {
+            // Entry may be stale-early if the host's state changed; re-key it
+            Clock::time_point actual = ready_time(queue, now);
+            if (actual > top.ready_at) {
+                ready_heap_.pop();
+                schedule(top.host_index, now);
+                continue;
+            }
+            next_ready = top.ready_at;
+            return false;
+        }
+
+        Clock::time_point actual = ready_time(queue, now);
+        if (actual > now || !queue.bucket.try_acquire(1.0, now)) {
+            ready_heap_.pop();
+            schedule(top.host_index, now);
+            continue;
+        }
+
+        ready_heap_.pop();
+        CompactTask entry = queue.tasks.front();
+        queue.tasks.pop_front();
+        total_tasks_--;
+        resident_bytes_ -= task_bytes(entry);
+        expand(entry, task);
+        release(entry);
+
+        if (queue.tasks.size() <= head_per_host_ / 2 &&
+            (!queue.spilled.empty() || !queue.tail.empty())) {
+            refill(queue);
+        }
+
+        if (queue.tasks.empty()) {
+            queue.scheduled = false;
+            note_idle(top.host_index);
+        } else {
+            schedule(top.host_index, now);
+        }
+        return true;
+    }
+
+    next_ready = now + std::chrono::seconds(1);
+    return false;
+}
+
+void HostFrontier::backoff(uint64_t host_id, Clock::time_point until) {
+    auto it = host_index_.find(host_id);
+    if (it == host_index_.end()) return; // never pushed, nothing to hold back
+    HostQueue& queue = hosts_[it->second];
+    queue.backoff_until = std::max(queue.backoff_until, until);
+    if (!queue.tasks.empty()) {
+        schedule(it->second, Clock::now());
+    }
+}
+
+void HostFrontier::backoff(const std::string& host, Clock::time_point until) {
+    uint64_t host_id = UrlUtils::hash_host(host);
+    host_queue(host_id, host);
+    backoff(host_id, until);
+}
+
+int HostFrontier::record_failure(uint64_t host_id) {
+    auto it = host_index_.find(host_id);
+    return it != host_index_.end() ? ++hosts_[it->second].consecutive_failures : 1;
+}
+
+int HostFrontier::record_failure(const std::string& host) {
+    uint64_t host_id = UrlUtils::hash_host(host);
+    return ++host_queue(host_id, host).consecutive_failures;
+}
+
+void HostFrontier::record_success(uint64_t host_id) {
+    auto it = host_index_.find(host_id);
+    if (it != host_index_.end()) {
+        hosts_[it->second].consecutive_failures = 0;
+    }
+}
+
+void HostFrontier::record_success(const std::string& host) {
+    record_success(UrlUtils::hash_host(host));
+}
+
+} // namespace crawler
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include "crawl_task.h"
+#include "frontier_spill.h"
+#include "../utils/token_bucket.h"
+#include "../utils/string_arena.h"
+
+namespace crawler {
+
+// Mercator-style politeness frontier.
+// Every host has its own FIFO of tasks and a token bucket; a min-heap keyed
+// on each host's "next allowed fetch time" hands out the host that is ready
+// soonest in O(log H). One slow or backed-off host never blocks the others.
+// Queued tasks are held as CompactTask entries with their URLs in an arena,
+// so moving them through the queues never touches the heap.
+// Hosts that drain are recycled once they hold no politeness state, so
+// the host table tracks live hosts rather than every host ever seen.
+// Not thread-safe: the Scheduler serialises access with its queue mutex.
+class HostFrontier {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // rate_for_host returns requests/sec for a host (<= 0 means unlimited)
+    explicit HostFrontier(std::function<double(const std::string&)> rate_for_host);
+
+    // Keep at most ~head_per_host tasks of each host in memory once the
+    // resident frontier exceeds memory_budget_bytes; the rest is spilled to
+    // `store` in blocks and refilled as the head drains.
+    void enable_spill(FrontierSpillStore* store, size_t memory_budget_bytes, size_t head_per_host);
+
+    void push(const CrawlTask& task);
+
+    // Pop a task whose host is allowed to fetch at `now`. Otherwise returns
+    // false and sets next_ready to when the soonest host becomes ready.
+    bool pop_ready(CrawlTask& task, Clock::time_point now, Clock::time_point& next_ready);
+
+    // Hold a host back until `until` (e.g. after errors). Hosts are named
+    // by UrlUtils host ID; the string forms hash the host[:port] first.
+    void backoff(uint64_t host_id, Clock::time_point until);
+    void backoff(const std::string& host, Clock::time_point until);
+
+    // Consecutive failures per host, for exponential backoff
+    int record_failure(uint64_t host_id);
+    int record_failure(const std::string& host);
+    void record_success(uint64_t host_id);
+    void record_success(const std::string& host);
+
+    // Append every queued task, spilled ones included, in per-host FIFO
+    // order; the frontier itself is left as it is
+    void export_tasks(std::vector<CrawlTask>& out);
+
+    size_t size() const { return total_tasks_; }
+    bool empty() const { return total_tasks_ == 0; }
+    size_t host_count() const { return hosts_.size() - free_hosts_.size(); }
+    // Queued tasks plus a fixed overhead per live host
+    size_t resident_bytes() const { return resident_bytes_; }
+    size_t spilled_tasks() const { return spilled_tasks_; }
+
+private:
+    struct HostQueue {
+        std::string host; // without the port, for rate_for_host_
+        uint64_t host_id = 0;
+        // FIFO order is tasks -> spilled -> tail. `tasks` is only empty
+        // when the other two are, so the head always holds the next task.
+        std::deque<CompactTask> tasks;  // in-memory head
+        std::deque<SpillRef> spilled;   // on-disk blocks
+        std::vector<CompactTask> tail;  // newest tasks, batched for the next block
+        TokenBucket bucket;
+        Clock::time_point backoff_until;
+        uint64_t version = 0; // bumped whenever the heap entry is superseded
+        bool scheduled = false;
+        bool idle_listed = false; // in idle_hosts_
+        int consecutive_failures = 0;
+    };
+
+    struct HeapEntry {
+        Clock::time_point ready_at;
+        uint32_t host_index;
+        uint64_t version;
+
+        bool operator>(const HeapEntry& other) const { return ready_at > other.ready_at; }
+    };
+
+    HostQueue& host_queue(uint64_t host_id, std::string_view host);
+    void refill(HostQueue& queue);
+    void spill_excess(HostQueue& queue);
+    void spill_tail(HostQueue& queue);
+    void enforce_budget();
+    bool over_budget() const { return spill_store_ && resident_bytes_ > memory_budget_bytes_; }
+    size_t task_bytes(const CompactTask& task) const;
+    size_t host_bytes(const HostQueue& queue) const;
+
+    // Drained hosts wait in idle_hosts_ until their bucket is full and any
+    // backoff has passed; recycle_idle() then frees their slot
+    void note_idle(uint32_t index);
+    void recycle_idle(Clock::time_point now);
+
+    // Between the public CrawlTask and the resident form; compact() copies
+    // the URL into the arena, expand() leaves it there, release() frees it
+    CompactTask compact(const CrawlTask& task, uint32_t host);
+    void expand(const CompactTask& entry, CrawlTask& task) const;
+    void release(const CompactTask& task) { urls_.release(task.url_ref); }
+    bool write_spill_block(const CompactTask* begin, const CompactTask* end, SpillRef& ref);
+    Clock::time_point ready_time(const HostQueue& queue, Clock::time_point now) const;
+    void schedule(uint32_t index, Clock::time_point now);
+
+    std::function<double(const std::string&)> rate_for_host_;
+    StringArena urls_;
+    std::vector<HostQueue> hosts_;
+    std::unordered_map<uint64_t, uint32_t> host_index_; // by host ID
+    std::vector<uint32_t> free_hosts_;  // recycled slots of hosts_
+    std::deque<uint32_t> idle_hosts_;   // drained hosts, oldest first
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> ready_heap_;
+    size_t total_tasks_ = 0;
+
+    // Spill-to-disk mode
+    FrontierSpillStore* spill_store_ = nullptr;
+    size_t memory_budget_bytes_ = 0;
+    size_t head_per_host_ = 64;
+    size_t resident_bytes_ = 0;
+    size_t spilled_tasks_ = 0;
+    size_t sweep_cursor_ = 0;
+    std::vector<CrawlTask> block_; // reused spill block
+};
+
+} // namespace crawler
@@ -0,0 +1,198 @@
+#include "frontier_spill.h"
+#include "../utils/varint.h"
+#include <algorithm>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace crawler {
+
+namespace {
+
+constexpr uint32_t kBlockMagic = 0x4C505346; // "FSPL"
+constexpr size_t kBlockHeaderSize = 12;      // magic, count, payload bytes
+
+} // namespace
+
+FrontierSpillStore::FrontierSpillStore(const std::string& dir, size_t segment_bytes)
+    : dir_(dir), segment_bytes_(segment_bytes) {
+    // Spill files only extend the in-memory frontier of this process;
+    // anything left over from a previous run is stale
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+}
+
+FrontierSpillStore::~FrontierSpillStore() {
+    for (auto& [id, segment] : segments_) {
+        if (segment.fd >= 0) {
+            close(segment.fd);
+        }
+        unlink(segment_path(id).c_str());
+    }
+}
+
+std::string FrontierSpillStore::segment_path(uint32_t segment_id) const {
+    return dir_ + "/segment_" + std::to_string(segment_id) + ".spill";
+}
+
+bool FrontierSpillStore::open_segment() {
+    uint32_t id = has_active_ ? active_segment_ + 1 : 0;
+    int fd = open(segment_path(id).c_str(), O_CREAT | O_RDWR | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    // The previous active segment may already be fully consumed
+    uint32_t previous = active_segment_;
+    bool had_previous = has_active_;
+
+    Segment segment;
+    segment.fd = fd;
+    segments_[id] = segment;
+    active_segment_ = id;
+    has_active_ = true;
+
+    if (had_previous) {
+        auto it = segments_.find(previous);
+        if (it != segments_.end() && it->second.live_blocks == 0) {
+            release(previous);
+        }
+    }
+    return true;
+}
+
+bool FrontierSpillStore::write_block(const std::vector<CrawlTask>& tasks, SpillRef& ref) {
+    if (tasks.empty()) return false;
+
+    if (!has_active_ || segments_[active_segment_].size >= segment_bytes_) {
+        if (!open_segment()) return false;
+    }
+
+    buffer_.clear();
+    buffer_.resize(kBlockHeaderSize);
+
+    const std::string* previous = nullptr;
+    for (const auto& task : tasks) {
+        size_t shared = 0;
+        if (previous) {
+            size_t limit = std::min(previous->size(), task.url.size());
+            while (shared < limit && (*previous)[shared] == task.url[shared]) {
+                shared++;
+            }
+        }
+        varint::put(buffer_, shared);
+        varint::put(buffer_, task.url.size() - shared);
+        buffer_.append(task.url, shared, std::string::npos);
+        varint::put(buffer_, varint::zigzag_encode(task.priority));
+        varint::put(buffer_, static_cast<uint64_t>(task.retry_count));
+        auto due = task.next_retry_time.time_since_epoch().count();
+        varint::put(buffer_, due > 0 ? static_cast<uint64_t>(due) : 0);
+        previous = &task.url;
+    }
+
+    std::string header;
+    varint::put_fixed32(header, kBlockMagic);
+    varint::put_fixed32(header, static_cast<uint32_t>(tasks.size()));
+    varint::put_fixed32(header, static_cast<uint32_t>(buffer_.size() - kBlockHeaderSize));
+    buffer_.replace(0, kBlockHeaderSize, header);
+
+    Segment& segment = segments_[active_segment_];
+    ssize_t written = write(segment.fd, buffer_.data(), buffer_.size());
+    if (written != static_cast<ssize_t>(buffer_.size())) {
+        return false;
+    }
+
+    ref.segment = active_segment_;
+    ref.offset = segment.size;
+    ref.length = static_cast<uint32_t>(buffer_.size());
+    ref.count = static_cast<uint32_t>(tasks.size());
+
+    segment.size += buffer_.size();
+    segment.live_blocks++;
+    bytes_written_ += buffer_.size();
+    return true;
+}
+
+bool FrontierSpillStore::read_block(const SpillRef& ref, std::vector<CrawlTask>& tasks, bool release_block) {
+    auto it = segments_.find(ref.segment);
+    if (it == segments_.end()) return false;
+
+    buffer_.resize(ref.length);
+    ssize_t n = pread(it->second.fd, buffer_.data(), ref.length, static_cast<off_t>(ref.offset));
+    if (n != static_cast<ssize_t>(ref.length) || ref.length < kBlockHeaderSize) {
+        if (release_block) release(ref.segment);
+        return false;
+    }
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(buffer_.data());
+    const uint8_t* end = p + buffer_.size();
+    bool ok = varint::get_fixed32(p) == kBlockMagic;
+    uint32_t count = varint::get_fixed32(p + 4);
+    p += kBlockHeaderSize;
+
+    std::string url;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        uint64_t shared, suffix, priority, retries, due;
+        p = varint::get(p, end, shared);
+        if (p) p = varint::get(p, end, suffix);
+        if (!p || shared > url.size() || suffix > static_cast<uint64_t>(end - p)) {
+            ok = false;
+            break;
+        }
+        url.resize(shared);
+        url.append(reinterpret_cast<const char*>(p), suffix);
+        p += suffix;
+
+        p = varint::get(p, end, priority);
+        if (p) p = varint::get(p, end, retries);
+        if (p) p = varint::get(p, end, due);
+        if (!p) {
+            ok = false;
+            break;
+        }
+
+        CrawlTask task;
+        task.url = url;
+        task.priority = static_cast<int>(varint::zigzag_decode(priority));
+        task.retry_count = static_cast<int>(retries);
+        task.next_retry_time = std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(static_cast<std::chrono::steady_clock::rep>(due)));
+        tasks.push_back(std::move(task));
+    }
+
+    if (release_block) release(ref.segment);
+    return ok;
+}
+
+void FrontierSpillStore::release(uint32_t segment_id) {
+    auto it = segments_.find(segment_id);
+    if (it == segments_.end()) return;
+
+    Segment& segment = it->second;
+    if (segment.live_blocks > 0) {
+        segment.live_blocks--;
+    }
+
+    if (segment.live_blocks > 0) return;
+
+    if (has_active_ && segment_id == active_segment_) {
+        // Keep the active segment open for appends, but reclaim its space
+        if (ftruncate(segment.fd, 0) == 0) {
+            segment.size = 0;
+        }
+        return;
+    }
+    close(segment.fd);
+    unlink(segment_path(segment_id).c_str());
+    segments_.erase(it);
+}
+
+uint64_t FrontierSpillStore::bytes_on_disk() const {
+    uint64_t total = 0;
+    for (const auto& [id, segment] : segments_) {
+        total += segment.size;
+    }
+    return total;
+}
+
+} // namespace crawler
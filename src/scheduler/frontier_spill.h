@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "crawl_task.h"
+
+namespace crawler {
+
+// Location of one spilled block of a host's queue
+struct SpillRef {
+    uint32_t segment = 0;
+    uint64_t offset = 0;
+    uint32_t length = 0;
+    uint32_t count = 0;
+};
+
+// Append-only segment files holding the tails of per-host frontier queues.
+// Each block is one contiguous run of a host's FIFO, front-coded against the
+// previous URL so the shared "https://host/path/" prefix is stored once.
+// A segment is deleted once every block in it has been read back.
+// Not thread-safe: owned by HostFrontier under the scheduler lock.
+class FrontierSpillStore {
+public:
+    FrontierSpillStore(const std::string& dir, size_t segment_bytes);
+    ~FrontierSpillStore();
+
+    FrontierSpillStore(const FrontierSpillStore&) = delete;
+    FrontierSpillStore& operator=(const FrontierSpillStore&) = delete;
+
+    // Append tasks as one block
+    bool write_block(const std::vector<CrawlTask>& tasks, SpillRef& ref);
+
+    // Read a block back (appending to tasks) and, unless only peeking,
+    // release it
+    bool read_block(const SpillRef& ref, std::vector<CrawlTask>& tasks, bool release_block = true);
+
+    // Statistics
+    uint64_t bytes_written() const { return bytes_written_; }
+    uint64_t bytes_on_disk() const;
+    size_t segment_count() const { return segments_.size(); }
+
+private:
+    struct Segment {
+        int fd = -1;
+        uint64_t size = 0;
+        uint32_t live_blocks = 0;
+    };
+
+    bool open_segment();
+    void release(uint32_t segment_id);
+    std::string segment_path(uint32_t segment_id) const;
+
+    std::string dir_;
+    size_t segment_bytes_;
+    std::map<uint32_t, Segment> segments_;
+    uint32_t active_segment_ = 0;
+    bool has_active_ = false;
+    uint64_t bytes_written_ = 0;
+    std::string buffer_; // reused encode buffer
+};
+
+} // namespace crawler
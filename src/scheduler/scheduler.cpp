@@ -7,11 +7,28 @@
 
 namespace crawler {
 
-Scheduler::Scheduler() {
+static double host_rate_limit(const std::string& host) {
+    auto& config = Config::instance();
+    if (!config.rate_limit_enabled()) {
+        return 0.0;
+    }
+    return config.rate_limit_per_domain(host);
+}
+
+Scheduler::Scheduler() : frontier_(host_rate_limit) {
     auto& config = Config::instance();
     max_retries_ = config.scheduler_max_retries();
     retry_backoff_ms_ = config.scheduler_retry_backoff_ms();
     worker_threads_ = config.scheduler_worker_threads();
+    
+    if (config.frontier_spill_to_disk()) {
+        size_t budget = static_cast<size_t>(config.frontier_max_memory_mb()) * 1024 * 1024 *
+                        config.flush_threshold_percent() / 100;
+        spill_store_ = std::make_unique<FrontierSpillStore>(
+            config.storage_data_dir() + "/frontier",
+            static_cast<size_t>(config.frontier_segment_size_mb()) * 1024 * 1024);
+        frontier_.enable_spill(spill_store_.get(), budget, config.frontier_head_per_host());
+    }
 }
 
 Scheduler::~Scheduler() {
@@ -19,8 +36,10 @@ Scheduler::~Scheduler() {
 }
 
 bool Scheduler::add_url(const std::string& url, int priority) {
-    std::string normalized = UrlUtils::canonicalize(url);
-    if (!UrlUtils::is_valid(normalized)) {
+    thread_local std::string normalized;
+    ParsedUrl parsed;
+    if (!UrlUtils::parse(url, normalized, parsed) ||
+        (parsed.scheme != "http" && parsed.scheme != "https")) {
         return false;
     }
     
@@ -32,9 +51,10 @@ bool Scheduler::add_url(const std::string& url, int priority) {
     
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
-        task_queue_.push(task);
+        frontier_.push(task);
         total_scheduled_++;
     }
+    queue_cv_.notify_one();
     
     return true;
 }
@@ -51,42 +71,37 @@ bool Scheduler::add_seed_urls(const std::vector<std::string>& urls) {
 bool Scheduler::get_next_task(CrawlTask& task) {
     std::unique_lock<std::mutex> lock(queue_mutex_);
     
-    while (task_queue_.empty() && running_) {
-        // Wait for tasks
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-    
-    if (!running_ && task_queue_.empty()) {
-        return false;
-    }
-    
-    if (task_queue_.empty()) {
-        return false;
-    }
-    
-    task = task_queue_.top();
-    task_queue_.pop();
-    
-    // Check if it's time to retry
-    if (std::chrono::steady_clock::now() < task.next_retry_time) {
-        // Put it back and try another
-        task_queue_.push(task);
-        return false;
-    }
-    
-    // Check domain backoff
-    std::string domain = UrlUtils::extract_domain(task.url);
-    if (!can_fetch_domain(domain)) {
-        // Put it back
-        task_queue_.push(task);
-        return false;
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point next_ready;
+        if (frontier_.pop_ready(task, now, next_ready)) {
+            // Counted under queue_mutex_ so idle() never sees a task in neither place
+            active_tasks_++;
+            in_flight_[task.url] = task;
+            return true;
+        }
+        
+        if (!running_) {
+            return false;
+        }
+        
+        // Sleep until the soonest host is due, or a push/stop wakes us
+        if (frontier_.empty()) {
+            queue_cv_.wait(lock);
+        } else {
+            queue_cv_.wait_until(lock, next_ready);
+        }
     }
-    
-    return true;
 }
 
 void Scheduler::mark_completed(const std::string& url) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        frontier_.record_success(UrlUtils::host_id(url));
+        in_flight_.erase(url);
+    }
     total_completed_++;
+    active_tasks_--;
     if (task_callback_) {
         CrawlTask task;
         task.url = url;
@@ -96,23 +111,62 @@ void Scheduler::mark_completed(const std::string& url) {
 
 void Scheduler::mark_failed(const std::string& url, bool will_retry) {
     if (!will_retry) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            in_flight_.erase(url);
+        }
         total_failed_++;
+        active_tasks_--;
         return;
     }
     
-    // Find task and retry
+    // Retry with the dispatched task's count, so max_retries_ still applies
     CrawlTask task;
-    task.url = url;
-    task.retry_count = 1; // Simplified
-    task.next_retry_time = std::chrono::steady_clock::now() + 
-                          std::chrono::milliseconds(retry_backoff_ms_);
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        auto it = in_flight_.find(url);
+        if (it != in_flight_.end()) {
+            task = it->second;
+        } else {
+            task.url = url;
+        }
+    }
+    mark_failed(task);
+}
+
+void Scheduler::mark_failed(const CrawlTask& task) {
+    if (task.retry_count >= max_retries_) {
+        mark_failed(task.url, false);
+        return;
+    }
+    
+    CrawlTask retry = task;
+    retry.retry_count++;
+    retry.next_retry_time = std::chrono::steady_clock::now() + 
+                            std::chrono::milliseconds(retry_backoff_ms_ * retry.retry_count);
     
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
-        task_queue_.push(task);
+        frontier_.push(retry);
+        update_domain_backoff(UrlUtils::host_id(task.url));
+        in_flight_.erase(task.url);
+        active_tasks_--;
     }
+    queue_cv_.notify_one();
+}
+
+void Scheduler::requeue(const CrawlTask& task) {
+    CrawlTask again = task;
+    again.next_retry_time = std::chrono::steady_clock::now() +
+                            std::chrono::milliseconds(retry_backoff_ms_);
     
-    update_domain_backoff(UrlUtils::extract_domain(url));
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        frontier_.push(again);
+        in_flight_.erase(task.url);
+        active_tasks_--;
+    }
+    queue_cv_.notify_one();
 }
 
 void Scheduler::start() {
@@ -123,7 +177,11 @@ void Scheduler::start() {
 }
 
 void Scheduler::stop() {
-    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        running_ = false;
+    }
+    queue_cv_.notify_all();
     for (auto& worker : workers_) {
         if (worker.joinable()) {
             worker.join();
@@ -136,29 +194,56 @@ void Scheduler::set_task_callback(std::function<void(const CrawlTask&)> callback
     task_callback_ = callback;
 }
 
-size_t Scheduler::queue_size() const {
+void Scheduler::set_task_handler(std::function<void(const CrawlTask&)> handler) {
+    task_handler_ = handler;
+}
+
+bool Scheduler::idle() const {
     std::lock_guard<std::mutex> lock(queue_mutex_);
-    return task_queue_.size();
+    return frontier_.empty() && active_tasks_ == 0;
 }
 
-void Scheduler::worker_thread() {
-    // Worker threads can process tasks
-    // This is a placeholder for future async processing
+void Scheduler::export_tasks(std::vector<CrawlTask>& out) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    out.reserve(out.size() + frontier_.size() + in_flight_.size());
+    for (const auto& [url, task] : in_flight_) {
+        out.push_back(task);
+    }
+    frontier_.export_tasks(out);
 }
 
-void Scheduler::update_domain_backoff(const std::string& domain) {
-    std::lock_guard<std::mutex> lock(backoff_mutex_);
-    domain_backoff_[domain] = std::chrono::steady_clock::now() + 
-                              std::chrono::seconds(1);
+size_t Scheduler::queue_size() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return frontier_.size();
 }
 
-bool Scheduler::can_fetch_domain(const std::string& domain) const {
-    std::lock_guard<std::mutex> lock(backoff_mutex_);
-    auto it = domain_backoff_.find(domain);
-    if (it == domain_backoff_.end()) {
-        return true;
+size_t Scheduler::spilled_tasks() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return frontier_.spilled_tasks();
+}
+
+void Scheduler::worker_thread() {
+    CrawlTask task;
+    while (running_) {
+        if (!get_next_task(task)) {
+            continue;
+        }
+        
+        if (task_handler_) {
+            task_handler_(task);
+        } else {
+            mark_completed(task.url);
+        }
     }
-    return std::chrono::steady_clock::now() >= it->second;
+}
+
+void Scheduler::update_domain_backoff(uint64_t host_id) {
+    // Exponential per-host backoff on consecutive failures, capped
+    int failures = frontier_.record_failure(host_id);
+    int64_t delay_ms = static_cast<int64_t>(retry_backoff_ms_) << std::min(failures - 1, 16);
+    delay_ms = std::min<int64_t>(delay_ms, max_backoff_ms_);
+    frontier_.backoff(host_id, std::chrono::steady_clock::now() + 
+                              std::chrono::milliseconds(delay_ms));
 }
 
 } // namespace crawler
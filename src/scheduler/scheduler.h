@@ -1,27 +1,21 @@
 #pragma once
 
 #include <string>
-#include <queue>
 #include <mutex>
 #include <thread>
 #include <atomic>
 #include <unordered_map>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <vector>
+#include <memory>
+#include "crawl_task.h"
+#include "frontier.h"
+#include "frontier_spill.h"
 
 namespace crawler {
 
-struct CrawlTask {
-    std::string url;
-    int priority = 0;
-    int retry_count = 0;
-    std::chrono::steady_clock::time_point next_retry_time;
-    
-    bool operator<(const CrawlTask& other) const {
-        return priority < other.priority;
-    }
-};
-
 class Scheduler {
 public:
     Scheduler();
@@ -33,7 +27,8 @@ public:
     // Add URLs from seed list
     bool add_seed_urls(const std::vector<std::string>& urls);
     
-    // Get next URL to crawl (blocking)
+    // Get next URL to crawl. Blocks until some host is allowed to fetch;
+    // returns false once the scheduler is stopped.
     bool get_next_task(CrawlTask& task);
     
     // Mark task as completed
@@ -42,6 +37,13 @@ public:
     // Mark task as failed (will retry if retries left)
     void mark_failed(const std::string& url, bool will_retry = true);
     
+    // Mark task as failed, retrying with backoff until max_retries is reached
+    void mark_failed(const CrawlTask& task);
+    
+    // Put a dispatched task back in the frontier unchanged, e.g. when a later
+    // stage had no room for it. Counts neither a retry nor a host failure.
+    void requeue(const CrawlTask& task);
+    
     // Start worker threads
     void start();
     
@@ -51,22 +53,36 @@ public:
     // Set callback for completed tasks
     void set_task_callback(std::function<void(const CrawlTask&)> callback);
     
+    // Set handler run by worker threads for every dispatched task.
+    // The handler (or a later pipeline stage) must end each task with
+    // mark_completed() or mark_failed().
+    void set_task_handler(std::function<void(const CrawlTask&)> handler);
+    
+    // True when nothing is queued and no dispatched task is still in progress
+    bool idle() const;
+    
+    // Queued tasks plus the dispatched ones not yet completed or failed,
+    // for checkpoints
+    void export_tasks(std::vector<CrawlTask>& out);
+    
     // Statistics
     size_t queue_size() const;
+    size_t spilled_tasks() const;
+    size_t active_tasks() const { return active_tasks_; }
     size_t total_scheduled() const { return total_scheduled_; }
     size_t total_completed() const { return total_completed_; }
     size_t total_failed() const { return total_failed_; }
 
 private:
     void worker_thread();
-    void update_domain_backoff(const std::string& domain);
-    bool can_fetch_domain(const std::string& domain) const;
+    // Caller holds queue_mutex_
+    void update_domain_backoff(uint64_t host_id);
     
-    std::priority_queue<CrawlTask> task_queue_;
+    std::unique_ptr<FrontierSpillStore> spill_store_; // declared before frontier_, outlives it
+    HostFrontier frontier_;
+    std::unordered_map<std::string, CrawlTask> in_flight_; // dispatched, by url
     mutable std::mutex queue_mutex_;
-    
-    std::unordered_map<std::string, std::chrono::steady_clock::time_point> domain_backoff_;
-    mutable std::mutex backoff_mutex_;
+    std::condition_variable queue_cv_;
     
     std::vector<std::thread> workers_;
     std::atomic<bool> running_{false};
@@ -74,12 +90,15 @@ private:
     std::atomic<size_t> total_scheduled_{0};
     std::atomic<size_t> total_completed_{0};
     std::atomic<size_t> total_failed_{0};
+    std::atomic<size_t> active_tasks_{0};
     
     std::function<void(const CrawlTask&)> task_callback_;
+    std::function<void(const CrawlTask&)> task_handler_;
     
     int max_retries_ = 3;
     int retry_backoff_ms_ = 1000;
     int worker_threads_ = 8;
+    int max_backoff_ms_ = 60000;
 };
 
 } // namespace crawler
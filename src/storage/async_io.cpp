@@ -0,0 +1,403 @@
+#include "async_io.h"
+#include "../utils/config.h"
+#include "../observability/logger.h"
+#include <linux/io_uring.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace crawler {
+
+namespace {
+
+// Registered buffers; writes up to this size are copied into one
+constexpr size_t kRegisteredBufferSize = 128 << 10;
+constexpr size_t kMaxRegisteredBuffers = 64;
+
+// user_data of the eventfd read that wakes the ring thread
+constexpr uint64_t kWakeTag = 0;
+
+// Kernel-shared ring indexes
+unsigned load_acquire(const unsigned* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void store_release(unsigned* p, unsigned value) {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+} // namespace
+
+AsyncIo& AsyncIo::instance() {
+    auto& config = Config::instance();
+    static AsyncIo io(static_cast<size_t>(std::max(config.storage_io_queue_depth(), 2)),
+                      static_cast<size_t>(std::max(config.storage_io_max_inflight_mb(), 1)) * 1024 * 1024,
+                      config.storage_io_uring(), std::max(config.storage_io_threads(), 1));
+    return io;
+}
+
+AsyncIo::AsyncIo(size_t queue_depth, size_t max_inflight_bytes, bool use_io_uring, int threads)
+    : max_inflight_bytes_(max_inflight_bytes) {
+    if (use_io_uring && setup_ring(queue_depth, max_inflight_bytes)) {
+        threads_.emplace_back(&AsyncIo::ring_worker, this);
+        return;
+    }
+    if (use_io_uring) {
+        Logger::instance().info("io_uring unavailable; storage I/O on " + std::to_string(threads) + " threads");
+    }
+    for (int i = 0; i < threads; i++) {
+        threads_.emplace_back(&AsyncIo::pool_worker, this);
+    }
+}
+
+AsyncIo::~AsyncIo() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    budget_cv_.notify_all();
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        (void)::write(wake_fd_, &one, sizeof(one));
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+
+    if (sqes_) munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) ::close(ring_fd_);
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+}
+
+bool AsyncIo::setup_ring(size_t queue_depth, size_t max_inflight_bytes) {
+    io_uring_params params{};
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(queue_depth), &params));
+    if (fd < 0) return false;
+
+    // The ops used here must all be there (IORING_OP_WRITE is 5.6)
+    std::vector<uint64_t> probe_memory(
+        (sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op)) / sizeof(uint64_t) + 1);
+    auto* probe = reinterpret_cast<io_uring_probe*>(probe_memory.data());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0 ||
+        probe->last_op < IORING_OP_WRITE || !(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED) ||
+        !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)) {
+        ::close(fd);
+        return false;
+    }
+    ring_fd_ = fd;
+    ring_entries_ = params.sq_entries;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                    IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_
+                           : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                  IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED || wake_fd_ < 0) {
+        if (sq_ring_ == MAP_FAILED) sq_ring_ = nullptr;
+        if (cq_ring_ == MAP_FAILED) cq_ring_ = nullptr;
+        if (sqes_ == MAP_FAILED) sqes_ = nullptr;
+        // The destructor unmaps the rest
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+        return false;
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    char* cq = static_cast<char*>(cq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+
+    // Registered buffers spare the kernel mapping each write's pages; the
+    // ring works without them (RLIMIT_MEMLOCK may be too low)
+    size_t count = std::min({kMaxRegisteredBuffers, static_cast<size_t>(ring_entries_),
+                             std::max<size_t>(max_inflight_bytes / kRegisteredBufferSize, 1)});
+    buffer_memory_.reset(new char[count * kRegisteredBufferSize]);
+    std::vector<iovec> iovecs(count);
+    for (size_t i = 0; i < count; i++) {
+        iovecs[i] = {buffer_memory_.get() + i * kRegisteredBufferSize, kRegisteredBufferSize};
+    }
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs.data(),
+                static_cast<unsigned>(count)) == 0) {
+        buffer_size_ = kRegisteredBufferSize;
+        for (size_t i = count; i > 0; i--) {
+            free_buffers_.push_back(static_cast<int>(i - 1));
+        }
+    } else {
+        buffer_memory_.reset();
+    }
+    Logger::instance().info("Storage I/O through io_uring, " + std::to_string(ring_entries_) + " entries, " +
+                            std::to_string(free_buffers_.size()) + " registered buffers");
+    return true;
+}
+
+void AsyncIo::write(int fd, uint64_t offset, std::string data, Callback done) {
+    auto op = std::make_unique<Op>();
+    op->fd = fd;
+    op->offset = offset;
+    op->size = data.size();
+    op->data = std::move(data);
+    op->done = std::move(done);
+    enqueue(std::move(op));
+}
+
+void AsyncIo::sync(int fd, Callback done) {
+    auto op = std::make_unique<Op>();
+    op->sync = true;
+    op->fd = fd;
+    op->done = std::move(done);
+    enqueue(std::move(op));
+}
+
+void AsyncIo::enqueue(std::unique_ptr<Op> op) {
+    bool wake = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // One oversized write still goes through on its own
+        budget_cv_.wait(lock, [&]() {
+            return inflight_bytes_ == 0 || inflight_bytes_ + op->size <= max_inflight_bytes_ || stop_;
+        });
+        inflight_bytes_ += op->size;
+        queue_.push_back(std::move(op));
+        if (ring_fd_ >= 0 && !wake_pending_) {
+            wake_pending_ = wake = true;
+        }
+    }
+    if (wake) {
+        uint64_t one = 1;
+        (void)::write(wake_fd_, &one, sizeof(one));
+    } else if (ring_fd_ < 0) {
+        work_cv_.notify_one();
+    }
+}
+
+bool AsyncIo::submit(Op* op) {
+    unsigned tail = *sq_tail_;
+    if (tail - load_acquire(sq_head_) >= ring_entries_) return false;
+    unsigned index = tail & *sq_mask_;
+    auto* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    if (!op) {
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = wake_fd_;
+        sqe->addr = reinterpret_cast<uint64_t>(&wake_value_);
+        sqe->len = sizeof(wake_value_);
+        sqe->user_data = kWakeTag;
+    } else if (op->sync) {
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = op->fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+    } else {
+        if (op->buffer < 0 && op->done_bytes == 0 && op->size <= buffer_size_ && !free_buffers_.empty()) {
+            op->buffer = free_buffers_.back();
+            free_buffers_.pop_back();
+            std::memcpy(buffer_memory_.get() + op->buffer * buffer_size_, op->data.data(), op->size);
+            std::string().swap(op->data);
+        }
+        const char* data = op->buffer >= 0 ? buffer_memory_.get() + op->buffer * buffer_size_ : op->data.data();
+        sqe->opcode = op->buffer >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = op->fd;
+        sqe->off = op->offset + op->done_bytes;
+        sqe->addr = reinterpret_cast<uint64_t>(data + op->done_bytes);
+        sqe->len = static_cast<uint32_t>(op->size - op->done_bytes);
+        sqe->buf_index = static_cast<uint16_t>(std::max(op->buffer, 0));
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+    }
+    sq_array_[index] = index;
+    store_release(sq_tail_, tail + 1);
+    return true;
+}
+
+void AsyncIo::ring_worker() {
+    std::vector<Op*> retry;          // short or interrupted, to go again
+    std::vector<std::pair<uint64_t, int64_t>> completions;
+    size_t inflight = 0;             // submitted ops, the wake read aside
+    unsigned to_submit = 0;
+    bool wake_armed = false;
+    // Room is left for the wake read, and the CQ (twice the SQ) cannot overflow
+    const size_t capacity = ring_entries_ - 1;
+
+    while (true) {
+        if (!wake_armed && submit(nullptr)) {
+            wake_armed = true;
+            to_submit++;
+        }
+        while (!retry.empty() && submit(retry.back())) {
+            retry.pop_back();
+            to_submit++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wake_pending_ = false;
+            if (stop_ && queue_.empty() && inflight == 0) break;
+            while (!queue_.empty() && inflight < capacity) {
+                // A sync waits for everything before it
+                if (queue_.front()->sync && inflight > 0) break;
+                if (!submit(queue_.front().get())) break;
+                queue_.front().release();
+                queue_.pop_front();
+                inflight++;
+                to_submit++;
+            }
+        }
+
+        int submitted = static_cast<int>(
+            syscall(__NR_io_uring_enter, ring_fd_, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+        submit_calls_++;
+        if (submitted < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                Logger::instance().error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        } else {
+            to_submit -= std::min(to_submit, static_cast<unsigned>(submitted));
+        }
+
+        completions.clear();
+        unsigned head = *cq_head_;
+        unsigned tail = load_acquire(cq_tail_);
+        for (; head != tail; head++) {
+            const auto& cqe = static_cast<const io_uring_cqe*>(cqes_)[head & *cq_mask_];
+            completions.emplace_back(cqe.user_data, cqe.res);
+        }
+        store_release(cq_head_, head);
+
+        for (auto [tag, result] : completions) {
+            if (tag == kWakeTag) {
+                wake_armed = false;
+                continue;
+            }
+            auto* op = reinterpret_cast<Op*>(tag);
+            if (result == -EINTR || result == -EAGAIN ||
+                (!op->sync && result > 0 && op->done_bytes + static_cast<size_t>(result) < op->size)) {
+                op->done_bytes += result > 0 ? static_cast<size_t>(result) : 0;
+                retry.push_back(op);
+                continue;
+            }
+            inflight--;
+            if (op->buffer >= 0) {
+                free_buffers_.push_back(op->buffer);
+            }
+            if (result == 0 && op->size > op->done_bytes) {
+                result = -EIO;
+            }
+            finish(std::unique_ptr<Op>(op), result < 0 ? result : static_cast<int64_t>(op->size));
+        }
+    }
+}
+
+void AsyncIo::pool_worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this]() {
+            return (stop_ && queue_.empty()) || (!queue_.empty() && (!queue_.front()->sync || running_ == 0));
+        });
+        if (queue_.empty()) break;
+
+        std::unique_ptr<Op> op = std::move(queue_.front());
+        queue_.pop_front();
+        running_++;
+        lock.unlock();
+        int64_t result = run(*op);
+        finish(std::move(op), result);
+        lock.lock();
+    }
+}
+
+int64_t AsyncIo::run(Op& op) {
+    if (op.sync) {
+        return fdatasync(op.fd) == 0 ? 0 : -errno;
+    }
+    while (op.done_bytes < op.size) {
+        ssize_t n = pwrite(op.fd, op.data.data() + op.done_bytes, op.size - op.done_bytes,
+                           static_cast<off_t>(op.offset + op.done_bytes));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return n < 0 ? -errno : -EIO;
+        op.done_bytes += static_cast<size_t>(n);
+    }
+    return static_cast<int64_t>(op.size);
+}
+
+void AsyncIo::finish(std::unique_ptr<Op> op, int64_t result) {
+    if (op->done) {
+        op->done(result);
+    }
+    size_t size = op->size;
+    op.reset();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    operations_++;
+    inflight_bytes_ -= size;
+    if (ring_fd_ < 0) {
+        running_--;
+    }
+    budget_cv_.notify_all();
+    work_cv_.notify_all();
+}
+
+size_t AsyncIo::inflight_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inflight_bytes_;
+}
+
+AsyncIo::Callback IoGroup::track(AsyncIo::Callback then) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        outstanding_++;
+    }
+    return [this, then = std::move(then)](int64_t result) {
+        if (then) {
+            then(result);
+        }
+        // Notified under the lock: a waiter may destroy the group once it wakes
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = failed_ || result < 0;
+        if (--outstanding_ == 0) {
+            cv_.notify_all();
+        }
+    };
+}
+
+bool IoGroup::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return outstanding_ == 0; });
+    return !failed_;
+}
+
+size_t IoGroup::outstanding() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return outstanding_;
+}
+
+bool IoGroup::failed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+} // namespace crawler
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+namespace crawler {
+
+// Asynchronous file writes and syncs for the storage layer, so disk
+// latency (fsync spikes on network-attached disks above all) stays off the
+// threads producing the data.
+//
+// With io_uring, driven through the raw system calls, one thread owns a
+// ring of queue_depth entries: everything queued since it last woke is
+// submitted with one io_uring_enter() that also reaps completions. Small
+// writes are copied into buffers registered with the ring. Kernels or
+// sandboxes without io_uring get a pool of threads doing pwrite and
+// fdatasync instead.
+//
+// A sync() starts once every operation queued before it has completed, so
+// it covers their writes and its callback runs after theirs. Callbacks run
+// on the I/O threads; they must not wait on further I/O, nor on locks held
+// by a thread calling write(). write() waits while max_inflight_bytes are
+// queued and not yet written.
+class AsyncIo {
+public:
+    // Bytes written, 0 for a sync, or -errno
+    using Callback = std::function<void(int64_t result)>;
+
+    // Shared engine, configured by storage.io_*
+    static AsyncIo& instance();
+
+    AsyncIo(size_t queue_depth, size_t max_inflight_bytes, bool use_io_uring, int threads);
+    ~AsyncIo();
+
+    AsyncIo(const AsyncIo&) = delete;
+    AsyncIo& operator=(const AsyncIo&) = delete;
+
+    // Write all of data at offset
+    void write(int fd, uint64_t offset, std::string data, Callback done);
+
+    // fdatasync fd after everything queued so far
+    void sync(int fd, Callback done);
+
+    // Statistics
+    bool uses_io_uring() const { return ring_fd_ >= 0; }
+    size_t inflight_bytes() const;
+    uint64_t submit_calls() const { return submit_calls_; }
+    uint64_t operations() const { return operations_; }
+
+private:
+    struct Op {
+        bool sync = false;
+        int fd = -1;
+        uint64_t offset = 0;
+        std::string data;      // emptied once copied to a registered buffer
+        size_t size = 0;
+        size_t done_bytes = 0; // written so far
+        int buffer = -1;        // registered buffer holding the data
+        Callback done;
+    };
+
+    void enqueue(std::unique_ptr<Op> op);
+    bool setup_ring(size_t queue_depth, size_t max_inflight_bytes);
+    void ring_worker();
+    void pool_worker();
+    bool submit(Op* op); // onto the SQ; nullptr for the wake read
+    void finish(std::unique_ptr<Op> op, int64_t result);
+    int64_t run(Op& op);
+
+    size_t max_inflight_bytes_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable budget_cv_; // writers waiting for in-flight bytes
+    std::condition_variable work_cv_;   // pool workers
+    std::deque<std::unique_ptr<Op>> queue_;
+    size_t inflight_bytes_ = 0;         // queued or being written
+    size_t running_ = 0;                // taken off the queue, not yet finished
+    bool stop_ = false;
+
+    // io_uring
+    int ring_fd_ = -1;
+    int wake_fd_ = -1;                  // eventfd, read through the ring
+    uint64_t wake_value_ = 0;
+    unsigned ring_entries_ = 0;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    void* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    void* cqes_ = nullptr;
+    bool wake_pending_ = false;        // wake_fd_ written, not yet seen
+
+    // Registered buffers; ring thread only
+    size_t buffer_size_ = 0;
+    std::unique_ptr<char[]> buffer_memory_;
+    std::vector<int> free_buffers_;
+
+    std::vector<std::thread> threads_;
+    std::atomic<uint64_t> submit_calls_{0};
+    std::atomic<uint64_t> operations_{0};
+};
+
+// Operations one user has outstanding, to wait for them and learn whether
+// any failed. Wait before destroying it.
+class IoGroup {
+public:
+    ~IoGroup() { wait(); }
+
+    // Callback to pass to AsyncIo, running `then` before counting the op done
+    AsyncIo::Callback track(AsyncIo::Callback then = nullptr);
+
+    // Until everything tracked so far is done; false if anything failed
+    bool wait();
+
+    size_t outstanding() const;
+    bool failed() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t outstanding_ = 0;
+    bool failed_ = false;
+};
+
+} // namespace crawler
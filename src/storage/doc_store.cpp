@@ -0,0 +1,683 @@
+#include "doc_store.h"
+#include "async_io.h"
+#include "../utils/varint.h"
+#include "../observability/logger.h"
+#include <zstd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace crawler {
+
+namespace {
+
+constexpr uint32_t kBlockMagic = 0x4B4C4244; // "DBLK"
+constexpr uint32_t kIndexMagic = 0x58444944; // "DIDX"
+constexpr size_t kBlockHeaderSize = 16;      // magic, stored size, raw size, crc
+constexpr size_t kIndexEntrySize = 20;       // doc_id, block offset, record offset and size
+constexpr int kCompressionLevel = 3;
+
+// The writer wakes at least this often to write what is pending
+constexpr auto kWriteInterval = std::chrono::milliseconds(100);
+
+// append() waits for the writer beyond this much pending
+constexpr size_t kMaxPendingBytes = 32 << 20;
+
+// Location fields are 32-bit
+constexpr size_t kMaxSegmentBytes = size_t(1) << 31;
+
+uint32_t crc(std::string_view bytes) {
+    return static_cast<uint32_t>(
+        crc32(0L, reinterpret_cast<const Bytef*>(bytes.data()), static_cast<uInt>(bytes.size())));
+}
+
+void put_string(std::string& out, std::string_view text) {
+    varint::put(out, text.size());
+    out.append(text);
+}
+
+bool get_string(const uint8_t*& p, const uint8_t* end, std::string_view& out) {
+    uint64_t length = 0;
+    p = varint::get(p, end, length);
+    if (!p || length > static_cast<uint64_t>(end - p)) return false;
+    out = std::string_view(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return true;
+}
+
+bool parse_record(std::string_view record, StoredDocument& out) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(record.data());
+    const uint8_t* end = p + record.size();
+    if (record.size() < 8) return false;
+    out.doc_id = varint::get_fixed64(p);
+    p += 8;
+
+    std::string_view url, key, value, content;
+    uint64_t fields = 0;
+    if (!get_string(p, end, url) || !(p = varint::get(p, end, fields))) return false;
+    out.url.assign(url);
+    out.metadata.clear();
+    for (uint64_t i = 0; i < fields; i++) {
+        if (!get_string(p, end, key) || !get_string(p, end, value)) return false;
+        out.metadata.emplace(key, value);
+    }
+    if (!get_string(p, end, content)) return false;
+    out.content.assign(content);
+    return true;
+}
+
+bool pread_all(int fd, char* out, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pread(fd, out, size, static_cast<off_t>(offset));
+        if (n <= 0) return false;
+        out += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// splitmix64 finaliser, to derive stable WARC record ids from doc ids
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+std::string warc_record(const char* type, const std::string& date, std::string_view uri,
+                        std::string_view content_type, std::string_view body, uint64_t id) {
+    uint64_t hi = mix(id);
+    uint64_t lo = mix(~id);
+    char uuid[48];
+    std::snprintf(uuid, sizeof(uuid), "%08llx-%04llx-4%03llx-%04llx-%012llx",
+                  static_cast<unsigned long long>(hi >> 32), static_cast<unsigned long long>((hi >> 16) & 0xFFFF),
+                  static_cast<unsigned long long>(hi & 0xFFF),
+                  static_cast<unsigned long long>(0x8000 | ((lo >> 48) & 0x3FFF)),
+                  static_cast<unsigned long long>(lo & 0xFFFFFFFFFFFFULL));
+
+    std::string record = "WARC/1.1\r\nWARC-Type: ";
+    record += type;
+    record += "\r\nWARC-Record-ID: <urn:uuid:";
+    record += uuid;
+    record += ">\r\nWARC-Date: " + date + "\r\n";
+    if (!uri.empty()) {
+        record += "WARC-Target-URI: ";
+        record += uri;
+        record += "\r\n";
+    }
+    record += "Content-Type: ";
+    record += content_type;
+    record += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    record += body;
+    record += "\r\n\r\n";
+    return record;
+}
+
+// One gzip member; concatenated members are a valid gzip stream
+bool gzip_member(const std::string& in, std::string& out) {
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.resize(deflateBound(&stream, in.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.avail_in = static_cast<uInt>(in.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    bool ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ok;
+}
+
+// The last block a thread read, decompressed
+struct BlockCache {
+    uint32_t segment = UINT32_MAX;
+    uint32_t offset = UINT32_MAX;
+    uint64_t instance = 0;
+    std::string raw;
+};
+
+std::atomic<uint64_t> next_instance{1};
+
+} // namespace
+
+DocStore::DocStore(const std::string& dir, size_t segment_bytes, size_t block_bytes, bool compress)
+    : dir_(dir), segment_bytes_(std::min(std::max<size_t>(segment_bytes, 1), kMaxSegmentBytes)),
+      block_bytes_(std::max<size_t>(block_bytes, 1)), compress_(compress), instance_(next_instance++) {}
+
+DocStore::~DocStore() {
+    close();
+    ZSTD_freeCCtx(zstd_);
+}
+
+std::string DocStore::segment_path(uint32_t id, const char* extension) const {
+    return dir_ + "/store_" + std::to_string(id) + extension;
+}
+
+bool DocStore::open() {
+    if (open_) return true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    std::vector<uint32_t> ids;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        unsigned int id = 0;
+        char extension[8] = {};
+        std::string file = entry.path().filename().string();
+        if (std::sscanf(file.c_str(), "store_%u.%3s", &id, extension) == 2 && std::string(extension) == "seg") {
+            ids.push_back(id);
+        }
+    }
+    if (ec) {
+        Logger::instance().error("Cannot read document store directory " + dir_);
+        return false;
+    }
+    std::sort(ids.begin(), ids.end());
+
+    std::vector<Location> locations;
+    std::vector<uint32_t> unsealed;
+    for (size_t i = 0; i < ids.size(); i++) {
+        bool last = i + 1 == ids.size();
+        int fd = ::open(segment_path(ids[i], ".seg").c_str(), (last ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        if (fd < 0) {
+            Logger::instance().error("Cannot open document segment " + segment_path(ids[i], ".seg"));
+            return false;
+        }
+        Segment& segment = segments_[ids[i]];
+        segment.fd = fd;
+        segment.size = static_cast<uint64_t>(std::max<off_t>(lseek(fd, 0, SEEK_END), 0));
+
+        // Sealed segments have an index unless the seal was interrupted
+        if (last || !load_index(ids[i], locations)) {
+            if (!scan_segment(ids[i], locations)) return false;
+            if (!last) unsealed.push_back(ids[i]);
+        }
+    }
+
+    // Later appends of a doc_id win
+    std::stable_sort(locations.begin(), locations.end(),
+                     [](const Location& a, const Location& b) { return a.doc_id < b.doc_id; });
+    for (const auto& location : locations) {
+        if (!index_.empty() && index_.back().doc_id == location.doc_id) {
+            index_.back() = location;
+        } else {
+            index_.push_back(location);
+        }
+    }
+
+    for (uint32_t id : unsealed) {
+        if (!seal_segment(id)) return false;
+    }
+
+    if (segments_.empty()) {
+        if (!open_segment(0)) return false;
+    } else {
+        active_segment_ = segments_.rbegin()->first;
+    }
+
+    stop_ = false;
+    open_ = true;
+    writer_thread_ = std::thread(&DocStore::writer_worker, this);
+    return true;
+}
+
+bool DocStore::load_index(uint32_t id, std::vector<Location>& out) const {
+    std::ifstream in(segment_path(id, ".idx"), std::ios::binary);
+    if (!in.is_open()) return false;
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 12) return false;
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(bytes.data());
+    uint64_t count = varint::get_fixed32(p + 4);
+    if (varint::get_fixed32(p) != kIndexMagic || bytes.size() != 12 + count * kIndexEntrySize ||
+        varint::get_fixed32(p + bytes.size() - 4) != crc(std::string_view(bytes.data(), bytes.size() - 4))) {
+        return false;
+    }
+    p += 8;
+    for (uint64_t i = 0; i < count; i++, p += kIndexEntrySize) {
+        out.push_back({varint::get_fixed64(p), id, varint::get_fixed32(p + 8), varint::get_fixed32(p + 12),
+                       varint::get_fixed32(p + 16)});
+    }
+    return true;
+}
+
+bool DocStore::scan_segment(uint32_t id, std::vector<Location>& out) {
+    Segment& segment = segments_[id];
+    std::string raw;
+    uint64_t offset = 0;
+    while (offset + kBlockHeaderSize <= segment.size) {
+        char header[kBlockHeaderSize];
+        if (!pread_all(segment.fd, header, sizeof(header), offset)) break;
+        const uint8_t* h = reinterpret_cast<const uint8_t*>(header);
+        uint32_t stored_size = varint::get_fixed32(h + 4);
+        if (varint::get_fixed32(h) != kBlockMagic || offset + kBlockHeaderSize + stored_size > segment.size ||
+            !read_block(id, static_cast<uint32_t>(offset), raw)) {
+            break;
+        }
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(raw.data());
+        const uint8_t* end = p + raw.size();
+        std::vector<Location> block;
+        bool ok = true;
+        while (p < end) {
+            // Walk the record to find its size
+            const uint8_t* start = p;
+            std::string_view text;
+            uint64_t fields = 0;
+            ok = end - p >= 8;
+            p += ok ? 8 : 0;
+            ok = ok && get_string(p, end, text) && (p = varint::get(p, end, fields));
+            for (uint64_t i = 0; ok && i < fields; i++) {
+                ok = get_string(p, end, text) && get_string(p, end, text);
+            }
+            ok = ok && get_string(p, end, text);
+            if (!ok) break;
+            block.push_back({varint::get_fixed64(start), id, static_cast<uint32_t>(offset),
+                             static_cast<uint32_t>(start - reinterpret_cast<const uint8_t*>(raw.data())),
+                             static_cast<uint32_t>(p - start)});
+        }
+        if (!ok) break;
+        out.insert(out.end(), block.begin(), block.end());
+        offset += kBlockHeaderSize + stored_size;
+    }
+
+    if (offset < segment.size) {
+        // A block the writer did not finish; nothing in it was flushed
+        Logger::instance().warn("Truncating document segment " + segment_path(id, ".seg") + " at byte " +
+                                std::to_string(offset));
+        if (ftruncate(segment.fd, static_cast<off_t>(offset)) != 0) return false;
+        segment.size = offset;
+    }
+    return true;
+}
+
+bool DocStore::open_segment(uint32_t id) {
+    int fd = ::open(segment_path(id, ".seg").c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Segment& segment = segments_[id];
+    segment.fd = fd;
+    segment.size = 0;
+    active_segment_ = id;
+    return true;
+}
+
+bool DocStore::seal_segment(uint32_t id) {
+    std::string bytes;
+    varint::put_fixed32(bytes, kIndexMagic);
+    varint::put_fixed32(bytes, 0);
+    int fd;
+    uint32_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fd = segments_[id].fd;
+        for (const auto& location : index_) {
+            if (location.segment != id) continue;
+            varint::put_fixed64(bytes, location.doc_id);
+            varint::put_fixed32(bytes, location.block_offset);
+            varint::put_fixed32(bytes, location.record_offset);
+            varint::put_fixed32(bytes, location.record_size);
+            count++;
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        bytes[4 + i] = static_cast<char>(count >> (8 * i));
+    }
+    varint::put_fixed32(bytes, crc(bytes));
+
+    // The data first, so an index never describes blocks a crash lost
+    if (fdatasync(fd) != 0) return false;
+    std::string path = segment_path(id, ".idx");
+    std::string tmp_path = path + ".tmp";
+    int index_fd = ::open(tmp_path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    if (index_fd < 0) return false;
+    bool ok = ::write(index_fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()) &&
+              fsync(index_fd) == 0;
+    ::close(index_fd);
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void DocStore::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) return;
+        stop_ = true;
+    }
+    work_cv_.notify_one();
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [id, segment] : segments_) {
+        if (segment.fd >= 0) ::close(segment.fd);
+        segment.fd = -1;
+    }
+    open_ = false;
+}
+
+bool DocStore::append(uint64_t doc_id, std::string_view url,
+                      const std::unordered_map<std::string, std::string>& metadata, std::string_view content,
+                      StoredCallback stored) {
+    Pending page;
+    page.doc_id = doc_id;
+    page.stored = std::move(stored);
+    page.record.reserve(content.size() + url.size() + 32);
+    varint::put_fixed64(page.record, doc_id);
+    put_string(page.record, url);
+    varint::put(page.record, metadata.size());
+    for (const auto& [key, value] : metadata) {
+        put_string(page.record, key);
+        put_string(page.record, value);
+    }
+    put_string(page.record, content);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Let a lagging writer catch up rather than buffer without bound
+    done_cv_.wait(lock, [this]() { return pending_bytes_ < kMaxPendingBytes || stop_ || failed_; });
+    if (!open_ || stop_ || failed_) return false;
+    pending_bytes_ += page.record.size();
+    pending_.push_back(std::move(page));
+    appended_++;
+    if (pending_bytes_ >= block_bytes_) {
+        work_cv_.notify_one();
+    }
+    return true;
+}
+
+bool DocStore::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!open_) return false;
+    uint64_t target = appended_;
+    flush_requested_ = true;
+    work_cv_.notify_one();
+    done_cv_.wait(lock, [&]() { return written_ >= target; });
+    return written_ >= target && !failed_;
+}
+
+void DocStore::writer_worker() {
+    auto& io = AsyncIo::instance();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait_for(lock, kWriteInterval, [this]() {
+            return stop_ || flush_requested_ || pending_bytes_ >= block_bytes_;
+        });
+        flush_requested_ = false;
+
+        if (!pending_.empty()) {
+            auto batch = std::make_shared<Batch>();
+            batch->pages.swap(pending_);
+            pending_bytes_ = 0;
+            writing_.push_back(batch);
+            done_cv_.notify_all(); // room for appends again
+            lock.unlock();
+
+            // Whatever piled up is cut into blocks of about block_bytes,
+            // written while the next pages are packed
+            size_t begin = 0;
+            while (begin < batch->pages.size()) {
+                size_t end = begin;
+                size_t bytes = 0;
+                while (end < batch->pages.size() && (end == begin || bytes < block_bytes_)) {
+                    bytes += batch->pages[end++].record.size();
+                }
+                write_block(*batch, begin, end);
+                begin = end;
+            }
+            // segments_ only changes on this thread
+            const Segment& active = segments_[active_segment_];
+            io.sync(active.fd, [this, batch](int64_t result) { batch_synced(*batch, result >= 0); });
+
+            lock.lock();
+            if (active.size >= segment_bytes_) {
+                // Sealed once everything queued to it is written
+                done_cv_.wait(lock, [this]() { return writing_.empty(); });
+                lock.unlock();
+                bool ok = seal_segment(active_segment_) && open_segment(active_segment_ + 1);
+                lock.lock();
+                if (!ok && !failed_) {
+                    Logger::instance().error("Cannot roll document segment in " + dir_);
+                }
+                failed_ = failed_ || !ok;
+            }
+        }
+
+        if (stop_ && pending_.empty()) break;
+    }
+    // Callbacks still to come use this object
+    done_cv_.wait(lock, [this]() { return writing_.empty(); });
+}
+
+void DocStore::write_block(Batch& batch, size_t begin, size_t end) {
+    Segment& segment = segments_[active_segment_];
+    uint64_t offset = segment.size;
+
+    block_.clear();
+    for (size_t i = begin; i < end; i++) {
+        const Pending& page = batch.pages[i];
+        batch.locations.push_back({page.doc_id, active_segment_, static_cast<uint32_t>(offset),
+                                   static_cast<uint32_t>(block_.size()), static_cast<uint32_t>(page.record.size())});
+        block_ += page.record;
+    }
+
+    std::string_view stored = block_;
+    if (compress_) {
+        if (!zstd_) {
+            zstd_ = ZSTD_createCCtx();
+        }
+        compressed_.resize(ZSTD_compressBound(block_.size()));
+        size_t size = zstd_ ? ZSTD_compressCCtx(zstd_, compressed_.data(), compressed_.size(), block_.data(),
+                                                block_.size(), kCompressionLevel)
+                            : 0;
+        // Kept raw if it does not shrink; readers tell by the sizes
+        if (zstd_ && !ZSTD_isError(size) && size < block_.size()) {
+            stored = std::string_view(compressed_.data(), size);
+        }
+    }
+
+    std::string bytes;
+    bytes.reserve(kBlockHeaderSize + stored.size());
+    varint::put_fixed32(bytes, kBlockMagic);
+    varint::put_fixed32(bytes, static_cast<uint32_t>(stored.size()));
+    varint::put_fixed32(bytes, static_cast<uint32_t>(block_.size()));
+    varint::put_fixed32(bytes, crc(stored));
+    bytes.append(stored);
+
+    size_t total = bytes.size();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segment.size = offset + total;
+    }
+    Batch* owner = &batch; // kept alive by the sync's callback, which runs after this one
+    AsyncIo::instance().write(segment.fd, offset, std::move(bytes), [this, owner, total](int64_t result) {
+        if (result < 0) {
+            owner->failed = true;
+        } else {
+            bytes_written_ += total;
+        }
+    });
+}
+
+void DocStore::batch_synced(Batch& batch, bool ok) {
+    ok = ok && !batch.failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ok) {
+            for (const auto& location : batch.locations) {
+                insert_locked(location);
+            }
+        } else if (!failed_) {
+            Logger::instance().error("Document store write failed in " + dir_);
+        }
+        failed_ = failed_ || !ok;
+    }
+
+    for (auto& page : batch.pages) {
+        if (page.stored) {
+            page.stored(ok);
+        }
+    }
+
+    // Syncs, and so batches, complete in order
+    std::lock_guard<std::mutex> lock(mutex_);
+    written_ += batch.pages.size();
+    writing_.pop_front();
+    done_cv_.notify_all();
+}
+
+void DocStore::insert_locked(const Location& location) {
+    if (index_.empty() || index_.back().doc_id < location.doc_id) {
+        index_.push_back(location);
+        return;
+    }
+    auto it = std::lower_bound(index_.begin(), index_.end(), location.doc_id,
+                               [](const Location& entry, uint64_t doc_id) { return entry.doc_id < doc_id; });
+    if (it != index_.end() && it->doc_id == location.doc_id) {
+        *it = location;
+    } else {
+        index_.insert(it, location);
+    }
+}
+
+const DocStore::Location* DocStore::find_locked(uint64_t doc_id) const {
+    auto it = std::lower_bound(index_.begin(), index_.end(), doc_id,
+                               [](const Location& entry, uint64_t id) { return entry.doc_id < id; });
+    return it != index_.end() && it->doc_id == doc_id ? &*it : nullptr;
+}
+
+bool DocStore::read_block(uint32_t segment_id, uint32_t offset, std::string& raw) const {
+    int fd;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = segments_.find(segment_id);
+        if (it == segments_.end() || it->second.fd < 0) return false;
+        fd = it->second.fd;
+    }
+
+    char header[kBlockHeaderSize];
+    if (!pread_all(fd, header, sizeof(header), offset)) return false;
+    const uint8_t* h = reinterpret_cast<const uint8_t*>(header);
+    uint32_t stored_size = varint::get_fixed32(h + 4);
+    uint32_t raw_size = varint::get_fixed32(h + 8);
+    if (varint::get_fixed32(h) != kBlockMagic || stored_size > raw_size) return false;
+
+    thread_local std::string stored;
+    stored.resize(stored_size);
+    if (!pread_all(fd, stored.data(), stored_size, offset + kBlockHeaderSize) ||
+        varint::get_fixed32(h + 12) != crc(stored)) {
+        return false;
+    }
+    if (stored_size == raw_size) {
+        raw.swap(stored);
+        return true;
+    }
+    raw.resize(raw_size);
+    size_t size = ZSTD_decompress(raw.data(), raw_size, stored.data(), stored_size);
+    return !ZSTD_isError(size) && size == raw_size;
+}
+
+bool DocStore::read(uint64_t doc_id, StoredDocument& out) const {
+    Location location;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Not written yet: newest first, as a later append wins
+        for (auto it = pending_.rbegin(); it != pending_.rend(); ++it) {
+            if (it->doc_id == doc_id) return parse_record(it->record, out);
+        }
+        for (auto batch = writing_.rbegin(); batch != writing_.rend(); ++batch) {
+            const auto& pages = (*batch)->pages;
+            for (auto it = pages.rbegin(); it != pages.rend(); ++it) {
+                if (it->doc_id == doc_id) return parse_record(it->record, out);
+            }
+        }
+        const Location* found = find_locked(doc_id);
+        if (!found) return false;
+        location = *found;
+    }
+
+    thread_local BlockCache cache;
+    if (cache.instance != instance_ || cache.segment != location.segment ||
+        cache.offset != location.block_offset) {
+        cache.instance = 0;
+        if (!read_block(location.segment, location.block_offset, cache.raw)) return false;
+        cache.instance = instance_;
+        cache.segment = location.segment;
+        cache.offset = location.block_offset;
+    }
+    if (static_cast<uint64_t>(location.record_offset) + location.record_size > cache.raw.size()) return false;
+    return parse_record(std::string_view(cache.raw).substr(location.record_offset, location.record_size), out);
+}
+
+std::vector<uint64_t> DocStore::doc_ids() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint64_t> ids;
+    ids.reserve(index_.size() + pending_.size());
+    for (const auto& location : index_) ids.push_back(location.doc_id);
+    for (const auto& page : pending_) ids.push_back(page.doc_id);
+    for (const auto& batch : writing_) {
+        for (const auto& page : batch->pages) ids.push_back(page.doc_id);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+size_t DocStore::document_count() const {
+    return doc_ids().size();
+}
+
+size_t DocStore::segment_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.size();
+}
+
+bool DocStore::export_warc(const std::string& path) const {
+    bool gzip = path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::tm utc{};
+    gmtime_r(&now, &utc);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    std::string compressed;
+    auto write = [&](const std::string& record) {
+        if (gzip && gzip_member(record, compressed)) {
+            out.write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+        } else {
+            out.write(record.data(), static_cast<std::streamsize>(record.size()));
+        }
+    };
+    write(warc_record("warcinfo", date, "", "application/warc-fields",
+                      "software: web-crawler\r\nformat: WARC File Format 1.1\r\n", 0));
+
+    StoredDocument doc;
+    for (uint64_t doc_id : doc_ids()) {
+        if (!read(doc_id, doc)) {
+            Logger::instance().warn("Skipping unreadable document " + std::to_string(doc_id) + " in WARC export");
+            continue;
+        }
+        auto type = doc.metadata.find("content_type");
+        write(warc_record("resource", date, doc.url, type != doc.metadata.end() ? type->second : "text/html",
+                          doc.content, doc_id));
+    }
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+} // namespace crawler
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+struct ZSTD_CCtx_s;
+
+namespace crawler {
+
+// A stored page
+struct StoredDocument {
+    uint64_t doc_id = 0;
+    std::string url;
+    std::unordered_map<std::string, std::string> metadata;
+    std::string content;
+};
+
+// Rolling, append-only store of fetched pages, so millions of pages take
+// a few hundred files instead of one each.
+//
+// Pages are appended to segment files store_<id>.seg of about segment_bytes
+// in blocks of about block_bytes, zstd-compressed when that makes them
+// smaller:
+//   block     magic "DBLK", stored size, raw size, crc32 of the stored
+//             bytes (fixed32); then the stored bytes
+//   record    doc_id (fixed64), varint-length url, metadata count and
+//             varint-length key / value pairs, varint-length content
+// A sealed segment gets an index file store_<id>.idx of its doc_id ->
+// (block offset, record offset and size) entries, so opening the store
+// reads those instead of the data; only the last segment is scanned, and
+// a torn block at its end is cut off.
+//
+// append() hands the page to a writer thread that packs what is pending
+// into blocks and queues them on AsyncIo with one sync behind them, then
+// goes on packing the next pages while those are written. Pages are
+// readable as soon as append() returns. Reads pread one block, and each
+// thread keeps the last block it decompressed, so pages read in order cost
+// one decompression per block.
+class DocStore {
+public:
+    // Runs on an I/O thread once the page is durable, or its write failed
+    using StoredCallback = std::function<void(bool ok)>;
+
+    DocStore(const std::string& dir, size_t segment_bytes, size_t block_bytes, bool compress);
+    ~DocStore();
+
+    DocStore(const DocStore&) = delete;
+    DocStore& operator=(const DocStore&) = delete;
+
+    // Load the indexes and start the writer
+    bool open();
+
+    // Queue a page; a later append of the same doc_id replaces it. `stored`
+    // is called if this returns true.
+    bool append(uint64_t doc_id, std::string_view url,
+                const std::unordered_map<std::string, std::string>& metadata, std::string_view content,
+                StoredCallback stored = nullptr);
+
+    bool read(uint64_t doc_id, StoredDocument& out) const;
+
+    // Wait until everything appended so far is written and synced
+    bool flush();
+
+    // Stop the writer after writing what is pending
+    void close();
+
+    // Every doc_id, ascending
+    std::vector<uint64_t> doc_ids() const;
+
+    // Write every page as a WARC/1.1 "resource" record; per-record gzip
+    // members (the usual .warc.gz) if the path ends in ".gz"
+    bool export_warc(const std::string& path) const;
+
+    // Statistics
+    size_t document_count() const;
+    size_t segment_count() const;
+    uint64_t bytes_written() const { return bytes_written_; }
+
+private:
+    struct Location {
+        uint64_t doc_id;
+        uint32_t segment;
+        uint32_t block_offset;
+        uint32_t record_offset; // within the raw block
+        uint32_t record_size;
+    };
+
+    struct Segment {
+        int fd = -1;
+        uint64_t size = 0;
+    };
+
+    struct Pending {
+        uint64_t doc_id;
+        std::string record;
+        StoredCallback stored;
+    };
+
+    // Pages taken by the writer; read-only until synced
+    struct Batch {
+        std::vector<Pending> pages;
+        std::vector<Location> locations; // published once synced
+        std::atomic<bool> failed{false};
+    };
+
+    void writer_worker();
+    void write_block(Batch& batch, size_t begin, size_t end);
+    void batch_synced(Batch& batch, bool ok);
+    bool open_segment(uint32_t id);
+    bool seal_segment(uint32_t id);
+    bool load_index(uint32_t id, std::vector<Location>& out) const;
+    bool scan_segment(uint32_t id, std::vector<Location>& out);
+    void insert_locked(const Location& location);
+    const Location* find_locked(uint64_t doc_id) const;
+    bool read_block(uint32_t segment, uint32_t offset, std::string& raw) const;
+    std::string segment_path(uint32_t id, const char* extension) const;
+
+    std::string dir_;
+    size_t segment_bytes_;
+    size_t block_bytes_;
+    bool compress_;
+    uint64_t instance_; // tells apart stores in the per-thread block cache
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;  // wakes the writer
+    std::condition_variable done_cv_;  // signalled after every batch synced
+    std::vector<Pending> pending_;     // appended, not yet taken by the writer
+    std::deque<std::shared_ptr<Batch>> writing_; // oldest first
+    size_t pending_bytes_ = 0;
+    uint64_t appended_ = 0;             // appends so far
+    uint64_t written_ = 0;              // of those, written
+    bool flush_requested_ = false;
+    bool failed_ = false;
+    bool stop_ = false;
+    bool open_ = false;
+
+    // Sorted by doc_id; ids from the indexer arrive almost in order
+    std::vector<Location> index_;
+    std::map<uint32_t, Segment> segments_;
+    uint32_t active_segment_ = 0;
+
+    // Writer thread only; segment sizes count blocks queued, not yet written
+    std::string block_;
+    std::string compressed_;
+    ZSTD_CCtx_s* zstd_ = nullptr;
+
+    std::atomic<uint64_t> bytes_written_{0};
+    std::thread writer_thread_;
+};
+
+} // namespace crawler
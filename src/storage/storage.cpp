@@ -1,119 +1,173 @@
 #include "storage.h"
+#include "../utils/config.h"
+#include "../utils/varint.h"
+#include "../observability/logger.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <filesystem>
+#include <iterator>
 #include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace crawler {
 
-Storage::Storage(const std::string& data_dir) : data_dir_(data_dir) {
+namespace {
+
+constexpr uint32_t kCheckpointMagic = 0x504B4343; // "CCKP"
+constexpr const char* kCheckpointFile = "latest.ckpt";
+
+} // namespace
+
+Storage::Storage(const std::string& data_dir)
+    : data_dir_(data_dir),
+      docs_(data_dir + "/docs",
+            static_cast<size_t>(Config::instance().storage_doc_segment_size_mb()) * 1024 * 1024,
+            static_cast<size_t>(Config::instance().storage_doc_block_kb()) * 1024,
+            Config::instance().storage_doc_compression()) {
     std::filesystem::create_directories(data_dir);
-    std::filesystem::create_directories(data_dir + "/docs");
     std::filesystem::create_directories(data_dir + "/checkpoints");
+    if (!docs_.open()) {
+        Logger::instance().warn("Document store unavailable in " + data_dir + "/docs; pages will not be stored");
+    }
 }
 
 Storage::~Storage() = default;
 
-std::string Storage::get_document_path(uint64_t doc_id) {
-    return data_dir_ + "/docs/" + std::to_string(doc_id) + ".doc";
-}
-
 bool Storage::save_document(uint64_t doc_id, const std::string& url,
                            const std::string& content,
-                           const std::unordered_map<std::string, std::string>& metadata) {
-    std::string path = get_document_path(doc_id);
-    std::ofstream out(path);
-    if (!out.is_open()) {
-        return false;
-    }
-    
-    // Simple format: URL\nMETADATA\nCONTENT
-    out << url << "\n";
-    for (const auto& [key, value] : metadata) {
-        out << key << ":" << value << "\n";
-    }
-    out << "---\n";
-    out << content;
-    
-    return true;
+                           const std::unordered_map<std::string, std::string>& metadata,
+                           DocStore::StoredCallback stored) {
+    return docs_.append(doc_id, url, metadata, content, std::move(stored));
 }
 
 bool Storage::load_document(uint64_t doc_id, std::string& content) {
-    std::string path = get_document_path(doc_id);
-    std::ifstream in(path);
-    if (!in.is_open()) {
+    StoredDocument doc;
+    if (!docs_.read(doc_id, doc)) {
         return false;
     }
+    content = std::move(doc.content);
+    return true;
+}
+
+bool Storage::load_document(uint64_t doc_id, StoredDocument& doc) {
+    return docs_.read(doc_id, doc);
+}
+
+bool Storage::flush() {
+    return docs_.flush();
+}
+
+bool Storage::export_warc(const std::string& path) {
+    return docs_.export_warc(path);
+}
+
+bool Storage::save_checkpoint(const CrawlCheckpoint& checkpoint) {
+    std::string bytes;
+    varint::put_fixed32(bytes, kCheckpointMagic);
+    varint::put_fixed64(bytes, checkpoint.wal_lsn);
+    varint::put_fixed64(bytes, checkpoint.index_next_doc_id);
+    varint::put_fixed64(bytes, checkpoint.frontier.size());
     
-    std::string line;
-    bool in_content = false;
-    while (std::getline(in, line)) {
-        if (line == "---") {
-            in_content = true;
-            continue;
-        }
-        if (in_content) {
-            content += line + "\n";
+    // Front-coded: tasks of a host come together and share a long prefix
+    const std::string* previous = nullptr;
+    for (const auto& task : checkpoint.frontier) {
+        size_t shared = 0;
+        if (previous) {
+            size_t limit = std::min(previous->size(), task.url.size());
+            while (shared < limit && (*previous)[shared] == task.url[shared]) {
+                shared++;
+            }
         }
+        varint::put(bytes, shared);
+        varint::put(bytes, task.url.size() - shared);
+        bytes.append(task.url, shared, std::string::npos);
+        varint::put(bytes, varint::zigzag_encode(task.priority));
+        varint::put(bytes, static_cast<uint64_t>(std::max(task.retry_count, 0)));
+        previous = &task.url;
     }
+    varint::put_fixed32(bytes, static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(bytes.data()),
+                                                           static_cast<uInt>(bytes.size()))));
     
-    return true;
-}
-
-bool Storage::save_checkpoint(const std::unordered_map<std::string, std::string>& state) {
-    std::string path = data_dir_ + "/checkpoints/latest.ckpt";
-    std::ofstream out(path);
-    if (!out.is_open()) {
+    std::string dir = data_dir_ + "/checkpoints";
+    std::string path = dir + "/" + kCheckpointFile;
+    std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
         return false;
     }
-    
-    for (const auto& [key, value] : state) {
-        out << key << "=" << value << "\n";
+    bool ok = ::write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()) &&
+              fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp_path.c_str());
+        return false;
     }
     
+    // Make the rename itself durable
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        ::close(dir_fd);
+    }
     return true;
 }
 
-bool Storage::load_checkpoint(std::unordered_map<std::string, std::string>& state) {
-    std::string path = data_dir_ + "/checkpoints/latest.ckpt";
-    std::ifstream in(path);
+bool Storage::load_checkpoint(CrawlCheckpoint& checkpoint) {
+    std::ifstream in(data_dir_ + "/checkpoints/" + kCheckpointFile, std::ios::binary);
     if (!in.is_open()) {
         return false;
     }
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 32) {
+        return false;
+    }
+    
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(bytes.data());
+    const uint8_t* end = p + bytes.size() - 4;
+    uint32_t crc = static_cast<uint32_t>(crc32(0L, p, static_cast<uInt>(end - p)));
+    if (varint::get_fixed32(p) != kCheckpointMagic || varint::get_fixed32(end) != crc) {
+        return false;
+    }
+    
+    CrawlCheckpoint loaded;
+    loaded.wal_lsn = varint::get_fixed64(p + 4);
+    loaded.index_next_doc_id = varint::get_fixed64(p + 12);
+    uint64_t count = varint::get_fixed64(p + 20);
+    p += 28;
     
-    std::string line;
-    while (std::getline(in, line)) {
-        size_t pos = line.find('=');
-        if (pos != std::string::npos) {
-            std::string key = line.substr(0, pos);
-            std::string value = line.substr(pos + 1);
-            state[key] = value;
+    std::string url;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t shared, suffix, priority, retries;
+        p = varint::get(p, end, shared);
+        if (p) p = varint::get(p, end, suffix);
+        if (!p || shared > url.size() || suffix > static_cast<uint64_t>(end - p)) {
+            return false;
         }
+        url.resize(shared);
+        url.append(reinterpret_cast<const char*>(p), suffix);
+        p += suffix;
+        p = varint::get(p, end, priority);
+        if (p) p = varint::get(p, end, retries);
+        if (!p) {
+            return false;
+        }
+        
+        CrawlTask task;
+        task.url = url;
+        task.priority = static_cast<int>(varint::zigzag_decode(priority));
+        task.retry_count = static_cast<int>(retries);
+        loaded.frontier.push_back(std::move(task));
     }
     
+    checkpoint = std::move(loaded);
     return true;
 }
 
 std::vector<uint64_t> Storage::list_documents() {
-    std::vector<uint64_t> doc_ids;
-    std::string docs_dir = data_dir_ + "/docs";
-    
-    if (!std::filesystem::exists(docs_dir)) {
-        return doc_ids;
-    }
-    
-    for (const auto& entry : std::filesystem::directory_iterator(docs_dir)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".doc") {
-            std::string filename = entry.path().stem().string();
-            try {
-                uint64_t doc_id = std::stoull(filename);
-                doc_ids.push_back(doc_id);
-            } catch (...) {
-                // Skip invalid filenames
-            }
-        }
-    }
-    
-    return doc_ids;
+    return docs_.doc_ids();
 }
 
 } // namespace crawler
@@ -3,34 +3,54 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <cstdint>
+#include "../scheduler/crawl_task.h"
+#include "doc_store.h"
 
 namespace crawler {
 
+// Crawl state as of a write-ahead log position (see CrawlJournal)
+struct CrawlCheckpoint {
+    uint64_t wal_lsn = 0;            // replay the log from here
+    uint64_t index_next_doc_id = 0;  // documents below it were in index segment files
+    std::vector<CrawlTask> frontier; // queued and in-flight tasks
+};
+
 class Storage {
 public:
     Storage(const std::string& data_dir);
     ~Storage();
     
-    // Save document
+    // Save document to the packed store under data_dir/docs; readable at
+    // once, durable after flush() or when `stored` is called
     bool save_document(uint64_t doc_id, const std::string& url, 
                       const std::string& content, 
-                      const std::unordered_map<std::string, std::string>& metadata);
+                      const std::unordered_map<std::string, std::string>& metadata,
+                      DocStore::StoredCallback stored = nullptr);
     
     // Load document
     bool load_document(uint64_t doc_id, std::string& content);
+    bool load_document(uint64_t doc_id, StoredDocument& doc);
+    
+    // Wait until every saved document is written and synced
+    bool flush();
+    
+    // Export every document as WARC/1.1, gzipped per record for ".gz" paths
+    bool export_warc(const std::string& path);
     
-    // Save checkpoint
-    bool save_checkpoint(const std::unordered_map<std::string, std::string>& state);
+    // Save checkpoint: binary, fsynced and renamed over the previous one,
+    // so a crash leaves either the old or the new checkpoint
+    bool save_checkpoint(const CrawlCheckpoint& checkpoint);
     
-    // Load checkpoint
-    bool load_checkpoint(std::unordered_map<std::string, std::string>& state);
+    // Load checkpoint; false if there is none or it fails its checksum
+    bool load_checkpoint(CrawlCheckpoint& checkpoint);
     
     // List all documents
     std::vector<uint64_t> list_documents();
 
 private:
     std::string data_dir_;
-    std::string get_document_path(uint64_t doc_id);
+    DocStore docs_;
 };
 
 } // namespace crawler
@@ -0,0 +1,334 @@
+#include "wal.h"
+#include "async_io.h"
+#include "../utils/varint.h"
+#include "../observability/logger.h"
+#include <zlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace crawler {
+
+namespace {
+
+constexpr size_t kRecordHeaderSize = 17; // length, crc, type, lsn
+
+// Commit early rather than let the buffer grow past this between windows
+constexpr size_t kEagerCommitBytes = 1 << 20;
+
+uint32_t record_crc(const uint8_t* type_and_lsn, std::string_view payload) {
+    uLong crc = crc32(0L, type_and_lsn, 9);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(payload.data()), static_cast<uInt>(payload.size()));
+    return static_cast<uint32_t>(crc);
+}
+
+// Parse the record at p; false at the end of the data or a torn / corrupt record
+bool read_record(const uint8_t*& p, const uint8_t* end, uint8_t& type, uint64_t& lsn,
+                 std::string_view& payload) {
+    if (static_cast<size_t>(end - p) < kRecordHeaderSize) return false;
+    uint32_t length = varint::get_fixed32(p);
+    if (length > static_cast<size_t>(end - p) - kRecordHeaderSize) return false;
+    payload = std::string_view(reinterpret_cast<const char*>(p + kRecordHeaderSize), length);
+    if (varint::get_fixed32(p + 4) != record_crc(p + 8, payload)) return false;
+    type = p[8];
+    lsn = varint::get_fixed64(p + 9);
+    p += kRecordHeaderSize + length;
+    return true;
+}
+
+bool read_file(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+// A new file's directory entry has to be synced too to survive a crash
+void sync_dir(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+    fsync(fd);
+    ::close(fd);
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& dir, size_t segment_bytes, int group_commit_ms)
+    : dir_(dir), segment_bytes_(segment_bytes), group_commit_ms_(group_commit_ms) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+std::string WriteAheadLog::segment_path(uint64_t first_lsn) const {
+    char name[40];
+    std::snprintf(name, sizeof(name), "/wal_%020llu.log", static_cast<unsigned long long>(first_lsn));
+    return dir_ + name;
+}
+
+bool WriteAheadLog::open() {
+    if (commit_thread_.joinable()) return true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        unsigned long long first_lsn = 0;
+        std::string file = entry.path().filename().string();
+        if (std::sscanf(file.c_str(), "wal_%llu.log", &first_lsn) == 1 && first_lsn > 0) {
+            segments_[first_lsn] = entry.path().string();
+        }
+    }
+    if (ec) {
+        Logger::instance().error("Cannot read write-ahead log directory " + dir_);
+        return false;
+    }
+
+    if (!segments_.empty()) {
+        auto last = std::prev(segments_.end());
+        if (!recover_tail(last->second, last->first)) {
+            return false;
+        }
+    }
+    durable_lsn_ = next_lsn_;
+    stop_ = false;
+    commit_thread_ = std::thread(&WriteAheadLog::commit_worker, this);
+    return true;
+}
+
+bool WriteAheadLog::recover_tail(const std::string& path, uint64_t first_lsn) {
+    std::string bytes;
+    if (!read_file(path, bytes)) {
+        Logger::instance().error("Cannot read write-ahead log segment " + path);
+        return false;
+    }
+
+    const uint8_t* begin = reinterpret_cast<const uint8_t*>(bytes.data());
+    const uint8_t* p = begin;
+    const uint8_t* end = begin + bytes.size();
+    uint64_t expected = first_lsn;
+    uint8_t type;
+    uint64_t lsn;
+    std::string_view payload;
+    const uint8_t* record = p;
+    while (read_record(p, end, type, lsn, payload) && lsn == expected) {
+        record = p;
+        expected++;
+    }
+    size_t valid = static_cast<size_t>(record - begin);
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd_ < 0) return false;
+    if (valid < bytes.size()) {
+        // Whatever the crash left half-written; nothing after it was acknowledged
+        Logger::instance().warn("Truncating write-ahead log " + path + " at byte " + std::to_string(valid));
+        if (ftruncate(fd_, static_cast<off_t>(valid)) != 0 || fdatasync(fd_) != 0) {
+            return false;
+        }
+    }
+    segment_size_ = valid;
+    next_lsn_ = expected;
+    return true;
+}
+
+void WriteAheadLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    commit_cv_.notify_one();
+    if (commit_thread_.joinable()) {
+        commit_thread_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+uint64_t WriteAheadLog::append(uint8_t type, std::string_view payload) {
+    uint8_t type_and_lsn[9];
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t lsn = next_lsn_++;
+    if (buffer_.empty()) {
+        buffer_first_lsn_ = lsn;
+    }
+
+    type_and_lsn[0] = type;
+    for (int i = 0; i < 8; i++) {
+        type_and_lsn[1 + i] = static_cast<uint8_t>(lsn >> (8 * i));
+    }
+    varint::put_fixed32(buffer_, static_cast<uint32_t>(payload.size()));
+    varint::put_fixed32(buffer_, record_crc(type_and_lsn, payload));
+    buffer_.append(reinterpret_cast<const char*>(type_and_lsn), sizeof(type_and_lsn));
+    buffer_.append(payload);
+
+    if (group_commit_ms_ <= 0 || buffer_.size() >= kEagerCommitBytes) {
+        commit_cv_.notify_one();
+    }
+    return lsn;
+}
+
+bool WriteAheadLog::sync(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!commit_thread_.joinable()) return false;
+    if (lsn >= durable_lsn_) {
+        sync_requested_ = true;
+        commit_cv_.notify_one();
+        durable_cv_.wait(lock, [&]() { return durable_lsn_ > lsn || stop_; });
+    }
+    return durable_lsn_ > lsn && !failed_;
+}
+
+void WriteAheadLog::commit_worker() {
+    auto interval = std::chrono::milliseconds(std::max(group_commit_ms_, 1));
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        commit_cv_.wait_for(lock, interval, [&]() {
+            return stop_ || sync_requested_ || buffer_.size() >= kEagerCommitBytes ||
+                   (group_commit_ms_ <= 0 && !buffer_.empty());
+        });
+        sync_requested_ = false;
+
+        if (!buffer_.empty()) {
+            std::string batch;
+            batch.swap(buffer_);
+            uint64_t first_lsn = buffer_first_lsn_;
+            uint64_t end_lsn = next_lsn_;
+
+            // The old segment is closed once everything sent to it is in
+            if (fd_ < 0 || segment_size_ >= segment_bytes_) {
+                durable_cv_.wait(lock, [&]() { return durable_lsn_ == first_lsn; });
+            }
+
+            // Appends go on into buffer_ while this batch is written
+            lock.unlock();
+            bool ok = write_batch(std::move(batch), first_lsn, end_lsn);
+            lock.lock();
+
+            if (!ok) {
+                if (!failed_) {
+                    Logger::instance().error("Write-ahead log commit failed in " + dir_);
+                }
+                failed_ = true;
+                durable_lsn_ = end_lsn;
+                durable_cv_.notify_all();
+            }
+        }
+
+        if (stop_ && buffer_.empty()) break;
+    }
+    // The callbacks of commits in flight use this object
+    durable_cv_.wait(lock, [&]() { return durable_lsn_ == next_lsn_; });
+    durable_cv_.notify_all();
+}
+
+bool WriteAheadLog::write_batch(std::string batch, uint64_t first_lsn, uint64_t end_lsn) {
+    if (fd_ < 0 || segment_size_ >= segment_bytes_) {
+        if (!open_segment(first_lsn)) return false;
+    }
+
+    // The sync starts after the write completes, and so do its callbacks
+    auto& io = AsyncIo::instance();
+    auto written = std::make_shared<std::atomic<bool>>(false);
+    size_t size = batch.size();
+    io.write(fd_, segment_size_, std::move(batch), [this, written, size](int64_t result) {
+        if (result >= 0) {
+            bytes_written_ += size;
+            *written = true;
+        }
+    });
+    io.sync(fd_, [this, written, end_lsn](int64_t result) {
+        bool ok = result >= 0 && *written;
+        if (ok) {
+            commits_++;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ok && !failed_) {
+            Logger::instance().error("Write-ahead log commit failed in " + dir_);
+        }
+        failed_ = failed_ || !ok;
+        durable_lsn_ = end_lsn;
+        durable_cv_.notify_all();
+    });
+    segment_size_ += size;
+    return true;
+}
+
+bool WriteAheadLog::open_segment(uint64_t first_lsn) {
+    std::string path = segment_path(first_lsn);
+    int fd = ::open(path.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    sync_dir(dir_);
+
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = fd;
+    segment_size_ = 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_[first_lsn] = path;
+    return true;
+}
+
+bool WriteAheadLog::replay(uint64_t from_lsn, const ReplayFn& fn) {
+    std::map<uint64_t, std::string> segments;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segments = segments_;
+    }
+
+    std::string bytes;
+    for (auto it = segments.begin(); it != segments.end(); ++it) {
+        // Skip segments that end before from_lsn
+        auto next = std::next(it);
+        if (next != segments.end() && next->first <= from_lsn) continue;
+
+        if (!read_file(it->second, bytes)) {
+            Logger::instance().error("Cannot read write-ahead log segment " + it->second);
+            return false;
+        }
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(bytes.data());
+        const uint8_t* end = p + bytes.size();
+        uint8_t type;
+        uint64_t lsn;
+        std::string_view payload;
+        while (read_record(p, end, type, lsn, payload)) {
+            if (lsn >= from_lsn) fn(type, lsn, payload);
+        }
+        if (p != end) {
+            // Only the last segment can have a bad tail, and open() cut that off
+            Logger::instance().error("Corrupt write-ahead log segment " + it->second);
+            return false;
+        }
+    }
+    return true;
+}
+
+void WriteAheadLog::truncate(uint64_t lsn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A segment's records all precede the next segment's first LSN; the
+    // last segment is the one being appended to and always stays
+    while (segments_.size() > 1 && std::next(segments_.begin())->first <= lsn) {
+        std::remove(segments_.begin()->second.c_str());
+        segments_.erase(segments_.begin());
+    }
+}
+
+uint64_t WriteAheadLog::next_lsn() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_lsn_;
+}
+
+size_t WriteAheadLog::segment_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.size();
+}
+
+} // namespace crawler
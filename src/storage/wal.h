@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+namespace crawler {
+
+// Append-only, group-committed write-ahead log.
+//
+// append() only copies a record into a buffer and hands back its log
+// sequence number (LSN). Every group_commit_ms a committer thread hands
+// whatever is buffered to AsyncIo as one write and one fdatasync, and goes
+// on to the next batch while they complete. The cost of a sync is shared
+// by every record in the batch, and a crash loses at most the records of
+// the last few windows. sync() waits for a record to be durable, for the
+// callers that cannot accept that.
+//
+// The log is a run of segment files wal_<first LSN>.log. Records:
+//   payload length (fixed32), crc32 of the rest (fixed32), type (1 byte),
+//   LSN (fixed64), payload
+// A torn or corrupt record marks the end of the log; open() cuts it and
+// anything after it off. truncate() drops segments a checkpoint covers.
+class WriteAheadLog {
+public:
+    using ReplayFn = std::function<void(uint8_t type, uint64_t lsn, std::string_view payload)>;
+
+    WriteAheadLog(const std::string& dir, size_t segment_bytes, int group_commit_ms);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Find the end of the existing log and start the committer
+    bool open();
+
+    // Commit what is buffered and stop the committer
+    void close();
+
+    // Buffer a record; returns its LSN
+    uint64_t append(uint8_t type, std::string_view payload);
+
+    // Wait until the record at `lsn` is on disk; false if writing failed
+    bool sync(uint64_t lsn);
+
+    // Call fn for every record with LSN >= from_lsn, in order. Only valid
+    // before anything is appended.
+    bool replay(uint64_t from_lsn, const ReplayFn& fn);
+
+    // Delete the segments holding only records below `lsn`
+    void truncate(uint64_t lsn);
+
+    // LSN the next append() gets
+    uint64_t next_lsn() const;
+
+    // Statistics
+    uint64_t bytes_written() const { return bytes_written_; }
+    uint64_t commits() const { return commits_; }
+    size_t segment_count() const;
+
+private:
+    void commit_worker();
+    bool write_batch(std::string batch, uint64_t first_lsn, uint64_t end_lsn);
+    bool open_segment(uint64_t first_lsn);
+    bool recover_tail(const std::string& path, uint64_t first_lsn);
+    std::string segment_path(uint64_t first_lsn) const;
+
+    std::string dir_;
+    size_t segment_bytes_;
+    int group_commit_ms_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable commit_cv_;  // wakes the committer early
+    std::condition_variable durable_cv_; // signalled after every commit
+    std::string buffer_;                 // records not yet handed to the committer
+    uint64_t buffer_first_lsn_ = 0;
+    uint64_t next_lsn_ = 1;
+    uint64_t durable_lsn_ = 1; // every record below it is on disk (or failed)
+    bool sync_requested_ = false;
+    bool failed_ = false;
+    bool stop_ = false;
+
+    // Segments by first LSN; the last one is appended to. Only the
+    // committer writes, so fd_ and segment_size_ are its own.
+    std::map<uint64_t, std::string> segments_;
+    int fd_ = -1;
+    uint64_t segment_size_ = 0;
+
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> commits_{0};
+    std::thread commit_thread_;
+};
+
+} // namespace crawler
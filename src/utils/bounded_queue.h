@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace crawler {
+
+enum class BackpressureStrategy {
+    BLOCK,  // Producer waits until a slot frees up
+    DROP    // Producer gets false back and the item is discarded
+};
+
+inline BackpressureStrategy parse_backpressure_strategy(const std::string& name) {
+    return name == "drop" ? BackpressureStrategy::DROP : BackpressureStrategy::BLOCK;
+}
+
+// Multi-producer / multi-consumer FIFO with a fixed capacity.
+// Used between pipeline stages so a slow stage pushes back on the one before it.
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity, BackpressureStrategy strategy)
+        : capacity_(capacity == 0 ? 1 : capacity), strategy_(strategy) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Returns false if the item was dropped (DROP strategy, queue full) or the queue is closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (strategy_ == BackpressureStrategy::BLOCK) {
+            not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        }
+        if (closed_ || items_.size() >= capacity_) {
+            dropped_++;
+            return false;
+        }
+        items_.push_back(std::move(item));
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Never waits, whatever the strategy: false if the queue is full or
+    // closed, and `item` is then left untouched for the caller
+    bool try_push(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_ || items_.size() >= capacity_) {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available; returns false once closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    // Wake all waiters; pending items can still be popped
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+    size_t capacity() const { return capacity_; }
+    BackpressureStrategy strategy() const { return strategy_; }
+    size_t dropped() const { return dropped_; }
+
+private:
+    std::deque<T> items_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+
+    const size_t capacity_;
+    const BackpressureStrategy strategy_;
+    bool closed_ = false;
+    std::atomic<size_t> dropped_{0};
+};
+
+} // namespace crawler
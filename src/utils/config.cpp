@@ -22,6 +22,24 @@ bool Config::load(const std::string& config_path) {
             if (sched["queue_size"]) scheduler_queue_size_ = sched["queue_size"].as<int>();
             if (sched["max_retries"]) scheduler_max_retries_ = sched["max_retries"].as<int>();
             if (sched["retry_backoff_ms"]) scheduler_retry_backoff_ms_ = sched["retry_backoff_ms"].as<int>();
+            if (sched["backpressure_strategy"]) scheduler_backpressure_strategy_ = sched["backpressure_strategy"].as<std::string>();
+        }
+        
+        // Pipeline
+        if (config["pipeline"]) {
+            auto pipe = config["pipeline"];
+            if (pipe["parse_workers"]) pipeline_parse_workers_ = pipe["parse_workers"].as<int>();
+            if (pipe["index_workers"]) pipeline_index_workers_ = pipe["index_workers"].as<int>();
+            if (pipe["storage_workers"]) pipeline_storage_workers_ = pipe["storage_workers"].as<int>();
+        }
+        
+        // Frontier
+        if (config["frontier"]) {
+            auto front = config["frontier"];
+            if (front["spill_to_disk"]) frontier_spill_to_disk_ = front["spill_to_disk"].as<bool>();
+            if (front["head_per_host"]) frontier_head_per_host_ = front["head_per_host"].as<size_t>();
+            if (front["max_memory_mb"]) frontier_max_memory_mb_ = front["max_memory_mb"].as<int64_t>();
+            if (front["segment_size_mb"]) frontier_segment_size_mb_ = front["segment_size_mb"].as<int64_t>();
         }
         
         // Fetcher
@@ -31,6 +49,14 @@ bool Config::load(const std::string& config_path) {
             if (fetch["read_timeout_ms"]) fetcher_read_timeout_ms_ = fetch["read_timeout_ms"].as<int>();
             if (fetch["max_redirects"]) fetcher_max_redirects_ = fetch["max_redirects"].as<int>();
             if (fetch["user_agent"]) fetcher_user_agent_ = fetch["user_agent"].as<std::string>();
+            if (fetch["verify_tls"]) fetcher_verify_tls_ = fetch["verify_tls"].as<bool>();
+            if (fetch["async"]) fetcher_async_ = fetch["async"].as<bool>();
+            if (fetch["max_in_flight"]) fetcher_max_in_flight_ = fetch["max_in_flight"].as<size_t>();
+            if (fetch["max_host_connections"]) fetcher_max_host_connections_ = fetch["max_host_connections"].as<long>();
+            if (fetch["max_total_connections"]) fetcher_max_total_connections_ = fetch["max_total_connections"].as<long>();
+            if (fetch["streaming"]) fetcher_streaming_ = fetch["streaming"].as<bool>();
+            if (fetch["max_body_mb"]) fetcher_max_body_bytes_ = fetch["max_body_mb"].as<size_t>() * 1024 * 1024;
+            if (fetch["html_only"]) fetcher_html_only_ = fetch["html_only"].as<bool>();
         }
         
         // Rate limit
@@ -39,7 +65,12 @@ bool Config::load(const std::string& config_path) {
             if (rl["enabled"]) rate_limit_enabled_ = rl["enabled"].as<bool>();
             if (rl["per_domain"]) {
                 for (const auto& item : rl["per_domain"]) {
-                    rate_limit_per_domain_[item.first.as<std::string>()] = item.second.as<int>();
+                    std::string domain = item.first.as<std::string>();
+                    if (domain == "default") {
+                        rate_limit_default_ = item.second.as<int>();
+                    } else {
+                        rate_limit_per_domain_[domain] = item.second.as<int>();
+                    }
                 }
             }
             if (rl["default"]) rate_limit_default_ = rl["default"].as<int>();
@@ -51,6 +82,50 @@ bool Config::load(const std::string& config_path) {
             if (redis["host"]) redis_host_ = redis["host"].as<std::string>();
             if (redis["port"]) redis_port_ = redis["port"].as<int>();
             if (redis["connection_pool_size"]) redis_connection_pool_size_ = redis["connection_pool_size"].as<int>();
+            if (redis["timeout_ms"]) redis_timeout_ms_ = redis["timeout_ms"].as<int>();
+            if (redis["db"]) redis_db_ = redis["db"].as<int>();
+            if (redis["password"]) redis_password_ = redis["password"].as<std::string>();
+        }
+        
+        // Dedup
+        if (config["dedup"]) {
+            auto dedup = config["dedup"];
+            if (dedup["redis_ttl_seconds"]) dedup_redis_ttl_seconds_ = dedup["redis_ttl_seconds"].as<int>();
+            if (dedup["url_filter_enabled"]) dedup_url_filter_enabled_ = dedup["url_filter_enabled"].as<bool>();
+            if (dedup["expected_urls"]) dedup_expected_urls_ = dedup["expected_urls"].as<size_t>();
+            if (dedup["url_filter_fp_rate"]) dedup_url_filter_fp_rate_ = dedup["url_filter_fp_rate"].as<double>();
+            if (dedup["near_dup_enabled"]) dedup_near_dup_enabled_ = dedup["near_dup_enabled"].as<bool>();
+            if (dedup["near_dup_max_distance"]) dedup_near_dup_max_distance_ = dedup["near_dup_max_distance"].as<int>();
+            if (dedup["near_dup_shingle_size"]) dedup_near_dup_shingle_size_ = dedup["near_dup_shingle_size"].as<size_t>();
+            if (dedup["near_dup_min_tokens"]) dedup_near_dup_min_tokens_ = dedup["near_dup_min_tokens"].as<size_t>();
+        }
+        
+        // Indexer
+        if (config["indexer"]) {
+            auto index = config["indexer"];
+            if (index["segment_size_mb"]) indexer_segment_size_mb_ = index["segment_size_mb"].as<int>();
+            if (index["max_docs_per_segment"]) indexer_max_docs_per_segment_ = index["max_docs_per_segment"].as<int>();
+            if (index["merge_threshold"]) indexer_merge_threshold_ = index["merge_threshold"].as<int>();
+            if (index["merge_mb_per_sec"]) indexer_merge_mb_per_sec_ = index["merge_mb_per_sec"].as<int>();
+            if (index["refresh_interval_ms"]) indexer_refresh_interval_ms_ = index["refresh_interval_ms"].as<int>();
+            if (index["proximity_weight"]) indexer_proximity_weight_ = index["proximity_weight"].as<double>();
+        }
+        
+        // Storage
+        if (config["storage"]) {
+            auto store = config["storage"];
+            if (store["data_dir"]) storage_data_dir_ = store["data_dir"].as<std::string>();
+            if (store["index_dir"]) storage_index_dir_ = store["index_dir"].as<std::string>();
+            if (store["checkpoint_interval_seconds"]) storage_checkpoint_interval_seconds_ = store["checkpoint_interval_seconds"].as<int>();
+            if (store["wal_group_commit_ms"]) storage_wal_group_commit_ms_ = store["wal_group_commit_ms"].as<int>();
+            if (store["wal_segment_size_mb"]) storage_wal_segment_size_mb_ = store["wal_segment_size_mb"].as<int>();
+            if (store["doc_segment_size_mb"]) storage_doc_segment_size_mb_ = store["doc_segment_size_mb"].as<int>();
+            if (store["doc_block_kb"]) storage_doc_block_kb_ = store["doc_block_kb"].as<int>();
+            if (store["doc_compression"]) storage_doc_compression_ = store["doc_compression"].as<bool>();
+            if (store["io_uring"]) storage_io_uring_ = store["io_uring"].as<bool>();
+            if (store["io_queue_depth"]) storage_io_queue_depth_ = store["io_queue_depth"].as<int>();
+            if (store["io_max_inflight_mb"]) storage_io_max_inflight_mb_ = store["io_max_inflight_mb"].as<int>();
+            if (store["io_threads"]) storage_io_threads_ = store["io_threads"].as<int>();
         }
         
         // API
@@ -59,6 +134,26 @@ bool Config::load(const std::string& config_path) {
             if (api["host"]) api_host_ = api["host"].as<std::string>();
             if (api["port"]) api_port_ = api["port"].as<int>();
             if (api["threads"]) api_threads_ = api["threads"].as<int>();
+            if (api["search_cache_mb"]) api_search_cache_mb_ = api["search_cache_mb"].as<int>();
+            if (api["max_results"]) api_max_results_ = api["max_results"].as<int>();
+        }
+        
+        // Logging
+        if (config["observability"] && config["observability"]["logging"]) {
+            auto logging = config["observability"]["logging"];
+            if (logging["level"]) logging_level_ = logging["level"].as<std::string>();
+            if (logging["format"]) logging_format_ = logging["format"].as<std::string>();
+            if (logging["output"]) logging_output_ = logging["output"].as<std::string>();
+            if (logging["file_path"]) logging_file_path_ = logging["file_path"].as<std::string>();
+            if (logging["buffer_kb"]) logging_buffer_kb_ = logging["buffer_kb"].as<int>();
+            if (logging["overflow"]) logging_overflow_ = logging["overflow"].as<std::string>();
+        }
+        
+        // Tracing
+        if (config["observability"] && config["observability"]["tracing"]) {
+            auto tracing = config["observability"]["tracing"];
+            if (tracing["slow_task_ms"]) tracing_slow_task_ms_ = tracing["slow_task_ms"].as<int>();
+            if (tracing["slow_task_samples"]) tracing_slow_task_samples_ = tracing["slow_task_samples"].as<int>();
         }
         
         // Memory
@@ -75,9 +170,16 @@ bool Config::load(const std::string& config_path) {
 }
 
 int Config::rate_limit_per_domain(const std::string& domain) const {
-    auto it = rate_limit_per_domain_.find(domain);
-    if (it != rate_limit_per_domain_.end()) {
-        return it->second;
+    // Exact host first, then parent domains (www.github.com -> github.com)
+    std::string candidate = domain;
+    while (!candidate.empty()) {
+        auto it = rate_limit_per_domain_.find(candidate);
+        if (it != rate_limit_per_domain_.end()) {
+            return it->second;
+        }
+        size_t dot = candidate.find('.');
+        if (dot == std::string::npos) break;
+        candidate = candidate.substr(dot + 1);
     }
     return rate_limit_default_;
 }
@@ -18,12 +18,32 @@ public:
     int scheduler_queue_size() const { return scheduler_queue_size_; }
     int scheduler_max_retries() const { return scheduler_max_retries_; }
     int scheduler_retry_backoff_ms() const { return scheduler_retry_backoff_ms_; }
+    std::string scheduler_backpressure_strategy() const { return scheduler_backpressure_strategy_; }
+    
+    // Pipeline (fetch stage runs on the scheduler worker threads)
+    int pipeline_parse_workers() const { return pipeline_parse_workers_; }
+    int pipeline_index_workers() const { return pipeline_index_workers_; }
+    int pipeline_storage_workers() const { return pipeline_storage_workers_; }
+    
+    // Frontier (spills per-host queue tails to disk past max_memory_mb)
+    bool frontier_spill_to_disk() const { return frontier_spill_to_disk_; }
+    size_t frontier_head_per_host() const { return frontier_head_per_host_; }
+    int64_t frontier_max_memory_mb() const { return frontier_max_memory_mb_; }
+    int64_t frontier_segment_size_mb() const { return frontier_segment_size_mb_; }
     
     // Fetcher
     int fetcher_connect_timeout_ms() const { return fetcher_connect_timeout_ms_; }
     int fetcher_read_timeout_ms() const { return fetcher_read_timeout_ms_; }
     int fetcher_max_redirects() const { return fetcher_max_redirects_; }
     std::string fetcher_user_agent() const { return fetcher_user_agent_; }
+    bool fetcher_verify_tls() const { return fetcher_verify_tls_; }
+    bool fetcher_async() const { return fetcher_async_; }
+    size_t fetcher_max_in_flight() const { return fetcher_max_in_flight_; }
+    long fetcher_max_host_connections() const { return fetcher_max_host_connections_; }
+    long fetcher_max_total_connections() const { return fetcher_max_total_connections_; }
+    bool fetcher_streaming() const { return fetcher_streaming_; }
+    size_t fetcher_max_body_bytes() const { return fetcher_max_body_bytes_; }
+    bool fetcher_html_only() const { return fetcher_html_only_; }
     
     // Rate limit
     bool rate_limit_enabled() const { return rate_limit_enabled_; }
@@ -33,11 +53,60 @@ public:
     std::string redis_host() const { return redis_host_; }
     int redis_port() const { return redis_port_; }
     int redis_connection_pool_size() const { return redis_connection_pool_size_; }
+    int redis_timeout_ms() const { return redis_timeout_ms_; }
+    int redis_db() const { return redis_db_; }
+    std::string redis_password() const { return redis_password_; }
+    
+    // Dedup
+    int dedup_redis_ttl_seconds() const { return dedup_redis_ttl_seconds_; }
+    bool dedup_url_filter_enabled() const { return dedup_url_filter_enabled_; }
+    size_t dedup_expected_urls() const { return dedup_expected_urls_; }
+    double dedup_url_filter_fp_rate() const { return dedup_url_filter_fp_rate_; }
+    bool dedup_near_dup_enabled() const { return dedup_near_dup_enabled_; }
+    int dedup_near_dup_max_distance() const { return dedup_near_dup_max_distance_; }
+    size_t dedup_near_dup_shingle_size() const { return dedup_near_dup_shingle_size_; }
+    size_t dedup_near_dup_min_tokens() const { return dedup_near_dup_min_tokens_; }
+    
+    // Indexer
+    int indexer_segment_size_mb() const { return indexer_segment_size_mb_; }
+    int indexer_max_docs_per_segment() const { return indexer_max_docs_per_segment_; }
+    int indexer_merge_threshold() const { return indexer_merge_threshold_; }
+    int indexer_merge_mb_per_sec() const { return indexer_merge_mb_per_sec_; }
+    int indexer_refresh_interval_ms() const { return indexer_refresh_interval_ms_; }
+    double indexer_proximity_weight() const { return indexer_proximity_weight_; }
+    
+    // Storage
+    std::string storage_data_dir() const { return storage_data_dir_; }
+    std::string storage_index_dir() const { return storage_index_dir_; }
+    int storage_checkpoint_interval_seconds() const { return storage_checkpoint_interval_seconds_; }
+    int storage_wal_group_commit_ms() const { return storage_wal_group_commit_ms_; }
+    int storage_wal_segment_size_mb() const { return storage_wal_segment_size_mb_; }
+    int storage_doc_segment_size_mb() const { return storage_doc_segment_size_mb_; }
+    int storage_doc_block_kb() const { return storage_doc_block_kb_; }
+    bool storage_doc_compression() const { return storage_doc_compression_; }
+    bool storage_io_uring() const { return storage_io_uring_; }
+    int storage_io_queue_depth() const { return storage_io_queue_depth_; }
+    int storage_io_max_inflight_mb() const { return storage_io_max_inflight_mb_; }
+    int storage_io_threads() const { return storage_io_threads_; }
     
     // API
     std::string api_host() const { return api_host_; }
     int api_port() const { return api_port_; }
     int api_threads() const { return api_threads_; }
+    int api_search_cache_mb() const { return api_search_cache_mb_; }
+    int api_max_results() const { return api_max_results_; }
+    
+    // Logging (overflow: what a thread does when its log buffer is full)
+    std::string logging_level() const { return logging_level_; }
+    std::string logging_format() const { return logging_format_; }
+    std::string logging_output() const { return logging_output_; }
+    std::string logging_file_path() const { return logging_file_path_; }
+    int logging_buffer_kb() const { return logging_buffer_kb_; }
+    std::string logging_overflow() const { return logging_overflow_; }
+    
+    // Tracing (tasks slower than slow_task_ms are kept for /debug/pipeline)
+    int tracing_slow_task_ms() const { return tracing_slow_task_ms_; }
+    int tracing_slow_task_samples() const { return tracing_slow_task_samples_; }
     
     // Memory
     int64_t max_memory_mb() const { return max_memory_mb_; }
@@ -50,11 +119,29 @@ private:
     int scheduler_queue_size_ = 10000;
     int scheduler_max_retries_ = 3;
     int scheduler_retry_backoff_ms_ = 1000;
+    std::string scheduler_backpressure_strategy_ = "block";
+    
+    int pipeline_parse_workers_ = 4;
+    int pipeline_index_workers_ = 2;
+    int pipeline_storage_workers_ = 2;
+    
+    bool frontier_spill_to_disk_ = true;
+    size_t frontier_head_per_host_ = 64;
+    int64_t frontier_max_memory_mb_ = 256;
+    int64_t frontier_segment_size_mb_ = 64;
     
     int fetcher_connect_timeout_ms_ = 5000;
     int fetcher_read_timeout_ms_ = 10000;
     int fetcher_max_redirects_ = 5;
     std::string fetcher_user_agent_ = "WebCrawler/1.0";
+    bool fetcher_verify_tls_ = true;
+    bool fetcher_async_ = true;
+    size_t fetcher_max_in_flight_ = 1000;
+    long fetcher_max_host_connections_ = 6;
+    long fetcher_max_total_connections_ = 512;
+    bool fetcher_streaming_ = false;
+    size_t fetcher_max_body_bytes_ = 10 * 1024 * 1024;
+    bool fetcher_html_only_ = true;
     
     bool rate_limit_enabled_ = true;
     std::unordered_map<std::string, int> rate_limit_per_domain_;
@@ -63,10 +150,54 @@ private:
     std::string redis_host_ = "localhost";
     int redis_port_ = 6379;
     int redis_connection_pool_size_ = 10;
+    int redis_timeout_ms_ = 1000;
+    int redis_db_ = 0;
+    std::string redis_password_;
+    
+    int dedup_redis_ttl_seconds_ = 86400;
+    bool dedup_url_filter_enabled_ = true;
+    size_t dedup_expected_urls_ = 10000000;
+    double dedup_url_filter_fp_rate_ = 0.01;
+    bool dedup_near_dup_enabled_ = true;
+    int dedup_near_dup_max_distance_ = 3;
+    size_t dedup_near_dup_shingle_size_ = 3;
+    size_t dedup_near_dup_min_tokens_ = 50;
+    
+    int indexer_segment_size_mb_ = 100;
+    int indexer_max_docs_per_segment_ = 100000;
+    int indexer_merge_threshold_ = 10;
+    int indexer_merge_mb_per_sec_ = 20;
+    int indexer_refresh_interval_ms_ = 1000;
+    double indexer_proximity_weight_ = 0.0;
+    
+    std::string storage_data_dir_ = "./data";
+    std::string storage_index_dir_ = "./data/index";
+    int storage_checkpoint_interval_seconds_ = 300;
+    int storage_wal_group_commit_ms_ = 10;
+    int storage_wal_segment_size_mb_ = 64;
+    int storage_doc_segment_size_mb_ = 256;
+    int storage_doc_block_kb_ = 64;
+    bool storage_doc_compression_ = true;
+    bool storage_io_uring_ = true;
+    int storage_io_queue_depth_ = 128;
+    int storage_io_max_inflight_mb_ = 64;
+    int storage_io_threads_ = 4;
     
     std::string api_host_ = "0.0.0.0";
     int api_port_ = 8080;
     int api_threads_ = 4;
+    int api_search_cache_mb_ = 64;
+    int api_max_results_ = 1000;
+    
+    std::string logging_level_ = "info";
+    std::string logging_format_ = "json";
+    std::string logging_output_ = "stdout";
+    std::string logging_file_path_ = "./logs/web-crawler.log";
+    int logging_buffer_kb_ = 64;
+    std::string logging_overflow_ = "drop";
+    
+    int tracing_slow_task_ms_ = 10000;
+    int tracing_slow_task_samples_ = 32;
     
     int64_t max_memory_mb_ = 2048;
     int flush_threshold_percent_ = 80;
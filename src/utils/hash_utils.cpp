@@ -15,7 +15,7 @@ extern "C" {
 
 namespace crawler {
 
-uint64_t HashUtils::xxhash(const std::string& data) {
+uint64_t HashUtils::xxhash(std::string_view data) {
 #ifdef XXHASH_H
     return XXH64(data.data(), data.size(), 0);
 #else
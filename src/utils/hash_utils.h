@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 namespace crawler {
@@ -8,7 +9,7 @@ namespace crawler {
 class HashUtils {
 public:
     // Compute xxhash (fast, non-cryptographic)
-    static uint64_t xxhash(const std::string& data);
+    static uint64_t xxhash(std::string_view data);
     
     // Compute SHA256 (slower, cryptographic)
     static std::string sha256(const std::string& data);
@@ -0,0 +1,94 @@
+#include "string_arena.h"
+#include <algorithm>
+#include <cstring>
+
+namespace crawler {
+
+namespace {
+
+// Emptied chunks kept around instead of going back to malloc
+constexpr size_t kMaxSpareChunks = 4;
+
+// Each string is stored behind its length
+constexpr size_t kLengthBytes = sizeof(uint32_t);
+
+} // namespace
+
+StringArena::StringArena(size_t chunk_bytes) : chunk_bytes_(std::max<size_t>(chunk_bytes, 256)) {}
+
+StringArena::Ref StringArena::add(std::string_view s) {
+    size_t need = kLengthBytes + s.size();
+    if (current_ == UINT32_MAX || chunks_[current_].used + need > chunks_[current_].capacity) {
+        uint32_t previous = current_;
+        current_ = new_chunk(need);
+        if (previous != UINT32_MAX && chunks_[previous].live == 0) {
+            free_chunk(previous);
+        }
+    }
+
+    Chunk& chunk = chunks_[current_];
+    uint32_t length = static_cast<uint32_t>(s.size());
+    std::memcpy(chunk.data.get() + chunk.used, &length, kLengthBytes);
+    std::memcpy(chunk.data.get() + chunk.used + kLengthBytes, s.data(), s.size());
+    Ref ref = (static_cast<uint64_t>(current_) << 32) | chunk.used;
+    chunk.used += static_cast<uint32_t>(need);
+    chunk.live++;
+    live_strings_++;
+    return ref;
+}
+
+std::string_view StringArena::get(Ref ref) const {
+    const Chunk& chunk = chunks_[ref >> 32];
+    const char* at = chunk.data.get() + static_cast<uint32_t>(ref);
+    uint32_t length;
+    std::memcpy(&length, at, kLengthBytes);
+    return std::string_view(at + kLengthBytes, length);
+}
+
+void StringArena::release(Ref ref) {
+    uint32_t slot = static_cast<uint32_t>(ref >> 32);
+    live_strings_--;
+    if (--chunks_[slot].live == 0 && slot != current_) {
+        free_chunk(slot);
+    }
+}
+
+uint32_t StringArena::new_chunk(size_t min_bytes) {
+    uint32_t slot;
+    if (min_bytes <= chunk_bytes_ && !spare_slots_.empty()) {
+        slot = spare_slots_.back();
+        spare_slots_.pop_back();
+    } else {
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(chunks_.size());
+            chunks_.emplace_back();
+        }
+        // Oversized strings get a chunk of their own
+        Chunk& chunk = chunks_[slot];
+        chunk.capacity = static_cast<uint32_t>(std::max(chunk_bytes_, min_bytes));
+        chunk.data.reset(new char[chunk.capacity]); // left uninitialised
+        bytes_allocated_ += chunk.capacity;
+    }
+    chunks_[slot].used = 0;
+    chunks_[slot].live = 0;
+    live_chunks_++;
+    return slot;
+}
+
+void StringArena::free_chunk(uint32_t slot) {
+    Chunk& chunk = chunks_[slot];
+    live_chunks_--;
+    if (chunk.capacity == chunk_bytes_ && spare_slots_.size() < kMaxSpareChunks) {
+        spare_slots_.push_back(slot);
+        return;
+    }
+    bytes_allocated_ -= chunk.capacity;
+    chunk.data.reset();
+    chunk.capacity = 0;
+    free_slots_.push_back(slot);
+}
+
+} // namespace crawler
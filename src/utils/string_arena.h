@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace crawler {
+
+// Bump-allocated storage for many short-lived strings (frontier URLs).
+// Strings are appended to fixed-size chunks and named by a 64-bit ref; a
+// chunk is one generation and is freed, or kept as a spare for the next
+// one, once every string in it has been released. Not thread-safe.
+class StringArena {
+public:
+    using Ref = uint64_t;
+
+    explicit StringArena(size_t chunk_bytes = 64 * 1024);
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+    StringArena(StringArena&&) = default;
+    StringArena& operator=(StringArena&&) = default;
+
+    // Copy a string in
+    Ref add(std::string_view s);
+
+    // Valid until the ref is released
+    std::string_view get(Ref ref) const;
+
+    // Drop a string; each ref is released exactly once
+    void release(Ref ref);
+
+    // Statistics
+    size_t live_strings() const { return live_strings_; }
+    size_t chunk_count() const { return live_chunks_; }
+    size_t bytes_allocated() const { return bytes_allocated_; }
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        uint32_t capacity = 0;
+        uint32_t used = 0;
+        uint32_t live = 0;
+    };
+
+    uint32_t new_chunk(size_t min_bytes);
+    void free_chunk(uint32_t slot);
+
+    size_t chunk_bytes_;
+    std::vector<Chunk> chunks_;
+    std::vector<uint32_t> free_slots_;  // no memory behind them
+    std::vector<uint32_t> spare_slots_; // standard-size chunks kept for reuse
+    uint32_t current_ = UINT32_MAX;     // chunk being filled
+    size_t live_strings_ = 0;
+    size_t live_chunks_ = 0;
+    size_t bytes_allocated_ = 0;
+};
+
+} // namespace crawler
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+namespace crawler {
+
+// Classic token bucket: refills at rate tokens/sec up to capacity.
+// A rate of 0 means unlimited. Not thread-safe; callers hold their own lock.
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double rate_per_sec = 0.0, double capacity = 1.0,
+                Clock::time_point now = Clock::now())
+        : rate_(rate_per_sec), capacity_(std::max(capacity, 1.0)),
+          tokens_(std::max(capacity, 1.0)), last_refill_(now) {}
+
+    bool unlimited() const { return rate_ <= 0.0; }
+
+    // Take tokens if available right now
+    bool try_acquire(double tokens = 1.0, Clock::time_point now = Clock::now()) {
+        if (unlimited()) return true;
+        refill(now);
+        if (tokens_ < tokens) return false;
+        tokens_ -= tokens;
+        return true;
+    }
+
+    // Earliest time try_acquire(tokens) can succeed
+    Clock::time_point next_available(double tokens = 1.0,
+                                     Clock::time_point now = Clock::now()) const {
+        if (unlimited()) return now;
+        double available = current_tokens(now);
+        if (available >= tokens) return now;
+        double wait_sec = (tokens - available) / rate_;
+        return now + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(wait_sec));
+    }
+
+    // True once the bucket has refilled to capacity, i.e. it is no
+    // different from a fresh one
+    bool full(Clock::time_point now = Clock::now()) const {
+        return unlimited() || current_tokens(now) >= capacity_;
+    }
+
+    double rate() const { return rate_; }
+    double capacity() const { return capacity_; }
+
+private:
+    double current_tokens(Clock::time_point now) const {
+        if (now <= last_refill_) return tokens_;
+        double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+        return std::min(capacity_, tokens_ + elapsed * rate_);
+    }
+
+    void refill(Clock::time_point now) {
+        tokens_ = current_tokens(now);
+        if (now > last_refill_) last_refill_ = now;
+    }
+
+    double rate_;
+    double capacity_;
+    double tokens_;
+    Clock::time_point last_refill_;
+};
+
+} // namespace crawler
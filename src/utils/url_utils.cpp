@@ -1,72 +1,389 @@
 #include "url_utils.h"
+#include "hash_utils.h"
 #include <algorithm>
+#include <array>
 #include <cctype>
-#include <sstream>
-#include <regex>
+#include <cstring>
+#include <vector>
+#include <strings.h>
 
 namespace crawler {
 
+namespace {
+
+// Query parameters sorted without touching the heap; longer queries fall
+// back to a vector
+constexpr size_t kInlineParams = 32;
+
+constexpr char kHex[] = "0123456789ABCDEF";
+
+enum class Part { USERINFO, PATH, QUERY };
+
+struct Span {
+    size_t offset;
+    size_t key_size; // up to the first '='
+    size_t size;
+};
+
+bool is_alpha(unsigned char c) {
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+}
+
+bool is_digit(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+int hex_value(unsigned char c) {
+    if (is_digit(c)) return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+char lower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : static_cast<char>(c);
+}
+
+bool is_unreserved(unsigned char c) {
+    return is_alpha(c) || is_digit(c) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+bool is_sub_delim(unsigned char c) {
+    return c != '\0' && std::strchr("!$&'()*+,;=", c) != nullptr;
+}
+
+bool is_allowed(unsigned char c, Part part) {
+    if (is_unreserved(c) || is_sub_delim(c) || c == ':') return true;
+    switch (part) {
+        case Part::USERINFO: return false;
+        case Part::PATH: return c == '/' || c == '@';
+        case Part::QUERY: return c == '/' || c == '@' || c == '?';
+    }
+    return false;
+}
+
+// Host bytes that may appear as-is; anything else makes the URL unparseable
+bool is_host_char(unsigned char c) {
+    return is_unreserved(c) || is_sub_delim(c) || c == '%' || c == ':' || c == '[' || c == ']';
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && static_cast<unsigned char>(s.front()) <= ' ') s.remove_prefix(1);
+    while (!s.empty() && static_cast<unsigned char>(s.back()) <= ' ') s.remove_suffix(1);
+    return s;
+}
+
+// Length of a leading "scheme:" (without the colon), or 0
+size_t scheme_length(std::string_view s) {
+    if (s.empty() || !is_alpha(s[0])) return 0;
+    size_t i = 1;
+    while (i < s.size() && (is_alpha(s[i]) || is_digit(s[i]) || s[i] == '+' || s[i] == '-' || s[i] == '.')) {
+        i++;
+    }
+    return i < s.size() && s[i] == ':' ? i : 0;
+}
+
+// Decode %XX of unreserved characters, uppercase the remaining escapes and
+// escape whatever may not appear raw in this part
+void append_normalized(std::string& out, std::string_view in, Part part) {
+    for (size_t i = 0; i < in.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(in[i]);
+        if (c == '%' && i + 2 < in.size() && hex_value(in[i + 1]) >= 0 && hex_value(in[i + 2]) >= 0) {
+            unsigned char decoded = static_cast<unsigned char>(hex_value(in[i + 1]) * 16 + hex_value(in[i + 2]));
+            if (is_unreserved(decoded)) {
+                out += static_cast<char>(decoded);
+            } else {
+                out += '%';
+                out += kHex[decoded >> 4];
+                out += kHex[decoded & 0xF];
+            }
+            i += 2;
+        } else if (c != '%' && is_allowed(c, part)) {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += kHex[c >> 4];
+            out += kHex[c & 0xF];
+        }
+    }
+}
+
+// RFC 3986 5.2.4 in place on the absolute path at buffer[begin..]
+void remove_dot_segments(std::string& buffer, size_t begin) {
+    char* s = buffer.data();
+    size_t end = buffer.size();
+    size_t in = begin;
+    size_t out = begin;
+    while (in < end) {
+        size_t next = in + 1;
+        while (next < end && s[next] != '/') next++;
+        std::string_view segment(s + in + 1, next - in - 1);
+        if (segment == "." || segment == "..") {
+            if (segment == "..") {
+                // Drop the last output segment and its slash
+                while (out > begin && s[out - 1] != '/') out--;
+                if (out > begin) out--;
+            }
+            if (next == end) s[out++] = '/';
+        } else {
+            std::memmove(s + out, s + in, next - in);
+            out += next - in;
+        }
+        in = next;
+    }
+    if (out == begin) s[out++] = '/';
+    buffer.resize(out);
+}
+
+// Write the query's non-empty parameters, normalised and stably sorted by key
+void append_query(std::string& buffer, std::string_view query) {
+    size_t count = static_cast<size_t>(std::count(query.begin(), query.end(), '&')) + 1;
+    std::array<Span, kInlineParams> inline_spans;
+    std::vector<Span> heap_spans;
+    Span* spans = inline_spans.data();
+    if (count > kInlineParams) {
+        heap_spans.resize(count);
+        spans = heap_spans.data();
+    }
+
+    size_t begin = buffer.size();
+    size_t params = 0;
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t amp = query.find('&', pos);
+        if (amp == std::string_view::npos) amp = query.size();
+        if (amp > pos) {
+            Span& span = spans[params++];
+            if (buffer.size() > begin) buffer += '&';
+            span.offset = buffer.size();
+            append_normalized(buffer, query.substr(pos, amp - pos), Part::QUERY);
+            span.size = buffer.size() - span.offset;
+            size_t eq = std::string_view(buffer).substr(span.offset, span.size).find('=');
+            span.key_size = eq == std::string_view::npos ? span.size : eq;
+        }
+        pos = amp + 1;
+    }
+
+    auto key = [&buffer](const Span& span) { return std::string_view(buffer).substr(span.offset, span.key_size); };
+    auto by_key = [&key](const Span& a, const Span& b) { return key(a) < key(b); };
+    if (std::is_sorted(spans, spans + params, by_key)) return;
+
+    // Append the sorted copy behind the unsorted one, then close the gap;
+    // parse() reserved room for both
+    std::stable_sort(spans, spans + params, by_key);
+    size_t unsorted_end = buffer.size();
+    for (size_t i = 0; i < params; i++) {
+        if (i > 0) buffer += '&';
+        buffer.append(buffer.data() + spans[i].offset, spans[i].size);
+    }
+    buffer.erase(begin, unsorted_end - begin);
+}
+
+std::string_view default_port(std::string_view scheme) {
+    if (scheme == "http" || scheme == "ws") return "80";
+    if (scheme == "https" || scheme == "wss") return "443";
+    if (scheme == "ftp") return "21";
+    return {};
+}
+
+// Scratch buffers for the std::string entry points; reused per thread
+std::string& scratch() {
+    thread_local std::string buffer;
+    return buffer;
+}
+
+} // namespace
+
+bool UrlUtils::parse(std::string_view url, std::string& buffer, ParsedUrl& out) {
+    url = trim(url);
+    size_t scheme_size = scheme_length(url);
+    if (scheme_size == 0 || url.compare(scheme_size, 3, "://") != 0) {
+        return false;
+    }
+
+    // Split scheme://userinfo@host:port/path?query#fragment on the raw input
+    size_t authority_begin = scheme_size + 3;
+    size_t authority_end = url.find_first_of("/?#", authority_begin);
+    if (authority_end == std::string_view::npos) authority_end = url.size();
+    std::string_view authority = url.substr(authority_begin, authority_end - authority_begin);
+
+    std::string_view userinfo;
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        userinfo = authority.substr(0, at);
+        authority.remove_prefix(at + 1);
+    }
+
+    std::string_view host = authority;
+    std::string_view port;
+    size_t colon = authority.rfind(':');
+    if (colon != std::string_view::npos && authority.find(']', colon) == std::string_view::npos) {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    }
+    if (host.empty() || !std::all_of(host.begin(), host.end(),
+                                     [](char c) { return is_host_char(static_cast<unsigned char>(c)); })) {
+        return false;
+    }
+    if (!std::all_of(port.begin(), port.end(), [](char c) { return is_digit(static_cast<unsigned char>(c)); })) {
+        return false;
+    }
+    while (port.size() > 1 && port.front() == '0') port.remove_prefix(1);
+    if (port.size() > 5 || (port.size() == 5 && port > "65535")) {
+        return false;
+    }
+
+    size_t path_end = url.find_first_of("?#", authority_end);
+    if (path_end == std::string_view::npos) path_end = url.size();
+    std::string_view path = url.substr(authority_end, path_end - authority_end);
+    std::string_view query;
+    if (path_end < url.size() && url[path_end] == '?') {
+        size_t query_end = url.find('#', path_end);
+        if (query_end == std::string_view::npos) query_end = url.size();
+        query = url.substr(path_end + 1, query_end - path_end - 1);
+    }
+
+    // Escaping at most triples a byte, and a query being sorted needs a
+    // second copy, so this is the only allocation (none once warm)
+    buffer.clear();
+    buffer.reserve(3 * url.size() + 3 * query.size() + 2);
+
+    for (char c : url.substr(0, scheme_size)) buffer += lower(c);
+    buffer += "://";
+
+    size_t userinfo_begin = buffer.size();
+    if (!userinfo.empty()) {
+        append_normalized(buffer, userinfo, Part::USERINFO);
+        buffer += '@';
+    }
+    size_t userinfo_size = userinfo.empty() ? 0 : buffer.size() - userinfo_begin - 1;
+
+    size_t host_begin = buffer.size();
+    for (char c : host) buffer += lower(c);
+    size_t port_begin = buffer.size();
+    if (!port.empty() && port != default_port(std::string_view(buffer.data(), scheme_size))) {
+        buffer += ':';
+        port_begin = buffer.size();
+        buffer += port;
+    }
+    size_t port_size = buffer.size() - port_begin;
+
+    size_t path_begin = buffer.size();
+    if (path.empty()) {
+        buffer += '/';
+    } else {
+        append_normalized(buffer, path, Part::PATH);
+        remove_dot_segments(buffer, path_begin);
+    }
+    size_t path_size = buffer.size() - path_begin;
+
+    size_t query_begin = buffer.size() + 1;
+    if (!query.empty()) {
+        buffer += '?';
+        append_query(buffer, query);
+        if (buffer.size() == query_begin) buffer.pop_back(); // only empty parameters
+    }
+    size_t query_size = buffer.size() >= query_begin ? buffer.size() - query_begin : 0;
+
+    std::string_view view(buffer);
+    out.scheme = view.substr(0, scheme_size);
+    out.userinfo = view.substr(userinfo_begin, userinfo_size);
+    out.host = view.substr(host_begin, host.size());
+    out.port = view.substr(port_begin, port_size);
+    out.path = view.substr(path_begin, path_size);
+    out.query = query_size ? view.substr(query_begin, query_size) : view.substr(view.size(), 0);
+    out.host_id = hash_host(out.authority());
+    return true;
+}
+
 std::string UrlUtils::canonicalize(const std::string& url) {
-    std::string result = url;
-    
-    // Remove fragment
-    size_t frag_pos = result.find('#');
-    if (frag_pos != std::string::npos) {
-        result = result.substr(0, frag_pos);
-    }
-    
-    // TODO: Sort query parameters
-    // For now, just return without fragment
-    
-    return result;
+    std::string& buffer = scratch();
+    ParsedUrl parsed;
+    if (parse(url, buffer, parsed)) {
+        return buffer;
+    }
+    return url.substr(0, url.find('#'));
 }
 
 std::string UrlUtils::extract_domain(const std::string& url) {
-    std::regex domain_regex(R"(https?://([^/]+))");
-    std::smatch match;
-    if (std::regex_search(url, match, domain_regex)) {
-        return match[1].str();
+    std::string& buffer = scratch();
+    ParsedUrl parsed;
+    if (parse(url, buffer, parsed)) {
+        return std::string(parsed.authority());
     }
     return "";
 }
 
+uint64_t UrlUtils::host_id(std::string_view url) {
+    std::string& buffer = scratch();
+    ParsedUrl parsed;
+    return parse(url, buffer, parsed) ? parsed.host_id : hash_host({});
+}
+
+uint64_t UrlUtils::hash_host(std::string_view authority) {
+    return HashUtils::xxhash(authority);
+}
+
 std::string UrlUtils::normalize(const std::string& url) {
     std::string result = url;
     std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-    
+
     // Remove trailing slash (except for root)
     if (result.length() > 1 && result.back() == '/') {
         result.pop_back();
     }
-    
+
     return result;
 }
 
 bool UrlUtils::is_valid(const std::string& url) {
-    std::regex url_regex(R"(https?://[^\s]+)");
-    return std::regex_match(url, url_regex);
+    std::string& buffer = scratch();
+    ParsedUrl parsed;
+    return parse(url, buffer, parsed) && (parsed.scheme == "http" || parsed.scheme == "https");
 }
 
 std::string UrlUtils::resolve(const std::string& base_url, const std::string& relative_url) {
-    if (relative_url.empty()) return base_url;
-    
-    if (relative_url.find("http://") == 0 || relative_url.find("https://") == 0) {
-        return relative_url;
-    }
-    
-    // Simple resolution
-    if (relative_url[0] == '/') {
-        std::string domain = extract_domain(base_url);
-        return domain + relative_url;
-    }
-    
-    // Relative path
-    size_t last_slash = base_url.find_last_of('/');
-    if (last_slash != std::string::npos) {
-        return base_url.substr(0, last_slash + 1) + relative_url;
-    }
-    
-    return base_url + "/" + relative_url;
+    std::string_view reference = trim(relative_url);
+    thread_local std::string base_buffer;
+    thread_local std::string joined;
+    std::string& buffer = scratch();
+    ParsedUrl base;
+    ParsedUrl parsed;
+
+    if (scheme_length(reference) > 0) {
+        return parse(reference, buffer, parsed) ? buffer : std::string(reference);
+    }
+    if (!parse(base_url, base_buffer, base)) {
+        return reference.empty() ? base_url : base_url + "/" + std::string(reference);
+    }
+
+    // Everything of the base before the part the reference replaces
+    std::string_view origin(base_buffer.data(), base.path.data() - base_buffer.data());
+    joined.clear();
+    if (reference.empty() || reference.front() == '#') {
+        return base_buffer;
+    } else if (reference.size() >= 2 && reference[0] == '/' && reference[1] == '/') {
+        joined.append(base.scheme).append(":").append(reference);
+    } else if (reference.front() == '/') {
+        joined.append(origin).append(reference);
+    } else if (reference.front() == '?') {
+        joined.append(origin).append(base.path).append(reference);
+    } else {
+        joined.append(origin).append(base.path.substr(0, base.path.rfind('/') + 1)).append(reference);
+    }
+    return parse(joined, buffer, parsed) ? buffer : joined;
+}
+
+bool UrlUtils::is_followable_href(std::string_view href) {
+    while (!href.empty() && std::isspace(static_cast<unsigned char>(href.front()))) {
+        href.remove_prefix(1);
+    }
+    if (href.empty() || href.front() == '#') return false;
+    for (const char* scheme : {"javascript:", "mailto:", "tel:", "data:"}) {
+        size_t n = std::strlen(scheme);
+        if (href.size() >= n && strncasecmp(href.data(), scheme, n) == 0) return false;
+    }
+    return true;
 }
 
 } // namespace crawler
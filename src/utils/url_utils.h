@@ -1,25 +1,62 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <cstdint>
 
 namespace crawler {
 
+// Components of a canonical URL, viewing into the buffer it was parsed into;
+// they stay valid until that buffer is modified
+struct ParsedUrl {
+    std::string_view scheme;   // lowercase
+    std::string_view userinfo;
+    std::string_view host;     // lowercase
+    std::string_view port;     // empty when it is the scheme's default
+    std::string_view path;     // at least "/"
+    std::string_view query;    // parameters sorted by key, without the '?'
+    uint64_t host_id = 0;      // UrlUtils::hash_host(authority())
+
+    // host[:port], the unit of politeness and connection reuse
+    std::string_view authority() const {
+        return port.empty() ? host : std::string_view(host.data(), port.data() + port.size() - host.data());
+    }
+};
+
 class UrlUtils {
 public:
-    // Canonicalize URL: remove fragment, sort query params
+    // Parse an absolute URL in one pass and write its canonical form to
+    // `buffer`: scheme and host lowercased, default port dropped,
+    // percent-encoding normalised, dot segments removed, query parameters
+    // sorted by key and the fragment removed. `buffer` is reserved once and
+    // reused across calls, so a warm buffer parses without allocating; it
+    // must not alias `url`. False if `url` has no scheme or host.
+    static bool parse(std::string_view url, std::string& buffer, ParsedUrl& out);
+
+    // Canonicalize URL (see parse); anything unparseable only loses its fragment
     static std::string canonicalize(const std::string& url);
-    
-    // Extract domain from URL
+
+    // Extract host[:port] from URL, lowercased, default port dropped
     static std::string extract_domain(const std::string& url);
-    
+
+    // 64-bit ID of a URL's host[:port]; hash_host("") if it does not parse
+    static uint64_t host_id(std::string_view url);
+
+    // Host ID from an already extracted host[:port]
+    static uint64_t hash_host(std::string_view authority);
+
     // Normalize URL (lowercase, remove trailing slash)
     static std::string normalize(const std::string& url);
-    
-    // Check if URL is valid
+
+    // Check if URL is a parseable http(s) URL
     static bool is_valid(const std::string& url);
-    
-    // Resolve relative URL
+
+    // Resolve a reference against a base URL (RFC 3986 section 5.2); the
+    // result is canonical
     static std::string resolve(const std::string& base_url, const std::string& relative_url);
+
+    // False for empty, fragment-only and javascript:/mailto:/tel:/data: hrefs
+    static bool is_followable_href(std::string_view href);
 };
 
 } // namespace crawler
@@ -0,0 +1,187 @@
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../../src/fetcher/async_fetcher.h"
+#include "../../src/utils/config.h"
+
+using namespace crawler;
+
+namespace {
+
+// Minimal HTTP/1.1 server on 127.0.0.1, one request per connection:
+//   /ok    200 text/html
+//   /loop  302 back to /loop, forever
+//   /ftp   302 to an ftp:// URL
+//   /hang  reads the request and never answers
+class LocalServer {
+public:
+    LocalServer() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        assert(listen_fd_ >= 0);
+        int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        assert(bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+        assert(listen(listen_fd_, 64) == 0);
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        accept_thread_ = std::thread(&LocalServer::accept_loop, this);
+    }
+
+    ~LocalServer() {
+        stopping_ = true;
+        accept_thread_.join();
+        for (auto& worker : workers_) worker.join();
+        close(listen_fd_);
+    }
+
+    std::string url(const std::string& path) const {
+        return "http://127.0.0.1:" + std::to_string(port_) + path;
+    }
+
+    int loop_hits() const { return loop_hits_; }
+
+private:
+    void accept_loop() {
+        while (!stopping_) {
+            pollfd pfd{listen_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, 20) <= 0) continue;
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd >= 0) workers_.emplace_back(&LocalServer::serve, this, fd);
+        }
+    }
+
+    void serve(int fd) {
+        std::string request;
+        char buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (stopping_) break;
+            if (poll(&pfd, 1, 20) <= 0) continue;
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            request.append(buf, n);
+        }
+        std::string path;
+        size_t start = request.find(' ');
+        if (start != std::string::npos) {
+            path = request.substr(start + 1, request.find(' ', start + 1) - start - 1);
+        }
+
+        std::string response;
+        if (path == "/ok") {
+            response = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 13\r\n"
+                       "Connection: close\r\n\r\n<html></html>";
+        } else if (path == "/loop") {
+            loop_hits_++;
+            response = "HTTP/1.1 302 Found\r\nLocation: /loop\r\nContent-Length: 0\r\n"
+                       "Connection: close\r\n\r\n";
+        } else if (path == "/ftp") {
+            response = "HTTP/1.1 302 Found\r\nLocation: ftp://127.0.0.1/file\r\nContent-Length: 0\r\n"
+                       "Connection: close\r\n\r\n";
+        } else if (path == "/hang") {
+            while (!stopping_) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = write(fd, response.data() + sent, response.size() - sent);
+            if (n <= 0) break;
+            sent += n;
+        }
+        close(fd);
+    }
+
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> loop_hits_{0};
+    std::thread accept_thread_;
+    std::vector<std::thread> workers_; // accept thread only, joined after it
+};
+
+// Fetch one URL and wait for its callback; false if it never came
+bool fetch(AsyncFetcher& fetcher, const std::string& url, FetchResult& out) {
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished = false;
+    bool queued = fetcher.submit(url, [&](FetchResult result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        out = std::move(result);
+        finished = true;
+        done.notify_all();
+    }, nullptr);
+    assert(queued);
+    std::unique_lock<std::mutex> lock(mutex);
+    return done.wait_for(lock, std::chrono::seconds(10), [&] { return finished; });
+}
+
+} // namespace
+
+int main() {
+    std::string dir = (std::filesystem::temp_directory_path() / "test_async_fetcher").string();
+    std::filesystem::create_directories(dir);
+    std::string config_path = dir + "/config.yaml";
+    {
+        std::ofstream out(config_path);
+        out << "fetcher:\n  connect_timeout_ms: 1000\n  read_timeout_ms: 300\n  max_redirects: 3\n";
+    }
+    assert(Config::instance().load(config_path));
+
+    LocalServer server;
+    AsyncFetcher fetcher;
+    assert(fetcher.start());
+    FetchResult result;
+
+    assert(fetch(fetcher, server.url("/ok"), result));
+    assert(result.success && result.http_status == 200);
+    assert(result.content == "<html></html>");
+
+    // A redirect loop stops after max_redirects hops: first request plus 3
+    assert(fetch(fetcher, server.url("/loop"), result));
+    assert(!result.success);
+    assert(result.error_message == "Too many redirects");
+    assert(result.redirects.size() == 3);
+    assert(server.loop_hits() == 4);
+
+    // Redirects are only followed to http(s)
+    assert(fetch(fetcher, server.url("/ftp"), result));
+    assert(!result.success);
+    assert(result.redirects.size() == 1);
+    assert(result.error_message == "Unsupported protocol");
+
+    // A server that never answers times out instead of hanging the loop
+    auto start = std::chrono::steady_clock::now();
+    assert(fetch(fetcher, server.url("/hang"), result));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    assert(!result.success);
+    assert(!result.error_message.empty());
+    assert(elapsed >= std::chrono::milliseconds(250) && elapsed < std::chrono::seconds(5));
+
+    // The loop still serves requests afterwards
+    assert(fetch(fetcher, server.url("/ok"), result));
+    assert(result.success);
+
+    fetcher.stop();
+    assert(fetcher.failed_fetches() == 3);
+    std::filesystem::remove_all(dir);
+    return 0;
+}
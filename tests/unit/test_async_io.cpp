@@ -0,0 +1,59 @@
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../../src/storage/async_io.h"
+
+int main() {
+    using namespace crawler;
+
+    std::string path = (std::filesystem::temp_directory_path() / "test_async_io.bin").string();
+
+    // Same results with io_uring (where the kernel has it) and the thread pool
+    for (bool use_io_uring : {true, false}) {
+        AsyncIo io(8, 64 << 10, use_io_uring, 3);
+        int fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+        assert(fd >= 0);
+
+        // Small writes go through registered buffers, large ones as they are,
+        // and both wait on the 64 KiB in-flight budget
+        IoGroup group;
+        std::vector<int64_t> results(64, -1);
+        uint64_t offset = 0;
+        for (size_t i = 0; i < results.size(); i++) {
+            size_t size = i % 8 == 7 ? 200000 : 1000 + i;
+            io.write(fd, offset, std::string(size, static_cast<char>('a' + i % 26)),
+                     group.track([&results, i](int64_t result) { results[i] = result; }));
+            offset += size;
+        }
+
+        // A sync runs after every write queued before it
+        bool all_written = false;
+        io.sync(fd, group.track([&](int64_t result) {
+            assert(result == 0);
+            all_written = true;
+            for (int64_t written : results) all_written = all_written && written > 0;
+        }));
+        assert(group.wait());
+        assert(all_written);
+        assert(static_cast<uint64_t>(lseek(fd, 0, SEEK_END)) == offset);
+        assert(io.inflight_bytes() == 0);
+
+        char byte = 0;
+        assert(pread(fd, &byte, 1, offset - 1) == 1 && byte == 'a' + 63 % 26);
+        ::close(fd);
+
+        // Errors reach the callback and the group
+        IoGroup failing;
+        int64_t error = 0;
+        io.write(-1, 0, "lost", failing.track([&](int64_t result) { error = result; }));
+        assert(!failing.wait());
+        assert(error < 0);
+    }
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../src/dedup/bloom_filter.h"
+#include "../../src/utils/hash_utils.h"
+
+int main() {
+    using namespace crawler;
+    
+    const size_t n = 100000;
+    BloomFilter filter(n, 0.01);
+    assert(filter.hash_count() >= 6);
+    // Well under the ~40+ bytes per URL of an unordered_set<uint64_t>
+    assert(filter.size_bytes() < n * 2);
+    
+    auto key = [](size_t i) {
+        return HashUtils::hash_url("https://example.com/page/" + std::to_string(i));
+    };
+    
+    // No false negatives; add() reports first insertions only
+    for (size_t i = 0; i < n; i++) {
+        filter.add(key(i));
+    }
+    for (size_t i = 0; i < n; i++) {
+        assert(filter.may_contain(key(i)));
+        assert(!filter.add(key(i)));
+    }
+    
+    // False-positive rate near the target at the design load
+    size_t false_positives = 0;
+    for (size_t i = n; i < 2 * n; i++) {
+        if (filter.may_contain(key(i))) {
+            false_positives++;
+        }
+    }
+    assert(false_positives < n / 50); // < 2%
+    
+    // Snapshot round trip; mismatched parameters are rejected
+    std::string path = (std::filesystem::temp_directory_path() / "test_bloom_filter.bloom").string();
+    assert(filter.save(path));
+    BloomFilter restored(n, 0.01);
+    assert(restored.load(path));
+    for (size_t i = 0; i < n; i++) {
+        assert(restored.may_contain(key(i)));
+    }
+    BloomFilter other(n * 10, 0.01);
+    assert(!other.load(path));
+    std::remove(path.c_str());
+    
+    // Threads racing to add the same keys: exactly one add() per key wins
+    {
+        const size_t keys = 20000;
+        const int threads = 8;
+        BloomFilter shared(keys, 0.01);
+        auto wins = std::make_unique<std::atomic<int>[]>(keys);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (size_t j = 0; j < keys; j++) {
+                    size_t i = (j + static_cast<size_t>(t) * 7919) % keys; // different orders
+                    if (shared.add(key(i))) wins[i]++;
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        size_t won = 0;
+        for (size_t i = 0; i < keys; i++) {
+            assert(wins[i] <= 1);
+            won += static_cast<size_t>(wins[i].load());
+        }
+        // Keys reporting "maybe present" on first insert are false positives
+        assert(won > keys - keys / 50);
+        assert(shared.approx_items() == won);
+    }
+    
+    return 0;
+}
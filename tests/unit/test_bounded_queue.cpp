@@ -0,0 +1,128 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../../src/utils/bounded_queue.h"
+
+using namespace crawler;
+
+int main() {
+    assert(parse_backpressure_strategy("drop") == BackpressureStrategy::DROP);
+    assert(parse_backpressure_strategy("block") == BackpressureStrategy::BLOCK);
+    assert(parse_backpressure_strategy("anything") == BackpressureStrategy::BLOCK);
+    
+    // DROP: a full queue refuses the item and counts it
+    {
+        BoundedQueue<int> queue(2, BackpressureStrategy::DROP);
+        assert(queue.push(1) && queue.push(2));
+        assert(!queue.push(3));
+        assert(!queue.push(4));
+        assert(queue.dropped() == 2 && queue.size() == 2);
+        int item = 0;
+        assert(queue.pop(item) && item == 1);
+        assert(queue.push(5));
+        assert(queue.pop(item) && item == 2);
+        assert(queue.pop(item) && item == 5);
+        assert(queue.dropped() == 2);
+    }
+    
+    // BLOCK: the producer waits for a slot, and nothing is dropped
+    {
+        BoundedQueue<int> queue(1, BackpressureStrategy::BLOCK);
+        assert(queue.push(1));
+        std::atomic<bool> pushed{false};
+        std::thread producer([&]() {
+            assert(queue.push(2));
+            pushed = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert(!pushed);
+        int item = 0;
+        assert(queue.pop(item) && item == 1);
+        producer.join();
+        assert(pushed && queue.size() == 1 && queue.dropped() == 0);
+        assert(queue.pop(item) && item == 2);
+    }
+    
+    // try_push never waits, even under BLOCK, and leaves a refused item
+    // with the caller
+    {
+        BoundedQueue<std::vector<int>> queue(1, BackpressureStrategy::BLOCK);
+        std::vector<int> first{1}, second{2, 3};
+        assert(queue.try_push(first) && first.empty());
+        assert(!queue.try_push(second));
+        assert(second.size() == 2 && queue.dropped() == 0);
+        std::vector<int> item;
+        assert(queue.pop(item) && item.size() == 1);
+        assert(queue.try_push(second));
+        queue.close();
+        std::vector<int> late{4};
+        assert(!queue.try_push(late) && late.size() == 1);
+    }
+    
+    // close() wakes a blocked producer (its item is dropped) and blocked
+    // consumers; items queued before the close still drain
+    {
+        BoundedQueue<int> queue(1, BackpressureStrategy::BLOCK);
+        assert(queue.push(1));
+        std::atomic<int> producer_result{-1};
+        std::thread producer([&]() { producer_result = queue.push(2) ? 1 : 0; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.close();
+        producer.join();
+        assert(producer_result == 0 && queue.dropped() == 1);
+        int item = 0;
+        assert(queue.pop(item) && item == 1);
+        assert(!queue.pop(item));
+        assert(!queue.push(3));
+    }
+    {
+        BoundedQueue<int> queue(4, BackpressureStrategy::BLOCK);
+        std::atomic<int> woken{0};
+        std::vector<std::thread> consumers;
+        for (int i = 0; i < 3; i++) {
+            consumers.emplace_back([&]() {
+                int item;
+                if (!queue.pop(item)) woken++;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.close();
+        for (auto& consumer : consumers) {
+            consumer.join();
+        }
+        assert(woken == 3);
+    }
+    
+    // Many producers and consumers: everything pushed is popped exactly once
+    {
+        BoundedQueue<int> queue(8, BackpressureStrategy::BLOCK);
+        const int per_producer = 10000;
+        std::atomic<long long> sum{0};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < 4; p++) {
+            threads.emplace_back([&]() {
+                for (int i = 1; i <= per_producer; i++) queue.push(i);
+            });
+        }
+        std::vector<std::thread> consumers;
+        for (int c = 0; c < 4; c++) {
+            consumers.emplace_back([&]() {
+                int item;
+                while (queue.pop(item)) sum += item;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        queue.close();
+        for (auto& consumer : consumers) {
+            consumer.join();
+        }
+        assert(sum == 4LL * per_producer * (per_producer + 1) / 2);
+        assert(queue.dropped() == 0);
+    }
+    
+    return 0;
+}
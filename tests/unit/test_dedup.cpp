@@ -0,0 +1,228 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../../src/dedup/dedup.h"
+#include "../../src/utils/config.h"
+
+using namespace crawler;
+using V = std::vector<std::string>;
+
+// filter_unseen without Redis, so the local tier alone decides
+static void check_local_batches(bool url_filter) {
+    Deduplicator dedup;
+    
+    // Repeats inside one batch, canonical forms included, are dropped
+    V first = {"http://example.com/a", "http://example.com/b", "HTTP://Example.com/a#top",
+               "http://example.com/c"};
+    assert((dedup.filter_unseen(first) ==
+            V{"http://example.com/a", "http://example.com/b", "http://example.com/c"}));
+    assert(dedup.url_duplicates() == 1);
+    
+    // Across batches too; a "maybe" from the filter counts as seen
+    V second = {"http://example.com/b", "http://example.com/d", "http://example.com/c"};
+    assert((dedup.filter_unseen(second) == V{"http://example.com/d"}));
+    assert(dedup.url_duplicates() == 3);
+    assert(dedup.filter_unseen({}).empty());
+    
+    if (url_filter) {
+        assert(dedup.filter_negatives() == 4);
+        assert(dedup.url_filter_bytes() > 0);
+    } else {
+        assert(dedup.url_filter_bytes() == 0);
+    }
+    assert(dedup.redis_hits() == 0 && dedup.redis_misses() == 0);
+    
+    // The single-URL calls see what the batches marked
+    assert(dedup.is_url_seen("http://example.com/d"));
+    assert(!dedup.is_url_seen("http://example.com/e"));
+    dedup.mark_url_seen("http://example.com/e");
+    assert(dedup.is_url_seen("http://example.com/e"));
+}
+
+namespace {
+
+// Just enough of a Redis server on 127.0.0.1 for dedup: PING, SET (with
+// NX) and EXISTS over RESP. stop() drops every connection; start() listens
+// on the same port again, with an empty keyspace.
+class FakeRedis {
+public:
+    FakeRedis() { start(); }
+    ~FakeRedis() { stop(); }
+
+    void start() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port_);
+        assert(bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+        assert(listen(listen_fd_, 16) == 0);
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            keys_.clear();
+        }
+        stopping_ = false;
+        accept_thread_ = std::thread(&FakeRedis::accept_loop, this);
+    }
+
+    void stop() {
+        if (stopping_.exchange(true)) return;
+        accept_thread_.join();
+        for (auto& worker : workers_) worker.join();
+        workers_.clear();
+        close(listen_fd_);
+    }
+
+    uint16_t port() const { return port_; }
+
+    size_t keys() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return keys_.size();
+    }
+
+private:
+    void accept_loop() {
+        while (!stopping_) {
+            pollfd pfd{listen_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, 20) <= 0) continue;
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd >= 0) workers_.emplace_back(&FakeRedis::serve, this, fd);
+        }
+    }
+
+    void serve(int fd) {
+        std::string in;
+        std::vector<std::string> args;
+        char buf[4096];
+        while (!stopping_) {
+            // One command is "*<n>" then n "$<len>" + value lines
+            size_t pos = 0;
+            args.clear();
+            bool complete = false;
+            size_t end = in.find("\r\n");
+            if (end != std::string::npos && in[0] == '*') {
+                size_t count = std::stoul(in.substr(1, end - 1));
+                pos = end + 2;
+                while (args.size() < count) {
+                    end = in.find("\r\n", pos);
+                    if (end == std::string::npos) break;
+                    size_t length = std::stoul(in.substr(pos + 1, end - pos - 1));
+                    if (in.size() < end + 2 + length + 2) break;
+                    args.push_back(in.substr(end + 2, length));
+                    pos = end + 2 + length + 2;
+                }
+                complete = args.size() == count;
+            }
+            if (complete) {
+                in.erase(0, pos);
+                std::string reply = answer(args);
+                if (write(fd, reply.data(), reply.size()) != static_cast<ssize_t>(reply.size())) break;
+                continue;
+            }
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, 20) <= 0) continue;
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            in.append(buf, n);
+        }
+        close(fd);
+    }
+
+    std::string answer(const std::vector<std::string>& args) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (args[0] == "PING") return "+PONG\r\n";
+        if (args[0] == "EXISTS") return keys_.count(args[1]) ? ":1\r\n" : ":0\r\n";
+        if (args[0] == "SET") {
+            bool nx = false;
+            for (const auto& arg : args) nx |= arg == "NX";
+            if (!keys_.insert(args[1]).second && nx) return "$-1\r\n";
+            return "+OK\r\n";
+        }
+        return "-ERR unknown command\r\n";
+    }
+
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_{true};
+    std::thread accept_thread_;
+    std::vector<std::thread> workers_; // accept thread only, joined after it
+    std::mutex mutex_;
+    std::set<std::string> keys_;
+};
+
+} // namespace
+
+// A Redis restart: dedup falls back to the filter while it is gone and
+// goes back to Redis after, delivering the marks of the batch that failed
+static void check_redis_recovery() {
+    FakeRedis redis;
+    Deduplicator dedup;
+    assert(dedup.init_redis("127.0.0.1", redis.port()));
+    
+    // Filter negatives: new for sure, their marks wait for the next batch
+    V first = {"http://r.example/a", "http://r.example/b"};
+    assert(dedup.filter_unseen(first) == first);
+    assert(redis.keys() == 0);
+    
+    // A "maybe" needs Redis, which is gone: counted as seen
+    redis.stop();
+    assert(dedup.filter_unseen(V{"http://r.example/a"}).empty());
+    
+    // Back with an empty keyspace; the pool reconnects within an interval
+    redis.start();
+    std::this_thread::sleep_for(RedisPool::kReconnectInterval + std::chrono::milliseconds(200));
+    assert((dedup.filter_unseen(V{"http://r.example/a"}) == V{"http://r.example/a"}));
+    assert(dedup.redis_misses() == 1);
+    assert(redis.keys() == 2);
+}
+
+int main() {
+    std::string dir = (std::filesystem::temp_directory_path() / "test_dedup").string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    
+    for (bool url_filter : {true, false}) {
+        std::string config_path = dir + "/config.yaml";
+        {
+            std::ofstream out(config_path);
+            out << "dedup:\n"
+                << "  url_filter_enabled: " << (url_filter ? "true" : "false") << "\n"
+                << "  expected_urls: 10000\n"
+                << "  near_dup_enabled: false\n"
+                << "storage:\n  data_dir: \"" << dir << "\"\n";
+        }
+        assert(Config::instance().load(config_path));
+        check_local_batches(url_filter);
+    }
+    
+    {
+        std::string config_path = dir + "/config.yaml";
+        std::ofstream out(config_path);
+        out << "dedup:\n  url_filter_enabled: true\n  expected_urls: 10000\n  near_dup_enabled: false\n"
+            << "redis:\n  connection_pool_size: 1\n  timeout_ms: 200\n"
+            << "storage:\n  data_dir: \"" << dir << "\"\n";
+        out.close();
+        assert(Config::instance().load(config_path));
+        check_redis_recovery();
+    }
+    
+    std::filesystem::remove_all(dir);
+    return 0;
+}
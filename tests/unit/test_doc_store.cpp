@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../../src/storage/doc_store.h"
+
+int main() {
+    using namespace crawler;
+
+    std::string dir = (std::filesystem::temp_directory_path() / "test_doc_store").string();
+    std::filesystem::remove_all(dir);
+
+    auto page = [](int i) {
+        return "<html><body>page " + std::to_string(i) + " " + std::string(200 + i % 7, 'x') + "</body></html>";
+    };
+    auto file_exists = [&](const std::string& name) {
+        return std::filesystem::exists(dir + "/" + name);
+    };
+
+    // Pages read back before and after they are written; small segments roll
+    {
+        DocStore store(dir, 512, 1024, true);
+        assert(store.open());
+        assert(store.append(1, "http://example.com/", {{"status", "200"}}, page(1)));
+
+        StoredDocument doc;
+        assert(store.read(1, doc));
+        assert(doc.doc_id == 1 && doc.url == "http://example.com/");
+        assert(doc.metadata.at("status") == "200");
+        assert(doc.content == page(1));
+
+        for (int i = 2; i <= 100; i++) {
+            assert(store.append(i, "http://example.com/" + std::to_string(i), {}, page(i)));
+            if (i % 10 == 0) assert(store.flush());
+        }
+        assert(store.flush());
+        assert(store.document_count() == 100);
+        assert(store.segment_count() > 1);
+        assert(file_exists("store_0.idx"));
+        assert(!store.read(101, doc));
+
+        // Blocks of repetitive html shrink
+        assert(store.bytes_written() < 100 * 200);
+
+        // A later append replaces the page
+        assert(store.append(7, "http://example.com/7", {}, "replaced"));
+        assert(store.read(7, doc) && doc.content == "replaced");
+    }
+
+    // Everything is there after a reopen, and the replacement still wins
+    {
+        DocStore store(dir, 512, 1024, true);
+        assert(store.open());
+        assert(store.document_count() == 100);
+        StoredDocument doc;
+        for (int i = 1; i <= 100; i++) {
+            assert(store.read(i, doc));
+            assert(doc.content == (i == 7 ? "replaced" : page(i)));
+        }
+        auto ids = store.doc_ids();
+        assert(ids.front() == 1 && ids.back() == 100);
+    }
+
+    // A torn block at the end of the last segment is cut off on open
+    {
+        std::vector<uint32_t> segments;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            unsigned int id = 0;
+            if (std::sscanf(entry.path().filename().string().c_str(), "store_%u.seg", &id) == 1) {
+                segments.push_back(id);
+            }
+        }
+        std::string last = dir + "/store_" + std::to_string(*std::max_element(segments.begin(), segments.end())) +
+                           ".seg";
+        auto size = std::filesystem::file_size(last);
+        {
+            std::ofstream out(last, std::ios::binary | std::ios::app);
+            out << "DBLK half a block";
+        }
+
+        DocStore store(dir, 512, 1024, true);
+        assert(store.open());
+        assert(std::filesystem::file_size(last) == size);
+        assert(store.document_count() == 100);
+        assert(store.append(101, "http://example.com/101", {}, "after the tear"));
+        assert(store.flush());
+        StoredDocument doc;
+        assert(store.read(101, doc) && doc.content == "after the tear");
+    }
+
+    // Uncompressed blocks, and WARC export with one gzip member per record
+    {
+        std::string raw_dir = dir + "/raw";
+        DocStore store(raw_dir, 1 << 20, 1 << 16, false);
+        assert(store.open());
+        assert(store.append(2, "http://example.com/b", {{"content_type", "text/plain"}}, "plain text"));
+        assert(store.append(1, "http://example.com/a", {}, page(1)));
+
+        std::string warc_path = dir + "/export.warc";
+        assert(store.export_warc(warc_path));
+        std::ifstream in(warc_path, std::ios::binary);
+        std::string warc((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        assert(warc.rfind("WARC/1.1\r\nWARC-Type: warcinfo\r\n", 0) == 0);
+        size_t first = warc.find("WARC-Target-URI: http://example.com/a\r\n");
+        size_t second = warc.find("WARC-Target-URI: http://example.com/b\r\n");
+        assert(first != std::string::npos && second != std::string::npos && first < second);
+        assert(warc.find("Content-Type: text/plain\r\nContent-Length: 10\r\n\r\nplain text\r\n\r\n") !=
+               std::string::npos);
+
+        assert(store.export_warc(warc_path + ".gz"));
+        std::ifstream gz(warc_path + ".gz", std::ios::binary);
+        assert(gz.get() == 0x1f && gz.get() == 0x8b);
+    }
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include "../../src/scheduler/frontier.h"
+#include "../../src/scheduler/frontier_spill.h"
+
+int main() {
+    using namespace crawler;
+    using Clock = HostFrontier::Clock;
+    
+    // slow.com allows 1 request/sec, fast.com is unlimited
+    HostFrontier frontier([](const std::string& host) {
+        return host == "slow.com" ? 1.0 : 0.0;
+    });
+    
+    auto make_task = [](const std::string& url) {
+        CrawlTask task;
+        task.url = url;
+        task.next_retry_time = Clock::now();
+        return task;
+    };
+    
+    frontier.push(make_task("https://slow.com/1"));
+    frontier.push(make_task("https://slow.com/2"));
+    frontier.push(make_task("https://fast.com/1"));
+    frontier.push(make_task("https://fast.com/2"));
+    assert(frontier.size() == 4);
+    assert(frontier.host_count() == 2);
+    
+    // Per-host FIFO order, and a rate-limited host does not block the other
+    auto now = Clock::now();
+    Clock::time_point next_ready;
+    CrawlTask task;
+    int slow = 0, fast = 0;
+    while (frontier.pop_ready(task, now, next_ready)) {
+        if (task.url.find("slow.com") != std::string::npos) {
+            assert(task.url == (slow == 0 ? "https://slow.com/1" : "https://slow.com/2"));
+            slow++;
+        } else {
+            fast++;
+        }
+    }
+    assert(slow == 1);
+    assert(fast == 2);
+    
+    // Next slow.com token is about one second away
+    assert(next_ready > now + std::chrono::milliseconds(900));
+    assert(next_ready <= now + std::chrono::milliseconds(1100));
+    assert(frontier.pop_ready(task, next_ready, next_ready));
+    assert(task.url == "https://slow.com/2");
+    assert(frontier.empty());
+    
+    // Backoff holds a host back until the given time
+    frontier.push(make_task("https://fast.com/3"));
+    auto until = Clock::now() + std::chrono::seconds(5);
+    frontier.backoff("fast.com", until);
+    assert(!frontier.pop_ready(task, Clock::now(), next_ready));
+    assert(next_ready >= until);
+    assert(frontier.pop_ready(task, until, next_ready));
+    
+    // Failure counting for exponential backoff
+    assert(frontier.record_failure("fast.com") == 1);
+    assert(frontier.record_failure("fast.com") == 2);
+    frontier.record_success("fast.com");
+    assert(frontier.record_failure("fast.com") == 1);
+    
+    // An explicit port keeps its own queue but the host's rate limit
+    {
+        HostFrontier ported([](const std::string& host) {
+            return host == "slow.com" ? 1.0 : 0.0;
+        });
+        ported.push(make_task("https://slow.com:8080/1"));
+        ported.push(make_task("https://slow.com:8080/2"));
+        ported.push(make_task("https://slow.com/1"));
+        assert(ported.host_count() == 2);
+        auto start = Clock::now();
+        int popped = 0;
+        while (ported.pop_ready(task, start, next_ready)) popped++;
+        assert(popped == 2);
+        assert(next_ready > start + std::chrono::milliseconds(900));
+        assert(ported.pop_ready(task, next_ready, next_ready));
+        assert(task.url == "https://slow.com:8080/2");
+    }
+    
+    // Drained hosts are recycled, so the host table and its memory track
+    // live hosts only; a reused slot never serves its old host's stale entries
+    {
+        HostFrontier recycling([](const std::string& host) {
+            return host == "slow.com" ? 1.0 : 0.0;
+        });
+        size_t empty_bytes = recycling.resident_bytes();
+        for (int i = 0; i < 1000; i++) {
+            std::string url = "https://host" + std::to_string(i) + ".com/";
+            recycling.push(make_task(url));
+            assert(recycling.pop_ready(task, Clock::now(), next_ready));
+            assert(task.url == url);
+        }
+        assert(recycling.host_count() <= 2);
+        
+        // slow.com just spent its only token: it is kept, not handed a fresh
+        // bucket, until that token is back
+        recycling.push(make_task("https://slow.com/1"));
+        assert(recycling.pop_ready(task, Clock::now(), next_ready));
+        recycling.push(make_task("https://other.com/1"));
+        assert(recycling.pop_ready(task, Clock::now(), next_ready));
+        recycling.push(make_task("https://slow.com/2"));
+        assert(!recycling.pop_ready(task, Clock::now(), next_ready));
+        assert(next_ready > Clock::now() + std::chrono::milliseconds(500));
+        assert(recycling.pop_ready(task, next_ready, next_ready));
+        assert(task.url == "https://slow.com/2");
+        assert(recycling.empty());
+        assert(recycling.resident_bytes() > empty_bytes);
+        
+        // Once its bucket refilled, it goes too
+        auto later = Clock::now() + std::chrono::seconds(5);
+        while (Clock::now() < later) {
+            recycling.push(make_task("https://other.com/2"));
+            assert(recycling.pop_ready(task, Clock::now(), next_ready));
+            if (recycling.host_count() <= 1) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        assert(recycling.host_count() <= 1);
+    }
+    
+    // Spill mode: a zero budget keeps only the head of each host in memory,
+    // and per-host FIFO order survives the round trip through disk
+    {
+        std::string dir = (std::filesystem::temp_directory_path() / "test_frontier_spill").string();
+        FrontierSpillStore store(dir, 4096);
+        HostFrontier spilling([](const std::string&) { return 0.0; });
+        spilling.enable_spill(&store, 0, 8);
+        
+        const int per_host = 500;
+        for (int i = 0; i < per_host; i++) {
+            spilling.push(make_task("https://a.com/page/" + std::to_string(i)));
+            spilling.push(make_task("https://b.com/page/" + std::to_string(i)));
+        }
+        assert(spilling.size() == 2 * per_host);
+        assert(spilling.spilled_tasks() > 0);
+        assert(store.bytes_on_disk() > 0);
+        assert(store.segment_count() > 1);
+        
+        int next_a = 0, next_b = 0;
+        while (spilling.pop_ready(task, Clock::now(), next_ready)) {
+            if (task.url.find("a.com") != std::string::npos) {
+                assert(task.url == "https://a.com/page/" + std::to_string(next_a++));
+            } else {
+                assert(task.url == "https://b.com/page/" + std::to_string(next_b++));
+            }
+        }
+        assert(next_a == per_host && next_b == per_host);
+        assert(spilling.empty());
+        assert(spilling.spilled_tasks() == 0);
+        assert(store.segment_count() <= 1);
+    }
+    
+    return 0;
+}
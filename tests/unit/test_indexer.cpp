@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "../../src/indexer/indexer.h"
+#include "../../src/indexer/snippet.h"
+#include "../../src/indexer/query_cache.h"
+#include "../../src/parser/tokenizer.h"
+#include "../../src/utils/config.h"
+
+using namespace crawler;
+
+static ParsedDocument make_doc(const std::string& url, const std::string& text) {
+    ParsedDocument doc;
+    doc.url = url;
+    doc.title = "Title of " + url;
+    doc.text_content = text;
+    doc.token_buffer.assign(text.begin(), text.end());
+    Tokenizer::tokenize(doc.token_buffer.data(), doc.token_buffer.size(), doc.tokens);
+    for (size_t i = 0; i < doc.tokens.size(); i++) {
+        doc.term_positions[doc.tokens[i]].push_back(i);
+    }
+    return doc;
+}
+
+static std::vector<uint64_t> ids_of(const std::vector<SearchResult>& results) {
+    std::vector<uint64_t> ids;
+    for (const auto& result : results) ids.push_back(result.doc_id);
+    return ids;
+}
+
+int main() {
+    std::string dir = std::filesystem::temp_directory_path().string() +
+                      "/test_indexer_" + std::to_string(getpid());
+    std::filesystem::remove_all(dir);
+
+    // Posting lists spanning several blocks plus an unsealed tail
+    {
+        PostingListBuilder builder;
+        std::vector<uint32_t> positions;
+        for (uint32_t doc = 0; doc < 300; doc++) {
+            positions.clear();
+            for (uint32_t k = 0; k < doc % 4; k++) {
+                positions.push_back(k * 70000 + doc);
+            }
+            builder.add(doc * 1000 + (doc == 299 ? 16777216 : 0), positions, 10 + doc);
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            auto cursor = builder.cursor();
+            for (uint32_t doc = 0; doc < 300; doc++) {
+                assert(cursor.next());
+                assert(cursor.doc() == doc * 1000 + (doc == 299 ? 16777216 : 0));
+                assert(cursor.freq() == doc % 4);
+                if (doc % 3 == 0) {
+                    auto read = cursor.positions();
+                    for (uint32_t k = 0; k < read.size(); k++) {
+                        assert(read[k] == k * 70000 + doc);
+                    }
+                }
+            }
+            assert(!cursor.next());
+            builder.finish();
+        }
+        assert(builder.doc_freq() == 300 && builder.max_freq() == 3 && builder.min_length() == 10);
+
+        // Skipping: whole blocks by their headers, then within a block
+        auto cursor = builder.cursor();
+        assert(cursor.seek_block(200000) && cursor.block_last() == 255000);
+        assert(cursor.block_max_freq() == 3 && cursor.block_min_length() == 10 + 128);
+        assert(cursor.advance(200001) && cursor.doc() == 201000);
+        assert(cursor.advance(201000) && cursor.doc() == 201000);
+        assert(cursor.next() && cursor.doc() == 202000);
+        assert(cursor.advance(16777216) && cursor.doc() == 299000 + 16777216);
+        assert(!cursor.advance(299000 + 16777217));
+
+        std::vector<uint32_t> values = {0, 255, 256, 65536, 16777216, 0xFFFFFFFF, 7};
+        std::string encoded;
+        StreamVByte::encode(values.data(), values.size(), encoded);
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(encoded.data());
+        assert(StreamVByte::encoded_size(in, values.size()) == encoded.size());
+        std::vector<uint32_t> decoded(values.size());
+        assert(StreamVByte::decode(in, in + encoded.size(), values.size(), decoded.data()) ==
+               in + encoded.size());
+        assert(decoded == values);
+        assert(!StreamVByte::decode(in, in + encoded.size() - 1, values.size(), decoded.data()));
+    }
+
+    // Segment file round trip
+    {
+        std::filesystem::create_directories(dir);
+        SegmentWriter writer;
+        assert(writer.open(dir + "/one.idx"));
+        StoredFields fields;
+        fields.url = "http://a.example/";
+        fields.text = "alpha beta";
+        fields.price = 9.5;
+        assert(writer.add_document(7, 2, fields) == 0);
+        fields.url = "http://b.example/";
+        assert(writer.add_document(9, 3, fields) == 1);
+        writer.start_term("alpha");
+        std::vector<uint32_t> positions = {0, 4};
+        writer.add_posting(0, positions);
+        writer.add_posting(1, std::vector<uint32_t>{1});
+        writer.start_term("beta");
+        writer.add_posting(1, std::vector<uint32_t>{2});
+        assert(writer.finish());
+
+        SegmentReader reader;
+        assert(reader.open(dir + "/one.idx"));
+        assert(reader.doc_count() == 2 && reader.term_count() == 2 && reader.total_length() == 5);
+        assert(reader.max_doc_id() == 9);
+
+        SegmentReader::TermInfo info;
+        assert(!reader.lookup("gamma", info));
+        assert(reader.lookup("alpha", info) && info.doc_freq == 2);
+        auto cursor = reader.postings(info);
+        assert(cursor.next() && cursor.doc() == 0 && cursor.freq() == 2);
+        auto read = cursor.positions();
+        assert(std::equal(read.begin(), read.end(), positions.begin(), positions.end()));
+        assert(cursor.next() && cursor.doc() == 1 && cursor.freq() == 1);
+        assert(!cursor.next());
+
+        uint32_t ordinal = 0;
+        assert(reader.find_doc(9, ordinal) && ordinal == 1);
+        assert(!reader.find_doc(8, ordinal));
+        StoredFields out;
+        assert(reader.stored_fields(1, out) && out.url == "http://b.example/" && out.price == 9.5);
+        std::filesystem::remove_all(dir);
+    }
+
+    // Flushed documents survive a restart and a merge
+    std::vector<uint64_t> before;
+    {
+        Indexer indexer(dir);
+        indexer.index_document(make_doc("http://one.example/", "Crawlers fetch documents"));
+        indexer.flush_segment();
+        indexer.index_document(make_doc("http://two.example/", "Search engines rank pages by relevance"));
+        indexer.flush_segment();
+        indexer.index_document(make_doc("http://three.example/", "Pages pages pages"));
+        assert(indexer.segment_count() == 2 && indexer.buffered_documents() == 1);
+
+        // Not searchable until the next refresh
+        assert(ids_of(indexer.search("pages", 10)) == std::vector<uint64_t>{2});
+        indexer.refresh();
+        assert(indexer.segment_count() == 2 && indexer.buffered_documents() == 1);
+        before = ids_of(indexer.search("pages", 10));
+        assert(before.size() == 2 && before[0] == 3);
+        auto results = indexer.search("relevance", 10);
+        assert(results.size() == 1 && results[0].url == "http://two.example/");
+        assert(results[0].snippet == "Search engines rank pages by relevance");
+    }
+    {
+        Indexer indexer(dir);
+        assert(indexer.total_documents() == 3 && indexer.segment_count() == 3);
+        assert(ids_of(indexer.search("pages", 10)) == before);
+
+        indexer.merge_segments();
+        assert(indexer.segment_count() == 1);
+        assert(ids_of(indexer.search("pages", 10)) == before);
+        assert(indexer.search("crawlers", 10).at(0).url == "http://one.example/");
+
+        // Doc ids continue after the persisted ones
+        assert(indexer.index_document(make_doc("http://four.example/", "more pages")) == 4);
+    }
+    std::filesystem::remove_all(dir);
+
+    // A merge whose manifest cannot be written is still published, and its
+    // inputs stay on disk until a later manifest drops them
+    {
+        Indexer indexer(dir);
+        indexer.index_document(make_doc("http://a.example/", "alpha pages"));
+        indexer.flush_segment();
+        indexer.index_document(make_doc("http://b.example/", "beta pages"));
+        indexer.flush_segment();
+        // A directory on the manifest's temp path makes the write fail
+        std::filesystem::create_directory(dir + "/segments.tmp");
+        indexer.merge_segments();
+        assert(indexer.segment_count() == 1);
+        assert(indexer.search("pages", 10).size() == 2);
+        assert(std::filesystem::exists(dir + "/segment_0.idx"));
+        assert(std::filesystem::exists(dir + "/segment_1.idx"));
+
+        std::filesystem::remove(dir + "/segments.tmp");
+        indexer.index_document(make_doc("http://c.example/", "gamma pages"));
+        indexer.flush_segment();
+        assert(!std::filesystem::exists(dir + "/segment_0.idx"));
+        assert(!std::filesystem::exists(dir + "/segment_1.idx"));
+    }
+    {
+        Indexer indexer(dir);
+        assert(indexer.total_documents() == 3 && indexer.search("pages", 10).size() == 3);
+    }
+    std::filesystem::remove_all(dir);
+
+    // Deleted documents vanish from search, and merges drop them while
+    // copying untouched posting blocks as they are
+    {
+        Indexer indexer(dir);
+        for (int i = 0; i < 200; i++) {
+            indexer.index_document(make_doc("http://d.example/" + std::to_string(i), "common words"));
+        }
+        indexer.flush_segment();
+        indexer.index_document(make_doc("http://d.example/last", "common"));
+        assert(indexer.delete_document(50) && !indexer.delete_document(50));
+        assert(indexer.delete_document(201));
+        assert(!indexer.delete_document(999));
+        assert(indexer.total_documents() == 199);
+
+        indexer.refresh();
+        auto ids = ids_of(indexer.search("common", 1000));
+        assert(ids.size() == 199);
+        assert(std::find(ids.begin(), ids.end(), 50) == ids.end());
+
+        indexer.merge_segments();
+        assert(indexer.segment_count() == 1 && indexer.search("common", 1000).size() == 199);
+        assert(indexer.search("words", 1000).size() == 199);
+        assert(indexer.search("common", 1000).back().url.rfind("http://d.example/", 0) == 0);
+    }
+    {
+        // Merged away ids are not handed out again
+        Indexer indexer(dir);
+        assert(indexer.total_documents() == 199 && indexer.search("common", 1000).size() == 199);
+        assert(indexer.index_document(make_doc("http://d.example/next", "common")) == 202);
+    }
+    std::filesystem::remove_all(dir);
+
+    // Pruned top-k agrees with scoring every posting (k above the doc count)
+    {
+        Indexer indexer(dir);
+        const char* words[] = {"alpha", "beta", "gamma", "delta", "epsilon"};
+        for (int i = 0; i < 600; i++) {
+            std::string text;
+            for (int w = 0; w < 5; w++) {
+                for (int r = 0; r < (i * (w + 3)) % (w + 2); r++) text += std::string(words[w]) + " ";
+            }
+            text += "filler words " + std::to_string(i % 7);
+            indexer.index_document(make_doc("http://s.example/" + std::to_string(i), text));
+            if (i % 250 == 249) indexer.flush_segment();
+            if (i % 40 == 39) indexer.refresh();
+        }
+        indexer.refresh();
+        for (const char* query : {"alpha", "alpha beta", "epsilon gamma delta", "beta filler", "alpha gamma nothing"}) {
+            auto all = indexer.search(query, 10000);
+            auto top = indexer.search(query, 10);
+            assert(top.size() == std::min<size_t>(10, all.size()));
+            for (size_t i = 0; i < top.size(); i++) {
+                assert(top[i].doc_id == all[i].doc_id && std::abs(top[i].score - all[i].score) < 1e-9);
+            }
+        }
+        assert(indexer.search("alpha", 0).empty());
+    }
+    std::filesystem::remove_all(dir);
+
+    // Queries tokenize like documents, and quoted words must be adjacent
+    {
+        Query query = Query::parse("Apple, \"New  York\" apple \"york\"");
+        assert((query.terms == std::vector<std::string>{"apple", "new", "york"}));
+        assert(query.phrases.size() == 1 && (query.phrases[0] == std::vector<size_t>{1, 2}));
+
+        std::vector<uint32_t> a = {1, 9, 40, 90}, b = {3, 41, 77}, c = {42};
+        std::vector<std::span<const uint32_t>> words = {a, b, c};
+        assert(phrase_match(words));
+        words = {b, a};
+        assert(!phrase_match(words));
+
+        Bm25 bm25{1.2, 0.75, 10.0};
+        std::vector<double> idfs = {1.0, 1.0};
+        std::vector<std::span<const uint32_t>> near = {a, b}, far = {a, c};
+        assert(proximity_score(near, idfs, bm25, 10) > proximity_score(far, idfs, bm25, 10));
+
+        Indexer indexer(dir);
+        indexer.index_document(make_doc("http://p.example/1", "York is new; new york is old"));
+        indexer.index_document(make_doc("http://p.example/2", "New, and York."));
+        indexer.index_document(make_doc("http://p.example/3", "An Apple, new"));
+        indexer.refresh();
+        assert((ids_of(indexer.search("\"NEW YORK\"", 10)) == std::vector<uint64_t>{1}));
+        assert(ids_of(indexer.search("\"new york\" apple", 10)).size() == 1);
+        assert((ids_of(indexer.search("apple", 10)) == std::vector<uint64_t>{3}));
+    }
+    std::filesystem::remove_all(dir);
+
+    // Roaring bitmaps switch containers and intersect across them
+    {
+        RoaringBitmap dense, sparse;
+        for (uint32_t v = 0; v < 10000; v++) dense.add(v * 2);
+        for (uint32_t v : {7u, 4000u, 9998u, 70000u, 5u}) sparse.add(v);
+        assert(dense.cardinality() == 10000 && dense.contains(19998) && !dense.contains(19999));
+        uint32_t next = 0;
+        assert(dense.next(3, next) && next == 4 && !dense.next(19999, next));
+        assert(sparse.next(8, next) && next == 4000 && sparse.next(9999, next) && next == 70000);
+        RoaringBitmap both = RoaringBitmap::intersect(dense, sparse);
+        assert(both.cardinality() == 2 && both.contains(4000) && both.contains(9998));
+        assert(RoaringBitmap::intersect(dense, dense).cardinality() == 10000);
+    }
+
+    // Filters and facets over doc values, in files and in memory
+    {
+        Indexer indexer(dir);
+        const char* brands[] = {"acme", "globex", "initech"};
+        for (int i = 0; i < 300; i++) {
+            std::unordered_map<std::string, std::string> metadata = {
+                {"category", i % 2 ? "shoes" : "hats"}, {"brand", brands[i % 3]},
+                {"price", std::to_string(i)}};
+            indexer.index_document(make_doc("http://f.example/" + std::to_string(i), "red item"), metadata);
+            if (i == 199) indexer.flush_segment();
+        }
+        indexer.delete_document(1);
+        indexer.refresh();
+
+        SearchFilter filter;
+        filter.category = "hats";
+        filter.brand = "acme";
+        auto results = indexer.search("red", 1000, filter);
+        assert(results.size() == 49); // multiples of 6 below 300 but the deleted 0
+        for (const auto& result : results) {
+            assert(result.category == "hats" && result.brand == "acme" && int(result.price) % 6 == 0);
+        }
+
+        filter.min_price = 100;
+        filter.max_price = 150;
+        Facets facets;
+        results = indexer.search("red item", 1000, filter, &facets);
+        assert(results.size() == 9 && facets.matches == 9); // 102, 108, ..., 150
+        assert(facets.categories.size() == 1 && facets.categories[0].value == "hats");
+
+        filter = SearchFilter();
+        filter.brand = "nobody";
+        assert(indexer.search("red", 10, filter).empty());
+
+        results = indexer.search("red", 0, SearchFilter(), &facets);
+        assert(results.empty() && facets.matches == 299);
+        assert(facets.brands.size() == 3 && facets.brands[0].value == "globex" && facets.brands[0].count == 100);
+        assert(facets.brands[2].value == "acme" && facets.brands[2].count == 99);
+    }
+    std::filesystem::remove_all(dir);
+
+    // Snippets show the densest run of query terms, cut at words
+    {
+        std::string text = "Intro words. ";
+        for (int i = 0; i < 40; i++) text += "filler" + std::to_string(i) + " ";
+        text += "the Crawler visits, the crawler parses pages. ";
+        for (int i = 0; i < 40; i++) text += "padding" + std::to_string(i) + " ";
+        std::string snippet = make_snippet(text, {"crawler", "pages"}, 80);
+        assert(snippet.size() <= 86 && snippet.rfind("...", 0) == 0);
+        assert(snippet.find("Crawler visits, the crawler parses pages.") != std::string::npos);
+        assert(snippet.substr(snippet.size() - 3) == "...");
+        assert(make_snippet(text, {"absent"}, 20) == "Intro words. filler0...");
+        assert(make_snippet("short text", {"text"}) == "short text");
+
+        // Stored fields span several compressed blocks and survive a merge
+        Indexer indexer(dir);
+        for (int i = 0; i < 100; i++) {
+            std::string body = "block" + std::to_string(i) + " " + std::string(900, 'x') + " tail" + std::to_string(i);
+            indexer.index_document(make_doc("http://b.example/" + std::to_string(i), body));
+            if (i == 49) indexer.flush_segment();
+        }
+        indexer.merge_segments();
+        for (int i : {0, 17, 49, 50, 99}) {
+            auto results = indexer.search("tail" + std::to_string(i), 1);
+            assert(results.size() == 1 && results[0].url == "http://b.example/" + std::to_string(i));
+            assert(results[0].snippet.find("tail" + std::to_string(i)) != std::string::npos);
+        }
+    }
+    std::filesystem::remove_all(dir);
+
+    // Cached responses go stale with the index generation, and popular
+    // keys are not displaced by one-off ones
+    {
+        assert(QueryCache::key("Laptop, bag", 10) == QueryCache::key("bag laptop", 10));
+        assert(QueryCache::key("laptop", 10) != QueryCache::key("laptop", 20));
+        assert(QueryCache::key("\"red bag\"", 10) != QueryCache::key("red bag", 10));
+
+        QueryCache cache(4 * 1024, 1);
+        std::string value;
+        assert(!cache.get("hot", 1, value));
+        cache.put("hot", 1, std::string(1000, 'h'));
+        assert(cache.get("hot", 1, value) && value.size() == 1000);
+        assert(!cache.get("hot", 2, value) && cache.memory_bytes() == 0);
+        cache.put("hot", 2, std::string(1000, 'h'));
+        for (int i = 0; i < 5; i++) cache.get("hot", 2, value);
+        for (int i = 0; i < 20; i++) {
+            cache.put("cold" + std::to_string(i), 2, std::string(1000, 'c'));
+        }
+        assert(cache.get("hot", 2, value));
+        assert(cache.memory_bytes() <= 4 * 1024 && cache.hits() == 7);
+
+        Indexer indexer(dir);
+        uint64_t generation = indexer.generation();
+        indexer.index_document(make_doc("http://c.example/", "cached"));
+        assert(indexer.generation() == generation);
+        indexer.refresh();
+        assert(indexer.generation() != generation);
+    }
+    std::filesystem::remove_all(dir);
+
+    // Searches run on snapshots while documents are indexed and deleted
+    {
+        Indexer indexer(dir);
+        std::atomic<bool> done{false};
+        std::thread reader([&] {
+            while (!done) {
+                assert(indexer.search("stream", 1000).size() <= 300);
+            }
+        });
+        for (int i = 0; i < 300; i++) {
+            indexer.index_document(make_doc("http://r.example/" + std::to_string(i), "stream of pages"));
+            if (i % 20 == 19) indexer.refresh();
+            if (i % 100 == 99) indexer.flush_segment();
+            if (i % 50 == 49) indexer.delete_document(i);
+        }
+        indexer.refresh();
+        done = true;
+        reader.join();
+        assert(indexer.search("stream", 1000).size() == 294);
+    }
+    std::filesystem::remove_all(dir);
+
+    // Background merging once merge_threshold same-tier segments pile up
+    {
+        std::filesystem::create_directories(dir);
+        std::string config_path = dir + "/config.yaml";
+        {
+            std::ofstream out(config_path);
+            out << "indexer:\n  merge_threshold: 3\n  merge_mb_per_sec: 0\n";
+        }
+        assert(Config::instance().load(config_path));
+
+        Indexer indexer(dir + "/index");
+        for (int i = 0; i < 9; i++) {
+            indexer.index_document(make_doc("http://m.example/" + std::to_string(i), "merge me"));
+            if (i == 4) {
+                assert(indexer.delete_document(3));
+            }
+            indexer.flush_segment();
+        }
+        for (int wait = 0; wait < 500 && indexer.segment_count() >= 3; wait++) {
+            usleep(10000);
+        }
+        assert(indexer.segment_count() < 3 && indexer.merges_completed() > 0);
+        auto ids = ids_of(indexer.search("merge", 100));
+        std::sort(ids.begin(), ids.end());
+        assert((ids == std::vector<uint64_t>{1, 2, 4, 5, 6, 7, 8, 9}));
+    }
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
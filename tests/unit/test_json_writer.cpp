@@ -0,0 +1,59 @@
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include "../../src/api/json_writer.h"
+
+int main() {
+    using namespace crawler;
+    
+    // Commas between members and elements, none after the last
+    {
+        std::string out;
+        JsonWriter json(out);
+        json.begin_object();
+        json.key("results");
+        json.begin_array();
+        json.begin_object();
+        json.key("doc_id");
+        json.value(uint64_t{18446744073709551615ULL});
+        json.key("score");
+        json.value(1.5);
+        json.end_object();
+        json.begin_object();
+        json.end_object();
+        json.end_array();
+        json.key("total");
+        json.value(-2);
+        json.key("cached");
+        json.value(false);
+        json.key("next");
+        json.null();
+        json.end_object();
+        assert(out == R"({"results":[{"doc_id":18446744073709551615,"score":1.5},{}],"total":-2,"cached":false,"next":null})");
+    }
+    
+    // Escapes, and bytes that are not UTF-8 replaced rather than passed on
+    {
+        std::string out;
+        JsonWriter json(out);
+        json.begin_array();
+        json.value("a\"b\\c\n\t\x01");
+        json.value("caf\xc3\xa9 \xe2\x82\xac");
+        json.value("bad\xff\xc3");
+        json.value(std::nan(""));
+        json.end_array();
+        assert(out == "[\"a\\\"b\\\\c\\n\\t\\u0001\",\"caf\xc3\xa9 \xe2\x82\xac\",\"bad\\ufffd\\ufffd\",null]");
+    }
+    
+    // Writing appends, so a reused buffer only needs clearing
+    {
+        std::string out = "x";
+        out.clear();
+        JsonWriter json(out);
+        json.value(0.1);
+        assert(out == "0.1");
+    }
+    
+    return 0;
+}
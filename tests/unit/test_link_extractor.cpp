@@ -0,0 +1,54 @@
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../../src/parser/link_extractor.h"
+
+using crawler::StreamingLinkExtractor;
+
+// Feed `html` in chunks of `chunk` bytes
+static std::vector<std::string> links_of(const std::string& html, size_t chunk) {
+    StreamingLinkExtractor extractor("http://example.com/dir/index.html");
+    std::vector<std::string> links;
+    for (size_t pos = 0; pos < html.size(); pos += chunk) {
+        extractor.feed(std::string_view(html).substr(pos, chunk), links);
+    }
+    return links;
+}
+
+int main() {
+    using V = std::vector<std::string>;
+
+    std::string html =
+        "<!DOCTYPE html><html><head><title>a < b</title>"
+        "<script>var s = '<a href=\"http://script.example/\">';</script>"
+        "<style>a > b { color: red }</style>"
+        "</head><body>"
+        "<!-- <a href=\"http://comment.example/\"> -->"
+        "<A HREF=\"http://a.example/x?p=1&amp;q=2\">one</A>"
+        "<a class='c' href='http://b.example/'>two</a>"
+        "<a href=page.html>three</a>"
+        "<a href=\"http://skip.example/\" rel=\"sponsored nofollow\">ad</a>"
+        "<a href=\"javascript:void(0)\">js</a>"
+        "<a href=\"#top\">top</a>"
+        "<a title=\"x > y\" href=\"http://c.example/\">four</a>"
+        "</body></html>";
+    V expected = {"http://a.example/x?p=1&q=2", "http://b.example/",
+                  "http://example.com/dir/page.html", "http://c.example/"};
+
+    // Same links whatever the chunk boundaries
+    for (size_t chunk : {html.size(), size_t(1), size_t(2), size_t(7), size_t(64)}) {
+        assert(links_of(html, chunk) == expected);
+    }
+
+    // <meta name=robots content=nofollow> stops link output
+    assert(links_of("<a href='http://x.example/'></a>"
+                    "<meta name=\"ROBOTS\" content=\"noindex, nofollow\">"
+                    "<a href='http://y.example/'></a>", 3) == V{"http://x.example/"});
+
+    // <base href> rebases relative links
+    assert(links_of("<base href=\"http://cdn.example/root/\"><a href=\"p\">p</a>", 5) ==
+           V{"http://cdn.example/root/p"});
+
+    return 0;
+}
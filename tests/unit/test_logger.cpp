@@ -0,0 +1,93 @@
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../src/observability/logger.h"
+
+namespace {
+
+std::vector<std::string> read_lines(const std::string& path) {
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) lines.push_back(line);
+    return lines;
+}
+
+} // namespace
+
+int main() {
+    using namespace crawler;
+
+    std::string path = (std::filesystem::temp_directory_path() / "test_logger" / "out.log").string();
+    std::filesystem::remove_all(std::filesystem::path(path).parent_path());
+    auto& logger = Logger::instance();
+
+    // A small ring that blocks when full loses nothing
+    logger.init("info", "json", path, 4096, true);
+    logger.debug("filtered out");
+    logger.info("say \"hi\"\n\tback\\slash", "req-1");
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&logger, t]() {
+            for (int i = 0; i < 2000; i++) {
+                logger.warn("thread " + std::to_string(t) + " message " + std::to_string(i));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    logger.flush();
+
+    auto lines = read_lines(path);
+    assert(lines.size() == 1 + 4 * 2000);
+    assert(logger.dropped() == 0);
+
+    // Escaped as JSON, fields in order
+    const std::string& first = lines[0];
+    assert(first.rfind("{\"timestamp\":\"", 0) == 0);
+    assert(first[first.find("\"level\"") - 3] == 'Z');
+    assert(first.find("\"level\":\"INFO\",\"request_id\":\"req-1\"") != std::string::npos);
+    assert(first.find("\"message\":\"say \\\"hi\\\"\\n\\tback\\\\slash\"}") != std::string::npos);
+
+    // Each thread's messages stay in order
+    for (int t = 0; t < 4; t++) {
+        std::string prefix = "\"message\":\"thread " + std::to_string(t) + " message ";
+        int next = 0;
+        for (const auto& line : lines) {
+            size_t at = line.find(prefix);
+            if (at == std::string::npos) continue;
+            assert(line.compare(at + prefix.size(), std::string::npos, std::to_string(next) + "\"}") == 0);
+            next++;
+        }
+        assert(next == 2000);
+    }
+
+    // Text format after a re-init; shutdown writes everything out
+    logger.init("debug", "text", path);
+    logger.debug("plain text", "req-2");
+    logger.shutdown();
+    lines = read_lines(path);
+    assert(lines.back().find(" [DEBUG] [req:req-2] plain text") == 23);
+
+    // Threads still logging into full rings while shutdown() runs neither
+    // hang nor lose messages
+    std::filesystem::remove(path);
+    logger.init("info", "text", path, 4096, true);
+    threads.clear();
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&logger]() {
+            for (int i = 0; i < 5000; i++) logger.info(std::string(200, 'x'));
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    logger.shutdown();
+    for (auto& thread : threads) thread.join();
+    assert(read_lines(path).size() == 4 * 5000);
+
+    std::filesystem::remove_all(std::filesystem::path(path).parent_path());
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../src/observability/metrics.h"
+
+int main() {
+    using namespace crawler;
+
+    auto& metrics = Metrics::instance();
+
+    // Shards written from many threads add up
+    Counter& pages = metrics.counter("test_pages");
+    assert(&pages == &metrics.counter("test_pages"));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10000; i++) pages.increment();
+            metrics.increment_counter("test_by_name", 2);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    assert(pages.value() == 80000);
+    assert(metrics.get_counter("test_by_name") == 16);
+
+    metrics.set_gauge("test_queue", 42);
+    assert(metrics.get_gauge("test_queue") == 42);
+    assert(metrics.get_gauge("test_missing") == 0);
+
+    // Buckets: 8 per power of two, the powers included in the one below
+    assert(Histogram::bucket_index(0) == 0);
+    assert(Histogram::bucket_index(-1) == 0);
+    assert(Histogram::bucket_upper_bound(Histogram::bucket_index(1.0)) == 1.0);
+    assert(Histogram::bucket_index(1.0) + 1 == Histogram::bucket_index(1.01));
+    assert(Histogram::bucket_index(1.0) + 8 == Histogram::bucket_index(2.0));
+    assert(Histogram::bucket_index(1e12) == Histogram::kBuckets - 1);
+
+    // Quantiles within a bucket's width of the truth
+    Histogram& latency = metrics.histogram("test_latency_ms");
+    for (int i = 1; i <= 1000; i++) latency.record(i);
+    auto snapshot = latency.snapshot();
+    assert(snapshot.count == 1000);
+    assert(snapshot.sum == 500500);
+    assert(std::abs(snapshot.quantile(0.5) - 500) < 500 / 8.0);
+    assert(std::abs(snapshot.quantile(0.99) - 990) < 990 / 8.0);
+
+    std::string text = metrics.to_prometheus();
+    assert(text.find("# TYPE test_pages counter\ntest_pages 80000\n") != std::string::npos);
+    assert(text.find("# TYPE test_latency_ms histogram\n") != std::string::npos);
+    assert(text.find("test_latency_ms_bucket{le=\"512\"} 512\n") != std::string::npos);
+    assert(text.find("test_latency_ms_bucket{le=\"+Inf\"} 1000\n") != std::string::npos);
+    assert(text.find("test_latency_ms_count 1000\n") != std::string::npos);
+    assert(text.find("test_latency_ms_p99 ") != std::string::npos);
+    assert(metrics.to_json().find("\"test_latency_ms\": {\"count\": 1000") != std::string::npos);
+
+    return 0;
+}
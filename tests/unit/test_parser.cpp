@@ -0,0 +1,77 @@
+#include <cassert>
+#include <string>
+#include <vector>
+#include "../../src/parser/parser.h"
+
+int main() {
+    using namespace crawler;
+    using V = std::vector<std::string>;
+    Parser parser;
+    
+    std::string html =
+        "<!DOCTYPE html><html lang=\"EN\"><head>"
+        "<title>Blue Widget</title>"
+        "<meta name=\"Description\" content=\"A sturdy widget\">"
+        "<meta name=\"keywords\" content=\"widget, blue\">"
+        "<meta property=\"og:price:amount\" content=\"19.99\">"
+        "<link rel=\"Canonical\" href=\"/widgets/blue\">"
+        "<base href=\"http://cdn.example/shop/\">"
+        "<script>var hidden = 'scripttext';</script>"
+        "<style>.hidden { content: 'styletext' }</style>"
+        "</head><body>"
+        "<h1>Widgets</h1>"
+        "<svg><title>icon title</title></svg>"
+        "<a href=\"item?id=1\">First <b>item</b></a>"
+        "<a href=\"/about\" rel=\"nofollow\">About</a>"
+        "<a href=\"https://other.example/\">Other</a>"
+        "</body></html>";
+    ParsedDocument doc = parser.parse("http://example.com/dir/page.html", html);
+    
+    // The <title> in <head> wins over one later in the body
+    assert(doc.title == "Blue Widget");
+    
+    // <meta> by lowercased name, shop markup under the indexer's aliases
+    assert(doc.metadata.at("description") == "A sturdy widget");
+    assert(doc.metadata.at("keywords") == "widget, blue");
+    assert(doc.metadata.at("price") == "19.99");
+    assert(doc.metadata.at("lang") == "en");
+    
+    // <link rel=canonical> resolves against the page (it precedes <base>)
+    assert(doc.canonical_url == "http://example.com/widgets/blue");
+    
+    // Anchors resolve against <base href>; rel=nofollow keeps the anchor
+    // text but not the outlink
+    assert((doc.links == V{"http://cdn.example/shop/item?id=1", "https://other.example/"}));
+    assert(doc.links_with_anchor.size() == 3);
+    assert(doc.links_with_anchor[0].first == "http://cdn.example/shop/item?id=1");
+    assert(doc.links_with_anchor[0].second.find("First") != std::string::npos);
+    assert(doc.links_with_anchor[0].second.find("item") != std::string::npos);
+    assert(doc.links_with_anchor[1].first == "http://cdn.example/about");
+    
+    // Text skips script and style
+    assert(doc.text_content.find("Widgets") != std::string::npos);
+    assert(doc.text_content.find("scripttext") == std::string::npos);
+    assert(doc.text_content.find("styletext") == std::string::npos);
+    assert(!doc.tokens.empty());
+    assert(doc.term_positions.count("widgets") == 1);
+    assert(!doc.noindex && !doc.nofollow);
+    
+    // Without a <title> in <head>, the first one in the body is used
+    doc = parser.parse("http://example.com/", "<html><body><title>Body Title</title><p>x</p></body></html>");
+    assert(doc.title == "Body Title");
+    
+    // meta robots, including "none" for both
+    doc = parser.parse("http://example.com/",
+                       "<html><head><meta name=\"robots\" content=\"NOINDEX, follow\"></head></html>");
+    assert(doc.noindex && !doc.nofollow);
+    doc = parser.parse("http://example.com/",
+                       "<html><head><meta name=\"ROBOTS\" content=\"none\"></head></html>");
+    assert(doc.noindex && doc.nofollow);
+    
+    // parse_into reuses a document; nothing carries over from the last page
+    parser.parse_into("http://example.com/plain", "<p>plain page</p>", doc);
+    assert(doc.title.empty() && doc.links.empty() && doc.canonical_url.empty());
+    assert(!doc.noindex && !doc.nofollow && doc.metadata.empty());
+    
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../../src/fetcher/replay_fetcher.h"
+
+using namespace crawler;
+
+namespace {
+
+void warc_record(std::ofstream& out, const std::string& type, const std::string& url, const std::string& block) {
+    out << "WARC/1.0\r\nWARC-Type: " << type << "\r\nWARC-Target-URI: " << url
+        << "\r\nContent-Length: " << block.size() << "\r\n\r\n" << block << "\r\n\r\n";
+}
+
+// Fetch every URL once through a fresh fetcher; false if some callback
+// never came
+bool replay(const ReplayOptions& options, const std::vector<std::string>& urls,
+            std::map<std::string, FetchResult>& results, size_t& callbacks) {
+    ReplayFetcher fetcher(options);
+    assert(fetcher.load());
+    assert(fetcher.start());
+
+    std::mutex mutex;
+    std::condition_variable done;
+    callbacks = 0;
+    for (const auto& url : urls) {
+        bool queued = fetcher.submit(url, [&, url](FetchResult result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            results[url] = std::move(result);
+            callbacks++;
+            done.notify_all();
+        });
+        assert(queued);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    bool all = done.wait_for(lock, std::chrono::seconds(10), [&] { return callbacks == urls.size(); });
+    lock.unlock();
+    fetcher.stop();
+    return all;
+}
+
+} // namespace
+
+int main() {
+    std::string path = (std::filesystem::temp_directory_path() / "test_replay_fetcher.warc").string();
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        warc_record(out, "resource", "https://corpus.example/a", "<html><a href=\"/b\">b</a></html>");
+        warc_record(out, "response", "https://corpus.example/b",
+                    "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\n<html>page b</html>");
+        warc_record(out, "response", "https://corpus.example/old",
+                    "HTTP/1.1 301 Moved Permanently\r\nLocation: /b\r\n\r\n");
+        warc_record(out, "response", "https://corpus.example/loop1",
+                    "HTTP/1.1 302 Found\r\nLocation: https://corpus.example/loop2\r\n\r\n");
+        warc_record(out, "response", "https://corpus.example/loop2",
+                    "HTTP/1.1 302 Found\r\nLocation: https://corpus.example/loop1\r\n\r\n");
+        warc_record(out, "metadata", "https://corpus.example/meta", "ignored");
+    }
+
+    ReplayOptions options;
+    options.corpus = path;
+    options.hosts = 3;
+    options.pages_per_host = 10;
+    options.latency_median_ms = 1;
+    options.latency_p99_ms = 5;
+    options.page_kb_median = 2;
+    options.page_kb_p99 = 4;
+    options.error_rate = 0.2;
+    options.timeout_rate = 0;
+    options.seed = 7;
+
+    std::vector<std::string> urls = {
+        "https://corpus.example/a", "https://corpus.example/b", "https://corpus.example/old",
+        "https://corpus.example/loop1", "https://corpus.example/missing", "https://nowhere.example/",
+        "https://site1.replay.test/p/999",
+    };
+    for (int page = 1; page < 10; page++) {
+        urls.push_back("https://site0.replay.test/p/" + std::to_string(page));
+        urls.push_back("https://site2.replay.test/p/" + std::to_string(page));
+    }
+
+    // Two runs agree on every response and every callback arrives
+    std::map<std::string, FetchResult> first, second;
+    size_t first_callbacks = 0, second_callbacks = 0;
+    assert(replay(options, urls, first, first_callbacks));
+    assert(replay(options, urls, second, second_callbacks));
+    assert(first_callbacks == urls.size() && second_callbacks == urls.size());
+    size_t errors = 0;
+    for (const auto& url : urls) {
+        const FetchResult& a = first.at(url);
+        const FetchResult& b = second.at(url);
+        assert(a.success == b.success && a.http_status == b.http_status);
+        assert(a.content == b.content && a.final_url == b.final_url);
+        assert(a.redirects == b.redirects && a.error_message == b.error_message);
+        if (a.http_status == 503) errors++;
+    }
+    assert(errors > 0 && errors < urls.size());
+
+    // Redirects are followed to the recorded page, loops give up
+    const FetchResult& moved = first.at("https://corpus.example/old");
+    if (moved.http_status != 503) {
+        assert(moved.success && moved.content == "<html>page b</html>");
+        assert(moved.final_url == "https://corpus.example/b");
+        assert(moved.redirects == std::vector<std::string>{"https://corpus.example/b"});
+    }
+    const FetchResult& loop = first.at("https://corpus.example/loop1");
+    if (loop.http_status != 503) {
+        assert(!loop.success && loop.error_message == "Too many redirects");
+    }
+
+    // Unknown URLs fail instead of hanging
+    for (const char* url : {"https://corpus.example/missing", "https://nowhere.example/",
+                            "https://site1.replay.test/p/999"}) {
+        const FetchResult& missing = first.at(url);
+        assert(!missing.success);
+        assert(missing.http_status == 404 || missing.http_status == 503);
+    }
+
+    // Without injected errors every known page is served
+    options.error_rate = 0;
+    std::map<std::string, FetchResult> clean;
+    size_t clean_callbacks = 0;
+    assert(replay(options, urls, clean, clean_callbacks));
+    assert(clean.at("https://corpus.example/a").content == "<html><a href=\"/b\">b</a></html>");
+    assert(clean.at("https://corpus.example/old").final_url == "https://corpus.example/b");
+    assert(clean.at("https://corpus.example/loop1").error_message == "Too many redirects");
+    assert(clean.at("https://nowhere.example/").http_status == 404);
+    assert(clean.at("https://site0.replay.test/p/3").success);
+    assert(!clean.at("https://site0.replay.test/p/3").content.empty());
+
+    std::remove(path.c_str());
+    return 0;
+}
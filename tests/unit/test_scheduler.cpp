@@ -0,0 +1,72 @@
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "../../src/scheduler/scheduler.h"
+#include "../../src/utils/config.h"
+
+using namespace crawler;
+
+// Next task once its retry delay and host backoff have passed
+static bool next_task(Scheduler& scheduler, CrawlTask& task) {
+    for (int i = 0; i < 200; i++) {
+        if (scheduler.get_next_task(task)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+int main() {
+    std::string dir = (std::filesystem::temp_directory_path() / "test_scheduler").string();
+    std::filesystem::create_directories(dir);
+    std::string config_path = dir + "/config.yaml";
+    {
+        std::ofstream out(config_path);
+        out << "scheduler:\n  max_retries: 3\n  retry_backoff_ms: 1\n"
+            << "frontier:\n  spill_to_disk: false\n"
+            << "rate_limit:\n  enabled: false\n";
+    }
+    assert(Config::instance().load(config_path));
+    
+    // Canonical URLs only; invalid ones are refused
+    Scheduler scheduler;
+    assert(!scheduler.add_url("not a url"));
+    assert(scheduler.add_url("HTTP://Example.com/a#top"));
+    assert(scheduler.queue_size() == 1);
+    
+    // Retrying by URL keeps the dispatched task's count: one first attempt
+    // plus max_retries retries, then the task fails for good
+    CrawlTask task;
+    int attempts = 0;
+    while (!scheduler.idle()) {
+        assert(next_task(scheduler, task));
+        assert(task.url == "http://example.com/a");
+        assert(task.retry_count == attempts);
+        attempts++;
+        scheduler.mark_failed(task.url, true);
+    }
+    assert(attempts == 4);
+    assert(scheduler.total_failed() == 1);
+    assert(scheduler.active_tasks() == 0);
+    
+    // Completion clears the task
+    assert(scheduler.add_url("http://example.com/b"));
+    assert(next_task(scheduler, task));
+    scheduler.mark_completed(task.url);
+    assert(scheduler.idle() && scheduler.total_completed() == 1);
+    
+    // Requeueing returns the task as it was: no retry counted
+    assert(scheduler.add_url("http://example.com/c"));
+    assert(next_task(scheduler, task));
+    scheduler.requeue(task);
+    assert(scheduler.active_tasks() == 0 && scheduler.queue_size() == 1);
+    assert(next_task(scheduler, task));
+    assert(task.url == "http://example.com/c" && task.retry_count == 0);
+    scheduler.mark_completed(task.url);
+    assert(scheduler.idle() && scheduler.total_failed() == 1);
+    
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <cassert>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include "../../src/api/search_handler.h"
+#include "../../src/parser/tokenizer.h"
+
+using namespace crawler;
+
+static ParsedDocument make_doc(const std::string& url, const std::string& text) {
+    ParsedDocument doc;
+    doc.url = url;
+    doc.title = "Title of " + url;
+    doc.text_content = text;
+    doc.token_buffer.assign(text.begin(), text.end());
+    Tokenizer::tokenize(doc.token_buffer.data(), doc.token_buffer.size(), doc.tokens);
+    for (size_t i = 0; i < doc.tokens.size(); i++) {
+        doc.term_positions[doc.tokens[i]].push_back(i);
+    }
+    return doc;
+}
+
+int main() {
+    std::string dir = std::filesystem::temp_directory_path().string() +
+                      "/test_search_handler_" + std::to_string(getpid());
+    std::filesystem::remove_all(dir);
+    {
+        Indexer indexer(dir);
+        indexer.index_document(make_doc("http://a.example/", "laptop and phone"));
+        indexer.index_document(make_doc("http://b.example/", "phone only"));
+        indexer.refresh();
+        QueryCache cache(1024 * 1024);
+
+        // Both share a cache entry, but each gets its own query echoed
+        SearchRequest first;
+        first.query = "LAPTOP  Phone";
+        std::string first_body;
+        write_search_response(indexer, cache, first, first_body);
+        std::string first_echo = "{\"query\":\"LAPTOP  Phone\",";
+        assert(first_body.compare(0, first_echo.size(), first_echo) == 0);
+        assert(first_body.find("http://a.example/") != std::string::npos);
+        assert(cache.hits() == 0);
+
+        SearchRequest second;
+        second.query = "phone laptop";
+        std::string second_body;
+        write_search_response(indexer, cache, second, second_body);
+        std::string second_echo = "{\"query\":\"phone laptop\",";
+        assert(second_body.compare(0, second_echo.size(), second_echo) == 0);
+        assert(cache.hits() == 1);
+        assert(first_body.substr(first_echo.size()) == second_body.substr(second_echo.size()));
+        assert(second_body.back() == '}');
+
+        // A new generation is computed afresh, still with its own echo
+        indexer.index_document(make_doc("http://c.example/", "laptop"));
+        indexer.refresh();
+        std::string third_body;
+        write_search_response(indexer, cache, second, third_body);
+        assert(third_body.compare(0, second_echo.size(), second_echo) == 0);
+        assert(third_body.find("http://c.example/") != std::string::npos);
+        assert(cache.hits() == 1);
+    }
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../../src/dedup/simhash.h"
+#include "../../src/parser/tokenizer.h"
+
+// Token views into a buffer kept alive alongside them
+struct Words {
+    std::string buffer;
+    std::vector<std::string_view> tokens;
+};
+
+static Words words(const std::string& text) {
+    Words out;
+    out.buffer = text;
+    crawler::Tokenizer::tokenize(out.buffer.data(), out.buffer.size(), out.tokens);
+    return out;
+}
+
+int main() {
+    using namespace crawler;
+    
+    // ~4000 words of product page, then a timestamp that changes per fetch
+    std::string body;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 4000; i++) {
+        seed = seed * 1103515245 + 12345;
+        body += "w" + std::to_string((seed >> 16) % 5000) + " ";
+    }
+    auto page = words(body + "updated at 10:32:01 session abc123");
+    auto same_page_later = words(body + "updated at 11:05:47 session abc123");
+    auto other_page = words("a completely different article about crawling the web "
+                            "with a politeness frontier and a bloom filter for urls " + body.substr(0, 200));
+    
+    uint64_t a = SimHash::compute(page.tokens);
+    uint64_t b = SimHash::compute(same_page_later.tokens);
+    uint64_t c = SimHash::compute(other_page.tokens);
+    
+    // Case-insensitive (via the tokenizer) and deterministic
+    assert(SimHash::compute(words("Hello World Again").tokens) ==
+           SimHash::compute(words("hello world again").tokens));
+    assert(SimHash::distance(a, b) <= 3);
+    assert(SimHash::distance(a, c) > 3);
+    
+    NearDupIndex index(3);
+    assert(!index.check_and_insert(a));
+    assert(index.check_and_insert(b));   // near-dup of a, not inserted
+    assert(!index.check_and_insert(c));
+    assert(index.size() == 2);
+    
+    // Anything within the distance is found whichever bits differ
+    assert(index.contains_near(a ^ 0x8000000000000001ULL ^ (1ULL << 31)));
+    assert(!index.contains_near(a ^ 0xF0F0ULL));
+    
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <cassert>
+#include <string>
+#include <vector>
+#include "../../src/utils/string_arena.h"
+
+int main() {
+    using namespace crawler;
+    
+    // Strings read back as written, across chunk boundaries
+    StringArena arena(256);
+    std::vector<StringArena::Ref> refs;
+    for (int i = 0; i < 100; i++) {
+        refs.push_back(arena.add("https://example.com/page/" + std::to_string(i)));
+    }
+    assert(arena.live_strings() == 100);
+    assert(arena.chunk_count() > 1);
+    for (int i = 0; i < 100; i++) {
+        assert(arena.get(refs[i]) == "https://example.com/page/" + std::to_string(i));
+    }
+    assert(arena.get(arena.add("")).empty());
+    
+    // A chunk goes away once all its strings are released; the one being
+    // filled stays
+    size_t chunks = arena.chunk_count();
+    for (int i = 0; i < 50; i++) {
+        arena.release(refs[i]);
+    }
+    assert(arena.chunk_count() < chunks);
+    for (int i = 50; i < 100; i++) {
+        assert(arena.get(refs[i]) == "https://example.com/page/" + std::to_string(i));
+        arena.release(refs[i]);
+    }
+    assert(arena.live_strings() == 1);
+    assert(arena.chunk_count() == 1);
+    
+    // Oversized strings get their own chunk; freed chunks are reused
+    std::string big(1000, 'x');
+    StringArena::Ref big_ref = arena.add(big);
+    assert(arena.get(big_ref) == big);
+    arena.release(big_ref);
+    size_t allocated = arena.bytes_allocated();
+    for (int i = 0; i < 20; i++) {
+        arena.release(arena.add(std::string(100, 'y')));
+    }
+    assert(arena.bytes_allocated() <= allocated + 256);
+    
+    return 0;
+}
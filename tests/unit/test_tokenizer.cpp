@@ -0,0 +1,52 @@
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../../src/parser/tokenizer.h"
+
+using crawler::Tokenizer;
+
+static std::vector<std::string> tokens_of(std::string text, bool scalar = false) {
+    std::vector<std::string_view> views;
+    if (scalar) {
+        Tokenizer::tokenize_scalar(text.data(), text.size(), views);
+    } else {
+        Tokenizer::tokenize(text.data(), text.size(), views);
+    }
+    return std::vector<std::string>(views.begin(), views.end());
+}
+
+int main() {
+    using V = std::vector<std::string>;
+    
+    assert(tokens_of("") == V{});
+    assert(tokens_of("  ,.;  ") == V{});
+    assert(tokens_of("Hello, World! 42 times") == (V{"hello", "world", "42", "times"}));
+    assert(tokens_of("snake_case and-dash") == (V{"snake", "case", "and", "dash"}));
+    
+    // UTF-8 letters stay inside words; Latin-1 capitals are lowercased
+    assert(tokens_of("Café MÜLLER naïve") == (V{"café", "müller", "naïve"}));
+    // Unicode spaces and punctuation separate words
+    assert(tokens_of("one two—three “four”、five") ==
+           (V{"one", "two", "three", "four", "five"}));
+    assert(tokens_of("\xEF\xBB\xBFstart") == V{"start"});
+    
+    // Views point into the (lowercased in place) buffer
+    std::string buffer = "ABC def";
+    std::vector<std::string_view> views;
+    Tokenizer::tokenize(buffer.data(), buffer.size(), views);
+    assert(buffer == "abc def");
+    assert(views.size() == 2 && views[0].data() == buffer.data());
+    
+    // SIMD and scalar agree across block boundaries and mixed content
+    std::string text;
+    const char* pieces[] = {"Lorem", " ", "IPSUM", ", ", "dolor", "’s ", "sit-amet",
+                            " 2024 ", "Straße", " ", "ÉCOLE", "   ", "x", "テスト", "."};
+    for (int round = 0; round < 200; round++) {
+        text += pieces[(round * 7) % 15];
+        text += pieces[(round * 11 + 3) % 15];
+        assert(tokens_of(text) == tokens_of(text, true));
+    }
+    
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <cassert>
+#include <string>
+#include <thread>
+#include "../../src/observability/trace.h"
+#include "../../src/observability/metrics.h"
+#include "../../src/api/json_writer.h"
+
+int main() {
+    using namespace crawler;
+
+    auto& tracer = Tracer::instance();
+    tracer.configure(5, 2);
+
+    // Laps charge the time since the previous mark to a stage
+    TaskTrace trace;
+    trace.begin();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    trace.lap(TraceStage::PARSE_QUEUE);
+    trace.add(TraceStage::DNS, 1.5);
+    trace.lap(TraceStage::PARSE);
+    assert(trace.has(TraceStage::PARSE_QUEUE) && trace.has(TraceStage::DNS));
+    assert(!trace.has(TraceStage::STORAGE));
+    assert(trace.stage_ms[static_cast<size_t>(TraceStage::PARSE_QUEUE)] >= 10);
+    assert(trace.total_ms() >= 10);
+
+    // Stages a task never reached are not recorded
+    TaskTrace fast;
+    fast.begin();
+    fast.lap(TraceStage::PARSE);
+    tracer.record("http://fast.example/", fast);
+    for (int i = 0; i < 3; i++) {
+        tracer.record("http://slow.example/" + std::to_string(i), trace);
+    }
+    auto& metrics = Metrics::instance();
+    assert(metrics.histogram("pipeline_task_ms").snapshot().count == 4);
+    assert(metrics.histogram("pipeline_stage_parse_ms").snapshot().count == 4);
+    assert(metrics.histogram("pipeline_stage_dns_ms").snapshot().count == 3);
+    assert(metrics.histogram("pipeline_stage_storage_ms").snapshot().count == 0);
+
+    // Only the most recent slow tasks are kept, newest first
+    std::string body;
+    JsonWriter json(body);
+    json.begin_object();
+    tracer.write_json(json);
+    json.end_object();
+    assert(body.find("\"stages\":{\"fetch_wait\":{\"count\":0") != std::string::npos);
+    assert(body.find("fast.example") == std::string::npos);
+    assert(body.find("slow.example/0") == std::string::npos);
+    assert(body.find("slow.example/2") < body.find("slow.example/1"));
+    assert(body.find("\"stages_ms\":{\"dns\":1.5,") != std::string::npos);
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <string>
 #include "../../src/utils/url_utils.h"
 
 int main() {
@@ -6,9 +7,43 @@ int main() {
     
     // Test canonicalize
     assert(UrlUtils::canonicalize("https://example.com/page#fragment") == "https://example.com/page");
+    assert(UrlUtils::canonicalize("HTTPS://Example.COM:443/a/./b/../c?z=1&a=2&&b=%7e#top") ==
+           "https://example.com/a/c?a=2&b=~&z=1");
+    assert(UrlUtils::canonicalize("http://example.com:8080") == "http://example.com:8080/");
+    assert(UrlUtils::canonicalize("http://example.com:80/a%2fb%41/x y") == "http://example.com/a%2FbA/x%20y");
+    assert(UrlUtils::canonicalize("http://example.com/a/b/../../..") == "http://example.com/");
+    assert(UrlUtils::canonicalize("http://example.com/?b=2&a=1&b=1") == "http://example.com/?a=1&b=2&b=1");
+    assert(UrlUtils::canonicalize("http://example.com/?") == "http://example.com/");
     
     // Test extract_domain
     assert(UrlUtils::extract_domain("https://example.com/page") == "example.com");
+    assert(UrlUtils::extract_domain("https://user@Example.com:8443/page") == "example.com:8443");
+    assert(UrlUtils::extract_domain("https://example.com:443") == "example.com");
+    assert(UrlUtils::extract_domain("/relative").empty());
+    
+    // Parse exposes components viewing into the caller's buffer
+    std::string buffer;
+    ParsedUrl parsed;
+    assert(UrlUtils::parse("http://u:p@[::1]:8080/x/../y?q=1#f", buffer, parsed));
+    assert(buffer == "http://u:p@[::1]:8080/y?q=1");
+    assert(parsed.scheme == "http" && parsed.userinfo == "u:p" && parsed.host == "[::1]");
+    assert(parsed.port == "8080" && parsed.path == "/y" && parsed.query == "q=1");
+    assert(parsed.authority() == "[::1]:8080");
+    assert(parsed.host_id == UrlUtils::hash_host("[::1]:8080"));
+    assert(UrlUtils::host_id("HTTP://[::1]:8080/other") == parsed.host_id);
+    assert(!UrlUtils::parse("mailto:someone@example.com", buffer, parsed));
+    assert(!UrlUtils::parse("http://exa mple.com/", buffer, parsed));
+    assert(!UrlUtils::parse("http://example.com:99999/", buffer, parsed));
+    
+    // Test resolve
+    std::string base = "http://example.com/dir/page.html?x=1";
+    assert(UrlUtils::resolve(base, "other.html") == "http://example.com/dir/other.html");
+    assert(UrlUtils::resolve(base, "/root") == "http://example.com/root");
+    assert(UrlUtils::resolve(base, "//cdn.example/lib.js") == "http://cdn.example/lib.js");
+    assert(UrlUtils::resolve(base, "?y=2") == "http://example.com/dir/page.html?y=2");
+    assert(UrlUtils::resolve(base, "../up") == "http://example.com/up");
+    assert(UrlUtils::resolve(base, "#frag") == "http://example.com/dir/page.html?x=1");
+    assert(UrlUtils::resolve(base, " https://other.example/a ") == "https://other.example/a");
     
     // Test normalize
     std::string normalized = UrlUtils::normalize("HTTPS://EXAMPLE.COM/PAGE/");
@@ -17,6 +52,7 @@ int main() {
     // Test is_valid
     assert(UrlUtils::is_valid("https://example.com"));
     assert(!UrlUtils::is_valid("not a url"));
+    assert(!UrlUtils::is_valid("ftp://example.com/file"));
     
     return 0;
 }
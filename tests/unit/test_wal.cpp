@@ -0,0 +1,116 @@
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../../src/storage/wal.h"
+#include "../../src/storage/storage.h"
+
+int main() {
+    using namespace crawler;
+    
+    std::string dir = (std::filesystem::temp_directory_path() / "test_wal").string();
+    std::filesystem::remove_all(dir);
+    
+    auto read_all = [](WriteAheadLog& wal, uint64_t from_lsn) {
+        std::vector<std::string> records;
+        bool ok = wal.replay(from_lsn, [&](uint8_t type, uint64_t lsn, std::string_view payload) {
+            records.push_back(std::to_string(type) + ":" + std::to_string(lsn) + ":" + std::string(payload));
+        });
+        assert(ok);
+        return records;
+    };
+    
+    // Records come back in order after a restart; tiny segments force rotation
+    {
+        WriteAheadLog wal(dir, 64, 5);
+        assert(wal.open());
+        assert(wal.append(1, "first") == 1);
+        assert(wal.append(2, "") == 2);
+        uint64_t lsn = 0;
+        for (int i = 0; i < 20; i++) {
+            lsn = wal.append(3, "record " + std::to_string(i));
+            if (i % 5 == 4) assert(wal.sync(lsn));
+        }
+        assert(lsn == 22);
+        assert(wal.segment_count() > 1);
+        
+        // Records without a sync between them share a commit
+        assert(wal.commits() < 22);
+    }
+    {
+        WriteAheadLog wal(dir, 64, 5);
+        assert(wal.open());
+        assert(wal.next_lsn() == 23);
+        auto records = read_all(wal, 0);
+        assert(records.size() == 22);
+        assert(records[0] == "1:1:first");
+        assert(records[1] == "2:2:");
+        assert(records[21] == "3:22:record 19");
+        assert(read_all(wal, 20).size() == 3);
+        
+        // Segments below a checkpoint go; the ones that reach it stay
+        size_t segments = wal.segment_count();
+        wal.truncate(20);
+        assert(wal.segment_count() < segments);
+        auto rest = read_all(wal, 20);
+        assert(rest.size() == 3 && rest[0] == "3:20:record 17");
+    }
+    
+    // A torn last record is cut off and its LSN reused
+    {
+        std::string last;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().string() > last) last = entry.path().string();
+        }
+        std::ofstream(last, std::ios::binary | std::ios::app) << std::string("\x10\0\0\0garbage", 11);
+        
+        WriteAheadLog wal(dir, 64, 5);
+        assert(wal.open());
+        assert(wal.next_lsn() == 23);
+        assert(wal.sync(wal.append(4, "after")));
+        auto records = read_all(wal, 22);
+        assert(records.size() == 2 && records[1] == "4:23:after");
+    }
+    std::filesystem::remove_all(dir);
+    
+    // Checkpoints round-trip and replace each other whole
+    {
+        Storage storage(dir);
+        CrawlCheckpoint checkpoint;
+        assert(!storage.load_checkpoint(checkpoint));
+        
+        checkpoint.wal_lsn = 42;
+        checkpoint.index_next_doc_id = 7;
+        for (const char* url : {"https://a.com/x/1", "https://a.com/x/2", "https://b.com/"}) {
+            CrawlTask task;
+            task.url = url;
+            task.priority = -1;
+            task.retry_count = 2;
+            checkpoint.frontier.push_back(task);
+        }
+        assert(storage.save_checkpoint(checkpoint));
+        checkpoint.wal_lsn = 43;
+        assert(storage.save_checkpoint(checkpoint));
+        
+        CrawlCheckpoint loaded;
+        assert(storage.load_checkpoint(loaded));
+        assert(loaded.wal_lsn == 43 && loaded.index_next_doc_id == 7);
+        assert(loaded.frontier.size() == 3);
+        assert(loaded.frontier[1].url == "https://a.com/x/2");
+        assert(loaded.frontier[2].url == "https://b.com/");
+        assert(loaded.frontier[0].priority == -1 && loaded.frontier[0].retry_count == 2);
+        
+        // A damaged checkpoint is refused rather than half-loaded
+        std::string path = dir + "/checkpoints/latest.ckpt";
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(30);
+        file.put('X');
+        file.close();
+        assert(!storage.load_checkpoint(loaded));
+    }
+    std::filesystem::remove_all(dir);
+    
+    return 0;
+}